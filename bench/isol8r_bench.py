@@ -0,0 +1,463 @@
+#!/usr/bin/env python3
+"""
+End-to-end cost of a request through the sandtrap, measured instead of
+guessed. Drives the two binaries directly with synthetic corpora and then
+the Python entry points the web tier actually calls:
+
+    echo         sandboxed_echo, one process per line
+    echo-serve   sandboxed_echo --serve, one resident process per client
+    vmmgr        tiny_vmmgr, one process per payload
+    run_echo     src.utils.jail_sandbox.run_echo()
+    vm_payloads  PythonJail._launch_vm_payloads()
+    keywords     PythonJail.check_banned_keywords(), per-keyword substring
+                 checks ("py") against libisol8r_scan ("lib") when it is built
+    startup      exec-to-first-read latency of each binary's one-shot mode,
+                 default against ISOL8R_FAST_START=1
+
+For every corpus it reports p50/p99 latency, requests per second at the
+chosen concurrency, and the per-stage breakdown the binaries print when
+ISOL8R_STAGE_TIMINGS=1 (spawn is our pre-fork timestamp subtracted from the
+binary's own startup clock; both are CLOCK_MONOTONIC).
+
+For startup the latency column is the time from our pre-spawn timestamp
+to the binary's read stage completing, with stdin a regular file so the
+read itself never waits: everything a launch costs before the payload is in
+hand. Runs are sequential, alternating modes, whatever --concurrency says.
+--startup-budget-us makes the run fail when a fast-start p50 exceeds it.
+
+Build the binaries first (the Dockerfile gcc lines), then e.g.::
+
+    python3 bench/isol8r_bench.py --iterations 500 --concurrency 4
+    python3 bench/isol8r_bench.py --targets vmmgr --json > bench_output.txt
+    python3 bench/isol8r_bench.py --targets startup -n 1000 --startup-budget-us 2000
+
+Bait log writes go wherever the binaries were compiled to send them; the
+Python targets log into a scratch directory so the real log stays clean.
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import Callable, Dict, List, Optional, Sequence, Tuple
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+if str(REPO_ROOT) not in sys.path:
+    sys.path.insert(0, str(REPO_ROOT))
+
+DEFAULT_ECHO_BIN = REPO_ROOT / "src" / "core" / "jail_binaries" / "sandboxed_echo"
+DEFAULT_VMMGR_BIN = REPO_ROOT / "src" / "core" / "pwnables" / "tiny_vmmgr"
+
+STAGES = ("spawn", "read", "inspect", "log", "execute")
+_STAGE_LINE = re.compile(rb"\[isol8r-stages\] program=\S+ start_ns=(\d+) read_ns=(\d+) "
+                         rb"inspect_ns=(\d+) log_ns=(\d+) execute_ns=(\d+)")
+
+# tiny_vmmgr rejects a read that fills its whole 4096-byte buffer, so the
+# largest payload it will run is one byte short of that.
+VMMGR_MAX_PAYLOAD = 4095
+
+# ----------------------------------------------------------------- corpora --
+
+
+def echo_corpora() -> Dict[str, List[bytes]]:
+    benign = [f"status report {i}: coffee levels nominal, nothing to see\n".encode() for i in range(64)]
+    keyword = [
+        f"cat /flag{i}; bash -c 'exec sh' && ptrace mmap syscall write\n".encode() for i in range(64)
+    ]
+    long_line = [(b"x" * 500) + b" FLAG\n"]
+    return {"benign": benign, "keyword-heavy": keyword, "max-line": long_line}
+
+
+def vmmgr_corpora() -> Dict[str, List[bytes]]:
+    # Every payload ends in `ret` so the harness returns instead of crashing.
+    max_size = [b"\x90" * (VMMGR_MAX_PAYLOAD - 1) + b"\xc3"]
+    with_nuls = [b"\x90\xc3" + b"\x00" * 254]
+    small = [b"\x90" * 31 + b"\xc3"]
+    bait = [b"\x90" * 64 + b"\x0f\x05" + b"\xc3"]
+    return {"small": small, "max-size": max_size, "nul-bytes": with_nuls, "bait": bait}
+
+
+def keyword_corpora() -> Dict[str, List[bytes]]:
+    benign = [f"total = sum(range({i}))\nprint(total * 2)\n".encode() for i in range(64)]
+    banned = [f"import os\nprint(os.listdir('/'), eval('{i}'))\n".encode() for i in range(64)]
+    large = [b"values = [x * x for x in range(50)]\n" * 120]
+    return {"benign": benign, "banned": banned, "large": large}
+
+
+# ----------------------------------------------------------------- results --
+
+
+class Sample:
+    __slots__ = ("latency", "stages", "ok")
+
+    def __init__(self, latency: float, stages: Optional[Dict[str, float]], ok: bool) -> None:
+        self.latency = latency
+        self.stages = stages
+        self.ok = ok
+
+
+def _percentile(sorted_values: Sequence[float], fraction: float) -> float:
+    if not sorted_values:
+        return 0.0
+    # Nearest-rank: the smallest sample at or above the requested fraction.
+    rank = max(1, math.ceil(fraction * len(sorted_values)))
+    return sorted_values[min(rank, len(sorted_values)) - 1]
+
+
+def summarise(target: str, corpus: str, samples: List[Sample], wall: float, concurrency: int) -> Dict[str, object]:
+    latencies = sorted(sample.latency for sample in samples)
+    staged = [sample.stages for sample in samples if sample.stages]
+    stage_means = {
+        stage: (sum(entry[stage] for entry in staged) / len(staged)) * 1e6 if staged else None
+        for stage in STAGES
+    }
+    return {
+        "target": target,
+        "corpus": corpus,
+        "requests": len(samples),
+        "errors": sum(1 for sample in samples if not sample.ok),
+        "concurrency": concurrency,
+        "p50_ms": _percentile(latencies, 0.50) * 1e3,
+        "p99_ms": _percentile(latencies, 0.99) * 1e3,
+        "rps": len(samples) / wall if wall > 0 else 0.0,
+        "stages_us": stage_means,
+    }
+
+
+def print_table(rows: List[Dict[str, object]]) -> None:
+    header = f"{'target':<12} {'corpus':<14} {'n':>6} {'err':>4} {'p50 ms':>9} {'p99 ms':>9} {'req/s':>9}  stages (mean us)"
+    print(header)
+    print("-" * len(header))
+    for row in rows:
+        stages = row["stages_us"]
+        stage_text = " ".join(
+            f"{name}={value:.0f}" for name, value in stages.items() if value is not None
+        ) or "-"
+        print(
+            f"{row['target']:<12} {row['corpus']:<14} {row['requests']:>6} {row['errors']:>4} "
+            f"{row['p50_ms']:>9.3f} {row['p99_ms']:>9.3f} {row['rps']:>9.1f}  {stage_text}"
+        )
+
+
+# ----------------------------------------------------------------- drivers --
+
+
+def _stage_env() -> Dict[str, str]:
+    env = os.environ.copy()
+    env["ISOL8R_STAGE_TIMINGS"] = "1"
+    return env
+
+
+def _parse_stages(stderr: bytes, spawned_ns: int) -> Optional[Dict[str, float]]:
+    match = _STAGE_LINE.search(stderr)
+    if not match:
+        return None
+    start_ns, read_ns, inspect_ns, log_ns, execute_ns = (int(value) for value in match.groups())
+    return {
+        "spawn": max(0, start_ns - spawned_ns) / 1e9,
+        "read": read_ns / 1e9,
+        "inspect": inspect_ns / 1e9,
+        "log": log_ns / 1e9,
+        "execute": execute_ns / 1e9,
+    }
+
+
+def run_process(binary: Path, payload: bytes, timeout: float, args: Sequence[str] = ()) -> Sample:
+    env = _stage_env()
+    spawned_ns = time.monotonic_ns()
+    start = time.perf_counter()
+    try:
+        proc = subprocess.run(
+            [str(binary), *args],
+            input=payload,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            env=env,
+            timeout=timeout,
+            check=False,
+        )
+    except subprocess.TimeoutExpired:
+        return Sample(time.perf_counter() - start, None, False)
+    latency = time.perf_counter() - start
+    return Sample(latency, _parse_stages(proc.stderr, spawned_ns), proc.returncode in (0, 1))
+
+
+def drive(
+    requests: int,
+    concurrency: int,
+    payloads: List[bytes],
+    call: Callable[[bytes], Sample],
+) -> Tuple[List[Sample], float]:
+    def one(index: int) -> Sample:
+        return call(payloads[index % len(payloads)])
+
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=concurrency) as pool:
+        samples = list(pool.map(one, range(requests)))
+    return samples, time.perf_counter() - start
+
+
+class _ServeClient:
+    """One resident ``sandboxed_echo --serve`` per benchmark thread."""
+
+    def __init__(self, binary: Path) -> None:
+        self.proc = subprocess.Popen(
+            [str(binary), "--serve"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            bufsize=0,
+        )
+
+    def request(self, payload: bytes) -> Sample:
+        start = time.perf_counter()
+        self.proc.stdin.write(len(payload).to_bytes(4, "big") + payload)
+        header = self._read(4)
+        body = self._read(int.from_bytes(header, "big"))
+        return Sample(time.perf_counter() - start, None, bool(body))
+
+    def _read(self, count: int) -> bytes:
+        data = b""
+        while len(data) < count:
+            chunk = self.proc.stdout.read(count - len(data))
+            if not chunk:
+                raise EOFError("sandboxed_echo --serve hung up")
+            data += chunk
+        return data
+
+    def close(self) -> None:
+        self.proc.stdin.close()
+        self.proc.wait(timeout=5)
+
+
+def bench_echo(args: argparse.Namespace) -> List[Dict[str, object]]:
+    rows = []
+    for corpus, payloads in echo_corpora().items():
+        samples, wall = drive(args.iterations, args.concurrency, payloads,
+                              lambda payload: run_process(args.echo_bin, payload, args.timeout))
+        rows.append(summarise("echo", corpus, samples, wall, args.concurrency))
+    return rows
+
+
+def bench_echo_serve(args: argparse.Namespace) -> List[Dict[str, object]]:
+    rows = []
+    for corpus, payloads in echo_corpora().items():
+        local = threading.local()
+        clients: List[_ServeClient] = []
+        lock = threading.Lock()
+
+        def call(payload: bytes) -> Sample:
+            client = getattr(local, "client", None)
+            if client is None:
+                client = local.client = _ServeClient(args.echo_bin)
+                with lock:
+                    clients.append(client)
+            return client.request(payload)
+
+        try:
+            samples, wall = drive(args.iterations, args.concurrency, payloads, call)
+        finally:
+            for client in clients:
+                client.close()
+        rows.append(summarise("echo-serve", corpus, samples, wall, args.concurrency))
+    return rows
+
+
+def bench_vmmgr(args: argparse.Namespace) -> List[Dict[str, object]]:
+    rows = []
+    for corpus, payloads in vmmgr_corpora().items():
+        samples, wall = drive(args.iterations, args.concurrency, payloads,
+                              lambda payload: run_process(args.vmmgr_bin, payload, args.timeout))
+        rows.append(summarise("vmmgr", corpus, samples, wall, args.concurrency))
+    return rows
+
+
+def bench_run_echo(args: argparse.Namespace, scratch: Path) -> List[Dict[str, object]]:
+    from src.utils import jail_sandbox
+
+    jail_sandbox.SANDBOX_BINARY = args.echo_bin
+    jail_sandbox.LOG_PATH = scratch / "logs" / "bait.log"
+
+    def call(payload: bytes) -> Sample:
+        start = time.perf_counter()
+        result = jail_sandbox.run_echo(payload.decode("utf-8"), "127.0.0.1", timeout=args.timeout)
+        return Sample(time.perf_counter() - start, None, result.get("returncode") == 0)
+
+    rows = []
+    for corpus, payloads in echo_corpora().items():
+        samples, wall = drive(args.iterations, args.concurrency, payloads, call)
+        rows.append(summarise("run_echo", corpus, samples, wall, args.concurrency))
+    return rows
+
+
+def bench_vm_payloads(args: argparse.Namespace, scratch: Path) -> List[Dict[str, object]]:
+    from src.core.pyjail.pyjail import PythonJail
+
+    pwnables = scratch / "core" / "pwnables"
+    pwnables.mkdir(parents=True, exist_ok=True)
+    link = pwnables / "tiny_vmmgr"
+    if not link.exists():
+        link.symlink_to(args.vmmgr_bin.resolve())
+    jail = PythonJail(project_root=scratch)
+
+    def call(payload: bytes) -> Sample:
+        start = time.perf_counter()
+        outcome = jail._launch_vm_payloads([payload])[0]
+        return Sample(time.perf_counter() - start, None, outcome.get("returncode") in (0, 1))
+
+    rows = []
+    for corpus, payloads in vmmgr_corpora().items():
+        samples, wall = drive(args.iterations, args.concurrency, payloads, call)
+        rows.append(summarise("vm_payloads", corpus, samples, wall, args.concurrency))
+    return rows
+
+
+def run_startup(binary: Path, stdin_path: Path, fast: bool, timeout: float) -> Sample:
+    env = _stage_env()
+    if fast:
+        env["ISOL8R_FAST_START"] = "1"
+    else:
+        env.pop("ISOL8R_FAST_START", None)
+    with stdin_path.open("rb") as stdin:
+        spawned_ns = time.monotonic_ns()
+        try:
+            proc = subprocess.run(
+                [str(binary)],
+                stdin=stdin,
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.PIPE,
+                env=env,
+                timeout=timeout,
+                check=False,
+            )
+        except subprocess.TimeoutExpired:
+            return Sample(timeout, None, False)
+    stages = _parse_stages(proc.stderr, spawned_ns)
+    if stages is None:
+        return Sample(0.0, None, False)
+    return Sample(stages["spawn"] + stages["read"], stages, proc.returncode in (0, 1))
+
+
+def bench_startup(args: argparse.Namespace, scratch: Path) -> List[Dict[str, object]]:
+    inputs = {
+        "echo": (args.echo_bin, echo_corpora()["benign"][0]),
+        "vmmgr": (args.vmmgr_bin, vmmgr_corpora()["small"][0]),
+    }
+    rows = []
+    for name, (binary, payload) in inputs.items():
+        stdin_path = scratch / f"startup-{name}.bin"
+        stdin_path.write_bytes(payload)
+        samples: Dict[bool, List[Sample]] = {False: [], True: []}
+        walls = {False: 0.0, True: 0.0}
+        for _ in range(args.iterations):
+            for fast in (False, True):
+                start = time.perf_counter()
+                samples[fast].append(run_startup(binary, stdin_path, fast, args.timeout))
+                walls[fast] += time.perf_counter() - start
+        for fast in (False, True):
+            mode = "fast" if fast else "default"
+            rows.append(summarise("startup", f"{name}/{mode}", samples[fast], walls[fast], 1))
+    return rows
+
+
+def bench_keywords(args: argparse.Namespace, scratch: Path) -> List[Dict[str, object]]:
+    from src.core.pyjail.pyjail import PythonJail
+
+    jail = PythonJail(project_root=scratch)
+    keywords = jail.banned_keywords
+
+    def substring_check(code: str) -> Tuple[str, ...]:
+        normalized = code.lower()
+        return tuple(keyword for keyword in keywords if keyword.lower() in normalized)
+
+    engines: List[Tuple[str, Callable[[str], Tuple[str, ...]]]] = [("py", substring_check)]
+    if jail._keyword_screen[1] is not None:
+        engines.append(("lib", jail.check_banned_keywords))
+
+    rows = []
+    for corpus, payloads in keyword_corpora().items():
+        for engine, check in engines:
+            def call(payload: bytes, check: Callable[[str], Tuple[str, ...]] = check) -> Sample:
+                start = time.perf_counter()
+                check(payload.decode("utf-8"))
+                return Sample(time.perf_counter() - start, None, True)
+
+            samples, wall = drive(args.iterations, args.concurrency, payloads, call)
+            rows.append(summarise("keywords", f"{corpus}/{engine}", samples, wall, args.concurrency))
+    return rows
+
+
+TARGETS = ("echo", "echo-serve", "vmmgr", "run_echo", "vm_payloads", "keywords", "startup")
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    parser = argparse.ArgumentParser(description="Latency/throughput benchmark for the isol8r sandboxes.")
+    parser.add_argument("--targets", default=",".join(TARGETS), help=f"comma-separated subset of {', '.join(TARGETS)}")
+    parser.add_argument("--iterations", "-n", type=int, default=200, help="requests per corpus")
+    parser.add_argument("--concurrency", "-c", type=int, default=1, help="parallel clients")
+    parser.add_argument("--timeout", type=float, default=6.0, help="per-request timeout, seconds")
+    parser.add_argument("--echo-bin", type=Path, default=DEFAULT_ECHO_BIN)
+    parser.add_argument("--vmmgr-bin", type=Path, default=DEFAULT_VMMGR_BIN)
+    parser.add_argument("--json", action="store_true", help="print one JSON object per row")
+    parser.add_argument("--startup-budget-us", type=float, default=None,
+                        help="startup: exit 1 if a fast-start p50 exceeds this many microseconds")
+    args = parser.parse_args(argv)
+
+    targets = [name.strip() for name in args.targets.split(",") if name.strip()]
+    unknown = sorted(set(targets) - set(TARGETS))
+    if unknown:
+        parser.error(f"unknown targets: {', '.join(unknown)}")
+    for option, binary, users in (
+        ("--echo-bin", args.echo_bin, {"echo", "echo-serve", "run_echo", "startup"}),
+        ("--vmmgr-bin", args.vmmgr_bin, {"vmmgr", "vm_payloads", "startup"}),
+    ):
+        if users.intersection(targets) and not binary.exists():
+            parser.error(f"{binary} not found; build it first or pass {option}")
+
+    rows: List[Dict[str, object]] = []
+    with tempfile.TemporaryDirectory(prefix="isol8r-bench-") as scratch_dir:
+        scratch = Path(scratch_dir)
+        for target in targets:
+            if target == "echo":
+                rows.extend(bench_echo(args))
+            elif target == "echo-serve":
+                rows.extend(bench_echo_serve(args))
+            elif target == "vmmgr":
+                rows.extend(bench_vmmgr(args))
+            elif target == "run_echo":
+                rows.extend(bench_run_echo(args, scratch))
+            elif target == "vm_payloads":
+                rows.extend(bench_vm_payloads(args, scratch))
+            elif target == "keywords":
+                rows.extend(bench_keywords(args, scratch))
+            elif target == "startup":
+                rows.extend(bench_startup(args, scratch))
+
+    if args.json:
+        for row in rows:
+            print(json.dumps(row))
+    else:
+        print_table(rows)
+
+    if args.startup_budget_us is not None:
+        over = [row for row in rows if row["target"] == "startup" and str(row["corpus"]).endswith("/fast")
+                and row["p50_ms"] * 1e3 > args.startup_budget_us]
+        for row in over:
+            print(f"isol8r_bench: {row['corpus']} p50 {row['p50_ms'] * 1e3:.0f} us exceeds the "
+                  f"{args.startup_budget_us:.0f} us startup budget", file=sys.stderr)
+        if over:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -23,9 +23,36 @@ if ! ensure_log_dir_writable; then
   exit 0
 fi
 
-: > "${LOG_FILE}"
-{
-  echo "Nice try. Bait reset."
-  printf '💣 bait.log wiped @ %s
-' "$(date '+%Y-%m-%d %H:%M:%S %Z')"
-} >> "${LOG_FILE}"
+# The writers rotate bait.log themselves (ISOL8R_LOG_ROTATE_BYTES) and keep
+# their descriptors open, so truncating it here would only punch a hole in
+# the trail. This job just squeezes the segments they leave behind. .1 is
+# skipped: a writer that has not noticed the rotation yet may still append
+# to it for a second or so.
+KEEP="${ISOL8R_LOG_ROTATE_KEEP:-5}"
+compressed=0
+
+# Rotating writers flock bait.log without waiting; holding it keeps them
+# from shifting segments under gzip. A rotation between the open and the
+# lock leaves us holding .1 instead, hence the check and the retry; if the
+# live file keeps moving, skip this cycle rather than race the writers.
+locked=0
+for _ in 1 2 3; do
+  exec 9>>"${LOG_FILE}"
+  flock 9
+  if [[ /proc/self/fd/9 -ef "${LOG_FILE}" ]]; then
+    locked=1
+    break
+  fi
+  exec 9>&-
+done
+if ((!locked)); then
+  printf 'bait.log upkeep @ %s: could not lock %s, skipped\n' "$(date '+%Y-%m-%d %H:%M:%S %Z')" "${LOG_FILE}"
+  exit 0
+fi
+for ((index = 2; index <= KEEP; index++)); do
+  segment="${LOG_FILE}.${index}"
+  if [[ -f "${segment}" ]] && gzip -f -- "${segment}" 2>/dev/null; then
+    compressed=$((compressed + 1))
+  fi
+done
+printf 'bait.log upkeep @ %s: %d segment(s) compressed\n' "$(date '+%Y-%m-%d %H:%M:%S %Z')" "${compressed}"
@@ -99,6 +99,24 @@ log_boot_step "busybox crond started with pid ${CRON_PID}"
 declare -a PROCS
 PROCS+=("${CRON_PID}")
 
+# Detector rules shared by every sandbox; compiled once, then mmap()ed from the cache.
+export ISOL8R_RULES="${ISOL8R_RULES:-${BASE_DIR}/config/isol8r_rules.conf}"
+export ISOL8R_RULES_CACHE="${ISOL8R_RULES_CACHE:-${NGINX_TEMP_ROOT}/isol8r_rules.cache}"
+log_boot_step "Detector rules at ${ISOL8R_RULES}, cached at ${ISOL8R_RULES_CACHE}"
+
+VMMGR_BINARY="${BASE_DIR}/src/core/pwnables/tiny_vmmgr"
+VMMGR_SOCKET="${ISOL8R_VMMGR_SOCKET:-/tmp/isol8r-vmmgr.sock}"
+if [[ "${ISOL8R_VMMGR_SERVER:-1}" != "0" && -x "${VMMGR_BINARY}" ]]; then
+  "${VMMGR_BINARY}" --server "${VMMGR_SOCKET}" 2>>"${LOG_DIR}/vmmgr_server.log" &
+  VMMGR_PID=$!
+  PROCS+=("${VMMGR_PID}")
+  export ISOL8R_VMMGR_SOCKET="${VMMGR_SOCKET}"
+  log_boot_step "tiny_vmmgr fork server started with pid ${VMMGR_PID} on ${VMMGR_SOCKET} (SIGHUP rereads the rules and reopens bait.log)"
+else
+  unset ISOL8R_VMMGR_SOCKET
+  log_boot_step "tiny_vmmgr fork server disabled; payloads will spawn the binary"
+fi
+
 rm -f "${UWSGI_SOCKET}"
 log_boot_step "Removed stale uWSGI socket at ${UWSGI_SOCKET}"
 uwsgi --ini "${UWSGI_INI_PATH}" --die-on-term &
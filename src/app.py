@@ -19,7 +19,7 @@ from typing import Dict, List, Optional
 from flask import Flask, abort, flash, jsonify, redirect, render_template, request, send_file, session, url_for, Response
 from jinja2 import ChoiceLoader, FileSystemLoader
 
-from src.utils import jail_sandbox
+from src.utils import isol8r_stats, jail_sandbox
 
 BASE_DIR = Path(__file__).resolve().parent
 PROJECT_ROOT = BASE_DIR.parent
@@ -569,6 +569,13 @@ def run_python() -> "Response":
     status = 200 if not result.get("error") else 400
     return jsonify(result), status
 
+
+@app.route("/stats", methods=["GET"])
+def sandbox_stats() -> "Response":
+    _require_login()
+    # Live counters from the binaries' shared stats pages; ?buckets=1 adds the histograms.
+    return jsonify(isol8r_stats.read_all(with_buckets=request.args.get("buckets") == "1"))
+
 @app.route("/devs/")
 def devs_easter_egg():
     _require_login()
@@ -6,109 +6,1298 @@
  * suspicious (or merely enthusiastic about flags). The implementation
  * is aggressively single-purpose on purpose; fancy code invites fancy
  * mistakes, and we already have enough of those elsewhere.
+ *
+ * For the web tier's benefit it can also stay resident (--serve, or
+ * --socket PATH) and answer a stream of length-prefixed requests, one
+ * framed reply each, so nobody pays for fork/exec just to echo a line.
+ * --socket runs a single epoll loop over any number of clients, each of
+ * which may pipeline requests; a client that stops reading its replies
+ * stops being read in turn.
+ * With --record, the one-shot and serving modes answer with one structured
+ * record per request instead (see ECHO_RECORD_VERSION below), so callers
+ * decode fields rather than scrape stdout and stderr.
+ *
+ * The one-shot and --stream modes run under a CPU, wall-clock and output
+ * budget (ISOL8R_ECHO_CPU_MS, ISOL8R_ECHO_WALL_MS, ISOL8R_ECHO_OUTPUT_MAX)
+ * and exit with a status of their own when one runs out, so a stalled or
+ * endless input gives its worker back long before the caller's timeout.
+ *
+ * Keywords come from the echo scope of the rules file (ISOL8R_RULES, see
+ * isol8r_rules.h) when it has one, the compiled-in copy of that scope
+ * otherwise; the serving modes reread the file on SIGHUP and apply it from
+ * the next request.
+ *
+ * Launched once per request, startup is the whole cost, so the one-shot
+ * modes keep stdio off the request path, and ISOL8R_FAST_START=1 skips the
+ * optional setup as well (bench/isol8r_bench.py --targets startup measures
+ * what that buys).
  */
 
 #define _POSIX_C_SOURCE 200809L
 
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include "isol8r_budget.h"
+#include "isol8r_cache.h"
+#include "isol8r_log.h"
+#include "isol8r_replay.h"
+#include "isol8r_match.h"
+#include "isol8r_ring.h"
+#include "isol8r_rules.h"
+#include "isol8r_rules_builtin.h"
+#include "isol8r_stage.h"
+#include "isol8r_stats.h"
+
 #ifndef LOG_PATH
 #define LOG_PATH "/tmp/bait.log"
 #endif
 
+/* Same budget the one-shot fgets() path has always had. */
+#define ECHO_LINE_MAX 512
+
+/* Anything larger than this is drained and rejected in server mode. */
+#define ECHO_FRAME_MAX (64u * 1024u)
+
+/* --socket event loop: clients served at once, listen backlog, events per wakeup. */
+#define ECHO_MAX_CLIENTS 1024u
+#define ECHO_BACKLOG 128
+#define ECHO_EVENTS 64
+
+/* Requests answered per client per wakeup; the rest wait for the next turn. */
+#define ECHO_BURST 32
+
+/* Unsent reply bytes past which a --socket client stops being read. */
+#define ECHO_OUT_HIGH (256u * 1024u)
+
+/* Smallest read a --socket client gets; frames larger than this grow its buffer. */
+#define ECHO_READ_CHUNK 4096u
+
+/* Read size for --stream; memory use stays at one chunk however long the input. */
+#define ECHO_STREAM_CHUNK 4096u
+
+/* Default budgets for the one-shot modes; the serving modes are resident and unbudgeted. */
+#ifndef ECHO_CPU_BUDGET_MS
+#define ECHO_CPU_BUDGET_MS 1000
+#endif
+#ifndef ECHO_WALL_BUDGET_MS
+#define ECHO_WALL_BUDGET_MS 3000
+#endif
+
+/*
+ * Server-mode wire format, both directions:
+ *   u32 length (big-endian) | length bytes of body
+ * Request bodies are the raw text that would otherwise arrive on stdin.
+ * Reply bodies are one verdict byte followed by the echoed line.
+ */
+enum echo_verdict {
+    ECHO_VERDICT_BORING = 0,
+    ECHO_VERDICT_SUSPICIOUS = 1,
+    ECHO_VERDICT_EMPTY = 2,
+    ECHO_VERDICT_REJECTED = 3,
+};
+
+/*
+ * --record output, one per request: in the serving modes it replaces the
+ * reply body above, in the one-shot mode it is all that reaches stdout
+ * (stderr stays quiet unless a budget runs out). Big-endian throughout:
+ *   u32 length | u8 version | u8 verdict | u16 labels_len | u32 hits
+ *   | u32 echo_len | u64 input_len | u64 read_ns | u64 inspect_ns
+ *   | u64 log_ns | echo_len bytes of echo | labels_len bytes of labels
+ * hits has bit i set for every keyword id i that matched; labels names
+ * them, comma-separated, in id order. input_len is the request as sent
+ * (in the one-shot mode, as read), before the echo was cut to one line. The times are
+ * CLOCK_MONOTONIC nanoseconds spent reading, scanning and logging.
+ */
+#define ECHO_RECORD_VERSION 1u
+#define ECHO_RECORD_HEADER 48u
+
+/* Per-request phase times carried in a record. */
+struct echo_timing {
+    uint64_t read_ns;
+    uint64_t inspect_ns;
+    uint64_t log_ns;
+};
+
+/* Set by --record. */
+static int record_output;
+
+/*
+ * ISOL8R_FAST_START=1, honoured by the one-shot modes: as little as possible
+ * between exec and the first read. No stats page and no tty probe, and the
+ * rules file is not read: the compiled-in keywords are used as they are.
+ */
+static int fast_start;
+
 static void die(const char *message) {
     fprintf(stderr, "[sandboxed_echo] fatal: %s\n", message);
     exit(EXIT_FAILURE);
 }
 
-static void append_log(const char *tag, const char *payload) {
-    FILE *log = fopen(LOG_PATH, "a");
-    if (!log) {
-        return;
+static struct isol8r_log bait_log = ISOL8R_LOG_INIT(LOG_PATH);
+
+/* Optional structured event store (ISOL8R_EVENT_RING); disabled by default. */
+static struct isol8r_ring event_ring = ISOL8R_RING_INIT;
+
+static struct isol8r_budget echo_budget = {
+    .cpu_ms = ECHO_CPU_BUDGET_MS,
+    .wall_ms = ECHO_WALL_BUDGET_MS,
+    .output_max = 0,
+};
+
+static const char *keyword_label(uint32_t pattern_id);
+
+/*
+ * Records one event. payload_length is the size of the whole input, which
+ * in stream mode is more than the text logged; pattern_id is the first
+ * keyword that matched, or ISOL8R_RING_NO_PATTERN. Per-request records are
+ * repeatable: while the flusher runs, a burst of identical ones (same tag,
+ * keyword and text) costs one record plus a repeat count per window; the
+ * text is part of the key, so distinct lines are all written. Notices never
+ * coalesce.
+ */
+static void log_event(const char *tag, const char *payload, uint64_t payload_length, uint32_t pattern_id,
+                      int repeatable) {
+    if (isol8r_ring_enabled(&event_ring)) {
+        isol8r_ring_append(&event_ring, ISOL8R_RING_SOURCE_ECHO, tag, pattern_id,
+                           payload, strlen(payload), payload_length, 0);
+        if (event_ring.exclusive) {
+            return;
+        }
     }
 
-    time_t now = time(NULL);
-    struct tm *stamp = gmtime(&now);
-    if (!stamp) {
-        fclose(log);
+    char prefix[ISOL8R_TIMESTAMP_MAX + 64];
+    size_t prefix_len = isol8r_log_timestamp(prefix, bait_log.millis);
+
+    size_t tag_len = strlen(tag);
+    if (prefix_len + tag_len + 6 >= sizeof(prefix)) {
         return;
     }
+    memcpy(prefix + prefix_len, " | ", 3);
+    memcpy(prefix + prefix_len + 3, tag, tag_len);
+    memcpy(prefix + prefix_len + 3 + tag_len, " | ", 3);
+    prefix_len += tag_len + 6;
+
+    struct iovec record[3] = {
+        { .iov_base = prefix, .iov_len = prefix_len },
+        { .iov_base = (void *)payload, .iov_len = strlen(payload) },
+        { .iov_base = "\n", .iov_len = 1 },
+    };
+    const struct isol8r_log_key key = {
+        .source = "sandboxed_echo",
+        .tag = tag,
+        .pattern = pattern_id,
+        .label = pattern_id != ISOL8R_RING_NO_PATTERN ? keyword_label(pattern_id) : NULL,
+        .client = NULL,
+        .digest = isol8r_cache_hash(payload, strlen(payload), 0),
+    };
+    isol8r_log_event(&bait_log, repeatable ? &key : NULL, record, 3);
+}
+
+static void append_log(const char *tag, const char *payload) {
+    log_event(tag, payload, strlen(payload), ISOL8R_RING_NO_PATTERN, 0);
+}
 
-    char buffer[64];
-    if (strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", stamp) == 0) {
-        fclose(log);
+/*
+ * Built-in keywords: the echo scope of config/isol8r_rules.conf, compiled
+ * into isol8r_rules_builtin.h at build time (isol8r_rulegen) as a ready
+ * automaton, so nothing is built at startup. Used whenever the rules file
+ * has no echo scope; a rules file identical to the compiled-in one is
+ * served from the same tables.
+ */
+_Static_assert(ISOL8R_BUILTIN_ECHO_COUNT <= 32, "keyword hit mask is 32 bits wide");
+
+/* Keywords in force: the rules file's echo scope when loaded, else the compiled-in one. */
+static struct isol8r_rules keyword_rules;
+static const struct isol8r_matcher *keyword_matcher = &isol8r_builtin_rules.scopes[ISOL8R_RULES_ECHO].matcher;
+
+/*
+ * Verdicts of recently seen lines, serving modes only, keyed to the
+ * automaton that produced them by keyword_version.
+ */
+static struct isol8r_cache verdict_cache = ISOL8R_CACHE_INIT;
+static uint64_t keyword_version;
+
+/* Set by SIGHUP in the serving modes; checked before each request. */
+static volatile sig_atomic_t reload_requested;
+
+static const char *keyword_label(uint32_t pattern_id) {
+    const struct isol8r_rule_set *set = &keyword_rules.scopes[ISOL8R_RULES_ECHO];
+    return set->count > 0 ? set->rules[pattern_id].label : isol8r_builtin_echo_rules[pattern_id].label;
+}
+
+/* Loads (or, after SIGHUP, reloads) the rules file; a bad file changes nothing. */
+static void load_keyword_rules(int reload) {
+    const int rc = reload ? isol8r_rules_reload(&keyword_rules, "sandboxed_echo")
+                          : isol8r_rules_from_env(&keyword_rules, "sandboxed_echo");
+    const struct isol8r_rule_set *set = &keyword_rules.scopes[ISOL8R_RULES_ECHO];
+
+    keyword_matcher = set->count > 0 ? &set->matcher : &isol8r_builtin_rules.scopes[ISOL8R_RULES_ECHO].matcher;
+    isol8r_stats_labels((uint32_t)keyword_matcher->pattern_count, keyword_label);
+    keyword_version = isol8r_cache_hash(keyword_matcher->byte_class, sizeof(keyword_matcher->byte_class), 0);
+    keyword_version = isol8r_cache_hash(keyword_matcher->next, keyword_matcher->arena_size, keyword_version);
+    if (reload) {
+        append_log("notice", rc < 0 ? "rules reload failed; keywords unchanged"
+                             : set->count > 0 ? "rules reloaded" : "rules reloaded; using built-in keywords");
+    }
+}
+
+static void request_reload(int signo) {
+    (void)signo;
+    reload_requested = 1;
+}
+
+/* Server modes hand bait log appends to a background flusher. */
+static void stop_log_flusher(void) {
+    struct isol8r_log_stats stats;
+    if (isol8r_log_queue_stats(&bait_log, &stats) == 0 && stats.dropped > 0) {
+        fprintf(stderr, "[sandboxed_echo] log queue dropped %llu of %llu records\n",
+                (unsigned long long)stats.dropped, (unsigned long long)(stats.queued + stats.dropped));
+    }
+    if (stats.coalesced > 0) {
+        fprintf(stderr, "[sandboxed_echo] %llu repeated records were logged as counts\n",
+                (unsigned long long)stats.coalesced);
+    }
+    isol8r_log_stop_flusher(&bait_log);
+}
+
+static void start_log_flusher(void) {
+    if (isol8r_log_start_flusher(&bait_log, "sandboxed_echo") < 0) {
+        fprintf(stderr, "[sandboxed_echo] warning: log flusher unavailable, logging synchronously: %s\n", strerror(errno));
         return;
     }
+    atexit(stop_log_flusher);
+}
+
+/* SIGHUP also reopens the bait log, for whoever rotated it from outside. */
+static void reload_if_requested(void) {
+    if (reload_requested) {
+        reload_requested = 0;
+        if (isol8r_log_reopen(&bait_log) != 0) {
+            fprintf(stderr, "[sandboxed_echo] warning: cannot reopen %s: %s\n", bait_log.path, strerror(errno));
+        }
+        load_keyword_rules(1);
+    }
+}
+
+static int record_keyword_hit(uint32_t pattern_id, size_t end_offset, void *ctx) {
+    (void)end_offset;
+    *(uint32_t *)ctx |= UINT32_C(1) << pattern_id;
+    return 0;
+}
+
+/*
+ * Single pass over the line; returns a bitmask of every keyword id that
+ * matched, so zero still means "boring".
+ */
+static uint32_t looks_suspicious(const char *input) {
+    uint32_t hits = 0;
+
+    isol8r_match_scan(keyword_matcher, (const uint8_t *)input, strlen(input), record_keyword_hit, &hits);
+    return hits;
+}
+
+/*
+ * Logs the echo and, if warranted, the alert. Shared by every mode so the
+ * bait log looks the same no matter how the line arrived.
+ */
+static enum echo_verdict report_verdict(const char *logged, uint64_t payload_length, uint32_t hits) {
+    log_event("echo", logged, payload_length, ISOL8R_RING_NO_PATTERN, 1);
+
+    if (hits) {
+        log_event("alert", logged, payload_length, (uint32_t)__builtin_ctz(hits), 1);
+        return ECHO_VERDICT_SUSPICIOUS;
+    }
+    return ECHO_VERDICT_BORING;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+/* Adds one classified request to the shared stats page. */
+static void count_request(uint64_t bytes, uint32_t hits, const struct echo_timing *timing) {
+    isol8r_stats_add(ISOL8R_STATS_REQUESTS, 1);
+    isol8r_stats_add(ISOL8R_STATS_BYTES, bytes);
+    isol8r_stats_hits(hits);
+    isol8r_stats_latency(ISOL8R_STAGE_READ, timing->read_ns);
+    isol8r_stats_latency(ISOL8R_STAGE_INSPECT, timing->inspect_ns);
+    isol8r_stats_latency(ISOL8R_STAGE_LOG, timing->log_ns);
+}
+
+/* Counts a request refused unread: empty, or too large to take in. */
+static void count_rejected(void) {
+    isol8r_stats_add(ISOL8R_STATS_REQUESTS, 1);
+    isol8r_stats_add(ISOL8R_STATS_REJECTED, 1);
+}
+
+/*
+ * Scans and logs one line, reporting the keyword hits and phase times.
+ * timing->read_ns is the caller's, and goes into the stats with the rest.
+ */
+static enum echo_verdict classify_line(const char *line, uint32_t *hits, struct echo_timing *timing) {
+    const size_t line_len = strlen(line);
+    uint64_t mark = monotonic_ns();
+    /* A line seen before under the same keywords is not scanned again. */
+    struct isol8r_cache_verdict cached;
+    if (isol8r_cache_lookup(&verdict_cache, keyword_version, line, line_len, &cached)) {
+        isol8r_stats_add(ISOL8R_STATS_CACHE_HITS, 1);
+        *hits = cached.mask;
+    } else {
+        *hits = looks_suspicious(line);
+        cached.mask = *hits;
+        cached.detail = 0;
+        isol8r_cache_store(&verdict_cache, keyword_version, line, line_len, &cached);
+    }
+    isol8r_stage_mark(ISOL8R_STAGE_INSPECT);
+    uint64_t now = monotonic_ns();
+    timing->inspect_ns = now - mark;
+    mark = now;
+
+    enum echo_verdict verdict = report_verdict(line, line_len, *hits);
+    isol8r_stage_mark(ISOL8R_STAGE_LOG);
+    timing->log_ns = monotonic_ns() - mark;
+    count_request(line_len, *hits, timing);
+    return verdict;
+}
+
+/* Renders a hit mask as "flag,sh" for stream-mode log records. */
+static void format_keyword_hits(uint32_t hits, char *out, size_t size) {
+    size_t used = 0;
+
+    out[0] = '\0';
+    for (uint32_t rest = hits; rest; rest &= rest - 1u) {
+        int written = snprintf(out + used, size - used, "%s%s", used ? "," : "",
+                               keyword_label((uint32_t)__builtin_ctz(rest)));
+        if (written < 0 || (size_t)written >= size - used) {
+            break;
+        }
+        used += (size_t)written;
+    }
+}
+
+/* Ends the run once `total` echoed bytes would exceed the output budget. */
+static int over_output_budget(uint64_t total) {
+    return echo_budget.output_max > 0 && total > echo_budget.output_max;
+}
 
-    fprintf(log, "%s | %s | %s\n", buffer, tag, payload);
-    fclose(log);
-}
-
-static int looks_suspicious(const char *input) {
-    const char *keywords[] = {
-        "flag",
-        "FLAG",
-        "Flag",
-        "syscall",
-        "ptrace",
-        "open",
-        "read",
-        "write",
-        "mmap",
-        "exec",
-        "binsh",
-        "cat /",
-        "sh",
-        "bash",
-        NULL
+static int output_budget_exhausted(void) {
+    isol8r_stats_add(ISOL8R_STATS_REQUESTS, 1);
+    isol8r_stats_add(ISOL8R_STATS_OUTPUT_CAPPED, 1);
+    append_log("warning", "output budget exhausted");
+    fflush(stdout);
+    fprintf(stderr, "\n[sandboxed_echo] output budget of %llu bytes exhausted\n",
+            (unsigned long long)echo_budget.output_max);
+    return ISOL8R_BUDGET_EXIT_OUTPUT;
+}
+
+static void usage(const char *program_name) {
+    fprintf(stderr,
+            "Usage: %s [--stream | --serve | --socket PATH | --scan-only CORPUS [BASELINE]] [--record]\n"
+            "  (no flags)     read one line from stdin, echo it, exit.\n"
+            "  --stream       echo and scan all of stdin, chunk by chunk, any length.\n"
+            "  --serve        answer length-prefixed requests on stdin/stdout.\n"
+            "  --socket PATH  same protocol over a unix socket, many clients at once, each\n"
+            "                 free to pipeline requests; replies come back in order.\n"
+            "  --record       with no mode, --serve or --socket: answer each request with\n"
+            "                 one framed record (verdict, keyword ids and labels, timings\n"
+            "                 and the echo) instead of the plain reply or stdout/stderr text.\n"
+            "  --scan-only    classify the first line of every payload in CORPUS (a\n"
+            "                 directory, or one payload per line; a bait log replays its\n"
+            "                 echo records) and report verdicts, throughput and keyword\n"
+            "                 hits, diffed against BASELINE if given. Exits 1 on changes.\n"
+            "                 ISOL8R_SCAN_ROUNDS repeats the timed pass; nothing is logged.\n"
+            "Keywords come from ISOL8R_RULES (default " ISOL8R_RULES_DEFAULT_PATH ", cached at\n"
+            "ISOL8R_RULES_CACHE); the serving modes reread it on SIGHUP. Live counters go to\n"
+            "ISOL8R_STATS_DIR/sandboxed_echo.stats (default " ISOL8R_STATS_DEFAULT_DIR ", empty = off).\n"
+            "The serving modes remember the verdicts of ISOL8R_VERDICT_CACHE recent lines\n"
+            "(default %u, 0 = off) and skip the scan for repeats.\n"
+            "The serving modes log through a background flusher: ISOL8R_LOG_QUEUE slots\n"
+            "(default %u, 0 logs synchronously), fdatasync every ISOL8R_LOG_FSYNC_MS (default %u);\n"
+            "echo and alert records repeating within ISOL8R_LOG_COALESCE_MS (default %u, 0 = off)\n"
+            "are written once, then counted in one \"repeated\" record per window.\n"
+            "The log rotates to .1 ... .ISOL8R_LOG_ROTATE_KEEP (default %u) at ISOL8R_LOG_ROTATE_BYTES\n"
+            "(default %u, 0 = never); the serving modes check off the request path and reopen on SIGHUP.\n"
+            "No flags and --stream run under ISOL8R_ECHO_CPU_MS (default %u), ISOL8R_ECHO_WALL_MS\n"
+            "(default %u) and ISOL8R_ECHO_OUTPUT_MAX (default none); 0 means unlimited.\n"
+            "Exhausted budgets exit with %d (CPU), %d (wall clock) or %d (output).\n"
+            "ISOL8R_FAST_START=1 trims the one-shot modes to the minimum before the first read:\n"
+            "no stats page, no tty check, and the compiled-in keywords instead of ISOL8R_RULES.\n",
+            program_name,
+            ISOL8R_CACHE_DEFAULT_ENTRIES,
+            ISOL8R_LOG_QUEUE_DEFAULT_SLOTS,
+            ISOL8R_LOG_FSYNC_DEFAULT_MS,
+            ISOL8R_LOG_COALESCE_DEFAULT_MS,
+            ISOL8R_LOG_ROTATE_DEFAULT_KEEP,
+            ISOL8R_LOG_ROTATE_DEFAULT_BYTES,
+            ECHO_CPU_BUDGET_MS,
+            ECHO_WALL_BUDGET_MS,
+            ISOL8R_BUDGET_EXIT_CPU,
+            ISOL8R_BUDGET_EXIT_WALL,
+            ISOL8R_BUDGET_EXIT_OUTPUT);
+}
+
+/* Returns 1 when len bytes arrived, 0 on EOF before the first byte, -1 otherwise. */
+static int read_full(int fd, void *buffer, size_t len) {
+    unsigned char *cursor = buffer;
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t got = read(fd, cursor + done, len - done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            return done == 0 ? 0 : -1;
+        }
+        done += (size_t)got;
+    }
+    return 1;
+}
+
+static int drain_bytes(int fd, size_t len) {
+    char scratch[4096];
+
+    while (len > 0) {
+        size_t chunk = len < sizeof(scratch) ? len : sizeof(scratch);
+        if (read_full(fd, scratch, chunk) != 1) {
+            return -1;
+        }
+        len -= chunk;
+    }
+    return 0;
+}
+
+static int write_all_iov(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t sent = writev(fd, iov, iovcnt);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (iovcnt > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= (ssize_t)iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= (size_t)sent;
+        }
+    }
+    return 0;
+}
+
+static int write_all(int fd, const void *buffer, size_t len) {
+    struct iovec iov = { .iov_base = (void *)buffer, .iov_len = len };
+    return write_all_iov(fd, &iov, 1);
+}
+
+/*
+ * Where replies go: straight to a descriptor, or, in the --socket event
+ * loop, onto a connection's output buffer until the socket takes them.
+ */
+struct echo_sink {
+    int fd;                 /* -1 when buffering. */
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+};
+
+static int sink_writev(struct echo_sink *sink, struct iovec *iov, int iovcnt) {
+    if (sink->fd >= 0) {
+        return write_all_iov(sink->fd, iov, iovcnt);
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+    if (sink->len + total > sink->cap) {
+        size_t cap = sink->cap ? sink->cap : 4096u;
+        while (cap < sink->len + total) {
+            cap *= 2u;
+        }
+        unsigned char *grown = realloc(sink->data, cap);
+        if (!grown) {
+            return -1;
+        }
+        sink->data = grown;
+        sink->cap = cap;
+    }
+    for (int i = 0; i < iovcnt; ++i) {
+        memcpy(sink->data + sink->len, iov[i].iov_base, iov[i].iov_len);
+        sink->len += iov[i].iov_len;
+    }
+    return 0;
+}
+
+static int send_reply(struct echo_sink *sink, enum echo_verdict verdict, const char *line, size_t line_len) {
+    uint32_t body_len = (uint32_t)(1u + line_len);
+    unsigned char header[5] = {
+        (unsigned char)(body_len >> 24),
+        (unsigned char)(body_len >> 16),
+        (unsigned char)(body_len >> 8),
+        (unsigned char)body_len,
+        (unsigned char)verdict,
+    };
+    struct iovec iov[2] = {
+        { .iov_base = header, .iov_len = sizeof(header) },
+        { .iov_base = (void *)line, .iov_len = line_len },
+    };
+    return sink_writev(sink, iov, line_len > 0 ? 2 : 1);
+}
+
+static void put_be32(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static void put_be64(unsigned char *out, uint64_t value) {
+    put_be32(out, (uint32_t)(value >> 32));
+    put_be32(out + 4, (uint32_t)value);
+}
+
+/* Writes one --record frame with a single writev. */
+static int send_record(struct echo_sink *sink,
+                       enum echo_verdict verdict,
+                       uint32_t hits,
+                       const char *echo,
+                       size_t echo_len,
+                       uint64_t input_len,
+                       const struct echo_timing *timing) {
+    char labels[4096];
+    format_keyword_hits(hits, labels, sizeof(labels));
+    const size_t labels_len = strlen(labels);
+
+    unsigned char header[ECHO_RECORD_HEADER];
+    put_be32(header, (uint32_t)(ECHO_RECORD_HEADER - 4u + echo_len + labels_len));
+    header[4] = (unsigned char)ECHO_RECORD_VERSION;
+    header[5] = (unsigned char)verdict;
+    header[6] = (unsigned char)(labels_len >> 8);
+    header[7] = (unsigned char)labels_len;
+    put_be32(header + 8, hits);
+    put_be32(header + 12, (uint32_t)echo_len);
+    put_be64(header + 16, input_len);
+    put_be64(header + 24, timing->read_ns);
+    put_be64(header + 32, timing->inspect_ns);
+    put_be64(header + 40, timing->log_ns);
+
+    struct iovec iov[3] = {
+        { .iov_base = header, .iov_len = sizeof(header) },
+        { .iov_base = (void *)echo, .iov_len = echo_len },
+        { .iov_base = labels, .iov_len = labels_len },
     };
+    return sink_writev(sink, iov, 3);
+}
+
+/*
+ * Mirrors what fgets() plus the \r\n strip did to stdin: at most
+ * ECHO_LINE_MAX - 1 bytes, cut at the first newline or NUL.
+ */
+static size_t extract_line(const char *frame, size_t frame_len, char *line) {
+    size_t limit = frame_len < ECHO_LINE_MAX - 1 ? frame_len : ECHO_LINE_MAX - 1;
+    size_t len = 0;
+
+    while (len < limit && frame[len] != '\r' && frame[len] != '\n' && frame[len] != '\0') {
+        line[len] = frame[len];
+        ++len;
+    }
+    line[len] = '\0';
+    return len;
+}
+
+/* One serving-mode reply, in whichever format was asked for. */
+static int send_answer(struct echo_sink *sink,
+                       enum echo_verdict verdict,
+                       uint32_t hits,
+                       const char *line,
+                       size_t line_len,
+                       uint64_t input_len,
+                       const struct echo_timing *timing) {
+    if (record_output) {
+        return send_record(sink, verdict, hits, line, line_len, input_len, timing);
+    }
+    return send_reply(sink, verdict, line, line_len);
+}
+
+/*
+ * Answers one request whose frame has fully arrived; started is when its
+ * header did. Oversized requests are the caller's, which drains them.
+ */
+static int answer_request(struct echo_sink *sink, const char *frame, uint32_t length, uint64_t started) {
+    char line[ECHO_LINE_MAX];
+    struct echo_timing timing = { 0, 0, 0 };
+
+    if (length == 0) {
+        append_log("warning", "received empty request");
+        count_rejected();
+        return send_answer(sink, ECHO_VERDICT_EMPTY, 0, NULL, 0, 0, &timing);
+    }
 
-    for (const char **keyword = keywords; *keyword; ++keyword) {
-        if (strstr(input, *keyword) != NULL) {
-            return 1;
+    isol8r_stage_mark(ISOL8R_STAGE_READ);
+    timing.read_ns = monotonic_ns() - started;
+    reload_if_requested();
+    size_t line_len = extract_line(frame, length, line);
+    uint32_t hits;
+    enum echo_verdict verdict = classify_line(line, &hits, &timing);
+    int status = send_answer(sink, verdict, hits, line, line_len, length, &timing);
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+    return status;
+}
+
+static int reject_oversized(struct echo_sink *sink, uint32_t length, uint64_t started) {
+    count_rejected();
+    struct echo_timing timing = { monotonic_ns() - started, 0, 0 };
+    return send_answer(sink, ECHO_VERDICT_REJECTED, 0, NULL, 0, length, &timing);
+}
+
+/* Serves framed requests until the peer hangs up. */
+static int serve_stream(int in_fd, int out_fd) {
+    static char frame[ECHO_FRAME_MAX];
+    struct echo_sink sink = { out_fd, NULL, 0, 0 };
+
+    for (;;) {
+        unsigned char header[4];
+        int status = read_full(in_fd, header, sizeof(header));
+        if (status == 0) {
+            return 0;
+        }
+        if (status < 0) {
+            append_log("error", "truncated request header");
+            isol8r_stats_add(ISOL8R_STATS_ERRORS, 1);
+            return -1;
+        }
+
+        uint32_t length = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) |
+                          ((uint32_t)header[2] << 8) | (uint32_t)header[3];
+        const uint64_t started = monotonic_ns();
+
+        if (length > ECHO_FRAME_MAX) {
+            append_log("warning", "oversized request rejected");
+            if (drain_bytes(in_fd, length) != 0 || reject_oversized(&sink, length, started) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (length > 0 && read_full(in_fd, frame, length) != 1) {
+            append_log("error", "truncated request body");
+            isol8r_stats_add(ISOL8R_STATS_ERRORS, 1);
+            return -1;
+        }
+        if (answer_request(&sink, frame, length, started) != 0) {
+            return -1;
         }
     }
+}
+
+/*
+ * --socket: one epoll loop multiplexes every client. Each connection
+ * buffers input until whole frames are in and may pipeline as many
+ * requests as it likes; replies queue on its output buffer in request
+ * order. A connection whose unsent replies pass ECHO_OUT_HIGH stops being
+ * read, so a client that never reads cannot make the server buffer without
+ * bound, and each wakeup answers at most ECHO_BURST requests per client
+ * before moving on, so a deep pipeline cannot starve the rest.
+ */
+struct echo_conn {
+    int fd;
+    unsigned char *in;
+    size_t in_len;
+    size_t in_cap;
+    uint64_t skip;          /* Bytes of an oversized request still to drain. */
+    uint32_t skip_length;   /* Its announced length, for the rejection. */
+    uint64_t started;       /* When the request being assembled began arriving. */
+    struct echo_sink out;
+    size_t out_sent;
+    uint32_t events;        /* EPOLL* bits currently registered. */
+    int starved;            /* Every whole frame buffered has been answered. */
+    int eof;                /* The peer has stopped sending. */
+};
+
+static int conn_watch(int epoll_fd, struct echo_conn *conn, uint32_t events) {
+    if (events == conn->events) {
+        return 0;
+    }
+    struct epoll_event change = { .events = events, .data.ptr = conn };
+    conn->events = events;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &change);
+}
+
+static void conn_close(int epoll_fd, struct echo_conn *conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn->in);
+    free(conn->out.data);
+    free(conn);
+}
+
+/*
+ * Answers the whole frames buffered so far, up to ECHO_BURST and while the
+ * output stays under ECHO_OUT_HIGH; starved records whether input ran out
+ * first. Returns -1 if a reply could not be queued.
+ */
+static int conn_answer(struct echo_conn *conn) {
+    size_t offset = 0;
+    int answered = 0;
+
+    conn->starved = 0;
+    while (answered < ECHO_BURST && conn->out.len - conn->out_sent < ECHO_OUT_HIGH) {
+        if (conn->skip > 0) {
+            size_t step = conn->in_len - offset < conn->skip ? conn->in_len - offset : (size_t)conn->skip;
+            offset += step;
+            conn->skip -= step;
+            if (conn->skip > 0) {
+                conn->starved = 1;
+                break;
+            }
+            if (reject_oversized(&conn->out, conn->skip_length, conn->started) != 0) {
+                return -1;
+            }
+            conn->started = 0;
+            ++answered;
+            continue;
+        }
+        if (conn->in_len - offset < 4) {
+            conn->starved = 1;
+            break;
+        }
+        const unsigned char *header = conn->in + offset;
+        uint32_t length = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) |
+                          ((uint32_t)header[2] << 8) | (uint32_t)header[3];
+        if (conn->started == 0) {
+            conn->started = monotonic_ns();
+        }
+        if (length > ECHO_FRAME_MAX) {
+            append_log("warning", "oversized request rejected");
+            offset += 4;
+            conn->skip = length;
+            conn->skip_length = length;
+            continue;
+        }
+        if (conn->in_len - offset < 4u + length) {
+            conn->starved = 1;
+            break;
+        }
+        if (answer_request(&conn->out, (const char *)header + 4, length, conn->started) != 0) {
+            return -1;
+        }
+        offset += 4u + length;
+        conn->started = 0;
+        ++answered;
+    }
+
+    if (offset > 0) {
+        memmove(conn->in, conn->in + offset, conn->in_len - offset);
+        conn->in_len -= offset;
+    }
     return 0;
 }
 
-int main(void) {
-    static char buffer[512];
+/*
+ * Sends what the socket will take; -1 once the peer is gone. An unsent
+ * tail moves to the front, since replies append at out.len and
+ * ECHO_OUT_HIGH would otherwise bound only the unsent bytes, not the buffer.
+ */
+static int conn_flush(struct echo_conn *conn) {
+    while (conn->out_sent < conn->out.len) {
+        ssize_t sent = write(conn->fd, conn->out.data + conn->out_sent, conn->out.len - conn->out_sent);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            if (conn->out_sent > 0) {
+                memmove(conn->out.data, conn->out.data + conn->out_sent, conn->out.len - conn->out_sent);
+                conn->out.len -= conn->out_sent;
+                conn->out_sent = 0;
+            }
+            return 0;
+        }
+        conn->out_sent += (size_t)sent;
+    }
+    conn->out.len = 0;
+    conn->out_sent = 0;
+    return 0;
+}
+
+/*
+ * Reads what has arrived, answers it and flushes. Input is only read
+ * while every buffered frame has been answered, so a deep pipeline waits
+ * in the socket rather than in memory. Returns 1 while the connection
+ * lives, 0 once it is finished with.
+ */
+static int conn_service(int epoll_fd, struct echo_conn *conn, uint32_t ready) {
+    if ((ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) && conn->starved && !conn->eof) {
+        /* Room for the frame being assembled, or a fresh read's worth. */
+        size_t want = ECHO_READ_CHUNK;
+        if (conn->skip == 0 && conn->in_len >= 4) {
+            uint32_t length = ((uint32_t)conn->in[0] << 24) | ((uint32_t)conn->in[1] << 16) |
+                              ((uint32_t)conn->in[2] << 8) | (uint32_t)conn->in[3];
+            if (length <= ECHO_FRAME_MAX && 4u + length > conn->in_len + want) {
+                want = 4u + length - conn->in_len;
+            }
+        }
+        if (conn->in_len + want > conn->in_cap) {
+            unsigned char *grown = realloc(conn->in, conn->in_len + want);
+            if (!grown) {
+                return 0;
+            }
+            conn->in = grown;
+            conn->in_cap = conn->in_len + want;
+        }
+        ssize_t got = read(conn->fd, conn->in + conn->in_len, conn->in_cap - conn->in_len);
+        if (got > 0) {
+            conn->in_len += (size_t)got;
+        } else if (got == 0) {
+            conn->eof = 1;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return 0;
+        }
+    }
+
+    if (conn_answer(conn) != 0 || conn_flush(conn) != 0) {
+        return 0;
+    }
+
+    const size_t backlog = conn->out.len - conn->out_sent;
+    if (conn->eof && conn->starved) {
+        /* A half-closed peer still gets every reply it asked for. */
+        if (backlog > 0) {
+            return conn_watch(epoll_fd, conn, EPOLLOUT) == 0;
+        }
+        if (conn->in_len > 0 || conn->skip > 0) {
+            append_log("error", "truncated request");
+            isol8r_stats_add(ISOL8R_STATS_ERRORS, 1);
+        }
+        return 0;
+    }
+
+    uint32_t events = 0;
+    if (conn->starved && !conn->eof && backlog < ECHO_OUT_HIGH) {
+        events |= EPOLLIN;
+    }
+    /*
+     * Pending output, or whole frames left behind by a full burst: an idle
+     * socket reports writable at once, which brings us straight back.
+     */
+    if (backlog > 0 || !conn->starved) {
+        events |= EPOLLOUT;
+    }
+    return conn_watch(epoll_fd, conn, events) == 0;
+}
+
+static void serve_socket(const char *path) {
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        die("socket path too long");
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || fcntl(listener, F_SETFL, O_NONBLOCK) != 0 || fcntl(listener, F_SETFD, FD_CLOEXEC) != 0) {
+        die("unable to create socket");
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+
+    unlink(path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, ECHO_BACKLOG) != 0) {
+        die("unable to bind socket");
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event watch = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &watch) != 0) {
+        die("unable to set up epoll");
+    }
+
+    append_log("notice", "server mode listening on unix socket");
+
+    unsigned clients = 0;
+    int accepting = 1;
+    for (;;) {
+        reload_if_requested();
+        struct epoll_event ready[ECHO_EVENTS];
+        int count = epoll_wait(epoll_fd, ready, ECHO_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            die("epoll_wait failed");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            struct echo_conn *conn = ready[i].data.ptr;
+            if (conn) {
+                if (!conn_service(epoll_fd, conn, ready[i].events)) {
+                    conn_close(epoll_fd, conn);
+                    --clients;
+                }
+                continue;
+            }
+
+            while (clients < ECHO_MAX_CLIENTS) {
+                int client = accept(listener, NULL, NULL);
+                if (client < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+                        break;
+                    }
+                    if (errno == EMFILE || errno == ENFILE) {
+                        append_log("warning", "out of descriptors; holding new clients back");
+                        break;
+                    }
+                    die("accept failed");
+                }
+                struct echo_conn *fresh = calloc(1, sizeof(*fresh));
+                struct epoll_event add = { .events = EPOLLIN, .data.ptr = fresh };
+                if (!fresh || fcntl(client, F_SETFL, O_NONBLOCK) != 0 || fcntl(client, F_SETFD, FD_CLOEXEC) != 0 ||
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &add) != 0) {
+                    free(fresh);
+                    close(client);
+                    continue;
+                }
+                fresh->fd = client;
+                fresh->out.fd = -1;
+                fresh->events = EPOLLIN;
+                fresh->starved = 1;
+                ++clients;
+            }
+        }
+
+        /* At the cap, leave further clients in the listen backlog until one leaves. */
+        if (accepting != (clients < ECHO_MAX_CLIENTS)) {
+            accepting = clients < ECHO_MAX_CLIENTS;
+            struct epoll_event change = { .events = accepting ? EPOLLIN : 0, .data.ptr = NULL };
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listener, &change);
+        }
+    }
+}
+
+/*
+ * Reads the one-shot line straight off stdin, no stdio: like fgets(), stop
+ * at the first newline, a full buffer or EOF. Returns the bytes read.
+ */
+static size_t read_stdin_line(char *buffer, size_t size) {
+    size_t got = 0;
+    while (got < size - 1u && !memchr(buffer, '\n', got)) {
+        ssize_t step = read(STDIN_FILENO, buffer + got, size - 1u - got);
+        if (step < 0 && errno == EINTR) {
+            continue;
+        }
+        if (step < 0) {
+            append_log("error", "failed to read stdin");
+            die("unable to read input");
+        }
+        if (step == 0) {
+            break;
+        }
+        got += (size_t)step;
+    }
+    return got;
+}
+
+/* Writes a one-shot message from its pieces in one writev; a lost message changes nothing else. */
+static void write_message(int fd, const char *head, const char *text, size_t text_len, const char *tail) {
+    struct iovec iov[3] = {
+        { .iov_base = (void *)head, .iov_len = strlen(head) },
+        { .iov_base = (void *)text, .iov_len = text_len },
+        { .iov_base = (void *)tail, .iov_len = strlen(tail) },
+    };
+    (void)write_all_iov(fd, iov, 3);
+}
+
+/*
+ * --record flavour of the one-shot mode: the whole answer is one record on
+ * stdout, written once, after the line has been classified.
+ */
+static int run_once_record(void) {
+    static char buffer[ECHO_LINE_MAX];
+    struct echo_sink sink = { STDOUT_FILENO, NULL, 0, 0 };
+    const uint64_t started = monotonic_ns();
+    struct echo_timing timing = { 0, 0, 0 };
+
+    const size_t got = read_stdin_line(buffer, sizeof(buffer));
+    isol8r_stage_mark(ISOL8R_STAGE_READ);
+    timing.read_ns = monotonic_ns() - started;
+    if (got == 0) {
+        append_log("warning", "received empty stdin");
+        count_rejected();
+        return send_record(&sink, ECHO_VERDICT_EMPTY, 0, NULL, 0, 0, &timing) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    char line[ECHO_LINE_MAX];
+    size_t line_len = extract_line(buffer, got, line);
+    if (over_output_budget(line_len + 1u)) {
+        return output_budget_exhausted();
+    }
+    uint32_t hits;
+    enum echo_verdict verdict = classify_line(line, &hits, &timing);
+    int status = send_record(&sink, verdict, hits, line, line_len, got, &timing);
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * The plain one-shot mode. Input and output go through read(2) and
+ * writev(2) rather than stdio, so nothing is allocated or fstat()ed on the
+ * way to the first read; the bytes written are what printf() used to write.
+ */
+static int run_once(void) {
+    static char buffer[ECHO_LINE_MAX];
 
-    if (isatty(STDIN_FILENO)) {
+    if (!fast_start && isatty(STDIN_FILENO)) {
         append_log("notice", "stdin connected to tty; someone is poking the sandbox manually");
     }
+    if (record_output) {
+        return run_once_record();
+    }
 
-    if (!fgets(buffer, sizeof(buffer), stdin)) {
-        if (ferror(stdin)) {
+    struct echo_timing timing = { 0, 0, 0 };
+    const uint64_t started = monotonic_ns();
+    const size_t got = read_stdin_line(buffer, sizeof(buffer));
+    isol8r_stage_mark(ISOL8R_STAGE_READ);
+    timing.read_ns = monotonic_ns() - started;
+    if (got == 0) {
+        append_log("warning", "received empty stdin");
+        count_rejected();
+        write_message(STDOUT_FILENO, "[sandboxed] no input received\n", "", 0, "");
+        return EXIT_SUCCESS;
+    }
+
+    char line[ECHO_LINE_MAX];
+    const size_t line_len = extract_line(buffer, got, line);
+
+    if (over_output_budget(line_len + 1u)) {
+        return output_budget_exhausted();
+    }
+    write_message(STDOUT_FILENO, "", line, line_len, "\n");
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+
+    uint32_t hits;
+    if (classify_line(line, &hits, &timing) == ECHO_VERDICT_SUSPICIOUS) {
+        // Before current ISO8601 logging
+        write_message(STDERR_FILENO, "[TRAP] User tried command: ", line, line_len, "\n");
+        write_message(STDERR_FILENO, "[sandboxed_echo] suspicious content detected; event logged\n", "", 0, "");
+    } else {
+        write_message(STDERR_FILENO, "[sandboxed_echo] input classified as boring\n", "", 0, "");
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Echoes stdin through as it arrives and scans every byte, carrying the
+ * matcher state across chunks so a keyword split by a read boundary still
+ * counts. The log gets the first line as a preview plus the totals.
+ */
+static int run_stream(void) {
+    static uint8_t chunk[ECHO_STREAM_CHUNK];
+    char preview[ECHO_LINE_MAX];
+    size_t preview_len = 0;
+    int preview_done = 0;
+    int echo_ok = 1;
+    uint64_t total = 0;
+    uint32_t hits = 0;
+    struct echo_timing timing = { 0, 0, 0 };   /* read_ns unused. */
+    struct isol8r_match_stream stream;
+
+    isol8r_match_stream_init(&stream);
+
+    for (;;) {
+        ssize_t got = read(STDIN_FILENO, chunk, sizeof(chunk));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             append_log("error", "failed to read stdin");
             die("unable to read input");
         }
+        isol8r_stage_mark(ISOL8R_STAGE_READ);
+        if (got == 0) {
+            break;
+        }
+
+        size_t echo_len = (size_t)got;
+        const int over_budget = over_output_budget(total + (uint64_t)got);
+        if (over_budget) {
+            echo_len = (size_t)(echo_budget.output_max - total);
+        }
+        if (echo_ok && write_all(STDOUT_FILENO, chunk, echo_len) != 0) {
+            /* Reader left early; keep scanning so the log stays honest. */
+            echo_ok = 0;
+        }
+        if (over_budget) {
+            return output_budget_exhausted();
+        }
+        isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+        const uint64_t mark = monotonic_ns();
+        isol8r_match_scan_stream(keyword_matcher, &stream, chunk, (size_t)got, record_keyword_hit, &hits);
+        isol8r_stage_mark(ISOL8R_STAGE_INSPECT);
+        timing.inspect_ns += monotonic_ns() - mark;
+
+        for (ssize_t i = 0; !preview_done && i < got; ++i) {
+            char c = (char)chunk[i];
+            if (c == '\r' || c == '\n' || c == '\0' || preview_len == sizeof(preview) - 1) {
+                preview_done = 1;
+            } else {
+                preview[preview_len++] = c;
+            }
+        }
+        total += (uint64_t)got;
+    }
+    preview[preview_len] = '\0';
+
+    if (total == 0) {
         append_log("warning", "received empty stdin");
+        count_rejected();
         printf("[sandboxed] no input received\n");
         fflush(stdout);
         return EXIT_SUCCESS;
     }
 
-    buffer[strcspn(buffer, "\r\n")] = '\0';
-
-    printf("%s\n", buffer);
-    fflush(stdout);
+    char matched[128];
+    char logged[ECHO_LINE_MAX + 192];
+    format_keyword_hits(hits, matched, sizeof(matched));
+    snprintf(logged, sizeof(logged), "%s [stream bytes=%llu%s%s]",
+             preview, (unsigned long long)total, hits ? " keywords=" : "", matched);
 
-    append_log("echo", buffer);
-
-    if (looks_suspicious(buffer)) {
-        // Before current ISO8601 logging
-        fprintf(stderr, "[TRAP] User tried command: %s\n", buffer);
-        append_log("alert", buffer);
-        fprintf(stderr, "[sandboxed_echo] suspicious content detected; event logged\n");
+    const uint64_t mark = monotonic_ns();
+    enum echo_verdict verdict = report_verdict(logged, total, hits);
+    isol8r_stage_mark(ISOL8R_STAGE_LOG);
+    timing.log_ns = monotonic_ns() - mark;
+    /* A stream has no one read to time, so only the scan and the log are sampled. */
+    isol8r_stats_add(ISOL8R_STATS_REQUESTS, 1);
+    isol8r_stats_add(ISOL8R_STATS_BYTES, total);
+    isol8r_stats_hits(hits);
+    isol8r_stats_latency(ISOL8R_STAGE_INSPECT, timing.inspect_ns);
+    isol8r_stats_latency(ISOL8R_STAGE_LOG, timing.log_ns);
+    if (verdict == ECHO_VERDICT_SUSPICIOUS) {
+        fprintf(stderr, "[TRAP] User tried command: %s\n", preview);
+        fprintf(stderr, "[sandboxed_echo] suspicious content detected (%s); event logged\n", matched);
     } else {
         fprintf(stderr, "[sandboxed_echo] input classified as boring\n");
     }
 
     return EXIT_SUCCESS;
 }
+
+/*
+ * --scan-only: the classification step of the serving modes, first line of
+ * each payload and all, over a whole corpus. isol8r_replay loads, times and
+ * diffs; nothing here logs or echoes.
+ */
+static uint32_t replay_inspect(const uint8_t *data, size_t len, void *ctx) {
+    char line[ECHO_LINE_MAX];
+    (void)ctx;
+    extract_line((const char *)data, len, line);
+    return looks_suspicious(line);
+}
+
+static const char *replay_label(uint32_t pattern_id, void *ctx) {
+    (void)ctx;
+    return keyword_label(pattern_id);
+}
+
+static int scan_only(const char *corpus, const char *baseline) {
+    const struct isol8r_replay replay = {
+        .program = "sandboxed_echo",
+        .inspect = replay_inspect,
+        .label = replay_label,
+        .ctx = NULL,
+        .detector_count = (uint32_t)keyword_matcher->pattern_count,
+        .max_payload = 0,
+    };
+    return isol8r_replay_run(&replay, corpus, baseline);
+}
+
+int main(int argc, char *argv[]) {
+    const char *fast = getenv("ISOL8R_FAST_START");
+    fast_start = fast && *fast && strcmp(fast, "0") != 0 &&
+                 (argc == 1 || (argc == 2 && (strcmp(argv[1], "--stream") == 0 || strcmp(argv[1], "--record") == 0)));
+
+    isol8r_stage_init("sandboxed_echo");
+    if (!fast_start) {
+        isol8r_stats_init("sandboxed_echo");
+    }
+    isol8r_log_from_env(&bait_log);
+    if (isol8r_ring_from_env(&event_ring) != 0) {
+        fprintf(stderr, "[sandboxed_echo] warning: event ring unavailable: %s\n", strerror(errno));
+    }
+    isol8r_rules_set_builtin(&isol8r_builtin_rules);
+    if (!fast_start) {
+        load_keyword_rules(0);
+    }
+    isol8r_budget_from_env(&echo_budget, "ISOL8R_ECHO", "sandboxed_echo");
+
+    /* --record goes last and applies to whichever mode precedes it. */
+    if (argc >= 2 && strcmp(argv[argc - 1], "--record") == 0) {
+        record_output = 1;
+        --argc;
+        if (argc >= 2 && strcmp(argv[1], "--serve") != 0 && strcmp(argv[1], "--socket") != 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (argc == 1) {
+        isol8r_budget_arm(&echo_budget, 1);
+        return run_once();
+    }
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "--scan-only") == 0) {
+        return scan_only(argv[2], argc == 4 ? argv[3] : NULL);
+    }
+    if (argc == 2 && strcmp(argv[1], "--stream") == 0) {
+        isol8r_budget_arm(&echo_budget, 1);
+        return run_stream();
+    }
+
+    /* A vanished client should end its connection, not the server. */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* No SA_RESTART, so an idle accept() wakes up for the reload. */
+    struct sigaction hup;
+    memset(&hup, 0, sizeof(hup));
+    hup.sa_handler = request_reload;
+    sigemptyset(&hup.sa_mask);
+    sigaction(SIGHUP, &hup, NULL);
+    isol8r_cache_from_env(&verdict_cache, "sandboxed_echo", ECHO_LINE_MAX, 0);
+
+    if (argc == 2 && strcmp(argv[1], "--serve") == 0) {
+        start_log_flusher();
+        return serve_stream(STDIN_FILENO, STDOUT_FILENO) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc == 3 && strcmp(argv[1], "--socket") == 0) {
+        start_log_flusher();
+        serve_socket(argv[2]);
+        return EXIT_SUCCESS;
+    }
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,163 @@
+/**
+ * isol8r_budget.c - environment parsing and in-process enforcement of run budgets.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_budget.h"
+#include "isol8r_stats.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* A day; anything longer is a typo, not a budget. */
+#define ISOL8R_BUDGET_MAX_MS (24u * 60u * 60u * 1000u)
+
+/* Notes written from the signal handler, formatted ahead of time. */
+static char budget_cpu_note[128];
+static char budget_wall_note[128];
+static size_t budget_cpu_note_len;
+static size_t budget_wall_note_len;
+static const char *budget_program = "isol8r";
+
+static void isol8r_budget_expired(int signo) {
+    const int wall = signo == SIGALRM;
+    ssize_t ignored = write(STDERR_FILENO,
+                            wall ? budget_wall_note : budget_cpu_note,
+                            wall ? budget_wall_note_len : budget_cpu_note_len);
+    (void)ignored;
+    isol8r_stats_add(ISOL8R_STATS_TIMEOUTS, 1);
+    _exit(wall ? ISOL8R_BUDGET_EXIT_WALL : ISOL8R_BUDGET_EXIT_CPU);
+}
+
+/* Parses N with an optional k/m suffix when `sized`; returns -1 if malformed or above max. */
+static int isol8r_budget_parse(const char *value, int sized, uint64_t max, uint64_t *out) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    unsigned long long scale = 1;
+    if (sized && end && (*end == 'k' || *end == 'K')) {
+        scale = 1024u;
+        ++end;
+    } else if (sized && end && (*end == 'm' || *end == 'M')) {
+        scale = 1024u * 1024u;
+        ++end;
+    }
+    if (errno != 0 || end == value || *end != '\0' || value[0] == '-' || parsed > max / scale) {
+        return -1;
+    }
+    *out = (uint64_t)(parsed * scale);
+    return 0;
+}
+
+static void isol8r_budget_env(const char *prefix, const char *suffix, int sized, uint64_t max, uint64_t *field) {
+    char name[96];
+    snprintf(name, sizeof(name), "%s_%s", prefix, suffix);
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        return;
+    }
+    if (isol8r_budget_parse(value, sized, max, field) != 0) {
+        fprintf(stderr, "[%s] Ignoring %s=%s (want 0..%llu%s; 0 is unlimited).\n",
+                budget_program, name, value, (unsigned long long)max, sized ? " bytes, optional k/m suffix" : " ms");
+    }
+}
+
+void isol8r_budget_from_env(struct isol8r_budget *budget, const char *prefix, const char *program) {
+    budget_program = program ? program : budget_program;
+
+    uint64_t cpu_ms = budget->cpu_ms;
+    uint64_t wall_ms = budget->wall_ms;
+    isol8r_budget_env(prefix, "CPU_MS", 0, ISOL8R_BUDGET_MAX_MS, &cpu_ms);
+    isol8r_budget_env(prefix, "WALL_MS", 0, ISOL8R_BUDGET_MAX_MS, &wall_ms);
+    isol8r_budget_env(prefix, "OUTPUT_MAX", 1, UINT32_MAX, &budget->output_max);
+    budget->cpu_ms = (uint32_t)cpu_ms;
+    budget->wall_ms = (uint32_t)wall_ms;
+}
+
+static struct timeval isol8r_budget_timeval(uint32_t ms) {
+    struct timeval tv = {
+        .tv_sec = (time_t)(ms / 1000u),
+        .tv_usec = (suseconds_t)(ms % 1000u) * 1000,
+    };
+    return tv;
+}
+
+int isol8r_budget_arm(const struct isol8r_budget *budget, int with_wall) {
+    struct sigaction action;
+    int rc = 0;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = isol8r_budget_expired;
+    sigemptyset(&action.sa_mask);
+    /* Whichever budget runs out first ends the run; keep the other quiet. */
+    sigaddset(&action.sa_mask, SIGPROF);
+    sigaddset(&action.sa_mask, SIGXCPU);
+    sigaddset(&action.sa_mask, SIGALRM);
+
+    if (budget->cpu_ms > 0) {
+        budget_cpu_note_len = (size_t)snprintf(budget_cpu_note, sizeof(budget_cpu_note),
+                                               "[%s] CPU budget of %u ms exhausted.\n",
+                                               budget_program, (unsigned)budget->cpu_ms);
+        if (budget_cpu_note_len >= sizeof(budget_cpu_note)) {
+            budget_cpu_note_len = sizeof(budget_cpu_note) - 1;
+        }
+
+        struct itimerval timer = { .it_interval = { 0, 0 }, .it_value = isol8r_budget_timeval(budget->cpu_ms) };
+        if (sigaction(SIGPROF, &action, NULL) != 0 || sigaction(SIGXCPU, &action, NULL) != 0 ||
+            setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+            rc = -1;
+        }
+
+        /*
+         * RLIMIT_CPU counts the whole process lifetime in whole seconds and
+         * SIGKILLs at the hard limit, which no handler or mask can stop.
+         */
+        struct rusage used;
+        struct rlimit limit;
+        if (getrusage(RUSAGE_SELF, &used) == 0 && getrlimit(RLIMIT_CPU, &limit) == 0) {
+            rlim_t soft = (rlim_t)used.ru_utime.tv_sec + (rlim_t)used.ru_stime.tv_sec + budget->cpu_ms / 1000u + 2u;
+            if (limit.rlim_max == RLIM_INFINITY || soft + 1u <= limit.rlim_max) {
+                limit.rlim_cur = soft;
+                limit.rlim_max = soft + 1u;
+                if (setrlimit(RLIMIT_CPU, &limit) != 0) {
+                    rc = -1;
+                }
+            }
+        }
+    }
+
+    if (with_wall && budget->wall_ms > 0) {
+        budget_wall_note_len = (size_t)snprintf(budget_wall_note, sizeof(budget_wall_note),
+                                                "[%s] Wall-clock budget of %u ms exhausted.\n",
+                                                budget_program, (unsigned)budget->wall_ms);
+        if (budget_wall_note_len >= sizeof(budget_wall_note)) {
+            budget_wall_note_len = sizeof(budget_wall_note) - 1;
+        }
+
+        struct itimerval timer = { .it_interval = { 0, 0 }, .it_value = isol8r_budget_timeval(budget->wall_ms) };
+        if (sigaction(SIGALRM, &action, NULL) != 0 || setitimer(ITIMER_REAL, &timer, NULL) != 0) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+const char *isol8r_budget_name(int status) {
+    switch (status) {
+    case ISOL8R_BUDGET_EXIT_CPU:
+        return "CPU";
+    case ISOL8R_BUDGET_EXIT_WALL:
+        return "wall-clock";
+    case ISOL8R_BUDGET_EXIT_OUTPUT:
+        return "output";
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * isol8r_budget.h - CPU, wall-clock and output budgets for one run.
+ *
+ * A binary starts from compiled-in defaults and lets the environment
+ * override them, one variable per limit under the binary's own prefix:
+ *
+ *   <PREFIX>_CPU_MS=N          CPU time, user plus system
+ *   <PREFIX>_WALL_MS=N         elapsed time
+ *   <PREFIX>_OUTPUT_MAX=N[k|m] bytes written to stdout and stderr together
+ *
+ * 0 means unlimited. isol8r_budget_arm() enforces the two time limits in
+ * the calling process: CPU through ITIMER_PROF, with RLIMIT_CPU a couple of
+ * seconds behind as a backstop a payload cannot disarm, and wall clock
+ * through ITIMER_REAL. Output has no in-process hook, so whoever reads it
+ * counts bytes against output_max. Each exhausted budget ends the run with
+ * its own exit status, clear of anything the payload or harness uses.
+ */
+
+#ifndef ISOL8R_BUDGET_H
+#define ISOL8R_BUDGET_H
+
+#include <stdint.h>
+
+/** Exit statuses for an exhausted budget. */
+#define ISOL8R_BUDGET_EXIT_CPU 121
+#define ISOL8R_BUDGET_EXIT_WALL 122
+#define ISOL8R_BUDGET_EXIT_OUTPUT 123
+
+/** Limits for one run; 0 leaves a dimension unlimited. */
+struct isol8r_budget {
+    uint32_t cpu_ms;
+    uint32_t wall_ms;
+    uint64_t output_max;
+};
+
+/**
+ * Applies <prefix>_CPU_MS, <prefix>_WALL_MS and <prefix>_OUTPUT_MAX on top
+ * of the defaults already in `budget`. A malformed value is reported on
+ * stderr and the default kept.
+ *
+ * @param budget  Defaults in, effective limits out.
+ * @param prefix  Variable prefix, e.g. "ISOL8R_VMMGR".
+ * @param program Name used in warnings and in the exhaustion notes.
+ */
+void isol8r_budget_from_env(struct isol8r_budget *budget, const char *prefix, const char *program);
+
+/**
+ * Starts enforcing the time limits in this process. When one runs out, a
+ * one-line note goes to stderr and the process _exit()s with the matching
+ * ISOL8R_BUDGET_EXIT_* status. Timers do not survive fork(), so call this
+ * in the process that does the work.
+ *
+ * @param budget    Limits to enforce.
+ * @param with_wall Also arm the wall-clock limit; pass 0 when a parent
+ *                  process is already watching the clock.
+ * @return 0 on success, -1 if a timer or limit could not be set.
+ */
+int isol8r_budget_arm(const struct isol8r_budget *budget, int with_wall);
+
+/**
+ * Names the budget behind an exit status.
+ *
+ * @param status Process exit status.
+ * @return "CPU", "wall-clock" or "output", or NULL for any other status.
+ */
+const char *isol8r_budget_name(int status);
+
+#endif /* ISOL8R_BUDGET_H */
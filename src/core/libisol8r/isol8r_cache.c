@@ -0,0 +1,219 @@
+/**
+ * isol8r_cache.c - set-associative verdict cache with verified hits.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_cache.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+struct isol8r_cache_entry {
+    uint64_t hash;
+    uint64_t version;
+    uint64_t stamp;                         /* Last use; 0 while the way is empty. */
+    uint32_t length;
+    uint32_t reserved;
+    struct isol8r_cache_verdict verdict;
+};
+
+struct isol8r_cache_set {
+    int32_t owner;                          /* pid holding the set, 0 when free. */
+    uint32_t reserved;
+    struct isol8r_cache_entry ways[ISOL8R_CACHE_WAYS];
+};
+
+static uint64_t isol8r_cache_rotl(uint64_t value, unsigned shift) {
+    return (value << shift) | (value >> (64u - shift));
+}
+
+static uint64_t isol8r_cache_word(uint64_t word) {
+    word *= UINT64_C(0x87c37b91114253d5);
+    word = isol8r_cache_rotl(word, 31);
+    return word * UINT64_C(0x4cf5ad432745937f);
+}
+
+uint64_t isol8r_cache_hash(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *bytes = data;
+    uint64_t hash = seed ^ ((uint64_t)len * UINT64_C(0x9e3779b97f4a7c15));
+
+    for (; len >= 8; bytes += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+        hash ^= isol8r_cache_word(word);
+        hash = isol8r_cache_rotl(hash, 27) * 5u + UINT64_C(0x52dce729);
+    }
+    if (len > 0) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, len);
+        hash ^= isol8r_cache_word(word);
+    }
+
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    return hash ^ (hash >> 33);
+}
+
+int isol8r_cache_open(struct isol8r_cache *cache, uint32_t entries, size_t key_max, int shared) {
+    if (!cache || entries == 0 || entries > ISOL8R_CACHE_MAX_ENTRIES || key_max == 0 || key_max > UINT32_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint32_t sets = 1;
+    while (sets * ISOL8R_CACHE_WAYS < entries) {
+        sets <<= 1;
+    }
+    const size_t set_bytes = (size_t)sets * sizeof(struct isol8r_cache_set);
+    const size_t map_size = sizeof(uint64_t) + set_bytes + (size_t)sets * ISOL8R_CACHE_WAYS * key_max;
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                     (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    /* Anonymous memory starts zeroed: every set free, every way empty. */
+    cache->clock = map;
+    cache->sets = (struct isol8r_cache_set *)((uint8_t *)map + sizeof(uint64_t));
+    cache->keys = (uint8_t *)cache->sets + set_bytes;
+    cache->set_mask = sets - 1u;
+    cache->key_max = key_max;
+    cache->map_size = map_size;
+    cache->shared = shared;
+    return 0;
+}
+
+void isol8r_cache_from_env(struct isol8r_cache *cache, const char *program, size_t key_max, int shared) {
+    unsigned long entries = ISOL8R_CACHE_DEFAULT_ENTRIES;
+    const char *value = getenv("ISOL8R_VERDICT_CACHE");
+    if (value && *value) {
+        char *end = NULL;
+        errno = 0;
+        entries = strtoul(value, &end, 10);
+        if (errno != 0 || !end || *end != '\0' || value[0] == '-' || entries > ISOL8R_CACHE_MAX_ENTRIES) {
+            fprintf(stderr, "[%s] Ignoring ISOL8R_VERDICT_CACHE=%s (want 0..%u entries; 0 disables).\n",
+                    program, value, ISOL8R_CACHE_MAX_ENTRIES);
+            entries = ISOL8R_CACHE_DEFAULT_ENTRIES;
+        }
+    }
+    if (entries > 0 && isol8r_cache_open(cache, (uint32_t)entries, key_max, shared) != 0) {
+        fprintf(stderr, "[%s] Warning: verdict cache unavailable: %s\n", program, strerror(errno));
+    }
+}
+
+void isol8r_cache_close(struct isol8r_cache *cache) {
+    if (cache && cache->sets) {
+        munmap(cache->clock, cache->map_size);
+        const struct isol8r_cache disabled = ISOL8R_CACHE_INIT;
+        *cache = disabled;
+    }
+}
+
+/* Takes a set without waiting; a set whose holder died is taken over. */
+static int isol8r_cache_lock(const struct isol8r_cache *cache, struct isol8r_cache_set *set) {
+    if (!cache->shared) {
+        return 1;
+    }
+    const int32_t self = (int32_t)getpid();
+    int32_t owner = 0;
+    if (__atomic_compare_exchange_n(&set->owner, &owner, self, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+    if (owner == self || kill((pid_t)owner, 0) == 0 || errno != ESRCH) {
+        return 0;
+    }
+    return __atomic_compare_exchange_n(&set->owner, &owner, self, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void isol8r_cache_unlock(const struct isol8r_cache *cache, struct isol8r_cache_set *set) {
+    if (cache->shared) {
+        __atomic_store_n(&set->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static uint64_t isol8r_cache_tick(struct isol8r_cache *cache) {
+    return __atomic_add_fetch(cache->clock, 1, __ATOMIC_RELAXED);
+}
+
+/* The way holding this payload, or -1. The set must be held. */
+static int isol8r_cache_find(const struct isol8r_cache *cache,
+                             const struct isol8r_cache_set *set,
+                             uint64_t hash,
+                             uint64_t version,
+                             const void *key,
+                             size_t len) {
+    const size_t first = (size_t)(set - cache->sets) * ISOL8R_CACHE_WAYS;
+    for (unsigned way = 0; way < ISOL8R_CACHE_WAYS; ++way) {
+        const struct isol8r_cache_entry *entry = &set->ways[way];
+        if (entry->stamp != 0 && entry->hash == hash && entry->version == version && entry->length == len &&
+            memcmp(cache->keys + (first + way) * cache->key_max, key, len) == 0) {
+            return (int)way;
+        }
+    }
+    return -1;
+}
+
+int isol8r_cache_lookup(struct isol8r_cache *cache,
+                        uint64_t version,
+                        const void *key,
+                        size_t len,
+                        struct isol8r_cache_verdict *verdict) {
+    if (!cache || !cache->sets || len > cache->key_max) {
+        return 0;
+    }
+    const uint64_t hash = isol8r_cache_hash(key, len, version);
+    struct isol8r_cache_set *set = &cache->sets[hash & cache->set_mask];
+    if (!isol8r_cache_lock(cache, set)) {
+        return 0;
+    }
+    const int way = isol8r_cache_find(cache, set, hash, version, key, len);
+    if (way >= 0) {
+        set->ways[way].stamp = isol8r_cache_tick(cache);
+        *verdict = set->ways[way].verdict;
+    }
+    isol8r_cache_unlock(cache, set);
+    return way >= 0;
+}
+
+void isol8r_cache_store(struct isol8r_cache *cache,
+                        uint64_t version,
+                        const void *key,
+                        size_t len,
+                        const struct isol8r_cache_verdict *verdict) {
+    if (!cache || !cache->sets || len > cache->key_max) {
+        return;
+    }
+    const uint64_t hash = isol8r_cache_hash(key, len, version);
+    struct isol8r_cache_set *set = &cache->sets[hash & cache->set_mask];
+    if (!isol8r_cache_lock(cache, set)) {
+        return;
+    }
+
+    int way = isol8r_cache_find(cache, set, hash, version, key, len);
+    if (way < 0) {
+        /* An empty way has stamp 0, so it is always the oldest. */
+        way = 0;
+        for (unsigned i = 1; i < ISOL8R_CACHE_WAYS; ++i) {
+            if (set->ways[i].stamp < set->ways[way].stamp) {
+                way = (int)i;
+            }
+        }
+        const size_t index = (size_t)(set - cache->sets) * ISOL8R_CACHE_WAYS + (size_t)way;
+        memcpy(cache->keys + index * cache->key_max, key, len);
+        set->ways[way].hash = hash;
+        set->ways[way].version = version;
+        set->ways[way].length = (uint32_t)len;
+    }
+    set->ways[way].verdict = *verdict;
+    set->ways[way].stamp = isol8r_cache_tick(cache);
+    isol8r_cache_unlock(cache, set);
+}
@@ -0,0 +1,131 @@
+/**
+ * isol8r_cache.h - bounded verdict cache for repeated submissions.
+ *
+ * Players resubmit the same payload over and over while they iterate. The
+ * serving modes keep the inspection verdict of recent payloads here, keyed
+ * by a fast hash of the payload bytes and by a version that fingerprints the
+ * rules in force, so a repeat skips the scan. Every entry keeps a copy of
+ * its payload and a hit compares it in full: a hash collision, crafted or
+ * not, is a miss, never somebody else's verdict.
+ *
+ * The cache is set-associative with ISOL8R_CACHE_WAYS entries per set and
+ * evicts the least recently used entry of a set. A cache opened shared lives
+ * in a MAP_SHARED anonymous mapping that forked children inherit, so every
+ * handler and runner of a server sees one cache; each set is guarded by a
+ * try-lock holding its owner's pid, a busy set counts as a miss, and a lock
+ * whose owner died is taken over. Nothing here ever waits.
+ */
+
+#ifndef ISOL8R_CACHE_H
+#define ISOL8R_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Entries per set. */
+#define ISOL8R_CACHE_WAYS 4u
+
+/** Entries used when ISOL8R_VERDICT_CACHE is unset. */
+#define ISOL8R_CACHE_DEFAULT_ENTRIES 256u
+
+/** Upper bound on ISOL8R_VERDICT_CACHE. */
+#define ISOL8R_CACHE_MAX_ENTRIES 65536u
+
+/** What a binary remembers about one payload. */
+struct isol8r_cache_verdict {
+    uint32_t mask;      /**< Patterns that fired, bit per id. */
+    uint32_t detail;    /**< Binary-specific extra, e.g. the detector acted on. */
+};
+
+struct isol8r_cache_set;
+
+/** An open cache; disabled until isol8r_cache_open() succeeds. */
+struct isol8r_cache {
+    struct isol8r_cache_set *sets;  /**< Mapping, NULL when disabled. */
+    uint8_t *keys;                  /**< Payload copies, key_max bytes per entry. */
+    uint64_t *clock;                /**< Shared use counter for LRU stamps. */
+    uint32_t set_mask;              /**< Set count - 1; the count is a power of two. */
+    size_t key_max;                 /**< Longest payload cached. */
+    size_t map_size;                /**< Bytes mapped. */
+    int shared;                     /**< Sets are locked: other processes may be in them. */
+};
+
+/** Static initialiser for a disabled cache. */
+#define ISOL8R_CACHE_INIT { NULL, NULL, NULL, 0, 0, 0, 0 }
+
+/**
+ * Maps a cache of at least `entries` entries, rounded to whole sets and a
+ * power-of-two set count.
+ *
+ * @param cache   Cache handle.
+ * @param entries Entries wanted, 1..ISOL8R_CACHE_MAX_ENTRIES.
+ * @param key_max Longest payload to cache; longer ones are always misses.
+ * @param shared  Nonzero to share the cache with children forked later.
+ * @return 0 on success, -1 with errno set (the cache stays disabled).
+ */
+int isol8r_cache_open(struct isol8r_cache *cache, uint32_t entries, size_t key_max, int shared);
+
+/**
+ * Opens a cache sized by ISOL8R_VERDICT_CACHE=N (default
+ * ISOL8R_CACHE_DEFAULT_ENTRIES, 0 disables). Problems go to stderr and
+ * leave the cache disabled.
+ *
+ * @param cache   Cache handle.
+ * @param program Name used in warnings.
+ * @param key_max As for isol8r_cache_open().
+ * @param shared  As for isol8r_cache_open().
+ */
+void isol8r_cache_from_env(struct isol8r_cache *cache, const char *program, size_t key_max, int shared);
+
+/**
+ * Unmaps the cache, e.g. in a child about to run untrusted code. Safe on a
+ * disabled cache.
+ *
+ * @param cache Cache handle.
+ */
+void isol8r_cache_close(struct isol8r_cache *cache);
+
+/**
+ * 64-bit non-cryptographic hash, eight bytes per step. Also what binaries
+ * fingerprint their rules with, chaining `seed` from one call to the next.
+ *
+ * @param data Bytes to hash.
+ * @param len  Number of bytes.
+ * @param seed Starting value.
+ * @return The hash.
+ */
+uint64_t isol8r_cache_hash(const void *data, size_t len, uint64_t seed);
+
+/**
+ * Looks a payload up.
+ *
+ * @param cache   Cache handle; a disabled cache always misses.
+ * @param version Fingerprint of the rules the verdict must have been made under.
+ * @param key     Payload bytes.
+ * @param len     Payload length.
+ * @param verdict Receives the cached verdict on a hit.
+ * @return 1 on a hit, 0 on a miss.
+ */
+int isol8r_cache_lookup(struct isol8r_cache *cache,
+                        uint64_t version,
+                        const void *key,
+                        size_t len,
+                        struct isol8r_cache_verdict *verdict);
+
+/**
+ * Remembers a verdict, evicting the set's least recently used entry if the
+ * set is full. Payloads over key_max, and sets that are busy, are skipped.
+ *
+ * @param cache   Cache handle; a disabled cache ignores the call.
+ * @param version As for isol8r_cache_lookup().
+ * @param key     Payload bytes.
+ * @param len     Payload length.
+ * @param verdict Verdict to remember.
+ */
+void isol8r_cache_store(struct isol8r_cache *cache,
+                        uint64_t version,
+                        const void *key,
+                        size_t len,
+                        const struct isol8r_cache_verdict *verdict);
+
+#endif /* ISOL8R_CACHE_H */
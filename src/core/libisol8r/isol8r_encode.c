@@ -0,0 +1,126 @@
+/**
+ * isol8r_encode.c - hex and base64 encoders for log records.
+ */
+
+#include "isol8r_encode.h"
+
+#include <string.h>
+
+/* Byte b encodes as hex_pairs[2 * b], hex_pairs[2 * b + 1]. */
+static const char hex_pairs[] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Sextet for each base64 character, -1 for anything else. */
+static const int8_t base64_values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+size_t isol8r_hex_encode(char *out, const uint8_t *data, size_t len, char separator) {
+    char *cursor = out;
+
+    if (len == 0) {
+        return 0;
+    }
+    if (!separator) {
+        for (size_t i = 0; i < len; ++i) {
+            memcpy(cursor, &hex_pairs[2u * data[i]], 2);
+            cursor += 2;
+        }
+        return (size_t)(cursor - out);
+    }
+
+    memcpy(cursor, &hex_pairs[2u * data[0]], 2);
+    cursor += 2;
+    for (size_t i = 1; i < len; ++i) {
+        cursor[0] = separator;
+        memcpy(cursor + 1, &hex_pairs[2u * data[i]], 2);
+        cursor += 3;
+    }
+    return (size_t)(cursor - out);
+}
+
+size_t isol8r_base64_encode(char *out, const uint8_t *data, size_t len) {
+    char *cursor = out;
+    size_t i = 0;
+
+    for (; i + 3 <= len; i += 3) {
+        const uint32_t group = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+        cursor[0] = base64_alphabet[group >> 18];
+        cursor[1] = base64_alphabet[(group >> 12) & 0x3fu];
+        cursor[2] = base64_alphabet[(group >> 6) & 0x3fu];
+        cursor[3] = base64_alphabet[group & 0x3fu];
+        cursor += 4;
+    }
+
+    if (i < len) {
+        const uint32_t group = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0u);
+        cursor[0] = base64_alphabet[group >> 18];
+        cursor[1] = base64_alphabet[(group >> 12) & 0x3fu];
+        cursor[2] = i + 1 < len ? base64_alphabet[(group >> 6) & 0x3fu] : '=';
+        cursor[3] = '=';
+        cursor += 4;
+    }
+    return (size_t)(cursor - out);
+}
+
+int isol8r_base64_decode(uint8_t *out, const char *text, size_t len, size_t *out_len) {
+    uint8_t *cursor = out;
+
+    if (len % 4 != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i += 4) {
+        const int last = i + 4 == len;
+        const int pad = last ? (text[i + 3] == '=') + (text[i + 2] == '=' && text[i + 3] == '=') : 0;
+        int32_t group = 0;
+        for (size_t j = 0; j < 4u - (size_t)pad; ++j) {
+            const int8_t value = base64_values[(uint8_t)text[i + j]];
+            if (value < 0) {
+                return -1;
+            }
+            group = group << 6 | value;
+        }
+        group <<= 6 * pad;
+        *cursor++ = (uint8_t)(group >> 16);
+        if (pad < 2) {
+            *cursor++ = (uint8_t)(group >> 8);
+        }
+        if (pad < 1) {
+            *cursor++ = (uint8_t)group;
+        }
+    }
+    *out_len = (size_t)(cursor - out);
+    return 0;
+}
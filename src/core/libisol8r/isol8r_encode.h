@@ -0,0 +1,55 @@
+/**
+ * isol8r_encode.h - table-driven hex and base64 encoders for log records.
+ *
+ * Both write straight into a caller-sized buffer instead of going through
+ * printf once per byte: hex costs one two-byte table copy per input byte,
+ * base64 one pass over three-byte groups. Neither writes a terminator, so
+ * an encoding can land in the middle of a record being assembled. A
+ * base64 decoder reads the payloads back when a log is replayed.
+ */
+
+#ifndef ISOL8R_ENCODE_H
+#define ISOL8R_ENCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Characters isol8r_hex_encode() produces for n bytes, with or without separators. */
+#define ISOL8R_HEX_LEN(n, separated) ((n) == 0 ? 0 : (separated) ? 3 * (n) - 1 : 2 * (n))
+
+/** Characters isol8r_base64_encode() produces for n bytes, padding included. */
+#define ISOL8R_BASE64_LEN(n) (((n) + 2) / 3 * 4)
+
+/**
+ * Lower-case hex, optionally with one separator between bytes: "2f 62 69".
+ *
+ * @param out       Destination, at least ISOL8R_HEX_LEN(len, separator != 0) bytes.
+ * @param data      Bytes to encode.
+ * @param len       Number of bytes.
+ * @param separator Character placed between bytes, or 0 for none.
+ * @return Characters written.
+ */
+size_t isol8r_hex_encode(char *out, const uint8_t *data, size_t len, char separator);
+
+/**
+ * Standard base64 (RFC 4648 alphabet, '=' padding, no line breaks).
+ *
+ * @param out  Destination, at least ISOL8R_BASE64_LEN(len) bytes.
+ * @param data Bytes to encode.
+ * @param len  Number of bytes.
+ * @return Characters written.
+ */
+size_t isol8r_base64_encode(char *out, const uint8_t *data, size_t len);
+
+/**
+ * Decodes standard padded base64 as isol8r_base64_encode() writes it.
+ *
+ * @param out     Destination, at least len / 4 * 3 bytes.
+ * @param text    Encoded characters; no whitespace.
+ * @param len     Number of characters, a multiple of four.
+ * @param out_len Receives the number of bytes decoded.
+ * @return 0 on success, -1 if text is not valid base64.
+ */
+int isol8r_base64_decode(uint8_t *out, const char *text, size_t len, size_t *out_len);
+
+#endif /* ISOL8R_ENCODE_H */
@@ -0,0 +1,926 @@
+/**
+ * isol8r_log.c - open-once, single-syscall bait log writer, with an
+ * optional batching flusher for the resident servers.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* "YYYY-MM-DDTHH:MM:SS" without the suffix. */
+#define ISOL8R_TIMESTAMP_BASE_LEN 19u
+
+/* Keeps a typo in ISOL8R_LOG_QUEUE from pinning gigabytes of shared memory. */
+#define ISOL8R_LOG_QUEUE_MIN_SLOTS 16u
+#define ISOL8R_LOG_QUEUE_MAX_SLOTS (1u << 16)
+
+/* The flusher wakes at least this often; a half-full queue wakes it early. */
+#define ISOL8R_LOG_FLUSH_MS 20u
+
+/* Slots gathered into one writev(2); well under IOV_MAX. */
+#define ISOL8R_LOG_BATCH 128
+
+/* A claimed slot still unpublished after this long belongs to a dead writer. */
+#define ISOL8R_LOG_STALE_MS 1000u
+
+/* How often the flusher looks at the file for a rotation, a rename or a truncation. */
+#define ISOL8R_LOG_CHECK_MS 1000u
+
+/* Distinct event keys tracked at once, and how far a key may land from its home entry. */
+#define ISOL8R_LOG_REPEAT_ENTRIES 64u
+#define ISOL8R_LOG_REPEAT_PROBES 4u
+
+/* Room for "tiny_vmmgr bait 'syscall (0x0f 0x05)' from 203.0.113.7". */
+#define ISOL8R_LOG_REPEAT_WHAT 96u
+
+/*
+ * The queue is a bounded MPSC ring of fixed-size slots (Vyukov's scheme).
+ * Each slot carries a sequence number: equal to the ticket a writer may
+ * claim it with while free, ticket + 1 once the record is in, and ticket +
+ * capacity after the flusher has written it out. Writers claim tickets with
+ * a CAS on tail and publish with a CAS on the slot, which lets the flusher
+ * reclaim a slot whose writer was killed half way without a race: whichever
+ * CAS lands first decides whether the record counts as written or dropped.
+ */
+struct isol8r_log_slot {
+    _Atomic uint64_t seq;
+    uint32_t length;
+    uint32_t reserved;
+    char data[ISOL8R_LOG_SLOT_BYTES];
+};
+
+_Static_assert(sizeof(struct isol8r_log_slot) == 1024, "log slot layout changed");
+
+/*
+ * One coalescing window. Entries are guarded by the same kind of pid
+ * try-lock as the verdict cache: a busy entry means the event is simply
+ * written, and an entry whose holder died is taken over. repeats is also
+ * read unlocked by the flusher's sweep, hence atomic.
+ */
+struct isol8r_log_repeat {
+    int32_t owner;                      /* pid holding the entry, 0 when free. */
+    uint32_t reserved;
+    uint64_t key;                       /* Key hash, 0 while unused. */
+    uint64_t since_ms;                  /* CLOCK_MONOTONIC start of the window. */
+    _Atomic uint64_t repeats;           /* Events counted, not written, since the last record. */
+    char what[ISOL8R_LOG_REPEAT_WHAT];  /* The key, rendered for the "repeated" record. */
+};
+
+struct isol8r_log_queue {
+    _Alignas(64) _Atomic uint64_t tail;   /* Next ticket handed to a writer. */
+    _Alignas(64) _Atomic uint64_t head;   /* Next ticket the flusher writes out. */
+    _Atomic uint32_t wake;                /* Futex word the flusher sleeps on. */
+    _Atomic uint32_t sleeping;
+    _Atomic uint32_t stop;
+    _Atomic uint64_t queued;
+    _Atomic uint64_t written;
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t direct;
+    _Atomic uint64_t fsyncs;
+    _Atomic uint64_t coalesced;
+
+    /* Set once before the flusher starts. */
+    uint32_t capacity;
+    uint32_t mask;
+    size_t mapping_size;
+    pid_t owner_pid;
+    int fd;
+    int millis;
+    unsigned fsync_ms;
+    unsigned coalesce_ms;
+    const char *path;
+    uint64_t rotate_bytes;
+    unsigned rotate_keep;
+    const char *owner;
+    pthread_t thread;
+
+    struct isol8r_log_repeat repeats[ISOL8R_LOG_REPEAT_ENTRIES];
+    struct isol8r_log_slot slots[];
+};
+
+void isol8r_log_from_env(struct isol8r_log *log) {
+    if (!log) {
+        return;
+    }
+    const char *millis = getenv("ISOL8R_LOG_MILLIS");
+    log->millis = millis && *millis && strcmp(millis, "0") != 0;
+
+    const char *bytes = getenv("ISOL8R_LOG_ROTATE_BYTES");
+    if (bytes && *bytes) {
+        char *end = NULL;
+        errno = 0;
+        unsigned long long parsed = strtoull(bytes, &end, 10);
+        unsigned shift = 0;
+        if (end && (*end == 'k' || *end == 'K')) {
+            shift = 10;
+            ++end;
+        } else if (end && (*end == 'm' || *end == 'M')) {
+            shift = 20;
+            ++end;
+        }
+        if (errno == 0 && end && *end == '\0' && bytes[0] != '-' && parsed <= (UINT64_MAX >> shift)) {
+            log->rotate_bytes = (uint64_t)parsed << shift;
+        }
+    }
+    const char *keep = getenv("ISOL8R_LOG_ROTATE_KEEP");
+    if (keep && *keep) {
+        char *end = NULL;
+        unsigned long parsed = strtoul(keep, &end, 10);
+        if (end && *end == '\0' && parsed >= 1 && parsed <= ISOL8R_LOG_ROTATE_MAX_KEEP) {
+            log->rotate_keep = (unsigned)parsed;
+        }
+    }
+}
+
+size_t isol8r_log_timestamp(char out[ISOL8R_TIMESTAMP_MAX], int with_millis) {
+    static _Thread_local time_t cached_second = (time_t)-1;
+    static _Thread_local char cached_text[ISOL8R_TIMESTAMP_MAX];
+
+    struct timespec now;
+    if (clock_gettime(CLOCK_REALTIME, &now) != 0) {
+        now.tv_sec = time(NULL);
+        now.tv_nsec = 0;
+    }
+
+    if (now.tv_sec != cached_second) {
+        struct tm stamp;
+        if (!gmtime_r(&now.tv_sec, &stamp) ||
+            strftime(cached_text, sizeof(cached_text), "%Y-%m-%dT%H:%M:%S", &stamp) != ISOL8R_TIMESTAMP_BASE_LEN) {
+            memcpy(cached_text, "1970-01-01T00:00:00", ISOL8R_TIMESTAMP_BASE_LEN + 1);
+        }
+        cached_second = now.tv_sec;
+    }
+
+    size_t length = ISOL8R_TIMESTAMP_BASE_LEN;
+    memcpy(out, cached_text, length);
+    if (with_millis) {
+        unsigned ms = (unsigned)(now.tv_nsec / 1000000L);
+        out[length++] = '.';
+        out[length++] = (char)('0' + ms / 100u);
+        out[length++] = (char)('0' + (ms / 10u) % 10u);
+        out[length++] = (char)('0' + ms % 10u);
+    }
+    out[length++] = 'Z';
+    out[length] = '\0';
+    return length;
+}
+
+static int isol8r_log_write_fd(int fd, const struct iovec *iov, int iovcnt, size_t total) {
+    ssize_t written;
+    do {
+        written = writev(fd, iov, iovcnt);
+    } while (written < 0 && errno == EINTR);
+    if (written < 0) {
+        return -1;
+    }
+    if ((size_t)written == total) {
+        return 0;
+    }
+
+    /*
+     * A short append on a regular file means the disk is full or a limit
+     * kicked in; finish the record piecemeal rather than leave half a line.
+     */
+    size_t skip = (size_t)written;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        const char *cursor = (const char *)iov[i].iov_base + skip;
+        size_t remaining = iov[i].iov_len - skip;
+        skip = 0;
+        while (remaining > 0) {
+            ssize_t step = write(fd, cursor, remaining);
+            if (step < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            cursor += step;
+            remaining -= (size_t)step;
+        }
+    }
+    return 0;
+}
+
+static int isol8r_log_open_path(const char *path) {
+    int fd;
+    do {
+        fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+    } while (fd < 0 && errno == EINTR);
+    return fd;
+}
+
+/* Reopens path onto fd itself, so every copy of the number in this process follows. */
+static int isol8r_log_reopen_fd(const char *path, int fd) {
+    const int fresh = isol8r_log_open_path(path);
+    if (fresh < 0) {
+        return -1;
+    }
+    if (fresh == fd) {
+        return 0;
+    }
+    int rc;
+    do {
+        rc = dup2(fresh, fd);
+    } while (rc < 0 && errno == EINTR);
+    close(fresh);
+    if (rc < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+/* Renames path.N (or path.N.gz) to path.N+1, dropping whatever was at path.keep. */
+static void isol8r_log_shift_segments(const char *path, unsigned keep) {
+    static const char *const suffixes[] = { "", ".gz" };
+    char from[PATH_MAX];
+    char to[PATH_MAX];
+
+    for (unsigned s = 0; s < 2; ++s) {
+        snprintf(to, sizeof(to), "%s.%u%s", path, keep, suffixes[s]);
+        unlink(to);
+    }
+    for (unsigned n = keep - 1u; n >= 1u; --n) {
+        for (unsigned s = 0; s < 2; ++s) {
+            snprintf(from, sizeof(from), "%s.%u%s", path, n, suffixes[s]);
+            snprintf(to, sizeof(to), "%s.%u%s", path, n + 1u, suffixes[s]);
+            rename(from, to);
+        }
+    }
+}
+
+/*
+ * Rotates the file behind fd once it has reached limit bytes, leaving fd on
+ * a fresh file. Every writer may try at once: the flock serialises them and
+ * the inode check makes all but the first see that the file at path is no
+ * longer theirs, so a file is never rotated twice. The lock is taken on the
+ * old file and never waited for. Returns 1 after a rotation, else 0.
+ */
+static int isol8r_log_rotate_fd(const char *path, int fd, uint64_t limit, unsigned keep) {
+    struct stat by_fd;
+    struct stat by_path;
+
+    if (limit == 0 || fstat(fd, &by_fd) != 0 || (uint64_t)by_fd.st_size < limit) {
+        return 0;
+    }
+    if (strlen(path) + sizeof(".99.gz") > PATH_MAX || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        return 0;
+    }
+    int rotated = 0;
+    if (stat(path, &by_path) == 0 && by_path.st_ino == by_fd.st_ino && by_path.st_dev == by_fd.st_dev) {
+        char first[PATH_MAX];
+        snprintf(first, sizeof(first), "%s.1", path);
+        isol8r_log_shift_segments(path, keep);
+        rotated = rename(path, first) == 0;
+    }
+    flock(fd, LOCK_UN);
+    return rotated && isol8r_log_reopen_fd(path, fd) == 0;
+}
+
+/* Writes one notice record straight to fd. */
+static void isol8r_log_notice(int fd, int millis, const char *owner, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void isol8r_log_notice(int fd, int millis, const char *owner, const char *fmt, ...) {
+    char record[512];
+    size_t length = isol8r_log_timestamp(record, millis);
+    int rest = snprintf(record + length, sizeof(record) - length, " | notice | %s%s",
+                        owner ? owner : "", owner ? ": " : "");
+    if (rest < 0 || (size_t)rest >= sizeof(record) - length) {
+        return;
+    }
+    length += (size_t)rest;
+
+    va_list args;
+    va_start(args, fmt);
+    rest = vsnprintf(record + length, sizeof(record) - length - 1u, fmt, args);
+    va_end(args);
+    if (rest < 0 || (size_t)rest >= sizeof(record) - length - 1u) {
+        return;
+    }
+    length += (size_t)rest;
+    record[length++] = '\n';
+
+    struct iovec iov = { .iov_base = record, .iov_len = length };
+    isol8r_log_write_fd(fd, &iov, 1, length);
+}
+
+int isol8r_log_open(struct isol8r_log *log) {
+    if (!log || !log->path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (log->fd >= 0) {
+        return 0;
+    }
+
+    const int fd = isol8r_log_open_path(log->path);
+    if (fd < 0) {
+        return -1;
+    }
+    log->fd = fd;
+
+    /* The only check a writer without a flusher makes; a one-shot run opens once. */
+    if (isol8r_log_rotate_fd(log->path, fd, log->rotate_bytes, log->rotate_keep)) {
+        isol8r_log_notice(fd, log->millis, NULL, "previous records are in %s.1", log->path);
+    }
+    return 0;
+}
+
+int isol8r_log_reopen(struct isol8r_log *log) {
+    if (!log || !log->path) {
+        errno = EINVAL;
+        return -1;
+    }
+    return log->fd < 0 ? 0 : isol8r_log_reopen_fd(log->path, log->fd);
+}
+
+static uint64_t isol8r_log_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000u + (uint64_t)now.tv_nsec / 1000000u;
+}
+
+static void isol8r_log_futex_wait(_Atomic uint32_t *word, uint32_t expected, unsigned ms) {
+    struct timespec timeout = { (time_t)(ms / 1000u), (long)(ms % 1000u) * 1000000L };
+    /* Not FUTEX_PRIVATE: writers may live in forked children. */
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void isol8r_log_kick(struct isol8r_log_queue *queue) {
+    if (atomic_load(&queue->sleeping)) {
+        atomic_store(&queue->wake, 1u);
+        syscall(SYS_futex, (uint32_t *)&queue->wake, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/*
+ * Copies one record into the queue. Returns 1 when the record is too long
+ * for a slot and the caller has to write it itself, 0 otherwise, including
+ * when the queue was full and the record was dropped.
+ */
+static int isol8r_log_enqueue(struct isol8r_log_queue *queue, const struct iovec *iov, int iovcnt, size_t total) {
+    if (total > ISOL8R_LOG_SLOT_BYTES) {
+        atomic_fetch_add_explicit(&queue->direct, 1u, memory_order_relaxed);
+        return 1;
+    }
+
+    struct isol8r_log_slot *slot;
+    uint64_t ticket = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    for (;;) {
+        slot = &queue->slots[ticket & queue->mask];
+        const uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        const int64_t lag = (int64_t)(seq - ticket);
+        if (lag == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &ticket, ticket + 1u,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            /* The slot still holds last lap's record: the queue is full. */
+            atomic_fetch_add_explicit(&queue->dropped, 1u, memory_order_relaxed);
+            isol8r_log_kick(queue);
+            return 0;
+        } else {
+            ticket = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    size_t used = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        memcpy(slot->data + used, iov[i].iov_base, iov[i].iov_len);
+        used += iov[i].iov_len;
+    }
+    slot->length = (uint32_t)used;
+
+    uint64_t expected = ticket;
+    if (!atomic_compare_exchange_strong_explicit(&slot->seq, &expected, ticket + 1u,
+                                                 memory_order_release, memory_order_relaxed)) {
+        /* We stalled long enough for the flusher to write the slot off. */
+        atomic_fetch_add_explicit(&queue->dropped, 1u, memory_order_relaxed);
+        return 0;
+    }
+    atomic_fetch_add_explicit(&queue->queued, 1u, memory_order_relaxed);
+
+    if (ticket + 1u - atomic_load_explicit(&queue->head, memory_order_relaxed) >= queue->capacity / 2u) {
+        isol8r_log_kick(queue);
+    }
+    return 0;
+}
+
+int isol8r_log_writev(struct isol8r_log *log, const struct iovec *iov, int iovcnt) {
+    if (isol8r_log_open(log) != 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+
+    if (log->queue && isol8r_log_enqueue(log->queue, iov, iovcnt, total) == 0) {
+        return 0;
+    }
+    return isol8r_log_write_fd(log->fd, iov, iovcnt, total);
+}
+
+int isol8r_log_printf(struct isol8r_log *log, const char *fmt, ...) {
+    char record[ISOL8R_LOG_RECORD_MAX];
+    va_list args;
+
+    va_start(args, fmt);
+    int length = vsnprintf(record, sizeof(record), fmt, args);
+    va_end(args);
+
+    if (length < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((size_t)length >= sizeof(record)) {
+        length = (int)sizeof(record) - 1;
+        memcpy(record + length - 4, "...\n", 4);
+    }
+
+    struct iovec iov = { .iov_base = record, .iov_len = (size_t)length };
+    return isol8r_log_writev(log, &iov, 1);
+}
+
+static uint64_t isol8r_log_key_hash(const struct isol8r_log_key *key) {
+    const char *parts[3] = { key->source, key->tag, key->client };
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+    /* FNV-1a over the strings, each closed by its NUL, then the pattern id and digest. */
+    for (unsigned i = 0; i < 3; ++i) {
+        for (const char *p = parts[i] ? parts[i] : ""; ; ++p) {
+            hash = (hash ^ (uint8_t)*p) * UINT64_C(0x100000001b3);
+            if (!*p) {
+                break;
+            }
+        }
+    }
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((key->pattern >> shift) & 0xffu)) * UINT64_C(0x100000001b3);
+    }
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        hash = (hash ^ ((key->digest >> shift) & 0xffu)) * UINT64_C(0x100000001b3);
+    }
+    return hash ? hash : 1u;
+}
+
+static int isol8r_log_repeat_lock(struct isol8r_log_repeat *entry) {
+    const int32_t self = (int32_t)getpid();
+    int32_t owner = 0;
+    if (__atomic_compare_exchange_n(&entry->owner, &owner, self, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+    if (owner == self || kill((pid_t)owner, 0) == 0 || errno != ESRCH) {
+        return 0;
+    }
+    return __atomic_compare_exchange_n(&entry->owner, &owner, self, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void isol8r_log_repeat_unlock(struct isol8r_log_repeat *entry) {
+    __atomic_store_n(&entry->owner, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Locks the entry holding this key or, failing that, the least recently
+ * windowed of its probe entries, which an empty one always is. NULL when
+ * every probe entry is busy.
+ */
+static struct isol8r_log_repeat *isol8r_log_repeat_claim(struct isol8r_log_queue *queue, uint64_t hash) {
+    struct isol8r_log_repeat *oldest = NULL;
+    for (unsigned probe = 0; probe < ISOL8R_LOG_REPEAT_PROBES; ++probe) {
+        struct isol8r_log_repeat *entry = &queue->repeats[(hash + probe) & (ISOL8R_LOG_REPEAT_ENTRIES - 1u)];
+        if (!isol8r_log_repeat_lock(entry)) {
+            continue;
+        }
+        if (entry->key == hash) {
+            if (oldest) {
+                isol8r_log_repeat_unlock(oldest);
+            }
+            return entry;
+        }
+        if (!oldest || entry->since_ms < oldest->since_ms) {
+            if (oldest) {
+                isol8r_log_repeat_unlock(oldest);
+            }
+            oldest = entry;
+        } else {
+            isol8r_log_repeat_unlock(entry);
+        }
+    }
+    return oldest;
+}
+
+static void isol8r_log_repeat_describe(char what[ISOL8R_LOG_REPEAT_WHAT], const struct isol8r_log_key *key) {
+    char pattern[48] = "";
+    if (key->label) {
+        snprintf(pattern, sizeof(pattern), " '%s'", key->label);
+    } else if (key->pattern != ISOL8R_LOG_NO_PATTERN) {
+        snprintf(pattern, sizeof(pattern), " #%u", key->pattern);
+    }
+    snprintf(what, ISOL8R_LOG_REPEAT_WHAT, "%s %s%s%s%s",
+             key->source ? key->source : "isol8r", key->tag ? key->tag : "event", pattern,
+             key->client ? " from " : "", key->client ? key->client : "");
+}
+
+/* Formats the record standing in for `count` events that were only counted. */
+static size_t isol8r_log_format_repeats(char *record, size_t size, int millis,
+                                        const char *what, uint64_t count, uint64_t span_ms) {
+    size_t length = isol8r_log_timestamp(record, millis);
+    int rest = snprintf(record + length, size - length, " | repeated | %s: %llu more in %llu ms\n",
+                        what, (unsigned long long)count, (unsigned long long)span_ms);
+    if (rest < 0 || (size_t)rest >= size - length) {
+        return 0;
+    }
+    return length + (size_t)rest;
+}
+
+int isol8r_log_event(struct isol8r_log *log, const struct isol8r_log_key *key, const struct iovec *iov, int iovcnt) {
+    struct isol8r_log_queue *queue = log ? log->queue : NULL;
+    if (!key || !queue || queue->coalesce_ms == 0) {
+        return isol8r_log_writev(log, iov, iovcnt);
+    }
+
+    const uint64_t hash = isol8r_log_key_hash(key);
+    struct isol8r_log_repeat *entry = isol8r_log_repeat_claim(queue, hash);
+    if (!entry) {
+        return isol8r_log_writev(log, iov, iovcnt);
+    }
+
+    const uint64_t now = isol8r_log_monotonic_ms();
+    if (entry->key == hash && now - entry->since_ms < queue->coalesce_ms) {
+        atomic_fetch_add_explicit(&entry->repeats, 1u, memory_order_relaxed);
+        isol8r_log_repeat_unlock(entry);
+        atomic_fetch_add_explicit(&queue->coalesced, 1u, memory_order_relaxed);
+        return 0;
+    }
+
+    /* A new window: settle what the old one, or the key evicted here, still owes. */
+    char what[ISOL8R_LOG_REPEAT_WHAT];
+    const uint64_t owed = atomic_exchange_explicit(&entry->repeats, 0u, memory_order_relaxed);
+    const uint64_t span_ms = now - entry->since_ms;
+    if (owed > 0) {
+        memcpy(what, entry->what, sizeof(what));
+    }
+    if (entry->key != hash) {
+        entry->key = hash;
+        isol8r_log_repeat_describe(entry->what, key);
+    }
+    entry->since_ms = now;
+    isol8r_log_repeat_unlock(entry);
+
+    if (owed > 0) {
+        char record[256];
+        const size_t length = isol8r_log_format_repeats(record, sizeof(record), log->millis, what, owed, span_ms);
+        if (length > 0) {
+            struct iovec note = { .iov_base = record, .iov_len = length };
+            isol8r_log_writev(log, &note, 1);
+        }
+    }
+    return isol8r_log_writev(log, iov, iovcnt);
+}
+
+/*
+ * Writes a "repeated" record for every window that has closed with events
+ * still counted, or for every window with any when the flusher stops.
+ * Returns nonzero when it wrote something.
+ */
+static int isol8r_log_sweep_repeats(struct isol8r_log_queue *queue, uint64_t now, int all) {
+    int wrote = 0;
+    for (unsigned i = 0; i < ISOL8R_LOG_REPEAT_ENTRIES; ++i) {
+        struct isol8r_log_repeat *entry = &queue->repeats[i];
+        if (atomic_load_explicit(&entry->repeats, memory_order_relaxed) == 0 || !isol8r_log_repeat_lock(entry)) {
+            continue;
+        }
+        char what[ISOL8R_LOG_REPEAT_WHAT];
+        uint64_t owed = 0;
+        /* Writers stamp windows with their own clock reads, which may be newer than ours. */
+        const uint64_t span_ms = now > entry->since_ms ? now - entry->since_ms : 0;
+        if (all || span_ms >= queue->coalesce_ms) {
+            owed = atomic_exchange_explicit(&entry->repeats, 0u, memory_order_relaxed);
+            memcpy(what, entry->what, sizeof(what));
+        }
+        isol8r_log_repeat_unlock(entry);
+
+        char record[256];
+        const size_t length = owed > 0 ? isol8r_log_format_repeats(record, sizeof(record), queue->millis,
+                                                                   what, owed, span_ms) : 0;
+        if (length > 0) {
+            struct iovec iov = { .iov_base = record, .iov_len = length };
+            isol8r_log_write_fd(queue->fd, &iov, 1, length);
+            wrote = 1;
+        }
+    }
+    return wrote;
+}
+
+/* Writes the flusher's own note about records it could not keep. */
+static void isol8r_log_report_drops(struct isol8r_log_queue *queue, uint64_t fresh, uint64_t total) {
+    isol8r_log_notice(queue->fd, queue->millis, queue->owner, "log queue dropped %llu records (%llu since start)",
+                      (unsigned long long)fresh, (unsigned long long)total);
+}
+
+/* What the flusher last saw of its file; size also counts what it wrote since. */
+struct isol8r_log_seen {
+    dev_t dev;
+    ino_t ino;
+    uint64_t size;
+};
+
+/*
+ * The flusher's periodic look at the file: rotates it when due, follows a
+ * rename or deletion by somebody else (another server's rotation, or an
+ * operator), and notes a file that shrank. Returns nonzero when it wrote.
+ */
+static int isol8r_log_maintain(struct isol8r_log_queue *queue, struct isol8r_log_seen *seen) {
+    struct stat by_fd;
+    struct stat by_path;
+    int wrote = 0;
+
+    if (isol8r_log_rotate_fd(queue->path, queue->fd, queue->rotate_bytes, queue->rotate_keep)) {
+        isol8r_log_notice(queue->fd, queue->millis, queue->owner, "previous records are in %s.1", queue->path);
+        wrote = 1;
+    } else if (stat(queue->path, &by_path) != 0 || fstat(queue->fd, &by_fd) != 0 ||
+               by_path.st_ino != by_fd.st_ino || by_path.st_dev != by_fd.st_dev) {
+        wrote = isol8r_log_reopen_fd(queue->path, queue->fd) == 0;
+    }
+    if (fstat(queue->fd, &by_fd) != 0) {
+        return wrote;
+    }
+
+    /*
+     * Appends only ever grow the file, so the same inode coming up short of
+     * what we saw plus what we wrote since was truncated. A new inode
+     * (rotation, reopen or SIGHUP) starts over.
+     */
+    if (by_fd.st_dev == seen->dev && by_fd.st_ino == seen->ino && (uint64_t)by_fd.st_size < seen->size) {
+        isol8r_log_notice(queue->fd, queue->millis, queue->owner,
+                          "%s holds %llu bytes, short of the %llu appended so far; it was truncated",
+                          queue->path, (unsigned long long)by_fd.st_size, (unsigned long long)seen->size);
+        wrote = 1;
+        fstat(queue->fd, &by_fd);
+    }
+    seen->dev = by_fd.st_dev;
+    seen->ino = by_fd.st_ino;
+    seen->size = (uint64_t)by_fd.st_size;
+    return wrote;
+}
+
+static void *isol8r_log_flusher(void *arg) {
+    struct isol8r_log_queue *queue = arg;
+    struct iovec batch[ISOL8R_LOG_BATCH];
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint64_t reported = 0;
+    uint64_t last_sync = isol8r_log_monotonic_ms();
+    uint64_t stalled_at = 0;
+    uint64_t stalled_since = 0;
+    uint64_t last_check = 0;
+    struct isol8r_log_seen seen = { 0, 0, 0 };
+    int dirty = 0;
+
+    for (;;) {
+        int count = 0;
+        size_t total = 0;
+        while (count < ISOL8R_LOG_BATCH) {
+            struct isol8r_log_slot *slot = &queue->slots[(head + (uint64_t)count) & queue->mask];
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != head + (uint64_t)count + 1u) {
+                break;
+            }
+            /* Writers share the mapping; never trust a length past the slot. */
+            const size_t length = slot->length <= ISOL8R_LOG_SLOT_BYTES ? slot->length : ISOL8R_LOG_SLOT_BYTES;
+            batch[count].iov_base = slot->data;
+            batch[count].iov_len = length;
+            total += length;
+            ++count;
+        }
+
+        if (count > 0) {
+            if (isol8r_log_write_fd(queue->fd, batch, count, total) == 0) {
+                atomic_fetch_add_explicit(&queue->written, (uint64_t)count, memory_order_relaxed);
+                seen.size += total;
+                dirty = 1;
+            } else {
+                atomic_fetch_add_explicit(&queue->dropped, (uint64_t)count, memory_order_relaxed);
+            }
+            for (int i = 0; i < count; ++i) {
+                atomic_store_explicit(&queue->slots[(head + (uint64_t)i) & queue->mask].seq,
+                                      head + (uint64_t)i + queue->capacity, memory_order_release);
+            }
+            head += (uint64_t)count;
+            atomic_store_explicit(&queue->head, head, memory_order_release);
+            if (count == ISOL8R_LOG_BATCH) {
+                continue;
+            }
+        }
+
+        const uint64_t now = isol8r_log_monotonic_ms();
+        const uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (tail != head) {
+            /* The next record is claimed but not in yet; give its writer a while. */
+            if (stalled_since == 0 || stalled_at != head) {
+                stalled_at = head;
+                stalled_since = now;
+            } else if (now - stalled_since >= ISOL8R_LOG_STALE_MS) {
+                struct isol8r_log_slot *slot = &queue->slots[head & queue->mask];
+                uint64_t expected = head;
+                if (atomic_compare_exchange_strong_explicit(&slot->seq, &expected, head + queue->capacity,
+                                                            memory_order_acq_rel, memory_order_acquire)) {
+                    atomic_fetch_add_explicit(&queue->dropped, 1u, memory_order_relaxed);
+                    ++head;
+                    atomic_store_explicit(&queue->head, head, memory_order_release);
+                }
+                stalled_since = 0;
+                continue;
+            }
+        } else {
+            stalled_since = 0;
+        }
+
+        if (queue->coalesce_ms > 0 && isol8r_log_sweep_repeats(queue, now, 0)) {
+            dirty = 1;
+        }
+
+        if (now - last_check >= ISOL8R_LOG_CHECK_MS) {
+            if (isol8r_log_maintain(queue, &seen)) {
+                dirty = 1;
+            }
+            last_check = now;
+        }
+
+        const uint64_t dropped = atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+        if (dropped != reported) {
+            isol8r_log_report_drops(queue, dropped - reported, dropped);
+            reported = dropped;
+            dirty = 1;
+        }
+
+        if (dirty && queue->fsync_ms > 0 && now - last_sync >= queue->fsync_ms) {
+            fdatasync(queue->fd);
+            atomic_fetch_add_explicit(&queue->fsyncs, 1u, memory_order_relaxed);
+            last_sync = now;
+            dirty = 0;
+        }
+
+        if (atomic_load(&queue->stop) && tail == head) {
+            break;
+        }
+
+        atomic_store(&queue->wake, 0u);
+        atomic_store(&queue->sleeping, 1u);
+        if (!atomic_load(&queue->stop)) {
+            isol8r_log_futex_wait(&queue->wake, 0u, ISOL8R_LOG_FLUSH_MS);
+        }
+        atomic_store(&queue->sleeping, 0u);
+    }
+
+    if (queue->coalesce_ms > 0 && isol8r_log_sweep_repeats(queue, isol8r_log_monotonic_ms(), 1)) {
+        dirty = 1;
+    }
+    if (dirty && queue->fsync_ms > 0) {
+        fdatasync(queue->fd);
+        atomic_fetch_add_explicit(&queue->fsyncs, 1u, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static unsigned isol8r_log_env_unsigned(const char *name, unsigned fallback, unsigned limit) {
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        return fallback;
+    }
+    char *end = NULL;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (!end || *end != '\0' || parsed > limit) {
+        return fallback;
+    }
+    return (unsigned)parsed;
+}
+
+int isol8r_log_start_flusher(struct isol8r_log *log, const char *owner) {
+    if (!log) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (log->queue) {
+        return 0;
+    }
+
+    uint32_t capacity = isol8r_log_env_unsigned("ISOL8R_LOG_QUEUE", ISOL8R_LOG_QUEUE_DEFAULT_SLOTS,
+                                                ISOL8R_LOG_QUEUE_MAX_SLOTS);
+    if (capacity == 0) {
+        return 1;
+    }
+    uint32_t slots = ISOL8R_LOG_QUEUE_MIN_SLOTS;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    if (isol8r_log_open(log) != 0) {
+        return -1;
+    }
+
+    const size_t size = sizeof(struct isol8r_log_queue) + (size_t)slots * sizeof(struct isol8r_log_slot);
+    struct isol8r_log_queue *queue = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (queue == MAP_FAILED) {
+        return -1;
+    }
+
+    /* The mapping starts zeroed, repeat table included; only the slot tickets need seeding. */
+    for (uint32_t i = 0; i < slots; ++i) {
+        atomic_init(&queue->slots[i].seq, (uint64_t)i);
+    }
+    queue->capacity = slots;
+    queue->mask = slots - 1u;
+    queue->mapping_size = size;
+    queue->owner_pid = getpid();
+    queue->fd = log->fd;
+    queue->millis = log->millis;
+    queue->fsync_ms = isol8r_log_env_unsigned("ISOL8R_LOG_FSYNC_MS", ISOL8R_LOG_FSYNC_DEFAULT_MS, 86400000u);
+    queue->coalesce_ms = isol8r_log_env_unsigned("ISOL8R_LOG_COALESCE_MS", ISOL8R_LOG_COALESCE_DEFAULT_MS, 3600000u);
+    queue->path = log->path;
+    queue->rotate_bytes = log->rotate_bytes;
+    queue->rotate_keep = log->rotate_keep;
+    queue->owner = owner ? owner : "isol8r";
+
+    /* The thread inherits a full mask, so SIGHUP and friends stay with the caller. */
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    const int rc = pthread_create(&queue->thread, NULL, isol8r_log_flusher, queue);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    if (rc != 0) {
+        munmap(queue, size);
+        errno = rc;
+        return -1;
+    }
+
+    log->queue = queue;
+    return 0;
+}
+
+void isol8r_log_stop_flusher(struct isol8r_log *log) {
+    if (!log || !log->queue) {
+        return;
+    }
+    struct isol8r_log_queue *queue = log->queue;
+    log->queue = NULL;
+    if (queue->owner_pid != getpid()) {
+        /* A forked child: the thread belongs to the parent; just drop our view. */
+        munmap(queue, queue->mapping_size);
+        return;
+    }
+
+    atomic_store(&queue->stop, 1u);
+    atomic_store(&queue->wake, 1u);
+    syscall(SYS_futex, (uint32_t *)&queue->wake, FUTEX_WAKE, 1, NULL, NULL, 0);
+    pthread_join(queue->thread, NULL);
+    munmap(queue, queue->mapping_size);
+}
+
+int isol8r_log_queue_stats(const struct isol8r_log *log, struct isol8r_log_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!log || !log->queue) {
+        return -1;
+    }
+    struct isol8r_log_queue *queue = log->queue;
+    stats->queued = atomic_load_explicit(&queue->queued, memory_order_relaxed);
+    stats->written = atomic_load_explicit(&queue->written, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+    stats->direct = atomic_load_explicit(&queue->direct, memory_order_relaxed);
+    stats->fsyncs = atomic_load_explicit(&queue->fsyncs, memory_order_relaxed);
+    stats->coalesced = atomic_load_explicit(&queue->coalesced, memory_order_relaxed);
+    stats->capacity = queue->capacity;
+    return 0;
+}
+
+void isol8r_log_close(struct isol8r_log *log) {
+    isol8r_log_stop_flusher(log);
+    if (log && log->fd >= 0) {
+        close(log->fd);
+        log->fd = -1;
+    }
+}
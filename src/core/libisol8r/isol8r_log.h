@@ -0,0 +1,232 @@
+/**
+ * isol8r_log.h - shared bait log writer for the sandbox binaries.
+ *
+ * The log is opened once with O_APPEND and kept open; each record is
+ * assembled in a stack buffer (or an iovec) and handed to the kernel in a
+ * single write(2)/writev(2), so concurrent writers never interleave within
+ * a record and the hot path costs one syscall instead of five.
+ *
+ * Resident servers can go one step further with isol8r_log_start_flusher():
+ * records are then copied into a bounded lock-free queue in shared memory
+ * and a background thread appends them in batches, so a request never
+ * waits on the disk. The queue lives in a MAP_SHARED mapping, which keeps
+ * it usable from children forked after the flusher started. A full queue
+ * drops the record and counts it rather than stall the writer; the flusher
+ * notes every drop in the log itself.
+ *
+ * While a flusher runs, isol8r_log_event() also coalesces: the first event
+ * with a given (source, tag, pattern, client, digest) key in a window is
+ * written in full, later ones in the same window are only counted, and once the window
+ * closes a single "repeated" record carries the count. A different key is
+ * written straight away, so a script hammering one keyword costs two
+ * records per window instead of one per request, and anything new still
+ * shows up at once. The window table sits in the queue mapping and is
+ * shared the same way.
+ *
+ * Upkeep stays off the request path too. Once the file reaches
+ * rotate_bytes it is renamed to <path>.1, older segments shift up to
+ * <path>.<rotate_keep> (a segment compressed to .gz in the meantime shifts
+ * with them) and a fresh file takes its place. The flusher checks about
+ * once a second, between batches. Writers without one check once, when they
+ * open the log. Every process keeps its descriptor number across a
+ * rotation or reopen, so each copy of it in the process follows. The
+ * flusher likewise picks up a file renamed or deleted under it, and leaves
+ * a notice when the file shrinks, which means someone truncated it.
+ */
+
+#ifndef ISOL8R_LOG_H
+#define ISOL8R_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/** Largest record isol8r_log_printf() will build; longer ones are truncated. */
+#define ISOL8R_LOG_RECORD_MAX 4096u
+
+/** Room for "YYYY-MM-DDTHH:MM:SS.mmmZ" plus the terminator. */
+#define ISOL8R_TIMESTAMP_MAX 32u
+
+/** Queue slots used when ISOL8R_LOG_QUEUE is unset. */
+#define ISOL8R_LOG_QUEUE_DEFAULT_SLOTS 1024u
+
+/** Largest record a queue slot holds; longer ones are written synchronously. */
+#define ISOL8R_LOG_SLOT_BYTES 1008u
+
+/** fsync interval used when ISOL8R_LOG_FSYNC_MS is unset. */
+#define ISOL8R_LOG_FSYNC_DEFAULT_MS 1000u
+
+/** Size that triggers a rotation when ISOL8R_LOG_ROTATE_BYTES is unset. */
+#define ISOL8R_LOG_ROTATE_DEFAULT_BYTES (8u * 1024u * 1024u)
+
+/** Rotated segments kept when ISOL8R_LOG_ROTATE_KEEP is unset. */
+#define ISOL8R_LOG_ROTATE_DEFAULT_KEEP 5u
+
+/** Upper bound on ISOL8R_LOG_ROTATE_KEEP. */
+#define ISOL8R_LOG_ROTATE_MAX_KEEP 99u
+
+/** Coalescing window used when ISOL8R_LOG_COALESCE_MS is unset. */
+#define ISOL8R_LOG_COALESCE_DEFAULT_MS 1000u
+
+/** pattern value for events that are not keyword or detector hits. */
+#define ISOL8R_LOG_NO_PATTERN UINT32_MAX
+
+/** Shared record queue drained by the flusher thread; see isol8r_log.c. */
+struct isol8r_log_queue;
+
+/** A lazily opened append-only log. */
+struct isol8r_log {
+    const char *path;               /**< File the records go to. */
+    int fd;                         /**< Open descriptor, -1 until first use. */
+    int millis;                     /**< Nonzero to add a .mmm suffix to timestamps. */
+    struct isol8r_log_queue *queue; /**< Set while a flusher owns the writes, else NULL. */
+    uint64_t rotate_bytes;          /**< Rotate once the file is this large; 0 never rotates. */
+    unsigned rotate_keep;           /**< Rotated segments kept, 1..ISOL8R_LOG_ROTATE_MAX_KEEP. */
+};
+
+/** Static initialiser: struct isol8r_log log = ISOL8R_LOG_INIT("/path"); */
+#define ISOL8R_LOG_INIT(log_path) \
+    { (log_path), -1, 0, NULL, ISOL8R_LOG_ROTATE_DEFAULT_BYTES, ISOL8R_LOG_ROTATE_DEFAULT_KEEP }
+
+/** What makes two events repeats of each other. Only source, tag, pattern, client and digest are compared. */
+struct isol8r_log_key {
+    const char *source;     /**< Writer, e.g. "tiny_vmmgr". */
+    const char *tag;        /**< Record kind: "alert", "bait", ... */
+    uint32_t pattern;       /**< Keyword or detector id, or ISOL8R_LOG_NO_PATTERN. */
+    const char *label;      /**< Pattern name for the "repeated" record; NULL prints the id. */
+    const char *client;     /**< Who sent the input, NULL when the writer cannot tell. */
+    uint64_t digest;        /**< Hash of the record's text when that tells events apart, else 0. */
+};
+
+/** Counters kept by a running flusher, shared by every process using it. */
+struct isol8r_log_stats {
+    uint64_t queued;    /**< Records accepted onto the queue. */
+    uint64_t written;   /**< Records the flusher appended to the file. */
+    uint64_t dropped;   /**< Records lost: queue full, writer died mid-record, or the append failed. */
+    uint64_t direct;    /**< Records too long for a slot, written by the caller instead. */
+    uint64_t fsyncs;    /**< fdatasync() calls made by the flusher. */
+    uint64_t coalesced; /**< Events counted as repeats instead of written. */
+    uint32_t capacity;  /**< Queue slots. */
+};
+
+/**
+ * Applies deployment knobs from the environment:
+ *   ISOL8R_LOG_MILLIS=1            append milliseconds to every timestamp.
+ *   ISOL8R_LOG_ROTATE_BYTES=N[k|m] rotate at this size; 0 never rotates.
+ *   ISOL8R_LOG_ROTATE_KEEP=N       rotated segments kept.
+ * Malformed values keep the defaults.
+ *
+ * @param log Log handle.
+ */
+void isol8r_log_from_env(struct isol8r_log *log);
+
+/**
+ * Writes the current UTC time in the one format every writer agrees on,
+ * ISO 8601 with a Z suffix: 2025-09-28T07:00:00Z (or ...07:00:00.123Z).
+ * The calendar part is cached per thread and only rebuilt when the second
+ * changes, so steady traffic costs one clock_gettime() per record.
+ *
+ * @param out         Destination buffer, at least ISOL8R_TIMESTAMP_MAX bytes.
+ * @param with_millis Nonzero to include milliseconds.
+ * @return Length written, excluding the terminator.
+ */
+size_t isol8r_log_timestamp(char out[ISOL8R_TIMESTAMP_MAX], int with_millis);
+
+/**
+ * Opens the log if it is not open yet. Called implicitly by the writers.
+ *
+ * @param log Log handle.
+ * @return 0 when the descriptor is usable, -1 with errno set otherwise.
+ */
+int isol8r_log_open(struct isol8r_log *log);
+
+/**
+ * Points the log at whatever file now sits at its path, e.g. on SIGHUP after
+ * an outside rotation. The descriptor number stays the same, so a running
+ * flusher follows. Does nothing if the log is not open yet.
+ *
+ * @param log Log handle.
+ * @return 0 on success, -1 with errno set (the old file stays in use).
+ */
+int isol8r_log_reopen(struct isol8r_log *log);
+
+/**
+ * Emits one record made of several pieces with a single writev(2).
+ *
+ * @param log    Log handle.
+ * @param iov    Record pieces, already including the trailing newline.
+ * @param iovcnt Number of pieces.
+ * @return 0 on success, -1 with errno set on failure.
+ */
+int isol8r_log_writev(struct isol8r_log *log, const struct iovec *iov, int iovcnt);
+
+/**
+ * Emits one event record, or counts it as a repeat of an earlier one with
+ * the same key in the current coalescing window. Without a running flusher,
+ * or with coalescing off, this is isol8r_log_writev().
+ *
+ * @param log    Log handle.
+ * @param key    Event identity; NULL never coalesces.
+ * @param iov    Record pieces, already including the trailing newline.
+ * @param iovcnt Number of pieces.
+ * @return 0 on success, counted repeats included; -1 with errno set on failure.
+ */
+int isol8r_log_event(struct isol8r_log *log, const struct isol8r_log_key *key, const struct iovec *iov, int iovcnt);
+
+/**
+ * Formats one record into a stack buffer and emits it with a single write.
+ * Records longer than ISOL8R_LOG_RECORD_MAX are cut and end in "...\n".
+ *
+ * @param log Log handle.
+ * @param fmt printf-style format; include the trailing newline yourself.
+ * @return 0 on success, -1 with errno set on failure.
+ */
+int isol8r_log_printf(struct isol8r_log *log, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Closes the descriptor, stopping the flusher first; the next write reopens it.
+ *
+ * @param log Log handle.
+ */
+void isol8r_log_close(struct isol8r_log *log);
+
+/**
+ * Moves the log's appends onto a background flusher thread. The queue is
+ * sized and tuned from the environment:
+ *   ISOL8R_LOG_QUEUE=<slots>     queue slots, rounded up to a power of two;
+ *                                0 keeps every write synchronous.
+ *   ISOL8R_LOG_FSYNC_MS=<ms>     fdatasync() at most this often while
+ *                                records arrive; 0 leaves it to the kernel.
+ *   ISOL8R_LOG_COALESCE_MS=<ms>  isol8r_log_event() coalescing window;
+ *                                0 writes every event.
+ * Call it before forking workers so they share the queue. The flusher
+ * blocks every signal, so process-directed signals keep reaching the
+ * caller's thread.
+ *
+ * @param log   Log handle.
+ * @param owner Name used in the flusher's own notices, e.g. "tiny_vmmgr".
+ * @return 0 when the flusher runs, 1 when the environment disabled it,
+ *         -1 with errno set when it could not start (writes stay synchronous).
+ */
+int isol8r_log_start_flusher(struct isol8r_log *log, const char *owner);
+
+/**
+ * Drains the queue, writes the pending repeat counts, fsyncs if an
+ * interval is configured and joins the flusher. In a process forked from the one that started it, only unmaps
+ * the queue so later writes there go straight to the file; do that before
+ * running anything untrusted. Safe to call when no flusher runs.
+ *
+ * @param log Log handle.
+ */
+void isol8r_log_stop_flusher(struct isol8r_log *log);
+
+/**
+ * Reads the flusher counters.
+ *
+ * @param log   Log handle.
+ * @param stats Receives the counters; zeroed when no flusher runs.
+ * @return 0 when a flusher runs, -1 otherwise.
+ */
+int isol8r_log_queue_stats(const struct isol8r_log *log, struct isol8r_log_stats *stats);
+
+#endif /* ISOL8R_LOG_H */
@@ -0,0 +1,437 @@
+/**
+ * isol8r_match.c - Aho-Corasick automaton construction and scanning.
+ *
+ * Construction builds a trie over case-folded, class-compressed bytes,
+ * then resolves failure links breadth-first into a dense transition table
+ * so scanning never backtracks: one table lookup per input byte plus a
+ * short walk of the output chain when a state reports.
+ */
+
+#include "isol8r_match.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ISOL8R_MATCH_NONE UINT32_MAX
+
+static uint8_t isol8r_fold(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c - 'A' + 'a') : c;
+}
+
+int isol8r_match_build(struct isol8r_matcher *matcher, const struct isol8r_pattern *patterns, size_t count) {
+    if (!matcher || !patterns || count == 0 || count >= ISOL8R_MATCH_NONE) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(matcher, 0, sizeof(*matcher));
+
+    /* Alphabet compression: every folded byte used by a pattern gets a class. */
+    uint8_t used[256] = {0};
+    size_t total_bytes = 0;
+    size_t max_length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!patterns[i].bytes || patterns[i].length == 0 || patterns[i].length > ISOL8R_MATCH_MAX_PATTERN) {
+            errno = EINVAL;
+            return -1;
+        }
+        for (size_t j = 0; j < patterns[i].length; ++j) {
+            used[isol8r_fold(patterns[i].bytes[j])] = 1;
+        }
+        total_bytes += patterns[i].length;
+        if (patterns[i].length > max_length) {
+            max_length = patterns[i].length;
+        }
+    }
+
+    uint8_t folded_class[256] = {0};
+    uint32_t class_count = 1;
+    for (size_t c = 0; c < 256; ++c) {
+        if (used[c]) {
+            folded_class[c] = (uint8_t)class_count++;
+        }
+    }
+    for (size_t c = 0; c < 256; ++c) {
+        matcher->byte_class[c] = folded_class[isol8r_fold((uint8_t)c)];
+    }
+
+    const size_t max_states = total_bytes + 1;
+    uint32_t *trie = malloc(max_states * class_count * sizeof(*trie));
+    uint32_t *out_head = calloc(max_states, sizeof(*out_head));
+    uint32_t *fail = calloc(max_states, sizeof(*fail));
+    uint32_t *dict_link = calloc(max_states, sizeof(*dict_link));
+    uint32_t *queue = malloc(max_states * sizeof(*queue));
+    uint32_t *pat_next = calloc(count, sizeof(*pat_next));
+    if (!trie || !out_head || !fail || !dict_link || !queue || !pat_next) {
+        free(trie);
+        free(out_head);
+        free(fail);
+        free(dict_link);
+        free(queue);
+        free(pat_next);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < max_states * class_count; ++i) {
+        trie[i] = ISOL8R_MATCH_NONE;
+    }
+
+    uint32_t state_count = 1;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t state = 0;
+        for (size_t j = 0; j < patterns[i].length; ++j) {
+            uint32_t cls = matcher->byte_class[patterns[i].bytes[j]];
+            uint32_t *slot = &trie[(size_t)state * class_count + cls];
+            if (*slot == ISOL8R_MATCH_NONE) {
+                *slot = state_count++;
+            }
+            state = *slot;
+        }
+        pat_next[i] = out_head[state];
+        out_head[state] = (uint32_t)i + 1u;
+    }
+
+    /* Breadth-first failure resolution turns the trie into a full DFA. */
+    size_t head = 0;
+    size_t tail = 0;
+    for (uint32_t cls = 0; cls < class_count; ++cls) {
+        uint32_t *slot = &trie[cls];
+        if (*slot == ISOL8R_MATCH_NONE) {
+            *slot = 0;
+        } else {
+            fail[*slot] = 0;
+            queue[tail++] = *slot;
+        }
+    }
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        for (uint32_t cls = 0; cls < class_count; ++cls) {
+            uint32_t *slot = &trie[(size_t)state * class_count + cls];
+            uint32_t via_fail = trie[(size_t)fail[state] * class_count + cls];
+            if (*slot == ISOL8R_MATCH_NONE) {
+                *slot = via_fail;
+                continue;
+            }
+            uint32_t child = *slot;
+            fail[child] = via_fail;
+            dict_link[child] = out_head[via_fail] ? via_fail : dict_link[via_fail];
+            queue[tail++] = child;
+        }
+    }
+
+    /* Pack the final tables into one arena. */
+    const size_t next_words = (size_t)state_count * class_count;
+    const size_t words = next_words + 3u * state_count + 4u * count;
+    uint32_t *arena = malloc(words * sizeof(uint32_t) + total_bytes);
+    if (!arena) {
+        free(trie);
+        free(out_head);
+        free(fail);
+        free(dict_link);
+        free(queue);
+        free(pat_next);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    uint32_t *next = arena;
+    uint32_t *report = next + next_words;
+    uint32_t *final_out = report + state_count;
+    uint32_t *final_dict = final_out + state_count;
+    uint32_t *final_pat_next = final_dict + state_count;
+    uint32_t *pat_length = final_pat_next + count;
+    uint32_t *pat_flags = pat_length + count;
+    uint32_t *pat_offset = pat_flags + count;
+    uint8_t *pat_bytes = (uint8_t *)(pat_offset + count);
+
+    memcpy(next, trie, next_words * sizeof(uint32_t));
+    memcpy(final_out, out_head, state_count * sizeof(uint32_t));
+    memcpy(final_dict, dict_link, state_count * sizeof(uint32_t));
+    memcpy(final_pat_next, pat_next, count * sizeof(uint32_t));
+    for (uint32_t state = 0; state < state_count; ++state) {
+        report[state] = out_head[state] ? state : dict_link[state];
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        pat_length[i] = (uint32_t)patterns[i].length;
+        pat_flags[i] = patterns[i].flags;
+        pat_offset[i] = (uint32_t)offset;
+        memcpy(pat_bytes + offset, patterns[i].bytes, patterns[i].length);
+        offset += patterns[i].length;
+    }
+
+    free(trie);
+    free(out_head);
+    free(fail);
+    free(dict_link);
+    free(queue);
+    free(pat_next);
+
+    matcher->state_count = state_count;
+    matcher->class_count = class_count;
+    matcher->pattern_count = (uint32_t)count;
+    matcher->max_length = (uint32_t)max_length;
+    matcher->next = next;
+    matcher->report = report;
+    matcher->out_head = final_out;
+    matcher->dict_link = final_dict;
+    matcher->pat_next = final_pat_next;
+    matcher->pat_length = pat_length;
+    matcher->pat_flags = pat_flags;
+    matcher->pat_offset = pat_offset;
+    matcher->pat_bytes = pat_bytes;
+    matcher->arena_size = words * sizeof(uint32_t) + total_bytes;
+    matcher->arena = arena;
+    return 0;
+}
+
+void isol8r_match_free(struct isol8r_matcher *matcher) {
+    if (!matcher) {
+        return;
+    }
+    free(matcher->arena);
+    memset(matcher, 0, sizeof(*matcher));
+}
+
+/* Arena words ahead of the pattern bytes, or 0 if the counts would overflow. */
+static size_t isol8r_match_table_words(uint32_t state_count, uint32_t class_count, uint32_t pattern_count) {
+    const uint64_t words = (uint64_t)state_count * class_count + 3u * (uint64_t)state_count + 4u * (uint64_t)pattern_count;
+    return words > SIZE_MAX / sizeof(uint32_t) ? 0 : (size_t)words;
+}
+
+size_t isol8r_match_image_size(const struct isol8r_matcher *matcher) {
+    const size_t raw = sizeof(struct isol8r_match_image_header) + matcher->arena_size;
+    return (raw + 3u) & ~(size_t)3u;
+}
+
+void isol8r_match_image_write(const struct isol8r_matcher *matcher, void *out) {
+    struct isol8r_match_image_header header;
+
+    memset(&header, 0, sizeof(header));
+    header.state_count = matcher->state_count;
+    header.class_count = matcher->class_count;
+    header.pattern_count = matcher->pattern_count;
+    header.max_length = matcher->max_length;
+    memcpy(header.byte_class, matcher->byte_class, sizeof(header.byte_class));
+
+    uint8_t *cursor = out;
+    memcpy(cursor, &header, sizeof(header));
+    memcpy(cursor + sizeof(header), matcher->next, matcher->arena_size);
+    memset(cursor + sizeof(header) + matcher->arena_size, 0,
+           isol8r_match_image_size(matcher) - sizeof(header) - matcher->arena_size);
+}
+
+int isol8r_match_image_attach(struct isol8r_matcher *matcher, const void *image, size_t size) {
+    struct isol8r_match_image_header header;
+
+    if (!matcher || !image || ((uintptr_t)image & 3u) != 0 || size < sizeof(header)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(&header, image, sizeof(header));
+
+    const uint32_t states = header.state_count;
+    const uint32_t classes = header.class_count;
+    const uint32_t count = header.pattern_count;
+    const size_t words = isol8r_match_table_words(states, classes, count);
+    if (states == 0 || classes == 0 || classes > 256u || count == 0 || count >= ISOL8R_MATCH_NONE ||
+        header.max_length == 0 || header.max_length > ISOL8R_MATCH_MAX_PATTERN || words == 0 ||
+        size - sizeof(header) < words * sizeof(uint32_t)) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (size_t c = 0; c < 256; ++c) {
+        if (header.byte_class[c] >= classes) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    const uint32_t *next = (const uint32_t *)((const uint8_t *)image + sizeof(header));
+    const uint32_t *report = next + (size_t)states * classes;
+    const uint32_t *out_head = report + states;
+    const uint32_t *dict_link = out_head + states;
+    const uint32_t *pat_next = dict_link + states;
+    const uint32_t *pat_length = pat_next + count;
+    const uint32_t *pat_flags = pat_length + count;
+    const uint32_t *pat_offset = pat_flags + count;
+    const uint8_t *pat_bytes = (const uint8_t *)(pat_offset + count);
+    const size_t byte_room = size - sizeof(header) - words * sizeof(uint32_t);
+
+    /* Every index the scanner follows must stay inside its table. */
+    for (size_t i = 0; i < (size_t)states * classes; ++i) {
+        if (next[i] >= states) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    for (uint32_t state = 0; state < states; ++state) {
+        if (report[state] >= states || dict_link[state] >= states || out_head[state] > count) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    size_t total_bytes = 0;
+    for (uint32_t id = 0; id < count; ++id) {
+        if (pat_next[id] > count || pat_length[id] == 0 || pat_length[id] > header.max_length ||
+            pat_offset[id] > byte_room || pat_length[id] > byte_room - pat_offset[id]) {
+            errno = EINVAL;
+            return -1;
+        }
+        if ((size_t)pat_offset[id] + pat_length[id] > total_bytes) {
+            total_bytes = (size_t)pat_offset[id] + pat_length[id];
+        }
+    }
+    /*
+     * And every chain it walks must end: a dictionary chain climbs to a
+     * shallower state each step, so it is never longer than max_length, and
+     * an output list cannot hold more than every pattern.
+     */
+    for (uint32_t state = 0; state < states; ++state) {
+        uint32_t steps = 0;
+        for (uint32_t r = report[state]; r != 0; r = dict_link[r]) {
+            if (++steps > header.max_length) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        steps = 0;
+        for (uint32_t p = out_head[state]; p != 0; p = pat_next[p - 1]) {
+            if (++steps > count) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+    }
+
+    memset(matcher, 0, sizeof(*matcher));
+    matcher->state_count = states;
+    matcher->class_count = classes;
+    matcher->pattern_count = count;
+    matcher->max_length = header.max_length;
+    memcpy(matcher->byte_class, header.byte_class, sizeof(matcher->byte_class));
+    matcher->next = next;
+    matcher->report = report;
+    matcher->out_head = out_head;
+    matcher->dict_link = dict_link;
+    matcher->pat_next = pat_next;
+    matcher->pat_length = pat_length;
+    matcher->pat_flags = pat_flags;
+    matcher->pat_offset = pat_offset;
+    matcher->pat_bytes = pat_bytes;
+    matcher->arena_size = words * sizeof(uint32_t) + total_bytes;
+    matcher->arena = NULL;
+    return 0;
+}
+
+/*
+ * Confirms a case-sensitive hit ending at data[end - 1]. Bytes before the
+ * chunk come from the stream carry.
+ */
+static int isol8r_match_confirm(const struct isol8r_matcher *matcher,
+                                uint32_t id,
+                                const uint8_t *carry,
+                                size_t carry_len,
+                                const uint8_t *data,
+                                size_t end) {
+    const uint32_t plen = matcher->pat_length[id];
+    const uint8_t *pattern = matcher->pat_bytes + matcher->pat_offset[id];
+
+    if (end >= plen) {
+        return memcmp(data + end - plen, pattern, plen) == 0;
+    }
+
+    const size_t from_carry = plen - end;
+    if (from_carry > carry_len) {
+        return 0;
+    }
+    return memcmp(carry + carry_len - from_carry, pattern, from_carry) == 0 &&
+           memcmp(data, pattern + from_carry, end) == 0;
+}
+
+static size_t isol8r_match_run(const struct isol8r_matcher *matcher,
+                               uint32_t *state_io,
+                               uint64_t base,
+                               const uint8_t *carry,
+                               size_t carry_len,
+                               const uint8_t *data,
+                               size_t len,
+                               isol8r_match_cb cb,
+                               void *ctx) {
+    const uint32_t *next = matcher->next;
+    const uint32_t class_count = matcher->class_count;
+    uint32_t state = *state_io;
+    size_t hits = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        state = next[(size_t)state * class_count + matcher->byte_class[data[i]]];
+        for (uint32_t r = matcher->report[state]; r != 0; r = matcher->dict_link[r]) {
+            for (uint32_t p = matcher->out_head[r]; p != 0; p = matcher->pat_next[p - 1]) {
+                const uint32_t id = p - 1;
+                if (!(matcher->pat_flags[id] & ISOL8R_MATCH_NOCASE) &&
+                    !isol8r_match_confirm(matcher, id, carry, carry_len, data, i + 1)) {
+                    continue;
+                }
+                ++hits;
+                if (cb && cb(id, (size_t)(base + i + 1), ctx)) {
+                    *state_io = state;
+                    return hits;
+                }
+            }
+        }
+    }
+    *state_io = state;
+    return hits;
+}
+
+void isol8r_match_stream_init(struct isol8r_match_stream *stream) {
+    if (stream) {
+        stream->state = 0;
+        stream->consumed = 0;
+        stream->carry_len = 0;
+    }
+}
+
+size_t isol8r_match_scan_stream(const struct isol8r_matcher *matcher,
+                                struct isol8r_match_stream *stream,
+                                const uint8_t *data,
+                                size_t len,
+                                isol8r_match_cb cb,
+                                void *ctx) {
+    if (!matcher || !matcher->next || !stream || !data) {
+        return 0;
+    }
+
+    size_t hits = isol8r_match_run(matcher, &stream->state, stream->consumed,
+                                   stream->carry, stream->carry_len, data, len, cb, ctx);
+
+    /* Keep just enough tail to confirm a pattern that straddles the next boundary. */
+    const size_t keep = matcher->max_length > 0 ? matcher->max_length - 1u : 0u;
+    if (len >= keep) {
+        memcpy(stream->carry, data + len - keep, keep);
+        stream->carry_len = keep;
+    } else {
+        size_t from_old = keep - len;
+        if (from_old > stream->carry_len) {
+            from_old = stream->carry_len;
+        }
+        memmove(stream->carry, stream->carry + stream->carry_len - from_old, from_old);
+        memcpy(stream->carry + from_old, data, len);
+        stream->carry_len = from_old + len;
+    }
+    stream->consumed += len;
+    return hits;
+}
+
+size_t isol8r_match_scan(const struct isol8r_matcher *matcher,
+                         const uint8_t *data,
+                         size_t len,
+                         isol8r_match_cb cb,
+                         void *ctx) {
+    if (!matcher || !matcher->next || !data) {
+        return 0;
+    }
+
+    uint32_t state = 0;
+    return isol8r_match_run(matcher, &state, 0, NULL, 0, data, len, cb, ctx);
+}
@@ -0,0 +1,172 @@
+/**
+ * isol8r_match.h - single-pass multi-pattern matcher shared by the sandboxes.
+ *
+ * A compiled Aho-Corasick automaton over a compressed byte alphabet. Every
+ * keyword is found in one left-to-right walk of the input, so adding
+ * keywords grows the table, not the per-byte cost. Patterns may be flagged
+ * case-insensitive; case-sensitive ones are folded in the automaton and
+ * confirmed against the original bytes when they fire.
+ *
+ * A compiled matcher can be written out as a flat image and later attached
+ * in place, e.g. straight from an mmap()ed cache file, without rebuilding.
+ */
+
+#ifndef ISOL8R_MATCH_H
+#define ISOL8R_MATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Pattern flag: match regardless of ASCII letter case. */
+#define ISOL8R_MATCH_NOCASE 0x1u
+
+/** Longest pattern accepted; bounds the carry a stream keeps between chunks. */
+#define ISOL8R_MATCH_MAX_PATTERN 256u
+
+/** One keyword handed to isol8r_match_build(). */
+struct isol8r_pattern {
+    const uint8_t *bytes;   /**< Raw pattern bytes (not necessarily text). */
+    size_t length;          /**< Number of bytes in the pattern. */
+    unsigned flags;         /**< ISOL8R_MATCH_* flags. */
+};
+
+/**
+ * Compiled automaton. All tables live in one allocation so the whole thing
+ * can be treated as a flat blob.
+ */
+struct isol8r_matcher {
+    uint32_t state_count;       /**< Number of automaton states (root is 0). */
+    uint32_t class_count;       /**< Alphabet size after byte-class compression. */
+    uint32_t pattern_count;     /**< Number of compiled patterns. */
+    uint32_t max_length;        /**< Longest pattern, in bytes. */
+    uint8_t byte_class[256];    /**< Input byte -> alphabet class (case folded). */
+    const uint32_t *next;       /**< state_count * class_count transitions. */
+    const uint32_t *report;     /**< Per state: nearest state with outputs, 0 if none. */
+    const uint32_t *out_head;   /**< Per state: first pattern id + 1 ending here, 0 if none. */
+    const uint32_t *dict_link;  /**< Per state: next shorter suffix state with outputs. */
+    const uint32_t *pat_next;   /**< Per pattern: next pattern id + 1 at the same state. */
+    const uint32_t *pat_length; /**< Per pattern: length in bytes. */
+    const uint32_t *pat_flags;  /**< Per pattern: ISOL8R_MATCH_* flags. */
+    const uint32_t *pat_offset; /**< Per pattern: offset of its bytes in pat_bytes. */
+    const uint8_t *pat_bytes;   /**< Original pattern bytes for case-sensitive checks. */
+    size_t arena_size;          /**< Bytes of tables and pattern bytes behind `next`. */
+    void *arena;                /**< Backing allocation, released by isol8r_match_free(); NULL if attached. */
+};
+
+/** Fixed part of a matcher image; the tables follow it, starting with `next`. */
+struct isol8r_match_image_header {
+    uint32_t state_count;
+    uint32_t class_count;
+    uint32_t pattern_count;
+    uint32_t max_length;
+    uint8_t byte_class[256];
+};
+
+/**
+ * Scan position for input that arrives in pieces. Holds the automaton state
+ * and the tail of the previous chunk, so a keyword split across a chunk
+ * boundary is still found and case-sensitive hits can still be confirmed.
+ * Memory use is constant no matter how long the stream runs.
+ */
+struct isol8r_match_stream {
+    uint32_t state;                                 /**< Current automaton state. */
+    uint64_t consumed;                              /**< Bytes scanned before the current chunk. */
+    size_t carry_len;                               /**< Valid bytes in carry. */
+    uint8_t carry[ISOL8R_MATCH_MAX_PATTERN - 1];    /**< Tail of the previous chunks. */
+};
+
+/**
+ * Hit callback. Receives the pattern id (its index in the build array) and
+ * the offset one past the last matching byte. Return nonzero to stop.
+ */
+typedef int (*isol8r_match_cb)(uint32_t pattern_id, size_t end_offset, void *ctx);
+
+/**
+ * Compiles the patterns into an automaton.
+ *
+ * @param matcher  Matcher to initialise.
+ * @param patterns Pattern array; ids are indices into it.
+ * @param count    Number of patterns (must be nonzero), each at most
+ *                 ISOL8R_MATCH_MAX_PATTERN bytes long.
+ * @return 0 on success, -1 with errno set on failure.
+ */
+int isol8r_match_build(struct isol8r_matcher *matcher, const struct isol8r_pattern *patterns, size_t count);
+
+/**
+ * Releases everything isol8r_match_build() allocated.
+ *
+ * @param matcher Matcher to release; it is zeroed afterwards.
+ */
+void isol8r_match_free(struct isol8r_matcher *matcher);
+
+/**
+ * Size of the image isol8r_match_image_write() produces.
+ *
+ * @param matcher Compiled matcher.
+ * @return Image size in bytes, a multiple of 4.
+ */
+size_t isol8r_match_image_size(const struct isol8r_matcher *matcher);
+
+/**
+ * Serialises a matcher (native byte order) for isol8r_match_image_attach().
+ *
+ * @param matcher Compiled matcher.
+ * @param out     Destination of isol8r_match_image_size() bytes.
+ */
+void isol8r_match_image_write(const struct isol8r_matcher *matcher, void *out);
+
+/**
+ * Points a matcher at an image in place. The image is validated first, so
+ * a corrupt or truncated one is refused rather than scanned with. The
+ * image must stay mapped, and unchanged, for as long as the matcher is used.
+ *
+ * @param matcher Matcher to initialise; isol8r_match_free() leaves the image alone.
+ * @param image   Image bytes, 4-byte aligned.
+ * @param size    Image size in bytes.
+ * @return 0 on success, -1 with errno set to EINVAL if the image is unusable.
+ */
+int isol8r_match_image_attach(struct isol8r_matcher *matcher, const void *image, size_t size);
+
+/**
+ * Resets a stream to the start of a new input.
+ *
+ * @param stream Stream position to reset.
+ */
+void isol8r_match_stream_init(struct isol8r_match_stream *stream);
+
+/**
+ * Scans the next chunk of a stream. End offsets handed to the callback are
+ * absolute (counted from the start of the stream), truncated to size_t.
+ *
+ * @param matcher Compiled matcher.
+ * @param stream  Stream position, updated in place.
+ * @param data    Chunk bytes.
+ * @param len     Chunk length.
+ * @param cb      Callback invoked per hit, may be NULL to just count.
+ * @param ctx     Opaque pointer passed to cb.
+ * @return Number of hits reported in this chunk.
+ */
+size_t isol8r_match_scan_stream(const struct isol8r_matcher *matcher,
+                                struct isol8r_match_stream *stream,
+                                const uint8_t *data,
+                                size_t len,
+                                isol8r_match_cb cb,
+                                void *ctx);
+
+/**
+ * Scans a buffer once and reports every pattern occurrence.
+ *
+ * @param matcher Compiled matcher.
+ * @param data    Input bytes.
+ * @param len     Input length.
+ * @param cb      Callback invoked per hit, may be NULL to just count.
+ * @param ctx     Opaque pointer passed to cb.
+ * @return Number of hits reported.
+ */
+size_t isol8r_match_scan(const struct isol8r_matcher *matcher,
+                         const uint8_t *data,
+                         size_t len,
+                         isol8r_match_cb cb,
+                         void *ctx);
+
+#endif /* ISOL8R_MATCH_H */
@@ -0,0 +1,518 @@
+/**
+ * isol8r_replay.c - corpus loading, timing and baseline diff for --scan-only.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_replay.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isol8r_encode.h"
+#include "isol8r_stats.h"
+
+/* Keeps a typo in ISOL8R_SCAN_ROUNDS from running all night. */
+#define REPLAY_MAX_ROUNDS 100000u
+
+/* Baseline differences listed one by one before the rest are just counted. */
+#define REPLAY_MAX_LISTED 50u
+
+#define REPLAY_BASE64_PREFIX "[BAIT] [VMMGR] Payload base64: "
+
+struct replay_entry {
+    char *name;
+    uint8_t *data;
+    size_t length;
+    uint32_t matches;
+    int oversized;
+    char *verdict;      /* Verdict text; in a baseline entry, the saved one. */
+};
+
+struct replay_list {
+    struct replay_entry *items;
+    size_t count;
+    size_t capacity;
+};
+
+static struct replay_entry *replay_push(struct replay_list *list) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        struct replay_entry *items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) {
+            return NULL;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    struct replay_entry *entry = &list->items[list->count++];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+static void replay_list_free(struct replay_list *list) {
+    for (size_t i = 0; i < list->count; ++i) {
+        free(list->items[i].name);
+        free(list->items[i].data);
+        free(list->items[i].verdict);
+    }
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static int replay_compare(const void *left, const void *right) {
+    return strcmp(((const struct replay_entry *)left)->name, ((const struct replay_entry *)right)->name);
+}
+
+/* Names end up in tab-separated lines; keep them on one column. */
+static char *replay_name(const char *text, size_t len) {
+    char *name = malloc(len + 1);
+    if (!name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        name[i] = text[i] == '\t' || text[i] == '\n' || text[i] == '\r' ? '?' : text[i];
+    }
+    name[len] = '\0';
+    return name;
+}
+
+static int replay_read_file(const char *path, uint8_t **data, size_t *length) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    uint8_t *buffer = malloc(size ? size : 1);
+    if (!buffer) {
+        close(fd);
+        return -1;
+    }
+    size_t used = 0;
+    while (used < size) {
+        ssize_t got = read(fd, buffer + used, size - used);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        used += (size_t)got;
+    }
+    close(fd);
+    *data = buffer;
+    *length = used;
+    return 0;
+}
+
+static int replay_add(struct replay_list *list, char *name, const uint8_t *data, size_t length) {
+    struct replay_entry *entry = name ? replay_push(list) : NULL;
+    uint8_t *copy = entry ? malloc(length ? length : 1) : NULL;
+    if (!copy) {
+        if (entry) {
+            --list->count;
+        }
+        free(name);
+        return -1;
+    }
+    memcpy(copy, data, length);
+    entry->name = name;
+    entry->data = copy;
+    entry->length = length;
+    return 0;
+}
+
+static int replay_load_dir(struct replay_list *list, const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+
+    int status = 0;
+    struct dirent *item;
+    while ((item = readdir(dir)) != NULL) {
+        if (item->d_name[0] == '.') {
+            continue;
+        }
+        size_t length = strlen(path) + strlen(item->d_name) + 2;
+        char *full = malloc(length);
+        if (!full) {
+            status = -1;
+            break;
+        }
+        snprintf(full, length, "%s/%s", path, item->d_name);
+
+        uint8_t *data = NULL;
+        size_t size = 0;
+        struct stat st;
+        if (stat(full, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(full);
+            continue;
+        }
+        if (replay_read_file(full, &data, &size) != 0) {
+            free(full);
+            status = -1;
+            break;
+        }
+        struct replay_entry *entry = replay_push(list);
+        if (!entry) {
+            free(data);
+            free(full);
+            status = -1;
+            break;
+        }
+        entry->name = replay_name(item->d_name, strlen(item->d_name));
+        entry->data = data;
+        entry->length = size;
+        free(full);
+        if (!entry->name) {
+            status = -1;
+            break;
+        }
+    }
+    closedir(dir);
+
+    qsort(list->items, list->count, sizeof(*list->items), replay_compare);
+    return status;
+}
+
+/*
+ * Recognises "YYYY-MM-DDT... | tag | body" and returns the offset of tag,
+ * or 0 when the line is not in that shape.
+ */
+static size_t replay_record_tag(const char *line, size_t len) {
+    if (len < 20 || line[4] != '-' || line[7] != '-' || line[10] != 'T') {
+        return 0;
+    }
+    const char *bar = memchr(line, '|', len);
+    if (!bar || bar == line || bar[-1] != ' ' || (size_t)(bar - line) + 2 > len || bar[1] != ' ') {
+        return 0;
+    }
+    return (size_t)(bar - line) + 2;
+}
+
+static int replay_load_line(struct replay_list *list, const char *base, size_t lineno, const char *line, size_t len) {
+    char label[64];
+    int label_len = snprintf(label, sizeof(label), ":%zu", lineno);
+    size_t base_len = strlen(base);
+    char *name = malloc(base_len + (size_t)label_len + 1);
+    if (!name) {
+        return -1;
+    }
+    memcpy(name, base, base_len);
+    memcpy(name + base_len, label, (size_t)label_len + 1);
+    char *clean = replay_name(name, base_len + (size_t)label_len);
+    free(name);
+    if (!clean) {
+        return -1;
+    }
+
+    const size_t prefix_len = sizeof(REPLAY_BASE64_PREFIX) - 1;
+    if (len > prefix_len && memcmp(line, REPLAY_BASE64_PREFIX, prefix_len) == 0) {
+        const char *text = line + prefix_len;
+        size_t text_len = len - prefix_len;
+        const char *space = memchr(text, ' ', text_len);
+        if (space) {
+            text_len = (size_t)(space - text);
+        }
+        uint8_t *decoded = malloc(text_len / 4 * 3 + 1);
+        size_t decoded_len = 0;
+        if (!decoded || isol8r_base64_decode(decoded, text, text_len, &decoded_len) != 0) {
+            free(decoded);
+            free(clean);
+            return 0;
+        }
+        struct replay_entry *entry = replay_push(list);
+        if (!entry) {
+            free(decoded);
+            free(clean);
+            return -1;
+        }
+        entry->name = clean;
+        entry->data = decoded;
+        entry->length = decoded_len;
+        return 0;
+    }
+    if (len >= 6 && memcmp(line, "[BAIT]", 6) == 0) {
+        free(clean);
+        return 0;
+    }
+
+    const size_t tag = replay_record_tag(line, len);
+    if (tag > 0) {
+        if (len >= tag + 7 && memcmp(line + tag, "echo | ", 7) == 0) {
+            return replay_add(list, clean, (const uint8_t *)line + tag + 7, len - tag - 7);
+        }
+        free(clean);
+        return 0;
+    }
+    return replay_add(list, clean, (const uint8_t *)line, len);
+}
+
+static int replay_load_lines(struct replay_list *list, const char *path) {
+    uint8_t *data = NULL;
+    size_t size = 0;
+    if (replay_read_file(path, &data, &size) != 0) {
+        return -1;
+    }
+
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    int status = 0;
+    size_t lineno = 0;
+    for (size_t start = 0; start < size && status == 0;) {
+        const uint8_t *newline = memchr(data + start, '\n', size - start);
+        size_t end = newline ? (size_t)(newline - data) : size;
+        size_t len = end - start;
+        ++lineno;
+        if (len > 0 && data[start + len - 1] == '\r') {
+            --len;
+        }
+        if (len > 0) {
+            status = replay_load_line(list, base, lineno, (const char *)data + start, len);
+        }
+        start = end + 1;
+    }
+    free(data);
+    return status;
+}
+
+/* "label,label" for a bitmask, "-" when nothing fired. */
+static char *replay_verdict(const struct isol8r_replay *replay, const struct replay_entry *entry) {
+    if (entry->oversized) {
+        return strdup("oversized");
+    }
+    if (entry->matches == 0) {
+        return strdup("-");
+    }
+
+    size_t size = 1;
+    for (uint32_t rest = entry->matches; rest; rest &= rest - 1u) {
+        size += strlen(replay->label((uint32_t)__builtin_ctz(rest), replay->ctx)) + 1;
+    }
+    char *text = malloc(size);
+    if (!text) {
+        return NULL;
+    }
+    char *cursor = text;
+    for (uint32_t rest = entry->matches; rest; rest &= rest - 1u) {
+        const char *label = replay->label((uint32_t)__builtin_ctz(rest), replay->ctx);
+        if (cursor != text) {
+            *cursor++ = ',';
+        }
+        size_t len = strlen(label);
+        memcpy(cursor, label, len);
+        cursor += len;
+    }
+    *cursor = '\0';
+    return text;
+}
+
+static int replay_load_baseline(struct replay_list *list, const char *path) {
+    uint8_t *data = NULL;
+    size_t size = 0;
+    if (replay_read_file(path, &data, &size) != 0) {
+        return -1;
+    }
+
+    int status = 0;
+    for (size_t start = 0; start < size && status == 0;) {
+        const char *line = (const char *)data + start;
+        const char *newline = memchr(line, '\n', size - start);
+        size_t len = newline ? (size_t)(newline - line) : size - start;
+        start += len + 1;
+
+        const char *tab = memchr(line, '\t', len);
+        if (!tab) {
+            continue;
+        }
+        struct replay_entry *entry = replay_push(list);
+        if (!entry) {
+            status = -1;
+            break;
+        }
+        entry->name = strndup(line, (size_t)(tab - line));
+        entry->verdict = strndup(tab + 1, len - (size_t)(tab - line) - 1);
+        if (!entry->name || !entry->verdict) {
+            status = -1;
+        }
+    }
+    free(data);
+    if (status == 0) {
+        qsort(list->items, list->count, sizeof(*list->items), replay_compare);
+    }
+    return status;
+}
+
+/* Walks both sorted lists and reports every payload whose verdict moved. */
+static int replay_diff(const struct isol8r_replay *replay, const struct replay_list *now, const struct replay_list *before) {
+    size_t changed = 0, added = 0, missing = 0, listed = 0;
+    size_t i = 0, j = 0;
+
+    while (i < now->count || j < before->count) {
+        const int order = i == now->count      ? 1
+                          : j == before->count ? -1
+                                               : strcmp(now->items[i].name, before->items[j].name);
+        const char *kind = NULL;
+        const char *name = NULL;
+        const char *was = NULL;
+        const char *is = NULL;
+
+        if (order == 0) {
+            if (strcmp(now->items[i].verdict, before->items[j].verdict) != 0) {
+                ++changed;
+                kind = "changed";
+                name = now->items[i].name;
+                was = before->items[j].verdict;
+                is = now->items[i].verdict;
+            }
+            ++i;
+            ++j;
+        } else if (order < 0) {
+            ++added;
+            kind = "new";
+            name = now->items[i].name;
+            is = now->items[i].verdict;
+            ++i;
+        } else {
+            ++missing;
+            kind = "missing";
+            name = before->items[j].name;
+            was = before->items[j].verdict;
+            ++j;
+        }
+
+        if (kind && listed++ < REPLAY_MAX_LISTED) {
+            fprintf(stderr, "[%s]   %s %s: %s -> %s\n", replay->program, kind, name, was ? was : "(none)", is ? is : "(none)");
+        }
+    }
+    if (listed > REPLAY_MAX_LISTED) {
+        fprintf(stderr, "[%s]   ... and %zu more\n", replay->program, listed - REPLAY_MAX_LISTED);
+    }
+    fprintf(stderr, "[%s] Baseline: %zu changed, %zu new, %zu missing.\n", replay->program, changed, added, missing);
+    return changed + added + missing > 0 ? ISOL8R_REPLAY_CHANGED : ISOL8R_REPLAY_SAME;
+}
+
+static unsigned replay_rounds(void) {
+    const char *value = getenv("ISOL8R_SCAN_ROUNDS");
+    if (!value || !*value) {
+        return 1;
+    }
+    char *end = NULL;
+    unsigned long parsed = strtoul(value, &end, 10);
+    return end && *end == '\0' && parsed >= 1 && parsed <= REPLAY_MAX_ROUNDS ? (unsigned)parsed : 1u;
+}
+
+static double replay_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int isol8r_replay_run(const struct isol8r_replay *replay, const char *corpus, const char *baseline) {
+    struct replay_list list = { NULL, 0, 0 };
+    struct stat st;
+
+    /* A replay is not traffic; keep it out of the live numbers. */
+    isol8r_stats_detach();
+    if (stat(corpus, &st) != 0) {
+        fprintf(stderr, "[%s] Cannot read corpus '%s': %s\n", replay->program, corpus, strerror(errno));
+        return ISOL8R_REPLAY_ERROR;
+    }
+    int loaded = S_ISDIR(st.st_mode) ? replay_load_dir(&list, corpus) : replay_load_lines(&list, corpus);
+    if (loaded != 0) {
+        fprintf(stderr, "[%s] Cannot read corpus '%s': %s\n", replay->program, corpus, strerror(errno));
+        replay_list_free(&list);
+        return ISOL8R_REPLAY_ERROR;
+    }
+
+    uint64_t scanned_bytes = 0;
+    size_t scanned = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        struct replay_entry *entry = &list.items[i];
+        entry->oversized = replay->max_payload > 0 && entry->length >= replay->max_payload;
+        if (!entry->oversized) {
+            scanned_bytes += entry->length;
+            ++scanned;
+        }
+    }
+
+    /* Only the inspection is timed; loading and reporting stay outside. */
+    const unsigned rounds = replay_rounds();
+    const double started = replay_seconds();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < list.count; ++i) {
+            struct replay_entry *entry = &list.items[i];
+            if (!entry->oversized) {
+                entry->matches = replay->inspect(entry->data, entry->length, replay->ctx);
+            }
+        }
+    }
+    const double elapsed = replay_seconds() - started;
+
+    uint64_t hits[32] = { 0 };
+    size_t flagged = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        struct replay_entry *entry = &list.items[i];
+        entry->verdict = replay_verdict(replay, entry);
+        if (!entry->verdict) {
+            fprintf(stderr, "[%s] Out of memory formatting verdicts.\n", replay->program);
+            replay_list_free(&list);
+            return ISOL8R_REPLAY_ERROR;
+        }
+        flagged += entry->matches != 0;
+        for (uint32_t rest = entry->matches; rest; rest &= rest - 1u) {
+            ++hits[__builtin_ctz(rest)];
+        }
+        printf("%s\t%s\n", entry->name, entry->verdict);
+    }
+    fflush(stdout);
+
+    const double per_round = elapsed / rounds;
+    fprintf(stderr,
+            "[%s] Scanned %zu payloads (%llu bytes, %zu oversized skipped) x%u in %.3f ms: %.1f MB/s, %.0f payloads/s.\n",
+            replay->program,
+            scanned,
+            (unsigned long long)scanned_bytes,
+            list.count - scanned,
+            rounds,
+            elapsed * 1e3,
+            per_round > 0 ? (double)scanned_bytes / per_round / 1e6 : 0.0,
+            per_round > 0 ? (double)scanned / per_round : 0.0);
+    fprintf(stderr, "[%s] %zu payloads flagged.\n", replay->program, flagged);
+    for (uint32_t i = 0; i < replay->detector_count && i < 32u; ++i) {
+        fprintf(stderr, "[%s]   %-24s %llu\n", replay->program, replay->label(i, replay->ctx), (unsigned long long)hits[i]);
+    }
+
+    int status = ISOL8R_REPLAY_SAME;
+    if (baseline) {
+        struct replay_list before = { NULL, 0, 0 };
+        if (replay_load_baseline(&before, baseline) != 0) {
+            fprintf(stderr, "[%s] Cannot read baseline '%s': %s\n", replay->program, baseline, strerror(errno));
+            status = ISOL8R_REPLAY_ERROR;
+        } else {
+            qsort(list.items, list.count, sizeof(*list.items), replay_compare);
+            status = replay_diff(replay, &list, &before);
+        }
+        replay_list_free(&before);
+    }
+
+    replay_list_free(&list);
+    return status;
+}
@@ -0,0 +1,74 @@
+/**
+ * isol8r_replay.h - scan-only corpus replay shared by the sandbox binaries.
+ *
+ * `--scan-only` runs a binary's inspection stage, and nothing else, over a
+ * corpus of payloads: nothing is mapped executable, run, logged or counted
+ * in the live stats page. The corpus is either a directory, where every
+ * regular file is one payload, or a single file with one payload per line.
+ * In a line corpus the bait log's own records are understood, so the log
+ * can be replayed as is:
+ *
+ *   <timestamp> | echo | <text>                 replays <text>
+ *   [BAIT] [VMMGR] Payload base64: <b64> at ... replays the decoded bytes
+ *   any other "<timestamp> | tag |" or "[BAIT]" line is skipped
+ *   anything else                                replays the whole line
+ *
+ * One verdict line per payload goes to stdout, "<name>\t<labels>", with
+ * the labels of every detector that fired joined by commas, "-" for none or
+ * "oversized" for payloads the binary would refuse unread. The summary goes
+ * to stderr: throughput, hits per detector and, given a baseline (a saved
+ * stdout of an earlier run), every payload whose verdict changed.
+ */
+
+#ifndef ISOL8R_REPLAY_H
+#define ISOL8R_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Exit status: the corpus was scanned and matched the baseline, if any. */
+#define ISOL8R_REPLAY_SAME 0
+
+/** Exit status: at least one verdict differs from the baseline. */
+#define ISOL8R_REPLAY_CHANGED 1
+
+/** Exit status: the corpus or the baseline could not be read. */
+#define ISOL8R_REPLAY_ERROR 2
+
+/**
+ * Inspects one payload.
+ *
+ * @return Bitmask with bit i set for every detector i that fired.
+ */
+typedef uint32_t (*isol8r_replay_inspect_fn)(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * Names a detector for reports.
+ *
+ * @return The detector's label, never NULL.
+ */
+typedef const char *(*isol8r_replay_label_fn)(uint32_t detector, void *ctx);
+
+/** What a binary plugs into the replay. */
+struct isol8r_replay {
+    const char *program;                /**< Prefix for stderr lines, e.g. "tiny_vmmgr". */
+    isol8r_replay_inspect_fn inspect;   /**< The binary's inspection stage. */
+    isol8r_replay_label_fn label;       /**< Detector names. */
+    void *ctx;                          /**< Passed to both callbacks. */
+    uint32_t detector_count;            /**< Detectors in force, at most 32. */
+    size_t max_payload;                 /**< Payloads this long or longer are "oversized"; 0 for no limit. */
+};
+
+/**
+ * Loads the corpus, inspects every payload ISOL8R_SCAN_ROUNDS times
+ * (default 1) while timing only the inspection, then prints the verdicts
+ * and the summary.
+ *
+ * @param replay   Binary hooks.
+ * @param corpus   Directory or line file.
+ * @param baseline Earlier verdict output to diff against, or NULL.
+ * @return ISOL8R_REPLAY_SAME, ISOL8R_REPLAY_CHANGED or ISOL8R_REPLAY_ERROR.
+ */
+int isol8r_replay_run(const struct isol8r_replay *replay, const char *corpus, const char *baseline);
+
+#endif /* ISOL8R_REPLAY_H */
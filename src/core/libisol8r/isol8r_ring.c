@@ -0,0 +1,220 @@
+/**
+ * isol8r_ring.c - lock-free writer side of the mmap event ring.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Keeps a typo in ISOL8R_EVENT_RING_SLOTS from filling the disk. */
+#define ISOL8R_RING_MAX_SLOTS (1u << 20)
+
+static int isol8r_ring_format(int fd, uint32_t capacity) {
+    struct isol8r_ring_header header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ISOL8R_RING_MAGIC, sizeof(header.magic));
+    header.version = ISOL8R_RING_VERSION;
+    header.record_size = (uint32_t)sizeof(struct isol8r_ring_record);
+    header.capacity = capacity;
+
+    const off_t size = (off_t)sizeof(header) + (off_t)capacity * (off_t)sizeof(struct isol8r_ring_record);
+    if (ftruncate(fd, size) != 0) {
+        return -1;
+    }
+    ssize_t written = pwrite(fd, &header, sizeof(header), 0);
+    if (written != (ssize_t)sizeof(header)) {
+        if (written >= 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static int isol8r_ring_check(int fd, uint32_t *capacity) {
+    struct isol8r_ring_header header;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, ISOL8R_RING_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ISOL8R_RING_VERSION ||
+        header.record_size != sizeof(struct isol8r_ring_record) ||
+        header.capacity == 0 || header.capacity > ISOL8R_RING_MAX_SLOTS ||
+        (uint64_t)st.st_size < sizeof(header) + (uint64_t)header.capacity * sizeof(struct isol8r_ring_record)) {
+        errno = EINVAL;
+        return -1;
+    }
+    *capacity = header.capacity;
+    return 0;
+}
+
+int isol8r_ring_open(struct isol8r_ring *ring, const char *path, uint32_t capacity) {
+    if (!ring || !path || !*path || capacity > ISOL8R_RING_MAX_SLOTS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (capacity == 0) {
+        capacity = ISOL8R_RING_DEFAULT_SLOTS;
+    }
+
+    int fd;
+    do {
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* The lock only covers creation: two first writers must not both format. */
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    struct stat st;
+    int status = fstat(fd, &st);
+    if (status == 0 && st.st_size == 0) {
+        status = isol8r_ring_format(fd, capacity);
+    }
+    if (status == 0) {
+        status = isol8r_ring_check(fd, &capacity);
+    }
+    int saved = errno;
+    flock(fd, LOCK_UN);
+    if (status != 0) {
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    const size_t map_size = sizeof(struct isol8r_ring_header) + (size_t)capacity * sizeof(struct isol8r_ring_record);
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    saved = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = saved;
+        return -1;
+    }
+
+    ring->header = map;
+    ring->records = (struct isol8r_ring_record *)(ring->header + 1);
+    ring->map_size = map_size;
+    return 0;
+}
+
+int isol8r_ring_from_env(struct isol8r_ring *ring) {
+    if (!ring) {
+        errno = EINVAL;
+        return -1;
+    }
+    const char *path = getenv("ISOL8R_EVENT_RING");
+    if (!path || !*path) {
+        return 0;
+    }
+
+    uint32_t capacity = 0;
+    const char *slots = getenv("ISOL8R_EVENT_RING_SLOTS");
+    if (slots && *slots) {
+        char *end = NULL;
+        unsigned long parsed = strtoul(slots, &end, 10);
+        if (end && *end == '\0' && parsed <= ISOL8R_RING_MAX_SLOTS) {
+            capacity = (uint32_t)parsed;
+        }
+    }
+    if (isol8r_ring_open(ring, path, capacity) != 0) {
+        return -1;
+    }
+
+    const char *only = getenv("ISOL8R_EVENT_RING_ONLY");
+    ring->exclusive = only && *only && strcmp(only, "0") != 0;
+    return 0;
+}
+
+int isol8r_ring_enabled(const struct isol8r_ring *ring) {
+    return ring && ring->header != NULL;
+}
+
+uint64_t isol8r_ring_append(struct isol8r_ring *ring,
+                            uint16_t source,
+                            const char *tag,
+                            uint32_t pattern_id,
+                            const void *payload,
+                            size_t preview_len,
+                            uint64_t payload_length,
+                            unsigned flags) {
+    if (!isol8r_ring_enabled(ring)) {
+        return UINT64_MAX;
+    }
+
+    struct timespec now;
+    if (clock_gettime(CLOCK_REALTIME, &now) != 0) {
+        now.tv_sec = time(NULL);
+        now.tv_nsec = 0;
+    }
+
+    if (!payload) {
+        preview_len = 0;
+    }
+    if (preview_len > ISOL8R_RING_PREVIEW_MAX) {
+        preview_len = ISOL8R_RING_PREVIEW_MAX;
+    }
+    if (payload_length > preview_len) {
+        flags |= ISOL8R_RING_TRUNCATED;
+    }
+
+    const uint64_t seq = __atomic_fetch_add(&ring->header->head, 1, __ATOMIC_RELAXED);
+    struct isol8r_ring_record *slot = &ring->records[seq % ring->header->capacity];
+
+    /*
+     * Seqlock-style publish: zero the sequence, fill the body, then store
+     * seq + 1. A reader that sees the same non-zero value before and after
+     * copying the slot got a whole record.
+     */
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->timestamp_ns = (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+    slot->payload_length = payload_length;
+    slot->pattern_id = pattern_id;
+    slot->source = source;
+    slot->flags = (uint16_t)flags;
+    slot->preview_length = (uint16_t)preview_len;
+    slot->reserved = 0;
+    memset(slot->tag, 0, sizeof(slot->tag));
+    if (tag) {
+        size_t tag_len = strnlen(tag, sizeof(slot->tag));
+        memcpy(slot->tag, tag, tag_len);
+    }
+    if (preview_len > 0) {
+        memcpy(slot->preview, payload, preview_len);
+    }
+    memset(slot->preview + preview_len, 0, sizeof(slot->preview) - preview_len);
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+    return seq;
+}
+
+void isol8r_ring_close(struct isol8r_ring *ring) {
+    if (ring && ring->header) {
+        munmap(ring->header, ring->map_size);
+        ring->header = NULL;
+        ring->records = NULL;
+        ring->map_size = 0;
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * isol8r_ring.h - fixed-record, memory-mapped bait event store.
+ *
+ * An optional companion to the text bait log. The file is a small header
+ * followed by an array of 128-byte records used as a ring: writers claim a
+ * sequence number with one atomic add on the shared header and fill the
+ * slot in place, so there is no formatting, no file growth and
+ * no lock. Disk use is fixed at creation time. Readers walk the last
+ * `capacity` sequence numbers and keep the slots whose stored sequence still
+ * matches, which drops records that were overwritten or are half written.
+ *
+ * Multi-byte fields are host byte order; the file is not meant to leave the
+ * machine that wrote it.
+ */
+
+#ifndef ISOL8R_RING_H
+#define ISOL8R_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** First eight bytes of every ring file. */
+#define ISOL8R_RING_MAGIC "I8RRING1"
+
+/** Layout version stored in the header. */
+#define ISOL8R_RING_VERSION 1u
+
+/** Slot count used when a new ring is created without an explicit size. */
+#define ISOL8R_RING_DEFAULT_SLOTS 4096u
+
+/** Bytes of tag text kept per record (not necessarily terminated). */
+#define ISOL8R_RING_TAG_MAX 12u
+
+/** Bytes of payload kept per record. */
+#define ISOL8R_RING_PREVIEW_MAX 80u
+
+/** pattern_id value for records that are not keyword hits. */
+#define ISOL8R_RING_NO_PATTERN UINT32_MAX
+
+/** Record flag: the payload was longer than the preview. */
+#define ISOL8R_RING_TRUNCATED 0x1u
+
+/** Record flag: the preview is raw bytes, best rendered as hex. */
+#define ISOL8R_RING_BINARY 0x2u
+
+/** Which writer produced a record. */
+enum isol8r_ring_source {
+    ISOL8R_RING_SOURCE_UNKNOWN = 0,
+    ISOL8R_RING_SOURCE_ECHO = 1,
+    ISOL8R_RING_SOURCE_VMMGR = 2,
+    ISOL8R_RING_SOURCE_PYJAIL = 3,
+    ISOL8R_RING_SOURCE_APP = 4,
+};
+
+/** On-disk header; one cache line. */
+struct isol8r_ring_header {
+    char magic[8];          /**< ISOL8R_RING_MAGIC, no terminator. */
+    uint32_t version;       /**< ISOL8R_RING_VERSION. */
+    uint32_t record_size;   /**< sizeof(struct isol8r_ring_record). */
+    uint32_t capacity;      /**< Number of record slots. */
+    uint32_t reserved;      /**< Zero. */
+    uint64_t head;          /**< Next sequence number to hand out. */
+    uint8_t pad[32];        /**< Keeps the records cache-line aligned. */
+};
+
+/** On-disk record; two cache lines. */
+struct isol8r_ring_record {
+    uint64_t seq;                           /**< Sequence + 1 once complete, 0 while being written. */
+    uint64_t timestamp_ns;                  /**< CLOCK_REALTIME, nanoseconds since the epoch. */
+    uint64_t payload_length;                /**< Full payload size, which may exceed the preview. */
+    uint32_t pattern_id;                    /**< Writer-specific keyword/detector id or ISOL8R_RING_NO_PATTERN. */
+    uint16_t source;                        /**< enum isol8r_ring_source. */
+    uint16_t flags;                         /**< ISOL8R_RING_* record flags. */
+    uint16_t preview_length;                /**< Valid bytes in preview. */
+    uint16_t reserved;                      /**< Zero. */
+    char tag[ISOL8R_RING_TAG_MAX];          /**< "echo", "alert", "bait", ... NUL padded. */
+    uint8_t preview[ISOL8R_RING_PREVIEW_MAX]; /**< Leading payload bytes. */
+};
+
+_Static_assert(sizeof(struct isol8r_ring_header) == 64, "ring header layout changed");
+_Static_assert(sizeof(struct isol8r_ring_record) == 128, "ring record layout changed");
+
+/** A mapped ring; disabled until isol8r_ring_open() succeeds. */
+struct isol8r_ring {
+    struct isol8r_ring_header *header;  /**< Shared mapping, NULL when disabled. */
+    struct isol8r_ring_record *records; /**< First slot, right after the header. */
+    size_t map_size;                    /**< Bytes mapped. */
+    int exclusive;                      /**< Nonzero when the ring replaces the text log. */
+};
+
+/** Static initialiser for a disabled ring. */
+#define ISOL8R_RING_INIT { NULL, NULL, 0, 0 }
+
+/**
+ * Maps the ring at `path`, creating and sizing it first if the file is new
+ * or empty. An existing ring keeps its own capacity.
+ *
+ * @param ring     Ring handle.
+ * @param path     Ring file.
+ * @param capacity Slot count for a new file, 0 for the default.
+ * @return 0 on success, -1 with errno set on failure (the ring stays disabled).
+ */
+int isol8r_ring_open(struct isol8r_ring *ring, const char *path, uint32_t capacity);
+
+/**
+ * Applies deployment knobs from the environment:
+ *   ISOL8R_EVENT_RING=PATH        enable the ring at PATH.
+ *   ISOL8R_EVENT_RING_SLOTS=N     slot count when the file is created.
+ *   ISOL8R_EVENT_RING_ONLY=1      skip the text log while the ring is up.
+ * Leaves the ring disabled when the variable is unset or the open fails.
+ *
+ * @param ring Ring handle.
+ * @return 0 when disabled by configuration or opened, -1 if opening failed.
+ */
+int isol8r_ring_from_env(struct isol8r_ring *ring);
+
+/**
+ * Reports whether records can be appended.
+ *
+ * @param ring Ring handle.
+ * @return Nonzero when the ring is mapped.
+ */
+int isol8r_ring_enabled(const struct isol8r_ring *ring);
+
+/**
+ * Appends one event. Safe to call from any number of processes at once.
+ *
+ * @param ring           Ring handle; a disabled ring makes this a no-op.
+ * @param source         enum isol8r_ring_source of the caller.
+ * @param tag            Short event tag, cut to ISOL8R_RING_TAG_MAX bytes.
+ * @param pattern_id     Keyword/detector id or ISOL8R_RING_NO_PATTERN.
+ * @param payload        Payload bytes to preview, may be NULL if preview_len is 0.
+ * @param preview_len    Bytes available at payload.
+ * @param payload_length Full payload size recorded in the event.
+ * @param flags          Extra ISOL8R_RING_* flags; truncation is detected here.
+ * @return Sequence number of the record, or UINT64_MAX when disabled.
+ */
+uint64_t isol8r_ring_append(struct isol8r_ring *ring,
+                            uint16_t source,
+                            const char *tag,
+                            uint32_t pattern_id,
+                            const void *payload,
+                            size_t preview_len,
+                            uint64_t payload_length,
+                            unsigned flags);
+
+/**
+ * Unmaps the ring; it is disabled afterwards.
+ *
+ * @param ring Ring handle.
+ */
+void isol8r_ring_close(struct isol8r_ring *ring);
+
+#endif /* ISOL8R_RING_H */
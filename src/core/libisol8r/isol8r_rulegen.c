@@ -0,0 +1,265 @@
+/**
+ * isol8r_rulegen.c - build-time compiler from a rules file to a C header.
+ *
+ *   isol8r_rulegen <rules file> <header>
+ *
+ * Loads the rules file with isol8r_rules_load(), the same parser and
+ * automaton builder the binaries use, and writes out every scope's rules
+ * and matcher tables as static const data, together with the file's text,
+ * as `isol8r_builtin_rules` (see struct isol8r_rules_builtin). The binaries
+ * include the header, so the default rules need no parsing or construction
+ * at startup and live in read-only pages shared by every process running
+ * the binary; isol8r_rules_set_builtin() lets a load of an identical file
+ * use them in place.
+ *
+ * Not part of libisol8r: the Dockerfile builds it against libisol8r.a and
+ * runs it before compiling the binaries. Tables are written in the build
+ * host's byte order, like the rules cache, so the header is only good for
+ * binaries built on the same kind of machine.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_rules.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Identifier stem and count macro per scope, in enum isol8r_rules_scope order. */
+static const char *const rulegen_scope_names[ISOL8R_RULES_SCOPE_COUNT] = { "echo", "vmmgr" };
+static const char *const rulegen_count_macros[ISOL8R_RULES_SCOPE_COUNT] = {
+    "ISOL8R_BUILTIN_ECHO_COUNT",
+    "ISOL8R_BUILTIN_VMMGR_COUNT",
+};
+static const char *const rulegen_severity_macros[] = {
+    "ISOL8R_SEVERITY_LOW",
+    "ISOL8R_SEVERITY_MEDIUM",
+    "ISOL8R_SEVERITY_HIGH",
+};
+
+/* Emits bytes as a string literal body: printable ASCII as is, the rest as three-digit octal. */
+static void rulegen_literal(FILE *out, const uint8_t *bytes, size_t length) {
+    fputc('"', out);
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t c = bytes[i];
+        if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\' && c != '?') {
+            fputc(c, out);
+        } else {
+            fprintf(out, "\\%03o", c);
+        }
+    }
+    fputc('"', out);
+}
+
+/* Index of `table` in the words starting at `base`. */
+static size_t rulegen_word_offset(const struct isol8r_matcher *matcher, const void *table) {
+    return (size_t)((const uint8_t *)table - (const uint8_t *)matcher->next) / sizeof(uint32_t);
+}
+
+static void rulegen_source(FILE *out, const uint8_t *text, size_t size) {
+    fprintf(out, "static const uint8_t isol8r_builtin_source[%zu] = {", size ? size : 1u);
+    for (size_t i = 0; i < size; ++i) {
+        fprintf(out, "%s0x%02x,", i % 16u == 0 ? "\n    " : " ", text[i]);
+    }
+    fputs(size ? "\n};\n\n" : " 0 };\n\n", out);
+}
+
+static void rulegen_scope_tables(FILE *out, int scope, const struct isol8r_rule_set *set) {
+    const char *name = rulegen_scope_names[scope];
+    const struct isol8r_matcher *matcher = &set->matcher;
+    const size_t words = (matcher->arena_size + sizeof(uint32_t) - 1u) / sizeof(uint32_t);
+    uint32_t *copy = calloc(words, sizeof(uint32_t));
+
+    if (!copy) {
+        fprintf(stderr, "isol8r_rulegen: out of memory\n");
+        exit(1);
+    }
+    /* The pattern bytes at the tail are padded with zeros to a whole word. */
+    memcpy(copy, matcher->next, matcher->arena_size);
+
+    fprintf(out, "static const uint32_t isol8r_builtin_%s_tables[%zu] = {", name, words);
+    for (size_t i = 0; i < words; ++i) {
+        fprintf(out, "%s0x%08xu,", i % 8u == 0 ? "\n    " : " ", copy[i]);
+    }
+    fputs("\n};\n\n", out);
+    free(copy);
+
+    fprintf(out, "static const struct isol8r_rule isol8r_builtin_%s_rules[%s] = {\n", name, rulegen_count_macros[scope]);
+    for (size_t i = 0; i < set->count; ++i) {
+        const struct isol8r_rule *rule = &set->rules[i];
+        fputs("    {\n        .bytes = (const uint8_t *)", out);
+        rulegen_literal(out, rule->bytes, rule->length);
+        fprintf(out, ",\n        .length = %u,\n", rule->length);
+        fprintf(out, "        .flags = %s,\n", rule->flags & ISOL8R_MATCH_NOCASE ? "ISOL8R_MATCH_NOCASE" : "0");
+        fprintf(out, "        .severity = %s,\n", rulegen_severity_macros[rule->severity]);
+        fputs("        .label = ", out);
+        rulegen_literal(out, (const uint8_t *)rule->label, strlen(rule->label));
+        fputs(",\n        .message = ", out);
+        rulegen_literal(out, (const uint8_t *)rule->message, strlen(rule->message));
+        fputs(",\n    },\n", out);
+    }
+    fputs("};\n\n", out);
+}
+
+static void rulegen_scope_set(FILE *out, int scope, const struct isol8r_rule_set *set) {
+    const char *name = rulegen_scope_names[scope];
+    const struct isol8r_matcher *matcher = &set->matcher;
+
+    fprintf(out, "        {\n            .count = %s,\n", rulegen_count_macros[scope]);
+    fprintf(out, "            .rules = isol8r_builtin_%s_rules,\n", name);
+    fputs("            .matcher = {\n", out);
+    fprintf(out, "                .state_count = %u,\n", matcher->state_count);
+    fprintf(out, "                .class_count = %u,\n", matcher->class_count);
+    fprintf(out, "                .pattern_count = %u,\n", matcher->pattern_count);
+    fprintf(out, "                .max_length = %u,\n", matcher->max_length);
+    fputs("                .byte_class = {", out);
+    for (size_t c = 0; c < sizeof(matcher->byte_class); ++c) {
+        fprintf(out, "%s%u,", c % 16u == 0 ? "\n                    " : " ", matcher->byte_class[c]);
+    }
+    fputs("\n                },\n", out);
+
+    const struct {
+        const char *field;
+        const void *table;
+    } tables[] = {
+        { "report", matcher->report },
+        { "out_head", matcher->out_head },
+        { "dict_link", matcher->dict_link },
+        { "pat_next", matcher->pat_next },
+        { "pat_length", matcher->pat_length },
+        { "pat_flags", matcher->pat_flags },
+        { "pat_offset", matcher->pat_offset },
+    };
+    fprintf(out, "                .next = isol8r_builtin_%s_tables,\n", name);
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i) {
+        fprintf(out, "                .%s = isol8r_builtin_%s_tables + %zu,\n", tables[i].field, name,
+                rulegen_word_offset(matcher, tables[i].table));
+    }
+    fprintf(out, "                .pat_bytes = (const uint8_t *)(isol8r_builtin_%s_tables + %zu),\n", name,
+            rulegen_word_offset(matcher, matcher->pat_bytes));
+    fprintf(out, "                .arena_size = %zu,\n", matcher->arena_size);
+    fputs("                .arena = NULL,\n            },\n        },\n", out);
+}
+
+static int rulegen_write(FILE *out, const char *path, const uint8_t *text, size_t size, const struct isol8r_rules *rules) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    fprintf(out,
+            "/*\n"
+            " * isol8r_rules_builtin.h - generated by isol8r_rulegen from %s; do not edit.\n"
+            " *\n"
+            " * The default detector rules as static const data, ready to scan with:\n"
+            " * see struct isol8r_rules_builtin in isol8r_rules.h. Tables are in the\n"
+            " * byte order of the machine that generated them.\n"
+            " */\n\n"
+            "#ifndef ISOL8R_RULES_BUILTIN_H\n"
+            "#define ISOL8R_RULES_BUILTIN_H\n\n"
+            "#include <stddef.h>\n"
+            "#include <stdint.h>\n\n"
+            "#include \"isol8r_rules.h\"\n\n",
+            base);
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        fprintf(out, "#define %s %zuu\n", rulegen_count_macros[scope], rules->scopes[scope].count);
+    }
+    fputs("\n", out);
+
+    rulegen_source(out, text, size);
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        rulegen_scope_tables(out, scope, &rules->scopes[scope]);
+    }
+
+    fputs("static const struct isol8r_rules_builtin isol8r_builtin_rules = {\n", out);
+    fputs("    .source = isol8r_builtin_source,\n", out);
+    fprintf(out, "    .source_size = %zu,\n", size);
+    fputs("    .scopes = {\n", out);
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        rulegen_scope_set(out, scope, &rules->scopes[scope]);
+    }
+    fputs("    },\n};\n\n#endif /* ISOL8R_RULES_BUILTIN_H */\n", out);
+    return ferror(out) ? -1 : 0;
+}
+
+/* Whole file, or NULL; the parser caps rules files at a megabyte, so this is small. */
+static uint8_t *rulegen_read(const char *path, size_t *size_out) {
+    FILE *in = fopen(path, "rb");
+    uint8_t *text = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    if (!in) {
+        return NULL;
+    }
+    for (;;) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2u : 4096u;
+            uint8_t *grown = realloc(text, capacity);
+            if (!grown) {
+                free(text);
+                fclose(in);
+                return NULL;
+            }
+            text = grown;
+        }
+        const size_t got = fread(text + size, 1, capacity - size, in);
+        size += got;
+        if (got == 0) {
+            break;
+        }
+    }
+    if (ferror(in)) {
+        free(text);
+        text = NULL;
+    }
+    fclose(in);
+    *size_out = size;
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <rules file> <header>\n", argv[0]);
+        return 2;
+    }
+    const char *path = argv[1];
+    const char *header = argv[2];
+
+    struct isol8r_rules rules;
+    char err[512];
+    memset(&rules, 0, sizeof(rules));
+    if (isol8r_rules_load(&rules, path, NULL, err, sizeof(err)) != 0) {
+        fprintf(stderr, "isol8r_rulegen: %s\n", err);
+        return 1;
+    }
+    /* The binaries fall back to these scopes; an empty one would leave a detector with nothing to match. */
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        if (rules.scopes[scope].count == 0) {
+            fprintf(stderr, "isol8r_rulegen: %s: no %s rules\n", path, rulegen_scope_names[scope]);
+            return 1;
+        }
+    }
+
+    size_t size = 0;
+    uint8_t *text = rulegen_read(path, &size);
+    if (!text) {
+        fprintf(stderr, "isol8r_rulegen: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    FILE *out = fopen(header, "w");
+    if (!out) {
+        fprintf(stderr, "isol8r_rulegen: %s: %s\n", header, strerror(errno));
+        return 1;
+    }
+    const int failed = rulegen_write(out, path, text, size, &rules);
+    if (fclose(out) != 0 || failed) {
+        fprintf(stderr, "isol8r_rulegen: %s: write failed\n", header);
+        remove(header);
+        return 1;
+    }
+    free(text);
+    isol8r_rules_free(&rules);
+    return 0;
+}
@@ -0,0 +1,763 @@
+/**
+ * isol8r_rules.c - rules file parsing, blob compilation and the mmap()able cache.
+ *
+ * Blob layout (native byte order, every section 8-byte aligned):
+ *
+ *   struct rules_blob_header
+ *   per scope: rule_count struct rules_blob_rule records
+ *   per scope: matcher image (isol8r_match_image_write())
+ *   strings: pattern bytes, labels and messages, each NUL-terminated
+ *
+ * A freshly compiled blob and a mapped cache go through the same checked
+ * attach, so a stale, truncated or tampered cache is simply rebuilt.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_rules.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RULES_BLOB_MAGIC "ISOL8RRB"
+#define RULES_BLOB_VERSION 1u
+#define RULES_BLOB_ENDIAN 0x01020304u
+
+/* Bounds that keep a hostile file from costing more than a page or two of work. */
+#define RULES_SOURCE_MAX (1u << 20)
+#define RULES_BLOB_MAX (16u << 20)
+#define RULES_TEXT_MAX 256u
+
+struct rules_blob_scope {
+    uint32_t rule_count;
+    uint32_t rules_offset;
+    uint32_t matcher_offset;
+    uint32_t matcher_size;
+};
+
+struct rules_blob_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t total_size;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t source_ino;
+    uint64_t source_dev;
+    struct rules_blob_scope scopes[ISOL8R_RULES_SCOPE_COUNT];
+};
+
+struct rules_blob_rule {
+    uint32_t bytes_offset;
+    uint32_t length;
+    uint32_t flags;
+    uint32_t severity;
+    uint32_t label_offset;
+    uint32_t message_offset;
+};
+
+/* One parsed line, before it is laid out in the blob. */
+struct rules_draft {
+    uint32_t severity;
+    uint32_t flags;
+    uint32_t length;
+    uint8_t bytes[ISOL8R_MATCH_MAX_PATTERN + 1];
+    char label[RULES_TEXT_MAX + 1];
+    char message[RULES_TEXT_MAX + 1];
+};
+
+struct rules_drafts {
+    size_t count[ISOL8R_RULES_SCOPE_COUNT];
+    struct rules_draft rule[ISOL8R_RULES_SCOPE_COUNT][ISOL8R_RULES_MAX_PER_SCOPE];
+};
+
+/* One token of a line: a bare word or a quoted string, unescaped. */
+struct rules_token {
+    const char *raw;        /* Token text without quotes or the i prefix. */
+    size_t raw_len;
+    uint8_t value[RULES_TEXT_MAX];
+    size_t length;
+    int quoted;
+    int nocase;
+};
+
+static const char *const rules_scope_names[ISOL8R_RULES_SCOPE_COUNT] = { "echo", "vmmgr" };
+static const char *const rules_severity_names[] = { "low", "medium", "high" };
+static const char *rules_program = "isol8r";
+static const struct isol8r_rules_builtin *rules_builtin;
+
+const char *isol8r_severity_name(uint32_t severity) {
+    return severity < sizeof(rules_severity_names) / sizeof(rules_severity_names[0])
+               ? rules_severity_names[severity]
+               : "unknown";
+}
+
+static size_t rules_align8(size_t value) {
+    return (value + 7u) & ~(size_t)7u;
+}
+
+static int rules_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* ---------------------------------------------------------------------------
+ *  PARSING
+ * ------------------------------------------------------------------------- */
+
+/* Returns 1 with a token, 0 at end of line, -1 with *why set on a malformed token. */
+static int rules_next_token(const char **cursor, const char *end, struct rules_token *token, const char **why) {
+    const char *c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        ++c;
+    }
+    if (c == end) {
+        *cursor = c;
+        return 0;
+    }
+
+    memset(token, 0, sizeof(*token));
+    if (*c == 'i' && c + 1 < end && c[1] == '"') {
+        token->nocase = 1;
+        ++c;
+    }
+    if (*c != '"') {
+        token->raw = c;
+        while (c < end && *c != ' ' && *c != '\t') {
+            if (token->length == RULES_TEXT_MAX) {
+                *why = "token too long";
+                return -1;
+            }
+            token->value[token->length++] = (uint8_t)*c++;
+        }
+        token->raw_len = (size_t)(c - token->raw);
+        *cursor = c;
+        return 1;
+    }
+
+    token->quoted = 1;
+    token->raw = ++c;
+    while (c < end && *c != '"') {
+        uint8_t byte = (uint8_t)*c++;
+        if (byte == '\\') {
+            if (c == end) {
+                break;
+            }
+            switch (*c++) {
+            case '\\': byte = '\\'; break;
+            case '"': byte = '"'; break;
+            case 'n': byte = '\n'; break;
+            case 'r': byte = '\r'; break;
+            case 't': byte = '\t'; break;
+            case '0': byte = 0; break;
+            case 'x': {
+                const int hi = c < end ? rules_hex_digit(c[0]) : -1;
+                const int lo = c + 1 < end ? rules_hex_digit(c[1]) : -1;
+                if (hi < 0 || lo < 0) {
+                    *why = "\\x needs two hex digits";
+                    return -1;
+                }
+                byte = (uint8_t)(hi << 4 | lo);
+                c += 2;
+                break;
+            }
+            default:
+                *why = "unknown escape";
+                return -1;
+            }
+        }
+        if (token->length == RULES_TEXT_MAX) {
+            *why = "string too long";
+            return -1;
+        }
+        token->value[token->length++] = byte;
+    }
+    if (c == end) {
+        *why = "unterminated string";
+        return -1;
+    }
+    token->raw_len = (size_t)(c - token->raw);
+    *cursor = c + 1;
+    return 1;
+}
+
+static int rules_token_is(const struct rules_token *token, const char *word) {
+    return !token->quoted && token->length == strlen(word) && memcmp(token->value, word, token->length) == 0;
+}
+
+/* Copies a label or message; text may not hold NUL bytes. */
+static int rules_token_text(const struct rules_token *token, char *out) {
+    if (memchr(token->value, 0, token->length)) {
+        return -1;
+    }
+    memcpy(out, token->value, token->length);
+    out[token->length] = '\0';
+    return 0;
+}
+
+/* Parses one non-empty line. Returns 0 and fills *draft, or -1 with *why set. */
+static int rules_parse_line(const char *line,
+                            const char *end,
+                            int *scope,
+                            struct rules_draft *draft,
+                            const char **why) {
+    struct rules_token token;
+    const char *cursor = line;
+    int rc;
+
+    memset(draft, 0, sizeof(*draft));
+
+    if ((rc = rules_next_token(&cursor, end, &token, why)) <= 0) {
+        return rc == 0 ? 0 : -1;
+    }
+    *scope = -1;
+    for (int i = 0; i < ISOL8R_RULES_SCOPE_COUNT; ++i) {
+        if (rules_token_is(&token, rules_scope_names[i])) {
+            *scope = i;
+        }
+    }
+    if (*scope < 0 && !rules_token_is(&token, "pyjail")) {
+        *why = "unknown scope (want echo, vmmgr or pyjail)";
+        return -1;
+    }
+
+    if ((rc = rules_next_token(&cursor, end, &token, why)) <= 0) {
+        *why = rc == 0 ? "missing severity" : *why;
+        return -1;
+    }
+    draft->severity = UINT32_MAX;
+    for (uint32_t i = 0; i < sizeof(rules_severity_names) / sizeof(rules_severity_names[0]); ++i) {
+        if (rules_token_is(&token, rules_severity_names[i])) {
+            draft->severity = i;
+        }
+    }
+    if (draft->severity == UINT32_MAX) {
+        *why = "unknown severity (want low, medium or high)";
+        return -1;
+    }
+
+    if ((rc = rules_next_token(&cursor, end, &token, why)) <= 0) {
+        *why = rc == 0 ? "missing pattern" : *why;
+        return -1;
+    }
+    if (token.quoted) {
+        memcpy(draft->bytes, token.value, token.length);
+        draft->length = (uint32_t)token.length;
+        draft->flags = token.nocase ? ISOL8R_MATCH_NOCASE : 0u;
+    } else if (token.length > 4 && memcmp(token.value, "hex:", 4) == 0 && token.length % 2 == 0) {
+        for (size_t i = 4; i < token.length; i += 2) {
+            const int hi = rules_hex_digit((char)token.value[i]);
+            const int lo = rules_hex_digit((char)token.value[i + 1]);
+            if (hi < 0 || lo < 0) {
+                *why = "bad hex pattern";
+                return -1;
+            }
+            draft->bytes[draft->length++] = (uint8_t)(hi << 4 | lo);
+        }
+    } else {
+        *why = "pattern must be \"text\", i\"text\" or hex:<bytes>";
+        return -1;
+    }
+    if (draft->length == 0) {
+        *why = "empty pattern";
+        return -1;
+    }
+    /* Default label: the pattern as written. */
+    const size_t label_len = token.raw_len < RULES_TEXT_MAX ? token.raw_len : RULES_TEXT_MAX;
+    memcpy(draft->label, token.raw, label_len);
+    draft->label[label_len] = '\0';
+
+    if ((rc = rules_next_token(&cursor, end, &token, why)) < 0) {
+        return -1;
+    }
+    if (rc == 1 && !rules_token_is(&token, "-") && rules_token_text(&token, draft->label) != 0) {
+        *why = "NUL byte in label";
+        return -1;
+    }
+    if (rc == 1) {
+        if ((rc = rules_next_token(&cursor, end, &token, why)) < 0) {
+            return -1;
+        }
+        if (rc == 1 && rules_token_text(&token, draft->message) != 0) {
+            *why = "NUL byte in message";
+            return -1;
+        }
+        if (rc == 1 && rules_next_token(&cursor, end, &token, why) != 0) {
+            *why = "trailing text (quote the message)";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int rules_parse(const char *text,
+                       size_t length,
+                       const char *path,
+                       struct rules_drafts *drafts,
+                       char *err,
+                       size_t err_len) {
+    const char *cursor = text;
+    const char *end = text + length;
+    unsigned line_no = 0;
+
+    while (cursor < end) {
+        const char *eol = memchr(cursor, '\n', (size_t)(end - cursor));
+        const char *line_end = eol ? eol : end;
+        const char *line = cursor;
+        cursor = eol ? eol + 1 : end;
+        ++line_no;
+
+        if (line_end > line && line_end[-1] == '\r') {
+            --line_end;
+        }
+        while (line < line_end && (*line == ' ' || *line == '\t')) {
+            ++line;
+        }
+        if (line == line_end || *line == '#') {
+            continue;
+        }
+
+        struct rules_draft draft;
+        const char *why = NULL;
+        int scope = -1;
+        if (rules_parse_line(line, line_end, &scope, &draft, &why) != 0) {
+            snprintf(err, err_len, "%s:%u: %s", path, line_no, why);
+            errno = EINVAL;
+            return -1;
+        }
+        if (scope < 0) {
+            continue; /* pyjail: consumed by the Python side. */
+        }
+        if (drafts->count[scope] == ISOL8R_RULES_MAX_PER_SCOPE) {
+            snprintf(err, err_len, "%s:%u: more than %u %s rules",
+                     path, line_no, ISOL8R_RULES_MAX_PER_SCOPE, rules_scope_names[scope]);
+            errno = EINVAL;
+            return -1;
+        }
+        drafts->rule[scope][drafts->count[scope]++] = draft;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ *  BLOB
+ * ------------------------------------------------------------------------- */
+
+/* Lays the drafts out as a blob stamped with the source's identity. */
+static void *rules_compile(const struct rules_drafts *drafts, const struct stat *source, size_t *size_out) {
+    struct isol8r_matcher matchers[ISOL8R_RULES_SCOPE_COUNT];
+    struct rules_blob_header header;
+    size_t offset = rules_align8(sizeof(header));
+    void *blob = NULL;
+
+    memset(matchers, 0, sizeof(matchers));
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RULES_BLOB_MAGIC, sizeof(header.magic));
+    header.version = RULES_BLOB_VERSION;
+    header.endian = RULES_BLOB_ENDIAN;
+    header.source_size = (uint64_t)source->st_size;
+    header.source_mtime_sec = (int64_t)source->st_mtim.tv_sec;
+    header.source_mtime_nsec = (int64_t)source->st_mtim.tv_nsec;
+    header.source_ino = (uint64_t)source->st_ino;
+    header.source_dev = (uint64_t)source->st_dev;
+
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        const size_t count = drafts->count[scope];
+        header.scopes[scope].rule_count = (uint32_t)count;
+        header.scopes[scope].rules_offset = (uint32_t)offset;
+        offset = rules_align8(offset + count * sizeof(struct rules_blob_rule));
+        if (count == 0) {
+            continue;
+        }
+
+        struct isol8r_pattern patterns[ISOL8R_RULES_MAX_PER_SCOPE];
+        for (size_t i = 0; i < count; ++i) {
+            patterns[i].bytes = drafts->rule[scope][i].bytes;
+            patterns[i].length = drafts->rule[scope][i].length;
+            patterns[i].flags = drafts->rule[scope][i].flags;
+        }
+        if (isol8r_match_build(&matchers[scope], patterns, count) != 0) {
+            goto out;
+        }
+        header.scopes[scope].matcher_offset = (uint32_t)offset;
+        header.scopes[scope].matcher_size = (uint32_t)isol8r_match_image_size(&matchers[scope]);
+        offset = rules_align8(offset + header.scopes[scope].matcher_size);
+    }
+
+    const size_t strings = offset;
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        for (size_t i = 0; i < drafts->count[scope]; ++i) {
+            const struct rules_draft *draft = &drafts->rule[scope][i];
+            offset += draft->length + 1u + strlen(draft->label) + 1u + strlen(draft->message) + 1u;
+        }
+    }
+    offset = rules_align8(offset);
+    header.total_size = (uint32_t)offset;
+
+    uint8_t *out = calloc(1, offset);
+    if (!out) {
+        goto out;
+    }
+    memcpy(out, &header, sizeof(header));
+    size_t cursor = strings;
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        struct rules_blob_rule *records = (struct rules_blob_rule *)(out + header.scopes[scope].rules_offset);
+        for (size_t i = 0; i < drafts->count[scope]; ++i) {
+            const struct rules_draft *draft = &drafts->rule[scope][i];
+            records[i].length = draft->length;
+            records[i].flags = draft->flags;
+            records[i].severity = draft->severity;
+            records[i].bytes_offset = (uint32_t)cursor;
+            memcpy(out + cursor, draft->bytes, draft->length);
+            cursor += draft->length + 1u;
+            records[i].label_offset = (uint32_t)cursor;
+            memcpy(out + cursor, draft->label, strlen(draft->label));
+            cursor += strlen(draft->label) + 1u;
+            records[i].message_offset = (uint32_t)cursor;
+            memcpy(out + cursor, draft->message, strlen(draft->message));
+            cursor += strlen(draft->message) + 1u;
+        }
+        if (drafts->count[scope] > 0) {
+            isol8r_match_image_write(&matchers[scope], out + header.scopes[scope].matcher_offset);
+        }
+    }
+    blob = out;
+    *size_out = offset;
+
+out:
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        isol8r_match_free(&matchers[scope]);
+    }
+    return blob;
+}
+
+/* Non-zero when a NUL-terminated string starts at offset inside the blob. */
+static int rules_blob_string(const uint8_t *blob, size_t size, uint32_t offset) {
+    return offset < size && memchr(blob + offset, 0, size - offset) != NULL;
+}
+
+/* Validates a blob and points `rules` into it. Takes ownership only on success. */
+static int rules_attach(struct isol8r_rules *rules, void *blob, size_t size, bool mapped) {
+    struct rules_blob_header header;
+    struct isol8r_rules loaded;
+    const uint8_t *bytes = blob;
+    size_t total = 0;
+
+    if (size < sizeof(header) || size > RULES_BLOB_MAX) {
+        return -1;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (memcmp(header.magic, RULES_BLOB_MAGIC, sizeof(header.magic)) != 0 || header.version != RULES_BLOB_VERSION ||
+        header.endian != RULES_BLOB_ENDIAN || header.total_size != size) {
+        return -1;
+    }
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        if (header.scopes[scope].rule_count > ISOL8R_RULES_MAX_PER_SCOPE) {
+            return -1;
+        }
+        total += header.scopes[scope].rule_count;
+    }
+
+    memset(&loaded, 0, sizeof(loaded));
+    loaded.storage = calloc(total ? total : 1u, sizeof(*loaded.storage));
+    if (!loaded.storage) {
+        return -1;
+    }
+
+    struct isol8r_rule *next_rule = loaded.storage;
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        const struct rules_blob_scope *entry = &header.scopes[scope];
+        struct isol8r_rule_set *set = &loaded.scopes[scope];
+        const size_t count = entry->rule_count;
+
+        if (count == 0) {
+            continue;
+        }
+        if (entry->rules_offset % 8u != 0 || entry->rules_offset > size ||
+            count * sizeof(struct rules_blob_rule) > size - entry->rules_offset ||
+            entry->matcher_offset % 8u != 0 || entry->matcher_offset > size ||
+            entry->matcher_size > size - entry->matcher_offset ||
+            isol8r_match_image_attach(&set->matcher, bytes + entry->matcher_offset, entry->matcher_size) != 0 ||
+            set->matcher.pattern_count != count) {
+            goto fail;
+        }
+
+        const struct rules_blob_rule *records = (const struct rules_blob_rule *)(bytes + entry->rules_offset);
+        for (size_t i = 0; i < count; ++i) {
+            const struct rules_blob_rule *record = &records[i];
+            if (record->length == 0 || record->length > ISOL8R_MATCH_MAX_PATTERN ||
+                record->length != set->matcher.pat_length[i] || (record->flags & ~ISOL8R_MATCH_NOCASE) != 0 ||
+                record->severity > ISOL8R_SEVERITY_HIGH || record->bytes_offset > size ||
+                record->length >= size - record->bytes_offset || bytes[record->bytes_offset + record->length] != 0 ||
+                !rules_blob_string(bytes, size, record->label_offset) ||
+                !rules_blob_string(bytes, size, record->message_offset)) {
+                goto fail;
+            }
+            next_rule[i].bytes = bytes + record->bytes_offset;
+            next_rule[i].length = record->length;
+            next_rule[i].flags = record->flags;
+            next_rule[i].severity = record->severity;
+            next_rule[i].label = (const char *)bytes + record->label_offset;
+            next_rule[i].message = (const char *)bytes + record->message_offset;
+        }
+        set->count = count;
+        set->rules = next_rule;
+        next_rule += count;
+    }
+
+    loaded.blob = blob;
+    loaded.blob_size = size;
+    loaded.from_cache = mapped;
+    *rules = loaded;
+    return 0;
+
+fail:
+    free(loaded.storage);
+    return -1;
+}
+
+static int rules_stamp_matches(const void *blob, size_t size, const struct stat *source) {
+    struct rules_blob_header header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, blob, sizeof(header));
+    return header.source_size == (uint64_t)source->st_size &&
+           header.source_mtime_sec == (int64_t)source->st_mtim.tv_sec &&
+           header.source_mtime_nsec == (int64_t)source->st_mtim.tv_nsec &&
+           header.source_ino == (uint64_t)source->st_ino && header.source_dev == (uint64_t)source->st_dev;
+}
+
+/* ---------------------------------------------------------------------------
+ *  CACHE
+ * ------------------------------------------------------------------------- */
+
+static int rules_try_cache(struct isol8r_rules *rules, const char *cache_path, const struct stat *source) {
+    const int fd = open(cache_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    /* Someone else's cache could steer the detectors, so only our own counts. */
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) != 0 || st.st_size < (off_t)sizeof(struct rules_blob_header) ||
+        st.st_size > (off_t)RULES_BLOB_MAX) {
+        close(fd);
+        return -1;
+    }
+
+    const size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (!rules_stamp_matches(map, size, source) || rules_attach(rules, map, size, true) != 0) {
+        munmap(map, size);
+        return -1;
+    }
+    return 0;
+}
+
+/* Replaces the cache atomically so concurrent loaders never map a partial file. */
+static void rules_write_cache(const char *cache_path, const void *blob, size_t size) {
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", cache_path) >= (int)sizeof(tmp_path)) {
+        return;
+    }
+
+    const int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        fprintf(stderr, "[%s] Cannot write rules cache %s: %s\n", rules_program, cache_path, strerror(errno));
+        return;
+    }
+
+    const uint8_t *cursor = blob;
+    size_t left = size;
+    while (left > 0) {
+        const ssize_t wrote = write(fd, cursor, left);
+        if (wrote < 0 && errno == EINTR) {
+            continue;
+        }
+        if (wrote <= 0) {
+            break;
+        }
+        cursor += wrote;
+        left -= (size_t)wrote;
+    }
+    if (close(fd) != 0 || left != 0 || rename(tmp_path, cache_path) != 0) {
+        fprintf(stderr, "[%s] Cannot write rules cache %s: %s\n", rules_program, cache_path, strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ *  LOADING
+ * ------------------------------------------------------------------------- */
+
+static char *rules_read_source(int fd, size_t size) {
+    char *text = malloc(size ? size : 1u);
+    size_t have = 0;
+    while (text && have < size) {
+        const ssize_t got = read(fd, text + have, size - have);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            free(text);
+            return NULL;
+        }
+        have += (size_t)got;
+    }
+    return text;
+}
+
+void isol8r_rules_set_builtin(const struct isol8r_rules_builtin *builtin) {
+    rules_builtin = builtin;
+}
+
+/* Points `rules` at the compiled-in tables; they are static, so nothing is copied but the sets. */
+static void rules_use_builtin(struct isol8r_rules *rules) {
+    memset(rules, 0, sizeof(*rules));
+    for (int scope = 0; scope < ISOL8R_RULES_SCOPE_COUNT; ++scope) {
+        rules->scopes[scope] = rules_builtin->scopes[scope];
+    }
+    rules->from_builtin = true;
+}
+
+int isol8r_rules_load(struct isol8r_rules *rules, const char *path, const char *cache_path, char *err, size_t err_len) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        const int saved = errno;
+        snprintf(err, err_len, "%s: %s", path, strerror(saved));
+        errno = saved;
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > (off_t)RULES_SOURCE_MAX) {
+        snprintf(err, err_len, "%s: not a regular file of at most %u bytes", path, RULES_SOURCE_MAX);
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* A file the length of the compiled-in one is worth reading to see if it is the same file. */
+    char *text = NULL;
+    if (rules_builtin && (size_t)st.st_size == rules_builtin->source_size) {
+        text = rules_read_source(fd, (size_t)st.st_size);
+        if (text && memcmp(text, rules_builtin->source, rules_builtin->source_size) == 0) {
+            close(fd);
+            free(text);
+            rules_use_builtin(rules);
+            return 0;
+        }
+    }
+    if (!text && cache_path && rules_try_cache(rules, cache_path, &st) == 0) {
+        close(fd);
+        return 0;
+    }
+
+    if (!text) {
+        text = rules_read_source(fd, (size_t)st.st_size);
+    }
+    close(fd);
+    struct rules_drafts *drafts = calloc(1, sizeof(*drafts));
+    if (!text || !drafts) {
+        snprintf(err, err_len, "%s: %s", path, text ? "out of memory" : "read failed");
+        free(text);
+        free(drafts);
+        errno = EIO;
+        return -1;
+    }
+
+    int rc = rules_parse(text, (size_t)st.st_size, path, drafts, err, err_len);
+    free(text);
+    if (rc == 0) {
+        size_t size = 0;
+        void *blob = rules_compile(drafts, &st, &size);
+        if (!blob || rules_attach(rules, blob, size, false) != 0) {
+            snprintf(err, err_len, "%s: could not compile rules", path);
+            free(blob);
+            errno = EINVAL;
+            rc = -1;
+        } else if (cache_path) {
+            rules_write_cache(cache_path, blob, size);
+        }
+    }
+    free(drafts);
+    return rc;
+}
+
+int isol8r_rules_from_env(struct isol8r_rules *rules, const char *program) {
+    rules_program = program ? program : rules_program;
+
+    const char *path = getenv("ISOL8R_RULES");
+    const bool explicit_path = path && *path;
+    if (!explicit_path) {
+        path = ISOL8R_RULES_DEFAULT_PATH;
+    }
+    if (strcmp(path, "none") == 0) {
+        return 1;
+    }
+    const char *cache_path = getenv("ISOL8R_RULES_CACHE");
+    if (cache_path && !*cache_path) {
+        cache_path = NULL;
+    }
+
+    char err[512];
+    if (isol8r_rules_load(rules, path, cache_path, err, sizeof(err)) == 0) {
+        return 0;
+    }
+    if (errno == ENOENT && !explicit_path) {
+        return 1;
+    }
+    fprintf(stderr, "[%s] Rules not loaded: %s\n", rules_program, err);
+    return -1;
+}
+
+int isol8r_rules_reload(struct isol8r_rules *rules, const char *program) {
+    struct isol8r_rules next;
+    memset(&next, 0, sizeof(next));
+
+    const int rc = isol8r_rules_from_env(&next, program);
+    if (rc >= 0) {
+        isol8r_rules_free(rules);
+        *rules = next;
+    }
+    return rc;
+}
+
+void isol8r_rules_free(struct isol8r_rules *rules) {
+    if (!rules) {
+        return;
+    }
+    if (rules->from_builtin) {
+        memset(rules, 0, sizeof(*rules));
+        return;
+    }
+    if (rules->from_cache) {
+        munmap(rules->blob, rules->blob_size);
+    } else {
+        free(rules->blob);
+    }
+    free(rules->storage);
+    memset(rules, 0, sizeof(*rules));
+}
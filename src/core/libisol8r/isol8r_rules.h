@@ -0,0 +1,161 @@
+/**
+ * isol8r_rules.h - detector rules loaded from one file, compiled and cached.
+ *
+ * Every detector reads its keywords from a single rules file, one rule per
+ * line (blank lines and lines starting with '#' are skipped):
+ *
+ *   <scope> <severity> <pattern> [<label> [<message>]]
+ *
+ *   scope     echo, vmmgr or pyjail (pyjail rules are read by the Python side)
+ *   severity  low, medium or high
+ *   pattern   "text" with C escapes (\\ \" \n \r \t \0 \xNN), i"text" to
+ *             ignore ASCII letter case, or hex:0f05
+ *   label     short name for logs; a bare word or "quoted", "-" reuses the pattern
+ *   message   what the caller is told when the rule fires, usually "quoted"
+ *
+ * Loading compiles each scope into a matcher automaton and lays the rules
+ * and automata out as one flat blob. With a cache path the blob is also
+ * written there, stamped with the source file's size, mtime and inode; a
+ * later load whose source still matches the stamp mmap()s the cache and
+ * attaches in place instead of parsing. Either way the rules point into the
+ * blob, so a loaded set is a single allocation or mapping.
+ *
+ * A binary can also carry a rules file compiled in at build time (see
+ * isol8r_rulegen.c). Once registered with isol8r_rules_set_builtin(), a load
+ * of a file identical to that one skips parsing and the cache altogether
+ * and points straight at the compiled-in tables.
+ */
+
+#ifndef ISOL8R_RULES_H
+#define ISOL8R_RULES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "isol8r_match.h"
+
+/** Rules file used when ISOL8R_RULES is unset. */
+#ifndef ISOL8R_RULES_DEFAULT_PATH
+#define ISOL8R_RULES_DEFAULT_PATH "/app/config/isol8r_rules.conf"
+#endif
+
+/** Most rules one scope holds; consumers track hits in a 32-bit mask. */
+#define ISOL8R_RULES_MAX_PER_SCOPE 32u
+
+/** Scopes the C binaries consume. */
+enum isol8r_rules_scope {
+    ISOL8R_RULES_ECHO = 0,
+    ISOL8R_RULES_VMMGR = 1,
+    ISOL8R_RULES_SCOPE_COUNT
+};
+
+/** Rule severities, in increasing order. */
+enum isol8r_severity {
+    ISOL8R_SEVERITY_LOW = 0,
+    ISOL8R_SEVERITY_MEDIUM = 1,
+    ISOL8R_SEVERITY_HIGH = 2,
+};
+
+/** One rule; every pointer refers into the loaded blob. */
+struct isol8r_rule {
+    const uint8_t *bytes;   /**< Pattern bytes, NUL-terminated for convenience. */
+    uint32_t length;        /**< Pattern length, excluding the terminator. */
+    uint32_t flags;         /**< ISOL8R_MATCH_* flags. */
+    uint32_t severity;      /**< enum isol8r_severity. */
+    const char *label;      /**< Short name for logs. */
+    const char *message;    /**< Caller-facing message; may be empty. */
+};
+
+/** Rules of one scope and the automaton compiled from them. */
+struct isol8r_rule_set {
+    size_t count;                   /**< Number of rules; 0 leaves the matcher empty. */
+    const struct isol8r_rule *rules;
+    struct isol8r_matcher matcher;  /**< Pattern id i is rules[i]. */
+};
+
+/** A loaded rules file. */
+struct isol8r_rules {
+    struct isol8r_rule_set scopes[ISOL8R_RULES_SCOPE_COUNT];
+    bool from_cache;                /**< Attached to an mmap()ed cache rather than compiled. */
+    bool from_builtin;              /**< Points at the compiled-in tables; nothing to release. */
+    void *blob;                     /**< Compiled blob, or the cache mapping. */
+    size_t blob_size;
+    struct isol8r_rule *storage;    /**< Backing array for every scope's `rules`. */
+};
+
+/**
+ * A rules file compiled into the binary. isol8r_rulegen emits one, as
+ * `isol8r_builtin_rules` in isol8r_rules_builtin.h, with every rule and
+ * matcher table static const data: nothing to build at startup, and the
+ * pages are read-only and shared by every process running the binary.
+ */
+struct isol8r_rules_builtin {
+    const uint8_t *source;          /**< Text of the file it was compiled from. */
+    size_t source_size;
+    struct isol8r_rule_set scopes[ISOL8R_RULES_SCOPE_COUNT];
+};
+
+/**
+ * Registers the rules compiled into the binary. Later loads of a file whose
+ * text is byte for byte the compiled-in source use the compiled tables in
+ * place instead of parsing or going through the cache.
+ *
+ * @param builtin Compiled-in rules, which must outlive every load; NULL unregisters.
+ */
+void isol8r_rules_set_builtin(const struct isol8r_rules_builtin *builtin);
+
+/**
+ * Loads a rules file, going through the cache when one is given and valid.
+ * A cache is only trusted when it is a regular file owned by the effective
+ * user, writable by nobody else, and stamped with the source's current
+ * identity; anything else is rebuilt. Failing to write the cache is not
+ * an error, the rules are just compiled again next time.
+ *
+ * @param rules      Receives the rules; untouched on failure.
+ * @param path       Rules file.
+ * @param cache_path Cache file, or NULL to always compile.
+ * @param err        Receives a "file:line: reason" description on failure.
+ * @param err_len    Capacity of err.
+ * @return 0 on success, -1 on failure (errno is ENOENT if path is missing).
+ */
+int isol8r_rules_load(struct isol8r_rules *rules, const char *path, const char *cache_path, char *err, size_t err_len);
+
+/**
+ * Loads the rules named by the environment: ISOL8R_RULES (default
+ * ISOL8R_RULES_DEFAULT_PATH; "none" disables the file) with the cache at
+ * ISOL8R_RULES_CACHE, if set. Problems are reported on stderr.
+ *
+ * @param rules   Receives the rules; untouched unless 0 is returned.
+ * @param program Name used in warnings.
+ * @return 0 when rules were loaded, 1 when there is no rules file to load,
+ *         -1 when the file could not be used.
+ */
+int isol8r_rules_from_env(struct isol8r_rules *rules, const char *program);
+
+/**
+ * Reloads from the environment, replacing `rules` only if the new file
+ * loads cleanly. If the file is gone, `rules` is emptied.
+ *
+ * @param rules   Current rules, zero-initialised if none are loaded.
+ * @param program Name used in warnings.
+ * @return As isol8r_rules_from_env(); on -1 the current rules are kept.
+ */
+int isol8r_rules_reload(struct isol8r_rules *rules, const char *program);
+
+/**
+ * Releases a loaded set and zeroes it. Safe on a zeroed struct.
+ *
+ * @param rules Rules to release.
+ */
+void isol8r_rules_free(struct isol8r_rules *rules);
+
+/**
+ * Names a severity.
+ *
+ * @param severity enum isol8r_severity value.
+ * @return "low", "medium", "high" or "unknown".
+ */
+const char *isol8r_severity_name(uint32_t severity);
+
+#endif /* ISOL8R_RULES_H */
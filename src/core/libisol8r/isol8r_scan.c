@@ -0,0 +1,484 @@
+/**
+ * isol8r_scan.c - scalar, SSE2 and AVX2 scanning kernels with runtime dispatch.
+ */
+
+#include "isol8r_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ISOL8R_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef ISOL8R_SCAN_VERIFY
+#include <stdio.h>
+#endif
+
+typedef size_t (*isol8r_find_fn)(const uint8_t *, size_t, const uint8_t *, size_t);
+typedef int (*isol8r_zero_fn)(const uint8_t *, size_t);
+typedef uint32_t (*isol8r_multi_fn)(const uint8_t *, size_t, const struct isol8r_scan_pattern *, size_t, int *);
+
+/* ---------------------------------------------------------------- scalar -- */
+
+size_t isol8r_scan_find_scalar(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len) {
+    if (!data || !pattern || pattern_len == 0 || pattern_len > len) {
+        return ISOL8R_SCAN_NOT_FOUND;
+    }
+    for (size_t i = 0; i + pattern_len <= len; ++i) {
+        if (memcmp(data + i, pattern, pattern_len) == 0) {
+            return i;
+        }
+    }
+    return ISOL8R_SCAN_NOT_FOUND;
+}
+
+int isol8r_scan_has_zero_scalar(const uint8_t *data, size_t len) {
+    if (!data) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        if (data[i] == 0x00u) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t isol8r_scan_multi_scalar(const uint8_t *data,
+                                  size_t len,
+                                  const struct isol8r_scan_pattern *patterns,
+                                  size_t count,
+                                  int *has_zero) {
+    int zero = 0;
+    uint32_t found = 0;
+
+    if (count > ISOL8R_SCAN_MULTI_MAX) {
+        count = ISOL8R_SCAN_MULTI_MAX;
+    }
+    uint32_t pending = 0;
+    for (size_t j = 0; j < count; ++j) {
+        if (patterns[j].bytes && patterns[j].length > 0 && patterns[j].length <= len) {
+            pending |= 1u << j;
+        }
+    }
+
+    for (size_t i = 0; data && i < len; ++i) {
+        zero |= data[i] == 0x00u;
+        for (uint32_t left = pending; left; left &= left - 1u) {
+            const unsigned j = (unsigned)__builtin_ctz(left);
+            if (data[i] == patterns[j].bytes[0] && i + patterns[j].length <= len &&
+                memcmp(data + i, patterns[j].bytes, patterns[j].length) == 0) {
+                found |= 1u << j;
+                pending &= ~(1u << j);
+            }
+        }
+        if (!pending && (zero || !has_zero)) {
+            break;
+        }
+    }
+
+    if (has_zero) {
+        *has_zero = zero;
+    }
+    return found;
+}
+
+/*
+ * Confirms the candidates in `mask` (bit k = a first/last-byte hit at
+ * base + k) and returns the first full match.
+ */
+static size_t isol8r_scan_confirm(const uint8_t *data, size_t base, uint32_t mask, const uint8_t *pattern, size_t pattern_len) {
+    while (mask) {
+        const unsigned bit = (unsigned)__builtin_ctz(mask);
+        if (pattern_len <= 2 || memcmp(data + base + bit + 1, pattern + 1, pattern_len - 2) == 0) {
+            return base + bit;
+        }
+        mask &= mask - 1u;
+    }
+    return ISOL8R_SCAN_NOT_FOUND;
+}
+
+/*
+ * Sets up a vectorised multi-pattern pass: the patterns that can match at
+ * all, and the longest of them, which bounds how far full-width loads may
+ * run before the scalar tail takes over.
+ */
+static uint32_t isol8r_scan_multi_prepare(size_t len, const struct isol8r_scan_pattern *patterns, size_t *count, size_t *longest) {
+    uint32_t pending = 0;
+    *longest = 1;
+    if (*count > ISOL8R_SCAN_MULTI_MAX) {
+        *count = ISOL8R_SCAN_MULTI_MAX;
+    }
+    for (size_t j = 0; j < *count; ++j) {
+        if (patterns[j].bytes && patterns[j].length > 0 && patterns[j].length <= len) {
+            pending |= 1u << j;
+            if (patterns[j].length > *longest) {
+                *longest = patterns[j].length;
+            }
+        }
+    }
+    return pending;
+}
+
+/*
+ * Finishes a vectorised multi-pattern pass from `from`: every match
+ * starting earlier has already been checked by the vector loop. Zero bytes
+ * are only looked for when the caller wants them and none was seen yet.
+ */
+static uint32_t isol8r_scan_multi_tail(const uint8_t *data,
+                                       size_t len,
+                                       size_t from,
+                                       const struct isol8r_scan_pattern *patterns,
+                                       size_t count,
+                                       uint32_t pending,
+                                       int want_zero,
+                                       int *zero) {
+    struct isol8r_scan_pattern remaining[ISOL8R_SCAN_MULTI_MAX];
+    for (size_t j = 0; j < count; ++j) {
+        remaining[j] = patterns[j];
+        if (!(pending & (1u << j))) {
+            remaining[j].length = 0;
+        }
+    }
+    int tail_zero = 0;
+    const uint32_t found = isol8r_scan_multi_scalar(data + from, len - from, remaining, count,
+                                                    want_zero && !*zero ? &tail_zero : NULL);
+    *zero |= tail_zero;
+    return found;
+}
+
+/* Scalar sweep over the positions a vector loop left behind. */
+static size_t isol8r_scan_find_tail(const uint8_t *data, size_t len, size_t from, const uint8_t *pattern, size_t pattern_len) {
+    size_t found = isol8r_scan_find_scalar(data + from, len - from, pattern, pattern_len);
+    return found == ISOL8R_SCAN_NOT_FOUND ? found : from + found;
+}
+
+#ifdef ISOL8R_SCAN_X86
+
+/* ------------------------------------------------------------------ sse2 -- */
+
+__attribute__((target("sse2")))
+static size_t isol8r_scan_find_sse2(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len) {
+    if (!data || !pattern || pattern_len == 0 || pattern_len > len) {
+        return ISOL8R_SCAN_NOT_FOUND;
+    }
+    if (pattern_len == 1) {
+        const uint8_t *hit = memchr(data, pattern[0], len);
+        return hit ? (size_t)(hit - data) : ISOL8R_SCAN_NOT_FOUND;
+    }
+
+    const __m128i first = _mm_set1_epi8((char)pattern[0]);
+    const __m128i last = _mm_set1_epi8((char)pattern[pattern_len - 1]);
+    size_t i = 0;
+    for (; i + pattern_len - 1 + 16 <= len; i += 16) {
+        const __m128i block_first = _mm_loadu_si128((const __m128i *)(const void *)(data + i));
+        const __m128i block_last = _mm_loadu_si128((const __m128i *)(const void *)(data + i + pattern_len - 1));
+        const __m128i both = _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(both);
+        if (mask) {
+            size_t found = isol8r_scan_confirm(data, i, mask, pattern, pattern_len);
+            if (found != ISOL8R_SCAN_NOT_FOUND) {
+                return found;
+            }
+        }
+    }
+    return isol8r_scan_find_tail(data, len, i, pattern, pattern_len);
+}
+
+__attribute__((target("sse2")))
+static int isol8r_scan_has_zero_sse2(const uint8_t *data, size_t len) {
+    if (!data) {
+        return 0;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(data + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(data + i + 16));
+        const __m128i c = _mm_loadu_si128((const __m128i *)(const void *)(data + i + 32));
+        const __m128i d = _mm_loadu_si128((const __m128i *)(const void *)(data + i + 48));
+        const __m128i lowest = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(lowest, zero))) {
+            return 1;
+        }
+    }
+    for (; i + 16 <= len; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero))) {
+            return 1;
+        }
+    }
+    return isol8r_scan_has_zero_scalar(data + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static uint32_t isol8r_scan_multi_sse2(const uint8_t *data,
+                                       size_t len,
+                                       const struct isol8r_scan_pattern *patterns,
+                                       size_t count,
+                                       int *has_zero) {
+    size_t longest;
+    uint32_t pending = isol8r_scan_multi_prepare(len, patterns, &count, &longest);
+    uint32_t found = 0;
+    int zero = 0;
+    size_t i = 0;
+
+    if (data) {
+        const __m128i nul = _mm_setzero_si128();
+        for (; i + longest - 1 + 16 <= len && (pending || (!zero && has_zero)); i += 16) {
+            const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)(data + i));
+            if (!zero && _mm_movemask_epi8(_mm_cmpeq_epi8(block, nul))) {
+                zero = 1;
+            }
+            for (uint32_t left = pending; left; left &= left - 1u) {
+                const unsigned j = (unsigned)__builtin_ctz(left);
+                const size_t plen = patterns[j].length;
+                const __m128i block_last = _mm_loadu_si128((const __m128i *)(const void *)(data + i + plen - 1));
+                const __m128i both = _mm_and_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8((char)patterns[j].bytes[0])),
+                                                   _mm_cmpeq_epi8(block_last, _mm_set1_epi8((char)patterns[j].bytes[plen - 1])));
+                const uint32_t mask = (uint32_t)_mm_movemask_epi8(both);
+                if (mask && isol8r_scan_confirm(data, i, mask, patterns[j].bytes, plen) != ISOL8R_SCAN_NOT_FOUND) {
+                    found |= 1u << j;
+                    pending &= ~(1u << j);
+                }
+            }
+        }
+        if (i < len && (pending || (!zero && has_zero))) {
+            found |= isol8r_scan_multi_tail(data, len, i, patterns, count, pending, has_zero != NULL, &zero);
+        }
+    }
+
+    if (has_zero) {
+        *has_zero = zero;
+    }
+    return found;
+}
+
+/* ------------------------------------------------------------------ avx2 -- */
+
+__attribute__((target("avx2")))
+static size_t isol8r_scan_find_avx2(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len) {
+    if (!data || !pattern || pattern_len == 0 || pattern_len > len) {
+        return ISOL8R_SCAN_NOT_FOUND;
+    }
+    if (pattern_len == 1) {
+        const uint8_t *hit = memchr(data, pattern[0], len);
+        return hit ? (size_t)(hit - data) : ISOL8R_SCAN_NOT_FOUND;
+    }
+
+    const __m256i first = _mm256_set1_epi8((char)pattern[0]);
+    const __m256i last = _mm256_set1_epi8((char)pattern[pattern_len - 1]);
+    size_t i = 0;
+    for (; i + pattern_len - 1 + 32 <= len; i += 32) {
+        const __m256i block_first = _mm256_loadu_si256((const __m256i *)(const void *)(data + i));
+        const __m256i block_last = _mm256_loadu_si256((const __m256i *)(const void *)(data + i + pattern_len - 1));
+        const __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last));
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(both);
+        if (mask) {
+            size_t found = isol8r_scan_confirm(data, i, mask, pattern, pattern_len);
+            if (found != ISOL8R_SCAN_NOT_FOUND) {
+                return found;
+            }
+        }
+    }
+    /* Finish with SSE2 before dropping to scalar. */
+    if (i < len) {
+        size_t found = isol8r_scan_find_sse2(data + i, len - i, pattern, pattern_len);
+        return found == ISOL8R_SCAN_NOT_FOUND ? found : i + found;
+    }
+    return ISOL8R_SCAN_NOT_FOUND;
+}
+
+__attribute__((target("avx2")))
+static int isol8r_scan_has_zero_avx2(const uint8_t *data, size_t len) {
+    if (!data) {
+        return 0;
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *)(const void *)(data + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i *)(const void *)(data + i + 32));
+        const __m256i c = _mm256_loadu_si256((const __m256i *)(const void *)(data + i + 64));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(const void *)(data + i + 96));
+        const __m256i lowest = _mm256_min_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(c, d));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(lowest, zero))) {
+            return 1;
+        }
+    }
+    return isol8r_scan_has_zero_sse2(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static uint32_t isol8r_scan_multi_avx2(const uint8_t *data,
+                                       size_t len,
+                                       const struct isol8r_scan_pattern *patterns,
+                                       size_t count,
+                                       int *has_zero) {
+    size_t longest;
+    uint32_t pending = isol8r_scan_multi_prepare(len, patterns, &count, &longest);
+    uint32_t found = 0;
+    int zero = 0;
+    size_t i = 0;
+
+    if (data) {
+        const __m256i nul = _mm256_setzero_si256();
+        for (; i + longest - 1 + 32 <= len && (pending || (!zero && has_zero)); i += 32) {
+            const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)(data + i));
+            if (!zero && _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, nul))) {
+                zero = 1;
+            }
+            for (uint32_t left = pending; left; left &= left - 1u) {
+                const unsigned j = (unsigned)__builtin_ctz(left);
+                const size_t plen = patterns[j].length;
+                const __m256i block_last = _mm256_loadu_si256((const __m256i *)(const void *)(data + i + plen - 1));
+                const __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)patterns[j].bytes[0])),
+                                                      _mm256_cmpeq_epi8(block_last, _mm256_set1_epi8((char)patterns[j].bytes[plen - 1])));
+                const uint32_t mask = (uint32_t)_mm256_movemask_epi8(both);
+                if (mask && isol8r_scan_confirm(data, i, mask, patterns[j].bytes, plen) != ISOL8R_SCAN_NOT_FOUND) {
+                    found |= 1u << j;
+                    pending &= ~(1u << j);
+                }
+            }
+        }
+        if (i < len && (pending || (!zero && has_zero))) {
+            found |= isol8r_scan_multi_tail(data, len, i, patterns, count, pending, has_zero != NULL, &zero);
+        }
+    }
+
+    if (has_zero) {
+        *has_zero = zero;
+    }
+    return found;
+}
+
+#endif /* ISOL8R_SCAN_X86 */
+
+/* -------------------------------------------------------------- dispatch -- */
+
+static const struct {
+    isol8r_find_fn find;
+    isol8r_zero_fn has_zero;
+    isol8r_multi_fn multi;
+} isol8r_scan_kernels[] = {
+    [ISOL8R_SCAN_SCALAR] = { isol8r_scan_find_scalar, isol8r_scan_has_zero_scalar, isol8r_scan_multi_scalar },
+#ifdef ISOL8R_SCAN_X86
+    [ISOL8R_SCAN_SSE2] = { isol8r_scan_find_sse2, isol8r_scan_has_zero_sse2, isol8r_scan_multi_sse2 },
+    [ISOL8R_SCAN_AVX2] = { isol8r_scan_find_avx2, isol8r_scan_has_zero_avx2, isol8r_scan_multi_avx2 },
+#endif
+};
+
+static int isol8r_scan_resolved;
+static enum isol8r_scan_isa isol8r_scan_current = ISOL8R_SCAN_SCALAR;
+
+static int isol8r_scan_supported(enum isol8r_scan_isa isa) {
+    switch (isa) {
+    case ISOL8R_SCAN_SCALAR:
+        return 1;
+#ifdef ISOL8R_SCAN_X86
+    case ISOL8R_SCAN_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case ISOL8R_SCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static void isol8r_scan_resolve(void) {
+    enum isol8r_scan_isa best = ISOL8R_SCAN_SCALAR;
+    if (isol8r_scan_supported(ISOL8R_SCAN_AVX2)) {
+        best = ISOL8R_SCAN_AVX2;
+    } else if (isol8r_scan_supported(ISOL8R_SCAN_SSE2)) {
+        best = ISOL8R_SCAN_SSE2;
+    }
+
+    const char *pinned = getenv("ISOL8R_SCAN_ISA");
+    if (pinned && *pinned) {
+        for (int isa = ISOL8R_SCAN_SCALAR; isa <= ISOL8R_SCAN_AVX2; ++isa) {
+            if (strcmp(pinned, isol8r_scan_isa_name((enum isol8r_scan_isa)isa)) == 0 &&
+                isol8r_scan_supported((enum isol8r_scan_isa)isa)) {
+                best = (enum isol8r_scan_isa)isa;
+                break;
+            }
+        }
+    }
+
+    isol8r_scan_current = best;
+    isol8r_scan_resolved = 1;
+}
+
+enum isol8r_scan_isa isol8r_scan_active(void) {
+    if (!isol8r_scan_resolved) {
+        isol8r_scan_resolve();
+    }
+    return isol8r_scan_current;
+}
+
+int isol8r_scan_select(enum isol8r_scan_isa isa) {
+    if (!isol8r_scan_supported(isa)) {
+        return -1;
+    }
+    isol8r_scan_current = isa;
+    isol8r_scan_resolved = 1;
+    return 0;
+}
+
+const char *isol8r_scan_isa_name(enum isol8r_scan_isa isa) {
+    switch (isa) {
+    case ISOL8R_SCAN_SSE2:
+        return "sse2";
+    case ISOL8R_SCAN_AVX2:
+        return "avx2";
+    case ISOL8R_SCAN_SCALAR:
+    default:
+        return "scalar";
+    }
+}
+
+size_t isol8r_scan_find(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len) {
+    const size_t found = isol8r_scan_kernels[isol8r_scan_active()].find(data, len, pattern, pattern_len);
+#ifdef ISOL8R_SCAN_VERIFY
+    if (found != isol8r_scan_find_scalar(data, len, pattern, pattern_len)) {
+        fprintf(stderr, "isol8r_scan: %s find disagrees with scalar (len=%zu pattern_len=%zu)\n",
+                isol8r_scan_isa_name(isol8r_scan_current), len, pattern_len);
+        abort();
+    }
+#endif
+    return found;
+}
+
+int isol8r_scan_has_zero(const uint8_t *data, size_t len) {
+    const int found = isol8r_scan_kernels[isol8r_scan_active()].has_zero(data, len);
+#ifdef ISOL8R_SCAN_VERIFY
+    if (found != isol8r_scan_has_zero_scalar(data, len)) {
+        fprintf(stderr, "isol8r_scan: %s has_zero disagrees with scalar (len=%zu)\n",
+                isol8r_scan_isa_name(isol8r_scan_current), len);
+        abort();
+    }
+#endif
+    return found;
+}
+
+uint32_t isol8r_scan_multi(const uint8_t *data,
+                           size_t len,
+                           const struct isol8r_scan_pattern *patterns,
+                           size_t count,
+                           int *has_zero) {
+    const uint32_t found = isol8r_scan_kernels[isol8r_scan_active()].multi(data, len, patterns, count, has_zero);
+#ifdef ISOL8R_SCAN_VERIFY
+    int zero = 0;
+    const uint32_t expected = isol8r_scan_multi_scalar(data, len, patterns, count, has_zero ? &zero : NULL);
+    if (found != expected || (has_zero && zero != *has_zero)) {
+        fprintf(stderr, "isol8r_scan: %s multi disagrees with scalar (len=%zu count=%zu)\n",
+                isol8r_scan_isa_name(isol8r_scan_current), len, count);
+        abort();
+    }
+#endif
+    return found;
+}
@@ -0,0 +1,118 @@
+/**
+ * isol8r_scan.h - vectorised byte-scanning kernels for payload inspection.
+ *
+ * Two primitives the detectors lean on: find a short byte pattern, and ask
+ * whether a buffer holds a NUL, plus a fused pass that answers both for a
+ * whole pattern set in one sweep. Each has a scalar reference and, on x86,
+ * an SSE2 kernel (always available on x86-64) plus an AVX2 kernel picked
+ * at runtime when the CPU supports it. Pattern search filters candidates
+ * on the pattern's first and last byte a whole vector at a time and only
+ * compares the middle on a double hit; the NUL check folds several vectors
+ * together with an unsigned min before a single compare-to-zero.
+ *
+ * ISOL8R_SCAN_ISA=scalar|sse2|avx2 in the environment pins a kernel (an
+ * unsupported choice falls back to the best available). Building with
+ * -DISOL8R_SCAN_VERIFY cross-checks every call against the scalar
+ * reference and aborts on disagreement.
+ */
+
+#ifndef ISOL8R_SCAN_H
+#define ISOL8R_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Returned by isol8r_scan_find() when the pattern does not occur. */
+#define ISOL8R_SCAN_NOT_FOUND SIZE_MAX
+
+/** Most patterns one isol8r_scan_multi() call tracks (one result bit each). */
+#define ISOL8R_SCAN_MULTI_MAX 32u
+
+/** One entry of a pattern set. */
+struct isol8r_scan_pattern {
+    const uint8_t *bytes;
+    size_t length;          /**< 0 never matches. */
+};
+
+/** Kernel families, in order of preference. */
+enum isol8r_scan_isa {
+    ISOL8R_SCAN_SCALAR = 0,
+    ISOL8R_SCAN_SSE2 = 1,
+    ISOL8R_SCAN_AVX2 = 2,
+};
+
+/**
+ * Reports the kernel family in use, resolving it on first call.
+ *
+ * @return Active kernel family.
+ */
+enum isol8r_scan_isa isol8r_scan_active(void);
+
+/**
+ * Pins a kernel family, e.g. for benchmarking.
+ *
+ * @param isa Desired family.
+ * @return 0 on success, -1 if this CPU or build lacks it (nothing changes).
+ */
+int isol8r_scan_select(enum isol8r_scan_isa isa);
+
+/**
+ * Human-readable kernel name: "scalar", "sse2" or "avx2".
+ *
+ * @param isa Kernel family.
+ * @return Static string.
+ */
+const char *isol8r_scan_isa_name(enum isol8r_scan_isa isa);
+
+/**
+ * Finds the first occurrence of a pattern.
+ *
+ * @param data        Bytes to search.
+ * @param len         Number of bytes.
+ * @param pattern     Pattern bytes.
+ * @param pattern_len Pattern length; 0 never matches.
+ * @return Offset of the first match, or ISOL8R_SCAN_NOT_FOUND.
+ */
+size_t isol8r_scan_find(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len);
+
+/**
+ * Reports whether a buffer holds a zero byte.
+ *
+ * @param data Bytes to check.
+ * @param len  Number of bytes.
+ * @return Nonzero when at least one byte is 0x00.
+ */
+int isol8r_scan_has_zero(const uint8_t *data, size_t len);
+
+/**
+ * Looks for every pattern of a set, and for zero bytes, in a single pass
+ * over the data. Each block is loaded once and tested against all patterns
+ * still unmatched; the sweep stops early once nothing is left to learn.
+ *
+ * @param data     Bytes to search.
+ * @param len      Number of bytes.
+ * @param patterns Pattern set; entries past ISOL8R_SCAN_MULTI_MAX are ignored.
+ * @param count    Number of patterns.
+ * @param has_zero Receives nonzero when a zero byte occurs; may be NULL.
+ * @return Bitmask with bit i set when patterns[i] occurs.
+ */
+uint32_t isol8r_scan_multi(const uint8_t *data,
+                           size_t len,
+                           const struct isol8r_scan_pattern *patterns,
+                           size_t count,
+                           int *has_zero);
+
+/** Scalar reference for isol8r_scan_find(). */
+size_t isol8r_scan_find_scalar(const uint8_t *data, size_t len, const uint8_t *pattern, size_t pattern_len);
+
+/** Scalar reference for isol8r_scan_has_zero(). */
+int isol8r_scan_has_zero_scalar(const uint8_t *data, size_t len);
+
+/** Scalar reference for isol8r_scan_multi(). */
+uint32_t isol8r_scan_multi_scalar(const uint8_t *data,
+                                  size_t len,
+                                  const struct isol8r_scan_pattern *patterns,
+                                  size_t count,
+                                  int *has_zero);
+
+#endif /* ISOL8R_SCAN_H */
@@ -0,0 +1,89 @@
+/**
+ * isol8r_screen.c - handle-based keyword screening over isol8r_match.
+ */
+
+#include "isol8r_screen.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isol8r_match.h"
+
+struct isol8r_screen {
+    struct isol8r_matcher matcher;
+};
+
+/* A screen's hit array plus the running count of distinct hits. */
+struct isol8r_screen_hits {
+    uint8_t *hit;
+    size_t found;
+    size_t count;
+};
+
+int isol8r_screen_abi(void) {
+    return ISOL8R_SCREEN_ABI;
+}
+
+struct isol8r_screen *isol8r_screen_new(const uint8_t *const *keywords,
+                                        const size_t *lengths,
+                                        size_t count,
+                                        unsigned flags) {
+    if (!keywords || !lengths || count == 0 || count > SIZE_MAX / sizeof(struct isol8r_pattern)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct isol8r_pattern *patterns = malloc(count * sizeof(*patterns));
+    struct isol8r_screen *screen = calloc(1, sizeof(*screen));
+    if (!patterns || !screen) {
+        free(patterns);
+        free(screen);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        patterns[i].bytes = keywords[i];
+        patterns[i].length = lengths[i];
+        patterns[i].flags = flags;
+    }
+
+    const int rc = isol8r_match_build(&screen->matcher, patterns, count);
+    free(patterns);
+    if (rc != 0) {
+        const int saved = errno;
+        free(screen);
+        errno = saved;
+        return NULL;
+    }
+    return screen;
+}
+
+static int isol8r_screen_record(uint32_t pattern_id, size_t end_offset, void *ctx) {
+    struct isol8r_screen_hits *hits = ctx;
+    (void)end_offset;
+    if (!hits->hit[pattern_id]) {
+        hits->hit[pattern_id] = 1;
+        ++hits->found;
+    }
+    /* Nothing left to learn once every keyword has been seen. */
+    return hits->found == hits->count;
+}
+
+size_t isol8r_screen_run(const struct isol8r_screen *screen, const uint8_t *data, size_t len, uint8_t *hits) {
+    struct isol8r_screen_hits state = { hits, 0, screen->matcher.pattern_count };
+
+    memset(hits, 0, screen->matcher.pattern_count);
+    if (data && len > 0) {
+        isol8r_match_scan(&screen->matcher, data, len, isol8r_screen_record, &state);
+    }
+    return state.found;
+}
+
+void isol8r_screen_free(struct isol8r_screen *screen) {
+    if (!screen) {
+        return;
+    }
+    isol8r_match_free(&screen->matcher);
+    free(screen);
+}
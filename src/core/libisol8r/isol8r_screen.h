@@ -0,0 +1,62 @@
+/**
+ * isol8r_screen.h - keyword screening entry points for libisol8r_scan.so.
+ *
+ * A small handle-based wrapper over isol8r_match for callers that cannot
+ * see C structs, chiefly the ctypes binding in src/utils/isol8r_scan.py
+ * that PythonJail screens submitted code with. One handle holds one
+ * compiled keyword set; a screen reports which keywords occur anywhere in
+ * the input, in a single pass, with no limit on the number of keywords.
+ */
+
+#ifndef ISOL8R_SCREEN_H
+#define ISOL8R_SCREEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** ABI version of this interface; bumped whenever a signature changes. */
+#define ISOL8R_SCREEN_ABI 1
+
+/** Opaque compiled keyword set. */
+struct isol8r_screen;
+
+/**
+ * Reports the ABI version the library was built with.
+ *
+ * @return ISOL8R_SCREEN_ABI at build time.
+ */
+int isol8r_screen_abi(void);
+
+/**
+ * Compiles a keyword set.
+ *
+ * @param keywords Keyword bytes, one pointer per keyword.
+ * @param lengths  Length of each keyword, 1..ISOL8R_MATCH_MAX_PATTERN.
+ * @param count    Number of keywords, at least 1.
+ * @param flags    ISOL8R_MATCH_* flags applied to every keyword.
+ * @return A handle for isol8r_screen_run(), or NULL with errno set.
+ */
+struct isol8r_screen *isol8r_screen_new(const uint8_t *const *keywords,
+                                        const size_t *lengths,
+                                        size_t count,
+                                        unsigned flags);
+
+/**
+ * Screens a buffer.
+ *
+ * @param screen Compiled keyword set.
+ * @param data   Bytes to screen.
+ * @param len    Number of bytes.
+ * @param hits   Receives hits[i] = 1 if keyword i occurs, else 0; sized to the keyword count.
+ * @return Number of distinct keywords found.
+ */
+size_t isol8r_screen_run(const struct isol8r_screen *screen, const uint8_t *data, size_t len, uint8_t *hits);
+
+/**
+ * Releases a keyword set. Safe on NULL.
+ *
+ * @param screen Handle from isol8r_screen_new().
+ */
+void isol8r_screen_free(struct isol8r_screen *screen);
+
+#endif /* ISOL8R_SCREEN_H */
@@ -0,0 +1,72 @@
+/**
+ * isol8r_stage.c - per-stage timing summary printed at exit.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "isol8r_stage.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int stage_enabled;
+static const char *stage_program = "unknown";
+static uint64_t stage_start;
+static uint64_t stage_last;
+static uint64_t stage_total[ISOL8R_STAGE_COUNT];
+
+static uint64_t isol8r_stage_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static void isol8r_stage_report(void) {
+    char line[256];
+    int length = snprintf(line, sizeof(line),
+                          "[isol8r-stages] program=%s start_ns=%llu read_ns=%llu inspect_ns=%llu log_ns=%llu execute_ns=%llu\n",
+                          stage_program,
+                          (unsigned long long)stage_start,
+                          (unsigned long long)stage_total[ISOL8R_STAGE_READ],
+                          (unsigned long long)stage_total[ISOL8R_STAGE_INSPECT],
+                          (unsigned long long)stage_total[ISOL8R_STAGE_LOG],
+                          (unsigned long long)stage_total[ISOL8R_STAGE_EXECUTE]);
+    if (length > 0 && (size_t)length < sizeof(line)) {
+        /* One write so the line cannot interleave with stdio's stderr buffer. */
+        ssize_t ignored = write(STDERR_FILENO, line, (size_t)length);
+        (void)ignored;
+    }
+}
+
+void isol8r_stage_init(const char *program) {
+    const char *flag = getenv("ISOL8R_STAGE_TIMINGS");
+    if (!flag || !*flag || strcmp(flag, "0") == 0) {
+        return;
+    }
+    stage_program = program ? program : stage_program;
+    stage_start = isol8r_stage_now();
+    stage_last = stage_start;
+    stage_enabled = atexit(isol8r_stage_report) == 0;
+}
+
+void isol8r_stage_restart(void) {
+    if (!stage_enabled) {
+        return;
+    }
+    stage_start = isol8r_stage_now();
+    stage_last = stage_start;
+    memset(stage_total, 0, sizeof(stage_total));
+}
+
+void isol8r_stage_mark(enum isol8r_stage stage) {
+    if (!stage_enabled || (unsigned)stage >= ISOL8R_STAGE_COUNT) {
+        return;
+    }
+    const uint64_t now = isol8r_stage_now();
+    stage_total[stage] += now - stage_last;
+    stage_last = now;
+}
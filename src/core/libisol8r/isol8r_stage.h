@@ -0,0 +1,50 @@
+/**
+ * isol8r_stage.h - opt-in per-stage timing for the sandbox binaries.
+ *
+ * With ISOL8R_STAGE_TIMINGS=1 in the environment, a binary notes the
+ * monotonic clock at startup and attributes the time between consecutive
+ * isol8r_stage_mark() calls to the stage being marked. At exit a single
+ * line goes to stderr:
+ *
+ *   [isol8r-stages] program=tiny_vmmgr start_ns=... read_ns=... inspect_ns=...
+ *                   log_ns=... execute_ns=...
+ *
+ * start_ns is CLOCK_MONOTONIC, the same clock Python's time.monotonic_ns()
+ * reads, so a driver can subtract its own pre-spawn timestamp to get the
+ * spawn cost. Without the variable every call is a flag test.
+ */
+
+#ifndef ISOL8R_STAGE_H
+#define ISOL8R_STAGE_H
+
+/** Stages a request passes through; not every binary uses all of them. */
+enum isol8r_stage {
+    ISOL8R_STAGE_READ = 0,      /**< Waiting for and reading the input. */
+    ISOL8R_STAGE_INSPECT,       /**< Keyword / detector scanning. */
+    ISOL8R_STAGE_LOG,           /**< Writing bait log or event ring records. */
+    ISOL8R_STAGE_EXECUTE,       /**< Running the payload (or echoing it back). */
+    ISOL8R_STAGE_COUNT
+};
+
+/**
+ * Reads ISOL8R_STAGE_TIMINGS and, when set, starts the clock and arranges
+ * for the summary line to be printed at exit.
+ *
+ * @param program Name printed in the summary line.
+ */
+void isol8r_stage_init(const char *program);
+
+/**
+ * Restarts the clock and clears the totals, for a forked child that serves
+ * one request on behalf of a long-lived parent.
+ */
+void isol8r_stage_restart(void);
+
+/**
+ * Charges the time since the previous mark (or startup) to `stage`.
+ *
+ * @param stage Stage that just finished.
+ */
+void isol8r_stage_mark(enum isol8r_stage stage);
+
+#endif /* ISOL8R_STAGE_H */
@@ -0,0 +1,155 @@
+/**
+ * isol8r_stats.c - writer side of the shared stats page.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "isol8r_stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(offsetof(struct isol8r_stats_page, counters) == 64, "stats header layout changed");
+_Static_assert(sizeof(struct isol8r_stats_page) <= 4096, "stats page outgrew a page");
+
+static struct isol8r_stats_page *stats_page;
+
+static void isol8r_stats_format(int fd, const char *program) {
+    struct isol8r_stats_page page;
+    struct timespec now;
+
+    memset(&page, 0, sizeof(page));
+    memcpy(page.magic, ISOL8R_STATS_MAGIC, sizeof(page.magic));
+    page.version = ISOL8R_STATS_VERSION;
+    page.size = (uint32_t)sizeof(page);
+    clock_gettime(CLOCK_REALTIME, &now);
+    page.created_ns = (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+    strncpy(page.program, program, sizeof(page.program) - 1);
+
+    /* A short write leaves a page the check below refuses; nothing else to do. */
+    ssize_t ignored = pwrite(fd, &page, sizeof(page), 0);
+    (void)ignored;
+}
+
+static int isol8r_stats_check(int fd) {
+    struct isol8r_stats_page page;
+
+    return pread(fd, &page, sizeof(page), 0) == (ssize_t)sizeof(page) &&
+           memcmp(page.magic, ISOL8R_STATS_MAGIC, sizeof(page.magic)) == 0 &&
+           page.version == ISOL8R_STATS_VERSION && page.size == sizeof(page);
+}
+
+void isol8r_stats_init(const char *program) {
+    const char *dir = getenv("ISOL8R_STATS_DIR");
+    if (!dir) {
+        dir = ISOL8R_STATS_DEFAULT_DIR;
+    }
+    if (!*dir || !program || stats_page) {
+        return;
+    }
+
+    char path[PATH_MAX];
+    int length = snprintf(path, sizeof(path), "%s/%s.stats", dir, program);
+    if (length < 0 || (size_t)length >= sizeof(path)) {
+        return;
+    }
+
+    int fd;
+    do {
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return;
+    }
+
+    /* As with the event ring, the lock only covers creation. */
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return;
+        }
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        isol8r_stats_format(fd, program);
+    }
+    const int usable = isol8r_stats_check(fd);
+    flock(fd, LOCK_UN);
+
+    void *map = usable ? mmap(NULL, sizeof(*stats_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map != MAP_FAILED) {
+        stats_page = map;
+    }
+}
+
+void isol8r_stats_detach(void) {
+    if (stats_page) {
+        munmap(stats_page, sizeof(*stats_page));
+        stats_page = NULL;
+    }
+}
+
+void isol8r_stats_add(enum isol8r_stats_counter counter, uint64_t amount) {
+    if (stats_page && (unsigned)counter < ISOL8R_STATS_COUNTER_COUNT) {
+        __atomic_fetch_add(&stats_page->counters[counter], amount, __ATOMIC_RELAXED);
+    }
+}
+
+void isol8r_stats_hits(uint32_t mask) {
+    if (!stats_page || !mask) {
+        return;
+    }
+    __atomic_fetch_add(&stats_page->counters[ISOL8R_STATS_FLAGGED], 1, __ATOMIC_RELAXED);
+    for (uint32_t rest = mask; rest; rest &= rest - 1u) {
+        __atomic_fetch_add(&stats_page->hits[__builtin_ctz(rest)], 1, __ATOMIC_RELAXED);
+    }
+}
+
+void isol8r_stats_latency(enum isol8r_stage stage, uint64_t ns) {
+    if (!stats_page || (unsigned)stage >= ISOL8R_STAGE_COUNT) {
+        return;
+    }
+    struct isol8r_stats_latency *latency = &stats_page->latency[stage];
+    unsigned bucket = ns ? 64u - (unsigned)__builtin_clzll(ns) : 0u;
+    if (bucket >= ISOL8R_STATS_BUCKETS) {
+        bucket = ISOL8R_STATS_BUCKETS - 1u;
+    }
+    __atomic_fetch_add(&latency->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency->total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency->count, 1, __ATOMIC_RELAXED);
+}
+
+void isol8r_stats_labels(uint32_t count, const char *(*label)(uint32_t pattern_id)) {
+    if (!stats_page) {
+        return;
+    }
+    if (count > ISOL8R_STATS_PATTERNS) {
+        count = ISOL8R_STATS_PATTERNS;
+    }
+    /* Every one-shot run passes through here; only a change dirties the page. */
+    for (uint32_t i = 0; i < ISOL8R_STATS_PATTERNS; ++i) {
+        char text[ISOL8R_STATS_LABEL_MAX];
+        memset(text, 0, sizeof(text));
+        if (i < count) {
+            const char *name = label(i);
+            memcpy(text, name, strnlen(name, sizeof(text)));
+        }
+        if (memcmp(stats_page->labels[i], text, sizeof(text)) != 0) {
+            memcpy(stats_page->labels[i], text, sizeof(text));
+        }
+    }
+    if (__atomic_load_n(&stats_page->pattern_count, __ATOMIC_RELAXED) != count) {
+        __atomic_store_n(&stats_page->pattern_count, count, __ATOMIC_RELAXED);
+    }
+}
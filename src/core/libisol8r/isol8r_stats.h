@@ -0,0 +1,129 @@
+/**
+ * isol8r_stats.h - live counters and latency histograms in a shared page.
+ *
+ * Each binary keeps one small file-backed page, <dir>/<program>.stats, with
+ * dir taken from ISOL8R_STATS_DIR (default ISOL8R_STATS_DEFAULT_DIR; empty
+ * disables). Every process that runs the binary maps the same page and adds
+ * to it with relaxed atomic increments, so one-shot runs, server handlers
+ * and their forked runners all land in the same totals; there is no lock,
+ * no syscall per update and nothing to flush. Counters only ever grow, and
+ * live outside the bait log, so rotating or wiping the log leaves them be.
+ * src/utils/isol8r_stats.py reads the page.
+ *
+ * Latencies go into log2 buckets per stage: bucket 0 holds 0 ns, bucket b
+ * durations in [2^(b-1), 2^b) ns, and the last bucket everything longer.
+ *
+ * Multi-byte fields are host byte order; the page is not meant to leave the
+ * machine that wrote it. A process that hands control to untrusted code
+ * calls isol8r_stats_detach() first, so a payload cannot scribble on it.
+ */
+
+#ifndef ISOL8R_STATS_H
+#define ISOL8R_STATS_H
+
+#include <stdint.h>
+
+#include "isol8r_stage.h"
+
+/** First eight bytes of every stats page. */
+#define ISOL8R_STATS_MAGIC "I8RSTAT1"
+
+/** Layout version stored in the header. */
+#define ISOL8R_STATS_VERSION 1u
+
+/** Where pages go unless ISOL8R_STATS_DIR says otherwise. */
+#define ISOL8R_STATS_DEFAULT_DIR "/var/run/isol8r"
+
+/** Latency buckets per stage; the last one is open-ended (2^38 ns is ~4.6 minutes). */
+#define ISOL8R_STATS_BUCKETS 40u
+
+/** Keywords or detectors counted individually; hit masks are 32 bits wide. */
+#define ISOL8R_STATS_PATTERNS 32u
+
+/** Bytes of label text kept per pattern (NUL padded, not necessarily terminated). */
+#define ISOL8R_STATS_LABEL_MAX 32u
+
+/** Counter slots; the ones past ISOL8R_STATS_COUNTER_COUNT are reserved. */
+#define ISOL8R_STATS_COUNTER_SLOTS 16u
+
+/** What the counters count. */
+enum isol8r_stats_counter {
+    ISOL8R_STATS_REQUESTS = 0,  /**< Inputs taken in, whatever became of them. */
+    ISOL8R_STATS_BYTES,         /**< Input bytes inspected. */
+    ISOL8R_STATS_FLAGGED,       /**< Inputs on which at least one pattern fired. */
+    ISOL8R_STATS_REJECTED,      /**< Inputs refused unread: empty or oversized. */
+    ISOL8R_STATS_TIMEOUTS,      /**< CPU or wall-clock budgets run out. */
+    ISOL8R_STATS_OUTPUT_CAPPED, /**< Output budgets run out. */
+    ISOL8R_STATS_SIGNALED,      /**< Payloads killed by a signal of their own. */
+    ISOL8R_STATS_ERRORS,        /**< Truncated requests, failed forks and the like. */
+    ISOL8R_STATS_CACHE_HITS,    /**< Inputs whose verdict came from the verdict cache. */
+    ISOL8R_STATS_COUNTER_COUNT
+};
+
+/** One stage's latency distribution. */
+struct isol8r_stats_latency {
+    uint64_t count;                         /**< Samples recorded. */
+    uint64_t total_ns;                      /**< Their sum. */
+    uint64_t buckets[ISOL8R_STATS_BUCKETS]; /**< log2 histogram, see above. */
+};
+
+/** The shared page. */
+struct isol8r_stats_page {
+    char magic[8];                          /**< ISOL8R_STATS_MAGIC, no terminator. */
+    uint32_t version;                       /**< ISOL8R_STATS_VERSION. */
+    uint32_t size;                          /**< sizeof(struct isol8r_stats_page). */
+    uint64_t created_ns;                    /**< CLOCK_REALTIME when the file was created. */
+    uint32_t pattern_count;                 /**< Patterns in force at the last label update. */
+    uint32_t reserved;                      /**< Zero. */
+    char program[24];                       /**< Writer, NUL padded. */
+    uint64_t pad;                           /**< Keeps the counters cache-line aligned. */
+    uint64_t counters[ISOL8R_STATS_COUNTER_SLOTS];         /**< enum isol8r_stats_counter. */
+    uint64_t hits[ISOL8R_STATS_PATTERNS];                  /**< Inputs each pattern fired on. */
+    struct isol8r_stats_latency latency[ISOL8R_STAGE_COUNT]; /**< Per stage. */
+    char labels[ISOL8R_STATS_PATTERNS][ISOL8R_STATS_LABEL_MAX]; /**< Pattern names. */
+};
+
+/**
+ * Maps <ISOL8R_STATS_DIR>/<program>.stats, creating it if new. Failure is
+ * silent and leaves every other call a no-op: statistics never stop a run.
+ *
+ * @param program Writer name, also the file name.
+ */
+void isol8r_stats_init(const char *program);
+
+/** Unmaps the page; later updates are no-ops. */
+void isol8r_stats_detach(void);
+
+/**
+ * Adds to a counter. Async-signal-safe.
+ *
+ * @param counter Which counter.
+ * @param amount  How much.
+ */
+void isol8r_stats_add(enum isol8r_stats_counter counter, uint64_t amount);
+
+/**
+ * Counts one input against every pattern in a hit mask, and the input as
+ * flagged if the mask is not empty.
+ *
+ * @param mask Bit i set for every pattern i that fired.
+ */
+void isol8r_stats_hits(uint32_t mask);
+
+/**
+ * Records one stage duration.
+ *
+ * @param stage Stage measured.
+ * @param ns    Its duration.
+ */
+void isol8r_stats_latency(enum isol8r_stage stage, uint64_t ns);
+
+/**
+ * Names the patterns in force, after startup and after every rules reload.
+ *
+ * @param count Patterns in force; those past ISOL8R_STATS_PATTERNS are not counted.
+ * @param label Returns pattern i's label.
+ */
+void isol8r_stats_labels(uint32_t count, const char *(*label)(uint32_t pattern_id));
+
+#endif /* ISOL8R_STATS_H */
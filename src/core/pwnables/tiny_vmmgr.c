@@ -19,10 +19,24 @@
 #define _POSIX_C_SOURCE 200809L
 #endif
 
+/* MAP_ANONYMOUS is a BSD/Linux extension, not part of strict POSIX. */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+/* cpu_set_t and sched_setaffinity() for pinning payload runners. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sched.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -30,28 +44,111 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "isol8r_budget.h"
+#include "isol8r_cache.h"
+#include "isol8r_encode.h"
+#include "isol8r_log.h"
+#include "isol8r_replay.h"
+#include "isol8r_ring.h"
+#include "isol8r_rules.h"
+#include "isol8r_rules_builtin.h"
+#include "isol8r_scan.h"
+#include "isol8r_stage.h"
+#include "isol8r_stats.h"
+
 /* ---------------------------------------------------------------------------
  *  CONSTANTS AND MACROS
  * ---------------------------------------------------------------------------
  */
 
-/** The maximum number of bytes of shellcode we will accept. */
+/**
+ * Default payload limit: a payload must be smaller than this. The region it
+ * runs from is the limit rounded up to whole pages, so the default is one
+ * page. ISOL8R_VMMGR_MAX_SIZE overrides it at runtime.
+ */
 #define VMMGR_MAX_SHELLCODE_SIZE 4096u
 
-/** If the user supplies a payload smaller than this, we still allocate a full page. */
-#define VMMGR_PAGE_SIZE 4096u
+/** Largest limit ISOL8R_VMMGR_MAX_SIZE may ask for. */
+#define VMMGR_MAX_SHELLCODE_CEILING (64u * 1024u * 1024u)
+
+/** Region alignment when ISOL8R_VMMGR_HUGEPAGES is set (x86-64 PMD size). */
+#define VMMGR_HUGEPAGE_SIZE (2u * 1024u * 1024u)
 
 /** Path to the honeypot log file */
+#ifndef VMMGR_BAIT_LOG_PATH
 #define VMMGR_BAIT_LOG_PATH "/app/logs/bait.log"
+#endif
 
 /** Default shellcode source indicator. */
 #define VMMGR_INPUT_STDIN "-"
 
+/** Flag that switches the harness into fork-server mode. */
+#define VMMGR_SERVER_FLAG "--server"
+
+/** Default wall-clock budget for one payload, in milliseconds. */
+#ifndef VMMGR_PAYLOAD_TIMEOUT_MS
+#define VMMGR_PAYLOAD_TIMEOUT_MS 1000
+#endif
+
+/** Default CPU budget for one payload, in milliseconds. */
+#ifndef VMMGR_PAYLOAD_CPU_MS
+#define VMMGR_PAYLOAD_CPU_MS 250
+#endif
+
+/** Captured stdout/stderr per forked payload; the rest is dropped. */
+#define VMMGR_CAPTURE_MAX (64u * 1024u)
+
+/** Result kinds carried in a server reply. */
+#define VMMGR_RESULT_EXITED 0u
+#define VMMGR_RESULT_SIGNALED 1u
+#define VMMGR_RESULT_TIMEOUT 2u
+#define VMMGR_RESULT_REJECTED 3u
+
+/** Flag that reads a framed batch of payloads from stdin. */
+#define VMMGR_BATCH_FLAG "--batch"
+
+/** Flag that replays a corpus through the detectors and nothing else. */
+#define VMMGR_SCAN_ONLY_FLAG "--scan-only"
+
+/** Upper bound on one formatted telemetry record. */
+#define VMMGR_TELEMETRY_MAX 768u
+
+/** Most payloads accepted in one batch. */
+#define VMMGR_BATCH_MAX 64u
+
+/** Most payloads in flight server-wide, whatever ISOL8R_VMMGR_PARALLEL asks for. */
+#define VMMGR_PARALLEL_MAX 256u
+
+/** Requests one server connection may have queued or running at once. */
+#define VMMGR_CLIENT_QUEUE 64u
+
+/** Unsent reply bytes past which a connection stops taking, running and queueing requests. */
+#define VMMGR_CONN_OUT_HIGH (256u * 1024u)
+
+/** How long a runner waiting for a lease sleeps before looking for dead holders. */
+#define VMMGR_LEASE_POLL_MS 10
+
+/** Longest a runner waits for a lease before answering that the server is busy. */
+#define VMMGR_LEASE_WAIT_MS 30000
+
+/** vmmgr_lease_acquire() result when no lease came free in time. */
+#define VMMGR_LEASE_BUSY (-2)
+
+/** Largest dirty prefix a pooled region is wiped with a fill instead of MADV_DONTNEED. */
+#define VMMGR_POOL_ZERO_MAX (64u * 1024u)
+
 /** Macro to supress unused parameter warnings in certain helper functions. */
 #define VMMGR_UNUSED(x) (void)(x)
 
@@ -71,6 +168,23 @@
 /** Macro to simplify writing banner text. */
 #define VMMGR_BANNER_LINE(msg) puts(msg)
 
+/** Banner lines, also captured verbatim for payloads that never reach a child. */
+#define VMMGR_BANNER_RULE "===================================="
+#define VMMGR_BANNER_TITLE " tiny_vmmgr :: ISOL8R VM Harness"
+#define VMMGR_BANNER_TEXT VMMGR_BANNER_RULE "\n" VMMGR_BANNER_TITLE "\n" VMMGR_BANNER_RULE "\n"
+
+/** Leading payload bytes shown in the bait log's hex dump unless ISOL8R_VMMGR_LOG_PREVIEW says otherwise. */
+#define VMMGR_PREVIEW_BYTES 16u
+
+/** Starts the optional third bait line, ISOL8R_VMMGR_LOG_BASE64=1. */
+#define VMMGR_BASE64_PREFIX "[BAIT] [VMMGR] Payload base64: "
+
+/** Detector id reported when nothing fired. */
+#define VMMGR_NO_DETECTOR UINT32_MAX
+
+/** Longest payload the verdict cache keeps; longer ones are always rescanned. */
+#define VMMGR_CACHE_KEY_MAX (16u * 1024u)
+
 /** Helper macro to calculate length of static arrays. */
 #define VMMGR_ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
 
@@ -80,20 +194,53 @@
  */
 
 struct shellcode_buffer;
+struct vmmgr_verdict;
+struct vmmgr_capture;
+struct vmmgr_telemetry;
+
+/** Body of a forked child; expected to exit rather than return. */
+typedef void (*vmmgr_child_main)(void *ctx);
 
 static void vmmgr_print_banner(void);
 static void vmmgr_print_usage(const char *program_name);
-static FILE *vmmgr_open_input_stream(int argc, char *const argv[]);
-static struct shellcode_buffer vmmgr_read_shellcode(FILE *stream);
-static bool vmmgr_contains_null_byte(const struct shellcode_buffer *buffer);
-static void vmmgr_log_bait_event(const char *pattern, const struct shellcode_buffer *buffer);
-static bool vmmgr_contains_pattern(const struct shellcode_buffer *buffer, const uint8_t *pattern, size_t pattern_len);
-static bool vmmgr_contains_string(const struct shellcode_buffer *buffer, const char *needle);
-static bool vmmgr_inspect_shellcode(const struct shellcode_buffer *buffer);
+static int vmmgr_open_input(int argc, char *const argv[]);
+static struct shellcode_buffer vmmgr_read_shellcode(int fd);
+static void vmmgr_load_limits(void);
+static uint8_t *vmmgr_map_region(void);
+static void vmmgr_release_buffer(struct shellcode_buffer *buffer);
+static void vmmgr_inspect(const struct shellcode_buffer *buffer, struct vmmgr_verdict *verdict);
+static void vmmgr_log_bait_event(const struct vmmgr_verdict *verdict, const struct shellcode_buffer *buffer);
+static bool vmmgr_inspect_shellcode(struct shellcode_buffer *buffer, struct vmmgr_verdict *verdict);
 static void vmmgr_warn_about_nulls(bool contains_nulls);
-static void vmmgr_execute_shellcode(const struct shellcode_buffer *buffer);
-static void vmmgr_handle_bait_detection(const char *pattern, const struct shellcode_buffer *buffer, const char *message);
+static void vmmgr_execute_shellcode(struct shellcode_buffer *buffer, const struct vmmgr_verdict *verdict);
+static void vmmgr_handle_bait_detection(const struct vmmgr_verdict *verdict, struct shellcode_buffer *buffer);
 static void vmmgr_secure_zero(void *ptr, size_t len);
+static int vmmgr_run_payload(int fd);
+static void vmmgr_serve(const char *socket_path);
+static int vmmgr_run_batch(int in_fd, int out_fd);
+static void vmmgr_process_one(uint8_t *data,
+                              size_t length,
+                              struct vmmgr_capture *out,
+                              struct vmmgr_capture *err,
+                              struct vmmgr_verdict *verdict,
+                              struct vmmgr_telemetry *telemetry);
+static int vmmgr_write_result(int fd,
+                              const struct vmmgr_capture *out,
+                              const struct vmmgr_capture *err,
+                              const struct vmmgr_verdict *verdict,
+                              const struct vmmgr_telemetry *telemetry,
+                              bool with_timing,
+                              uint64_t elapsed_us);
+static int vmmgr_write_full(int fd, const void *buffer, size_t len);
+static int vmmgr_fork_capture(vmmgr_child_main child_main,
+                              void *ctx,
+                              const uint8_t *input,
+                              size_t input_len,
+                              struct vmmgr_capture *out,
+                              struct vmmgr_capture *err,
+                              uint32_t *kind,
+                              uint32_t *code,
+                              struct rusage *usage);
 
 /* ---------------------------------------------------------------------------
  *  DATA STRUCTURES
@@ -101,15 +248,172 @@ static void vmmgr_secure_zero(void *ptr, size_t len);
  */
 
 /**
- * A simple heap-backed buffer storing user-supplied shellcode, along with
- * metadata that simplifies logging and analysis.
+ * User-supplied shellcode, held in the page-sized RW mapping it will later
+ * execute from, along with metadata that simplifies logging and analysis.
+ * The bytes land there straight from read(2) or a private file mapping, so
+ * inspection and execution work on the same memory with no copy between.
  */
 struct shellcode_buffer {
-    uint8_t *data;      /**< Pointer to the raw shellcode bytes. */
+    uint8_t *data;      /**< Start of the mapping; the payload begins here. */
     size_t length;      /**< Total number of bytes read. */
+    size_t map_length;  /**< Size of the mapping at data. */
     bool from_stdin;    /**< Whether the payload was sourced from stdin. */
+    bool file_backed;   /**< Private mapping of the input file, not anonymous. */
+};
+
+/**
+ * What one inspection pass found. Drives the bait log, the NUL warning at
+ * execution time and the detector fields of batch and server result frames.
+ */
+struct vmmgr_verdict {
+    uint32_t matches;       /**< Bit i set when vmmgr_detectors[i] fired. */
+    uint32_t detector;      /**< Lowest detector that fired, or VMMGR_NO_DETECTOR. */
+    bool contains_nulls;    /**< Whether a 0x00 byte occurs anywhere. */
+};
+
+/**
+ * Payload limit and region layout, fixed at startup by vmmgr_load_limits():
+ *
+ *   ISOL8R_VMMGR_MAX_SIZE=N[k|m]  payloads must be smaller than N bytes
+ *   ISOL8R_VMMGR_PREFAULT=1       fault the whole region in when mapping it
+ *   ISOL8R_VMMGR_HUGEPAGES=1      2 MiB-aligned region with MADV_HUGEPAGE
+ *
+ * Prefaulting moves the page faults out of the execute stage; huge pages
+ * cut a large region down to a handful of TLB entries.
+ */
+static struct vmmgr_limits {
+    size_t max_payload;     /**< Reads of this many bytes are rejected. */
+    size_t map_length;      /**< Region size: max_payload rounded up. */
+    bool prefault;
+    bool hugepages;
+} vmmgr_limits = {
+    .max_payload = VMMGR_MAX_SHELLCODE_SIZE,
+    .map_length = VMMGR_MAX_SHELLCODE_SIZE,
+    .prefault = false,
+    .hugepages = false,
+};
+
+/**
+ * How much of a payload a bait record carries, fixed at startup by
+ * vmmgr_load_log_options():
+ *
+ *   ISOL8R_VMMGR_LOG_PREVIEW=N|full  leading bytes in the hex dump (default 16)
+ *   ISOL8R_VMMGR_LOG_BASE64=1        add a line with the whole payload in base64
+ */
+static struct vmmgr_log_options {
+    size_t preview_bytes;   /**< SIZE_MAX for the full payload. */
+    bool base64;
+} vmmgr_log_options = {
+    .preview_bytes = VMMGR_PREVIEW_BYTES,
+    .base64 = false,
+};
+
+/**
+ * Built-in banned patterns, used when no rules file supplies a vmmgr scope:
+ * isol8r_builtin_vmmgr_rules, the vmmgr scope of config/isol8r_rules.conf
+ * compiled into isol8r_rules_builtin.h at build time (isol8r_rulegen). An
+ * entry's index doubles as its detector id in event records and result
+ * frames; when several fire, the lowest index is the one acted on and
+ * reported first.
+ */
+_Static_assert(ISOL8R_BUILTIN_VMMGR_COUNT <= ISOL8R_SCAN_MULTI_MAX, "built-in detectors outgrow the scan");
+
+/** Message for a rule that does not carry one. */
+#define VMMGR_DEFAULT_RULE_MESSAGE "[VMMGR] Banned pattern detected. Blocked."
+
+/**
+ * Detectors in force: the built-in table, or the vmmgr scope of the rules
+ * file (ISOL8R_RULES, see isol8r_rules.h). The fork server swaps them on
+ * SIGHUP between connections; the scan patterns are rebuilt with them so
+ * inspection never recomputes them per payload.
+ */
+static struct isol8r_rules vmmgr_rules;
+static const struct isol8r_rule *vmmgr_detectors = isol8r_builtin_vmmgr_rules;
+static size_t vmmgr_detector_count = VMMGR_ARRAY_LEN(isol8r_builtin_vmmgr_rules);
+static struct isol8r_scan_pattern vmmgr_scan_patterns[ISOL8R_SCAN_MULTI_MAX];
+
+/** Set by SIGHUP in server mode; the accept loop reloads the rules and reopens the bait log. */
+static volatile sig_atomic_t vmmgr_reload_requested;
+
+/**
+ * ISOL8R_FAST_START=1, one-shot mode only: nothing between exec and the
+ * first read that the payload does not need. No banner, no stats page, and
+ * the compiled-in detectors instead of the rules file.
+ */
+static bool vmmgr_fast_start;
+
+/**
+ * Output captured from one payload child. With data NULL the bytes are
+ * passed straight through to sink instead of kept; length counts them
+ * either way.
+ */
+struct vmmgr_capture {
+    uint8_t *data;
+    size_t length;
+    int sink;
+};
+
+/**
+ * Per-payload limits, from compiled-in defaults and then
+ *
+ *   ISOL8R_VMMGR_CPU_MS=N          CPU time per payload (default VMMGR_PAYLOAD_CPU_MS)
+ *   ISOL8R_VMMGR_WALL_MS=N         elapsed time per payload (default VMMGR_PAYLOAD_TIMEOUT_MS)
+ *   ISOL8R_VMMGR_OUTPUT_MAX=N[k|m] stdout plus stderr per payload (default unlimited)
+ *
+ * The CPU limit is armed in whichever process jumps to the payload. A child
+ * run by vmmgr_fork_capture() has its clock and output watched by the
+ * parent, which kills it on overrun; a payload run in-process arms its own
+ * wall-clock timer. An overrun ends the payload with the matching
+ * ISOL8R_BUDGET_EXIT_* status.
+ */
+static struct isol8r_budget vmmgr_budget = {
+    .cpu_ms = VMMGR_PAYLOAD_CPU_MS,
+    .wall_ms = VMMGR_PAYLOAD_TIMEOUT_MS,
+    .output_max = 0,
+};
+
+/** Set in a vmmgr_fork_capture() child, whose parent enforces the budget. */
+static bool vmmgr_supervised;
+
+/**
+ * How one payload fared, phase by phase. In one-shot mode the record goes
+ * out as a single JSON line on the descriptor named by
+ * ISOL8R_VMMGR_TELEMETRY_FD; batch and server mode append it to every
+ * result frame. Phase times are CLOCK_MONOTONIC nanoseconds.
+ */
+struct vmmgr_telemetry {
+    uint64_t started_ns;        /**< When the record was opened. */
+    uint64_t read_ns;           /**< Reading the payload (excluding map_ns). */
+    uint64_t inspect_ns;        /**< The inspection pass. */
+    uint64_t map_ns;            /**< Mapping the payload region. */
+    uint64_t mprotect_ns;       /**< Flipping the region to RWX. */
+    uint64_t execute_ns;        /**< Running the payload, child reap included. */
+    bool mprotect_measured;     /**< False when mprotect ran inside the payload child. */
+    size_t bytes;               /**< Payload length. */
+    uint32_t kind;              /**< VMMGR_RESULT_*. */
+    uint32_t code;              /**< Exit status, or signal number when signaled. */
+    uint32_t detector;          /**< Detector acted on, or VMMGR_NO_DETECTOR. */
+    uint32_t matches;           /**< Every detector that fired. */
+    const char *rejected;       /**< Why a payload was refused without a detector firing. */
+    struct rusage self_start;   /**< getrusage(RUSAGE_SELF) when the record was opened. */
+    struct rusage child;        /**< wait4() usage of the payload child, zero if none ran. */
 };
 
+/** Descriptor for one-shot telemetry records, or -1 when disabled. */
+static int vmmgr_telemetry_fd = -1;
+
+/** The one-shot run's record; phases fill it in as they complete. */
+static struct vmmgr_telemetry vmmgr_telemetry;
+
+/** Set once the one-shot record has been counted and, if enabled, written. */
+static bool vmmgr_telemetry_closed;
+
+/** Shared bait log handle; opened on first use and kept for the process. */
+static struct isol8r_log vmmgr_bait_log = ISOL8R_LOG_INIT(VMMGR_BAIT_LOG_PATH);
+
+/** Optional structured event store, enabled through ISOL8R_EVENT_RING. */
+static struct isol8r_ring vmmgr_event_ring = ISOL8R_RING_INIT;
+
 /* ---------------------------------------------------------------------------
  *  UTILITY FUNCTIONS
  * ---------------------------------------------------------------------------
@@ -117,17 +421,14 @@ struct shellcode_buffer {
 
 /**
  * Securely zeroes memory to avoid leaving copies of shellcode around longer
- * than necessary. Implemented with volatile pointer semantics to discourage
- * the compiler from optimising it out.
+ * than necessary. explicit_bzero() runs at memset speed but, unlike a plain
+ * memset before free(), is never optimised away.
  */
 static void vmmgr_secure_zero(void *ptr, size_t len) {
     if (ptr == NULL || len == 0) {
         return;
     }
-    volatile unsigned char *p = (volatile unsigned char *)ptr;
-    while (len--) {
-        *p++ = 0u;
-    }
+    explicit_bzero(ptr, len);
 }
 
 /**
@@ -136,9 +437,9 @@ static void vmmgr_secure_zero(void *ptr, size_t len) {
  * not a carnival ride.
  */
 static void vmmgr_print_banner(void) {
-    VMMGR_BANNER_LINE("====================================");
-    VMMGR_BANNER_LINE(" tiny_vmmgr :: ISOL8R VM Harness");
-    VMMGR_BANNER_LINE("====================================");
+    VMMGR_BANNER_LINE(VMMGR_BANNER_RULE);
+    VMMGR_BANNER_LINE(VMMGR_BANNER_TITLE);
+    VMMGR_BANNER_LINE(VMMGR_BANNER_RULE);
 }
 
 /**
@@ -151,380 +452,2485 @@ static void vmmgr_print_usage(const char *program_name) {
             "Usage: %s [shellcode_file|-]\n"
             "  - If no argument is provided, shellcode is read from stdin.\n"
             "  - Passing '-' explicitly also reads from stdin.\n"
-            "  - Any other single argument is treated as a file path.\n",
-            program_name);
+            "  - Any other single argument is treated as a file path.\n"
+            "Server mode: %s " VMMGR_SERVER_FLAG " SOCKET_PATH\n"
+            "  - Forks a fresh child per framed payload received on SOCKET_PATH; pipelined\n"
+            "    payloads run in parallel and are answered in the order they were sent.\n"
+            "Batch mode:  %s " VMMGR_BATCH_FLAG "\n"
+            "  - Reads a framed list of payloads from stdin, one result frame each.\n"
+            "Scan-only:   %s " VMMGR_SCAN_ONLY_FLAG " CORPUS [BASELINE]\n"
+            "  - Runs only the detectors over a directory of payloads or a line file\n"
+            "    (a bait log replays its base64 lines); prints one verdict per payload,\n"
+            "    throughput and per-detector hits, and diffs against BASELINE, a saved\n"
+            "    earlier verdict output. Exits 1 when verdicts changed. ISOL8R_SCAN_ROUNDS\n"
+            "    repeats the timed pass. Nothing is mapped, executed or logged.\n"
+            "Environment:\n"
+            "  ISOL8R_VMMGR_MAX_SIZE=N[k|m]  payloads must be smaller than N bytes (default %u)\n"
+            "  ISOL8R_VMMGR_PREFAULT=1       prefault the payload region when mapping it\n"
+            "  ISOL8R_VMMGR_HUGEPAGES=1      align the region to 2 MiB and ask for huge pages\n"
+            "  ISOL8R_VMMGR_TELEMETRY_FD=N   one-shot mode: write a JSON telemetry record to fd N\n"
+            "  ISOL8R_VMMGR_CPU_MS=N         CPU budget per payload (default %u, 0 = none)\n"
+            "  ISOL8R_VMMGR_WALL_MS=N        wall-clock budget per payload (default %u, 0 = none)\n"
+            "  ISOL8R_VMMGR_OUTPUT_MAX=N[k|m] output budget per payload (default none)\n"
+            "  ISOL8R_VMMGR_LOG_PREVIEW=N    bait log hex dump of the first N bytes, or 'full' (default %u)\n"
+            "  ISOL8R_VMMGR_LOG_BASE64=1     also log the whole offending payload in base64\n"
+            "  ISOL8R_RULES=PATH             detector rules file (default " ISOL8R_RULES_DEFAULT_PATH ", 'none' for built-ins)\n"
+            "  ISOL8R_RULES_CACHE=PATH       compiled rules cache; the server rereads the rules on SIGHUP\n"
+            "  ISOL8R_LOG_QUEUE=N            server: bait log queue slots (default %u, 0 = write synchronously)\n"
+            "  ISOL8R_LOG_FSYNC_MS=N         server: fdatasync the bait log at most every N ms (default %u, 0 = never)\n"
+            "  ISOL8R_LOG_COALESCE_MS=N      server: log repeats of a detection within N ms as one count (default %u, 0 = off)\n"
+            "  ISOL8R_LOG_ROTATE_BYTES=N[k|m] rotate the bait log at N bytes (default %u, 0 = never); SIGHUP reopens it\n"
+            "  ISOL8R_LOG_ROTATE_KEEP=N      rotated bait log segments kept (default %u)\n"
+            "  ISOL8R_VMMGR_CPUS=LIST        server: CPUs to run payloads on, e.g. 0-3,6 (default all allowed)\n"
+            "  ISOL8R_VMMGR_AFFINITY=POLICY  server: spread (one CPU per payload), set or none (default spread)\n"
+            "  ISOL8R_VMMGR_PARALLEL=N       server: payloads running at once overall (default CPU count, max %u)\n"
+            "  ISOL8R_VMMGR_CLIENT_PARALLEL=N server: payloads running at once per connection (default half that)\n"
+            "  ISOL8R_VERDICT_CACHE=N        server, batch: remember the verdicts of N recent payloads (default %u, 0 = off)\n"
+            "  ISOL8R_STATS_DIR=DIR          live counters in DIR/tiny_vmmgr.stats (default " ISOL8R_STATS_DEFAULT_DIR ", empty = off)\n"
+            "  ISOL8R_FAST_START=1           one-shot: no banner, no stats page, compiled-in detectors only\n"
+            "Exhausted budgets exit with %d (CPU), %d (wall clock) or %d (output).\n",
+            program_name,
+            program_name,
+            program_name,
+            program_name,
+            VMMGR_MAX_SHELLCODE_SIZE,
+            VMMGR_PAYLOAD_CPU_MS,
+            VMMGR_PAYLOAD_TIMEOUT_MS,
+            VMMGR_PREVIEW_BYTES,
+            ISOL8R_LOG_QUEUE_DEFAULT_SLOTS,
+            ISOL8R_LOG_FSYNC_DEFAULT_MS,
+            ISOL8R_LOG_COALESCE_DEFAULT_MS,
+            ISOL8R_LOG_ROTATE_DEFAULT_BYTES,
+            ISOL8R_LOG_ROTATE_DEFAULT_KEEP,
+            VMMGR_PARALLEL_MAX,
+            ISOL8R_CACHE_DEFAULT_ENTRIES,
+            ISOL8R_BUDGET_EXIT_CPU,
+            ISOL8R_BUDGET_EXIT_WALL,
+            ISOL8R_BUDGET_EXIT_OUTPUT);
 }
 
 /**
- * Opens the input stream from which shellcode will be read. Supports stdin
+ * Opens the input from which shellcode will be read. Supports stdin
  * (default) or a file specified by the user. Additional arguments trigger the
- * usage message.
+ * usage message. A plain descriptor, not a FILE: the payload never passes
+ * through stdio, so there is no stream to allocate.
  *
  * @param argc Argument count.
  * @param argv Argument vector.
- * @return A FILE pointer ready for reading shellcode.
+ * @return A descriptor ready for reading shellcode.
  */
-static FILE *vmmgr_open_input_stream(int argc, char *const argv[]) {
+static int vmmgr_open_input(int argc, char *const argv[]) {
     if (argc == 1) {
-        return stdin;
+        return STDIN_FILENO;
     }
 
     if (argc == 2) {
         if (strcmp(argv[1], VMMGR_INPUT_STDIN) == 0) {
-            return stdin;
+            return STDIN_FILENO;
         }
 
-        FILE *file = fopen(argv[1], "rb");
-        if (!file) {
+        const int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
             fprintf(stderr, "[tiny_vmmgr] Failed to open '%s': %s\n", argv[1], strerror(errno));
             exit(VMMGR_EXIT_FAILURE);
         }
-        return file;
+        return fd;
     }
 
     vmmgr_print_usage(argv[0]);
     exit(VMMGR_EXIT_FAILURE);
 }
 
+/* ---------------------------------------------------------------------------
+ *  TELEMETRY
+ * ---------------------------------------------------------------------------
+ */
+
+static uint64_t vmmgr_monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/** Returns the nanoseconds since `*mark` and moves the mark to now. */
+static uint64_t vmmgr_lap_ns(uint64_t *mark) {
+    const uint64_t now = vmmgr_monotonic_ns();
+    const uint64_t elapsed = now - *mark;
+    *mark = now;
+    return elapsed;
+}
+
+/** Opens a fresh record: clock started, usage baseline taken, nothing found yet. */
+static void vmmgr_telemetry_begin(struct vmmgr_telemetry *telemetry) {
+    memset(telemetry, 0, sizeof(*telemetry));
+    telemetry->started_ns = vmmgr_monotonic_ns();
+    telemetry->mprotect_measured = true;
+    telemetry->kind = VMMGR_RESULT_REJECTED;
+    telemetry->code = VMMGR_EXIT_FAILURE;
+    telemetry->detector = VMMGR_NO_DETECTOR;
+    getrusage(RUSAGE_SELF, &telemetry->self_start);
+}
+
+static uint64_t vmmgr_timeval_us(struct timeval tv) {
+    return (uint64_t)tv.tv_sec * 1000000u + (uint64_t)tv.tv_usec;
+}
+
 /**
- * Reads shellcode from the provided stream into a heap-backed buffer. The
- * function enforces a strict size limit and exits gracefully if the payload
- * exceeds expectations.
+ * Formats a record as one newline-terminated JSON object. Resource usage
+ * is this process's since the record was opened plus the payload child's.
  *
- * @param stream Input stream (stdin or file).
- * @return A populated shellcode_buffer structure.
+ * @return Bytes written to `out` (excluding the terminator).
  */
-static struct shellcode_buffer vmmgr_read_shellcode(FILE *stream) {
-    uint8_t *buffer = (uint8_t *)malloc(VMMGR_MAX_SHELLCODE_SIZE);
-    VMMGR_CHECK_ALLOC(buffer);
-
-    size_t total_read = 0u;
-    while (!feof(stream) && total_read < VMMGR_MAX_SHELLCODE_SIZE) {
-        size_t bytes_read = fread(buffer + total_read, 1, VMMGR_MAX_SHELLCODE_SIZE - total_read, stream);
-        total_read += bytes_read;
-        if (bytes_read == 0) {
-            if (ferror(stream)) {
-                perror("[tiny_vmmgr] fread");
-                free(buffer);
-                exit(VMMGR_EXIT_FAILURE);
-            }
-            break;
-        }
+static size_t vmmgr_telemetry_format(const struct vmmgr_telemetry *telemetry, char *out, size_t cap) {
+    static const char *const outcomes[] = { "exited", "signaled", "timeout", "rejected" };
+    struct rusage now;
+    getrusage(RUSAGE_SELF, &now);
+
+    char matches[4 * 32 + 3] = "[";
+    size_t matches_len = 1;
+    for (uint32_t rest = telemetry->matches; rest; rest &= rest - 1u) {
+        matches_len += (size_t)snprintf(matches + matches_len,
+                                        sizeof(matches) - matches_len,
+                                        "%s%d",
+                                        matches_len > 1 ? "," : "",
+                                        __builtin_ctz(rest));
     }
-
-    if (total_read == VMMGR_MAX_SHELLCODE_SIZE && !feof(stream)) {
-        fprintf(stderr, "[tiny_vmmgr] Payload exceeds %u bytes. Please behave.\n", VMMGR_MAX_SHELLCODE_SIZE);
-        free(buffer);
-        exit(VMMGR_EXIT_FAILURE);
+    snprintf(matches + matches_len, sizeof(matches) - matches_len, "]");
+
+    /* Ready-made summary so callers need not rebuild it from the fields. */
+    char error[160] = "null";
+    if (telemetry->kind == VMMGR_RESULT_SIGNALED) {
+        snprintf(error, sizeof(error), "\"tiny_vmmgr payload killed by signal %" PRIu32 " (%s)\"",
+                 telemetry->code, strsignal((int)telemetry->code));
+    } else if (telemetry->kind != VMMGR_RESULT_REJECTED && isol8r_budget_name((int)telemetry->code)) {
+        snprintf(error, sizeof(error), "\"tiny_vmmgr payload exhausted its %s budget\"",
+                 isol8r_budget_name((int)telemetry->code));
+    } else if (telemetry->detector < vmmgr_detector_count) {
+        snprintf(error, sizeof(error), "\"tiny_vmmgr blocked payload: detector '%s' fired\"",
+                 vmmgr_detectors[telemetry->detector].label);
+    } else if (telemetry->rejected) {
+        snprintf(error, sizeof(error), "\"tiny_vmmgr rejected payload: %s\"", telemetry->rejected);
+    } else if (telemetry->code != 0) {
+        snprintf(error, sizeof(error), "\"tiny_vmmgr exited with code %" PRIu32 "\"", telemetry->code);
     }
 
-    struct shellcode_buffer result = {
-        .data = buffer,
-        .length = total_read,
-        .from_stdin = (stream == stdin),
-    };
-
-    if (stream != stdin) {
-        fclose(stream);
+    char detector[16] = "null";
+    if (telemetry->detector != VMMGR_NO_DETECTOR) {
+        snprintf(detector, sizeof(detector), "%" PRIu32, telemetry->detector);
+    }
+    char mprotect_ns[24] = "null";
+    if (telemetry->mprotect_measured) {
+        snprintf(mprotect_ns, sizeof(mprotect_ns), "%" PRIu64, telemetry->mprotect_ns);
     }
 
-    return result;
+    const bool signaled = telemetry->kind == VMMGR_RESULT_SIGNALED;
+    char exit_code[16] = "null";
+    char signal_number[16] = "null";
+    snprintf(signaled ? signal_number : exit_code, sizeof(exit_code), "%" PRIu32, telemetry->code);
+
+    const uint64_t utime = vmmgr_timeval_us(now.ru_utime) - vmmgr_timeval_us(telemetry->self_start.ru_utime) +
+                           vmmgr_timeval_us(telemetry->child.ru_utime);
+    const uint64_t stime = vmmgr_timeval_us(now.ru_stime) - vmmgr_timeval_us(telemetry->self_start.ru_stime) +
+                           vmmgr_timeval_us(telemetry->child.ru_stime);
+    const long minflt = now.ru_minflt - telemetry->self_start.ru_minflt + telemetry->child.ru_minflt;
+    const long majflt = now.ru_majflt - telemetry->self_start.ru_majflt + telemetry->child.ru_majflt;
+    const long maxrss = now.ru_maxrss > telemetry->child.ru_maxrss ? now.ru_maxrss : telemetry->child.ru_maxrss;
+
+    int written = snprintf(out,
+                           cap,
+                           "{\"program\":\"tiny_vmmgr\",\"bytes\":%zu,\"outcome\":\"%s\","
+                           "\"exit_code\":%s,\"signal\":%s,\"detector\":%s,\"matches\":%s,\"error\":%s,"
+                           "\"read_ns\":%" PRIu64 ",\"inspect_ns\":%" PRIu64 ",\"map_ns\":%" PRIu64 ","
+                           "\"mprotect_ns\":%s,\"execute_ns\":%" PRIu64 ",\"wall_ns\":%" PRIu64 ","
+                           "\"utime_us\":%" PRIu64 ",\"stime_us\":%" PRIu64 ","
+                           "\"minflt\":%ld,\"majflt\":%ld,\"maxrss_kb\":%ld}\n",
+                           telemetry->bytes,
+                           outcomes[telemetry->kind < VMMGR_ARRAY_LEN(outcomes) ? telemetry->kind : VMMGR_RESULT_REJECTED],
+                           exit_code,
+                           signal_number,
+                           detector,
+                           matches,
+                           error,
+                           telemetry->read_ns,
+                           telemetry->inspect_ns,
+                           telemetry->map_ns,
+                           mprotect_ns,
+                           telemetry->execute_ns,
+                           vmmgr_monotonic_ns() - telemetry->started_ns,
+                           utime,
+                           stime,
+                           minflt,
+                           majflt,
+                           maxrss);
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < cap ? (size_t)written : cap - 1;
 }
 
 /**
- * Checks whether the supplied shellcode contains a null byte. This often hints
- * at string-based payload tooling mishaps, so the harness merely warns.
+ * Adds a closed record to the shared stats page (isol8r_stats.h). Payloads
+ * refused unread count as rejected; inspected ones add their bytes, hits
+ * and phase times; payloads that ran add their outcome. A budget that ran
+ * out inside a payload child is counted here, from its exit status, since
+ * the child itself no longer has the page mapped.
  *
- * @param buffer Pointer to the shellcode buffer.
- * @return True if a null byte is present, false otherwise.
+ * @param telemetry Record to count.
  */
-static bool vmmgr_contains_null_byte(const struct shellcode_buffer *buffer) {
-    if (!buffer || !buffer->data) {
-        return false;
+static void vmmgr_stats_record(const struct vmmgr_telemetry *telemetry) {
+    isol8r_stats_add(ISOL8R_STATS_REQUESTS, 1);
+    if (telemetry->rejected) {
+        isol8r_stats_add(ISOL8R_STATS_REJECTED, 1);
+        return;
     }
-    for (size_t i = 0; i < buffer->length; ++i) {
-        if (buffer->data[i] == 0x00u) {
-            return true;
-        }
+    isol8r_stats_add(ISOL8R_STATS_BYTES, telemetry->bytes);
+    isol8r_stats_hits(telemetry->matches);
+    isol8r_stats_latency(ISOL8R_STAGE_READ, telemetry->read_ns);
+    isol8r_stats_latency(ISOL8R_STAGE_INSPECT, telemetry->inspect_ns);
+    if (telemetry->detector != VMMGR_NO_DETECTOR || telemetry->kind == VMMGR_RESULT_REJECTED) {
+        return;
+    }
+
+    isol8r_stats_latency(ISOL8R_STAGE_EXECUTE, telemetry->execute_ns);
+    if (telemetry->kind == VMMGR_RESULT_TIMEOUT ||
+        (telemetry->kind == VMMGR_RESULT_EXITED &&
+         (telemetry->code == ISOL8R_BUDGET_EXIT_CPU || telemetry->code == ISOL8R_BUDGET_EXIT_WALL))) {
+        isol8r_stats_add(ISOL8R_STATS_TIMEOUTS, 1);
+    } else if (telemetry->kind == VMMGR_RESULT_EXITED && telemetry->code == ISOL8R_BUDGET_EXIT_OUTPUT) {
+        isol8r_stats_add(ISOL8R_STATS_OUTPUT_CAPPED, 1);
+    } else if (telemetry->kind == VMMGR_RESULT_SIGNALED) {
+        isol8r_stats_add(ISOL8R_STATS_SIGNALED, 1);
     }
-    return false;
 }
 
 /**
- * Appends a formatted entry to the bait log, tagging the security team and
- * leaving breadcrumbs for post-incident forensics. The message includes the
- * detected pattern and the timestamp in UTC.
+ * Closes the one-shot record, counts it and writes it to the telemetry
+ * descriptor when there is one. Later calls are no-ops, so every exit path
+ * can call it unconditionally.
  *
- * @param pattern Detected suspicious pattern.
- * @param buffer  Pointer to the offending payload (for length reporting).
+ * @param kind VMMGR_RESULT_* outcome.
+ * @param code Exit status, or signal number for VMMGR_RESULT_SIGNALED.
  */
-static void vmmgr_log_bait_event(const char *pattern, const struct shellcode_buffer *buffer) {
-    FILE *log = fopen(VMMGR_BAIT_LOG_PATH, "a");
-    if (!log) {
-        fprintf(stderr, "[tiny_vmmgr] Warning: unable to open bait log at '%s': %s\n", VMMGR_BAIT_LOG_PATH, strerror(errno));
+static void vmmgr_telemetry_emit(uint32_t kind, uint32_t code) {
+    if (vmmgr_telemetry_closed) {
+        return;
+    }
+    vmmgr_telemetry_closed = true;
+    vmmgr_telemetry.kind = kind;
+    vmmgr_telemetry.code = code;
+    vmmgr_stats_record(&vmmgr_telemetry);
+    if (vmmgr_telemetry_fd < 0) {
         return;
     }
 
-    time_t now = time(NULL);
-    struct tm tm_snapshot;
-    gmtime_r(&now, &tm_snapshot);
+    char line[VMMGR_TELEMETRY_MAX];
+    const size_t length = vmmgr_telemetry_format(&vmmgr_telemetry, line, sizeof(line));
+    vmmgr_write_full(vmmgr_telemetry_fd, line, length);
+    close(vmmgr_telemetry_fd);
+    vmmgr_telemetry_fd = -1;
+}
 
-    char timestamp[64];
-    if (strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_snapshot) == 0) {
-        strncpy(timestamp, "1970-01-01 00:00:00", sizeof(timestamp));
-        timestamp[sizeof(timestamp) - 1] = '\0';
+/**
+ * Enables one-shot telemetry when ISOL8R_VMMGR_TELEMETRY_FD names an open
+ * descriptor. main() opens the record first, so read_ns includes waiting
+ * for input.
+ */
+static void vmmgr_telemetry_from_env(void) {
+    const char *value = getenv("ISOL8R_VMMGR_TELEMETRY_FD");
+    if (!value || !*value) {
+        return;
     }
-
-    size_t payload_length = buffer && buffer->data ? buffer->length : 0u;
-    size_t preview_len = payload_length < 16 ? payload_length : 16;
-
-    char hex_preview[3 * 16 + 5];
-    hex_preview[0] = '\0';
-    if (preview_len > 0 && buffer && buffer->data) {
-        size_t offset = 0;
-        for (size_t i = 0; i < preview_len && offset + 3 < sizeof(hex_preview); ++i) {
-            int written = snprintf(hex_preview + offset,
-                                   sizeof(hex_preview) - offset,
-                                   "%02x%s",
-                                   buffer->data[i],
-                                   (i + 1 < preview_len) ? " " : "");
-            if (written <= 0) {
-                hex_preview[0] = '\0';
-                break;
-            }
-            offset += (size_t)written;
-        }
-        if (payload_length > preview_len && offset + 4 < sizeof(hex_preview)) {
-            snprintf(hex_preview + offset, sizeof(hex_preview) - offset, " ...");
-        }
+    char *end = NULL;
+    long fd = strtol(value, &end, 10);
+    if (!end || *end != '\0' || fd < 0 || fd > INT32_MAX || fcntl((int)fd, F_GETFD) < 0) {
+        fprintf(stderr, "[tiny_vmmgr] Warning: ISOL8R_VMMGR_TELEMETRY_FD=%s is not an open descriptor.\n", value);
+        return;
     }
+    fcntl((int)fd, F_SETFD, FD_CLOEXEC);
+    vmmgr_telemetry_fd = (int)fd;
+}
 
-    const char *hex_dump = (hex_preview[0] != '\0') ? hex_preview : "(empty)";
+/* ---------------------------------------------------------------------------
+ *  PAYLOAD REGIONS
+ * ---------------------------------------------------------------------------
+ */
 
-    fprintf(log,
-            "[BAIT] [VMMGR] Pattern '%s' detected in payload (length=%zu) at %s\n",
-            pattern ? pattern : "unknown",
-            payload_length,
-            timestamp);
-    fprintf(log,
-            "[BAIT] [VMMGR] Payload hex dump: %s at %s\n",
-            hex_dump,
-            timestamp);
-    fclose(log);
+static bool vmmgr_env_flag(const char *name) {
+    const char *value = getenv(name);
+    return value && *value && strcmp(value, "0") != 0;
 }
 
 /**
- * Searches the shellcode buffer for a raw byte pattern.
- *
- * @param buffer      Shellcode buffer.
- * @param pattern     Byte sequence to find.
- * @param pattern_len Length of the pattern.
- * @return True if the pattern is found.
+ * Reads the payload limit and region options from the environment. A bad
+ * ISOL8R_VMMGR_MAX_SIZE is reported and the default kept.
  */
-static bool vmmgr_contains_pattern(const struct shellcode_buffer *buffer, const uint8_t *pattern, size_t pattern_len) {
-    if (!buffer || !buffer->data || pattern_len == 0) {
-        return false;
+static void vmmgr_load_limits(void) {
+    const char *value = getenv("ISOL8R_VMMGR_MAX_SIZE");
+    if (value && *value) {
+        char *end = NULL;
+        errno = 0;
+        unsigned long long parsed = strtoull(value, &end, 10);
+        unsigned long long scale = 1;
+        if (end && (*end == 'k' || *end == 'K')) {
+            scale = 1024u;
+            ++end;
+        } else if (end && (*end == 'm' || *end == 'M')) {
+            scale = 1024u * 1024u;
+            ++end;
+        }
+        if (errno != 0 || end == value || *end != '\0' || parsed > VMMGR_MAX_SHELLCODE_CEILING ||
+            parsed * scale < 2 || parsed * scale > VMMGR_MAX_SHELLCODE_CEILING) {
+            fprintf(stderr,
+                    "[tiny_vmmgr] Ignoring ISOL8R_VMMGR_MAX_SIZE=%s (want 2..%u bytes, optional k/m suffix).\n",
+                    value,
+                    VMMGR_MAX_SHELLCODE_CEILING);
+        } else {
+            vmmgr_limits.max_payload = (size_t)(parsed * scale);
+        }
     }
 
-    for (size_t i = 0; i + pattern_len <= buffer->length; ++i) {
-        if (memcmp(buffer->data + i, pattern, pattern_len) == 0) {
-            return true;
+    vmmgr_limits.prefault = vmmgr_env_flag("ISOL8R_VMMGR_PREFAULT");
+    vmmgr_limits.hugepages = vmmgr_env_flag("ISOL8R_VMMGR_HUGEPAGES");
+
+    const size_t align = vmmgr_limits.hugepages ? VMMGR_HUGEPAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+    vmmgr_limits.map_length = (vmmgr_limits.max_payload + align - 1) / align * align;
+}
+
+/** Reads the bait record options; a bad ISOL8R_VMMGR_LOG_PREVIEW keeps the default. */
+static void vmmgr_load_log_options(void) {
+    const char *value = getenv("ISOL8R_VMMGR_LOG_PREVIEW");
+    if (value && *value) {
+        char *end = NULL;
+        errno = 0;
+        unsigned long long parsed = strtoull(value, &end, 10);
+        if (strcmp(value, "full") == 0) {
+            vmmgr_log_options.preview_bytes = SIZE_MAX;
+        } else if (errno != 0 || end == value || *end != '\0' || parsed > VMMGR_MAX_SHELLCODE_CEILING) {
+            fprintf(stderr,
+                    "[tiny_vmmgr] Ignoring ISOL8R_VMMGR_LOG_PREVIEW=%s (want 0..%u bytes or 'full').\n",
+                    value,
+                    VMMGR_MAX_SHELLCODE_CEILING);
+        } else {
+            vmmgr_log_options.preview_bytes = (size_t)parsed;
         }
     }
-    return false;
+    vmmgr_log_options.base64 = vmmgr_env_flag("ISOL8R_VMMGR_LOG_BASE64");
 }
 
 /**
- * Searches the shellcode buffer for a string (case-sensitive).
- *
- * @param buffer Shellcode buffer.
- * @param needle Null-terminated string to search for.
- * @return True if the string appears within the payload.
+ * Faults every page of a region in for writing, so that neither the read
+ * nor the payload itself takes a demand-paging fault later.
  */
-static bool vmmgr_contains_string(const struct shellcode_buffer *buffer, const char *needle) {
-    if (!buffer || !buffer->data || !needle) {
-        return false;
+static void vmmgr_prefault(uint8_t *region, size_t length) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(region, length, MADV_POPULATE_WRITE) == 0) {
+        return;
     }
-
-    const size_t needle_len = strlen(needle);
-    if (needle_len == 0) {
-        return false;
+#endif
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t offset = 0; offset < length; offset += page_size) {
+        ((volatile uint8_t *)region)[offset] = 0u;
     }
-
-    return vmmgr_contains_pattern(buffer, (const uint8_t *)needle, needle_len);
 }
 
 /**
- * Handles bait detection events: logs the attempt, prints a sarcastic quip,
- * and terminates the program.
+ * Maps a fresh anonymous RW region of vmmgr_limits.map_length bytes for a
+ * payload to be read into and run from, prefaulted and huge-page aligned
+ * as configured. The time taken is charged to the one-shot record.
  *
- * @param pattern Human-readable description of the detected pattern.
- * @param buffer  The offending payload.
- * @param message Sarcastic message to display to the user.
+ * @return The mapping; exits on failure.
  */
-static void vmmgr_handle_bait_detection(const char *pattern, const struct shellcode_buffer *buffer, const char *message) {
-    vmmgr_log_bait_event(pattern, buffer);
-    if (message && *message) {
-        fprintf(stderr, "%s\n", message);
+static uint8_t *vmmgr_map_region(void) {
+    const size_t length = vmmgr_limits.map_length;
+    uint64_t mark = vmmgr_monotonic_ns();
+
+    if (vmmgr_limits.hugepages) {
+        /* Over-allocate, then trim to a huge-page boundary on both sides. */
+        uint8_t *raw = mmap(NULL, length + VMMGR_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            perror("[tiny_vmmgr] mmap");
+            exit(VMMGR_EXIT_FAILURE);
+        }
+        const uintptr_t aligned = ((uintptr_t)raw + VMMGR_HUGEPAGE_SIZE - 1) & ~(uintptr_t)(VMMGR_HUGEPAGE_SIZE - 1);
+        uint8_t *region = (uint8_t *)aligned;
+        const size_t head = (size_t)(region - raw);
+        if (head > 0) {
+            munmap(raw, head);
+        }
+        munmap(region + length, VMMGR_HUGEPAGE_SIZE - head);
+        madvise(region, length, MADV_HUGEPAGE);
+        if (vmmgr_limits.prefault) {
+            vmmgr_prefault(region, length);
+        }
+        vmmgr_telemetry.map_ns += vmmgr_lap_ns(&mark);
+        return region;
     }
 
-    if (buffer && buffer->data) {
-        vmmgr_secure_zero(buffer->data, buffer->length);
-        free(buffer->data);
+    void *region = mmap(NULL,
+                        length,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | (vmmgr_limits.prefault ? MAP_POPULATE : 0),
+                        -1,
+                        0);
+    if (region == MAP_FAILED) {
+        perror("[tiny_vmmgr] mmap");
+        exit(VMMGR_EXIT_FAILURE);
     }
-    exit(VMMGR_EXIT_FAILURE);
+    vmmgr_telemetry.map_ns += vmmgr_lap_ns(&mark);
+    return region;
 }
 
 /**
- * Inspects the shellcode for banned patterns. Returns true if the payload is
- * deemed safe, false otherwise. The function handles logging when necessary.
- *
- * @param buffer Shellcode buffer.
- * @return True if no banned patterns were found.
+ * Unmaps a payload buffer. The pages go straight back to the kernel, which
+ * hands out zeroed ones, so there is no copy left behind to scrub.
  */
-static bool vmmgr_inspect_shellcode(const struct shellcode_buffer *buffer) {
-    if (!buffer || !buffer->data) {
-        return false;
+static void vmmgr_release_buffer(struct shellcode_buffer *buffer) {
+    if (buffer && buffer->data) {
+        munmap(buffer->data, buffer->map_length);
+        buffer->data = NULL;
+        buffer->length = 0;
     }
+}
 
-    static const struct {
-        const char *description;
-        const char *message;
-        const uint8_t pattern[8];
-        size_t length;
-        bool is_string;
-    } detectors[] = {
-        {
-            .description = "/bin/sh",
-            .message = "[VMMGR] A classic. Predictable. Blocked.",
-            .pattern = "/bin/sh",
-            .length = 7,
-            .is_string = true,
-        },
-        {
-            .description = "execve",
-            .message = "[VMMGR] execve? How original. Try again.",
-            .pattern = "execve",
-            .length = 6,
-            .is_string = true,
-        },
-        {
-            .description = "syscall (0x0f 0x05)",
-            .message = "[VMMGR] Forbidden fruits are the juiciest. But no.",
-            .pattern = {0x0f, 0x05},
-            .length = 2,
-            .is_string = false,
-        },
-        {
-            .description = "syscall",
-            .message = "[VMMGR] 'syscall' spelled out? Subtlety is a virtue.",
-            .pattern = "syscall",
-            .length = 7,
-            .is_string = true,
-        },
-        {
-            .description = "flag",
-            .message = "[VMMGR] The flag is in another castle. Blocked.",
-            .pattern = "flag",
-            .length = 4,
-            .is_string = true,
-        },
-    };
-
-    for (size_t i = 0; i < VMMGR_ARRAY_LEN(detectors); ++i) {
-        bool hit = false;
-        if (detectors[i].is_string) {
-            hit = vmmgr_contains_string(buffer, (const char *)detectors[i].pattern);
-        } else {
-            hit = vmmgr_contains_pattern(buffer, detectors[i].pattern, detectors[i].length);
-        }
+/**
+ * Prefaulted payload regions a batch process or connection handler keeps
+ * for the whole session. Payloads never run in the process that owns the
+ * pool: each executes in a forked child that flips its own copy-on-write
+ * view to RWX, so the pooled mapping stays RW and its contents are only
+ * ever what this process wrote. Handing a region back resets it and it
+ * goes out again as is, with no mmap, munmap or first-touch faults on the
+ * way to the next payload.
+ */
+struct vmmgr_region_pool {
+    uint8_t *idle[VMMGR_CLIENT_QUEUE];  /**< Reset regions ready to hand out. */
+    unsigned idle_count;
+    unsigned mapped;                    /**< Regions mapped so far, idle or not. */
+    unsigned limit;                     /**< Most regions to map, at most VMMGR_CLIENT_QUEUE. */
+};
 
-        if (hit) {
-            vmmgr_handle_bait_detection(detectors[i].description, buffer, detectors[i].message);
-            return false;
-        }
+/**
+ * Hands out a clean region, mapping and prefaulting a new one while under
+ * the pool's limit.
+ *
+ * @return A region of vmmgr_limits.map_length bytes, or NULL when all are
+ *         taken; exits if a new mapping fails, like vmmgr_map_region().
+ */
+static uint8_t *vmmgr_pool_take(struct vmmgr_region_pool *pool) {
+    if (pool->idle_count > 0) {
+        return pool->idle[--pool->idle_count];
     }
-
-    return true;
+    if (pool->mapped >= pool->limit) {
+        return NULL;
+    }
+    uint8_t *region = vmmgr_map_region();
+    if (!vmmgr_limits.prefault) {
+        vmmgr_prefault(region, vmmgr_limits.map_length);
+    }
+    ++pool->mapped;
+    return region;
 }
 
 /**
- * Emits a gentle warning if the payload contains null bytes. These often foil
- * string-based loaders, and the harness prefers to alert the operator rather
- * than enforce a restriction.
+ * Resets a region and returns it to the pool. Only the bytes a payload
+ * occupied can differ from zero, so small payloads are wiped in place;
+ * past VMMGR_POOL_ZERO_MAX the pages are dropped and faulted back in now,
+ * which is cheaper than the fill and still off the next payload's path.
  *
- * @param contains_nulls Whether the original payload included a null byte.
+ * @param region Region from vmmgr_pool_take().
+ * @param dirty  Bytes written since it was taken.
  */
-static void vmmgr_warn_about_nulls(bool contains_nulls) {
-    if (contains_nulls) {
-        fprintf(stderr, "[tiny_vmmgr] Caution: payload contains null bytes. Hope your loader likes NULs.\n");
+static void vmmgr_pool_give(struct vmmgr_region_pool *pool, uint8_t *region, size_t dirty) {
+    if (dirty > VMMGR_POOL_ZERO_MAX && madvise(region, vmmgr_limits.map_length, MADV_DONTNEED) == 0) {
+        vmmgr_prefault(region, vmmgr_limits.map_length);
+    } else {
+        vmmgr_secure_zero(region, dirty);
     }
+    pool->idle[pool->idle_count++] = region;
 }
 
 /**
- * Executes the validated shellcode by allocating RWX memory, copying the
- * payload, and performing a function pointer jump. Relies on MAP_ANONYMOUS
- * allocations and ensures the pointer is properly aligned.
+ * Maps a regular input file privately over the start of a fresh region
+ * when it fits the size limit; the rest of the region stays anonymous.
+ * Every file page is dirtied once so it becomes this process's own copy:
+ * later writes to the file cannot change what was inspected. Huge-page
+ * regions are always filled with read(2) instead.
  *
- * @param buffer Shellcode buffer.
+ * @return 1 if mapped, 0 if the caller should read(2) instead.
  */
-static void vmmgr_execute_shellcode(const struct shellcode_buffer *buffer) {
-    if (!buffer || !buffer->data || buffer->length == 0) {
-        fprintf(stderr, "[tiny_vmmgr] No shellcode to execute. Perhaps try writing some first.\n");
+static int vmmgr_map_input_file(int fd, struct shellcode_buffer *buffer) {
+    struct stat st;
+    if (vmmgr_limits.hugepages || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return 0;
+    }
+    if ((uint64_t)st.st_size >= vmmgr_limits.max_payload) {
+        fprintf(stderr, "[tiny_vmmgr] Payload exceeds %zu bytes. Please behave.\n", vmmgr_limits.max_payload);
+        vmmgr_telemetry.rejected = "payload too large";
+        vmmgr_telemetry.bytes = (size_t)st.st_size;
+        vmmgr_telemetry_emit(VMMGR_RESULT_REJECTED, VMMGR_EXIT_FAILURE);
         exit(VMMGR_EXIT_FAILURE);
     }
 
-    const bool contains_nulls = vmmgr_contains_null_byte(buffer);
-
-    void *region = mmap(NULL,
-                        VMMGR_PAGE_SIZE,
-                        PROT_READ | PROT_WRITE,
-                        MAP_PRIVATE | MAP_ANONYMOUS,
-                        -1,
-                        0);
-    if (region == MAP_FAILED) {
-        perror("[tiny_vmmgr] mmap");
-        exit(VMMGR_EXIT_FAILURE);
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t file_length = ((size_t)st.st_size + page_size - 1) / page_size * page_size;
+    uint8_t *region = vmmgr_map_region();
+    if (mmap(region,
+             file_length,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED | (vmmgr_limits.prefault ? MAP_POPULATE : 0),
+             fd,
+             0) == MAP_FAILED) {
+        munmap(region, vmmgr_limits.map_length);
+        return 0;
+    }
+    volatile uint8_t *page = region;
+    for (size_t offset = 0; offset < file_length; offset += page_size) {
+        page[offset] = page[offset];
     }
 
-    memcpy(region, buffer->data, buffer->length);
-    vmmgr_secure_zero(buffer->data, buffer->length);
-    free(buffer->data);
+    buffer->data = region;
+    buffer->length = (size_t)st.st_size;
+    buffer->file_backed = true;
+    return 1;
+}
 
-    if (mprotect(region, VMMGR_PAGE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
-        perror("[tiny_vmmgr] mprotect");
-        munmap(region, VMMGR_PAGE_SIZE);
-        exit(VMMGR_EXIT_FAILURE);
-    }
+/**
+ * Reads shellcode from the provided descriptor directly into its execution
+ * mapping: a private mapping of the file when one was named, otherwise
+ * read(2) into an anonymous page. No stdio buffering, heap copy or second
+ * pass is involved. The function enforces a strict size limit and exits
+ * gracefully if the payload exceeds expectations.
+ *
+ * @param fd Input descriptor (stdin or a file), closed unless it is stdin.
+ * @return A populated shellcode_buffer structure.
+ */
+static struct shellcode_buffer vmmgr_read_shellcode(int fd) {
+    struct shellcode_buffer result = {
+        .data = NULL,
+        .length = 0,
+        .map_length = vmmgr_limits.map_length,
+        .from_stdin = (fd == STDIN_FILENO),
+        .file_backed = false,
+    };
 
-    vmmgr_warn_about_nulls(contains_nulls);
+    if (fd == STDIN_FILENO || !vmmgr_map_input_file(fd, &result)) {
+        result.data = vmmgr_map_region();
+
+        /* A read that fills the whole buffer counts as too much. */
+        while (result.length < vmmgr_limits.max_payload) {
+            ssize_t got = read(fd, result.data + result.length, vmmgr_limits.max_payload - result.length);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("[tiny_vmmgr] read");
+                exit(VMMGR_EXIT_FAILURE);
+            }
+            if (got == 0) {
+                break;
+            }
+            result.length += (size_t)got;
+        }
+        if (result.length == vmmgr_limits.max_payload) {
+            fprintf(stderr, "[tiny_vmmgr] Payload exceeds %zu bytes. Please behave.\n", vmmgr_limits.max_payload);
+            vmmgr_telemetry.rejected = "payload too large";
+            vmmgr_telemetry.bytes = result.length;
+            vmmgr_telemetry_emit(VMMGR_RESULT_REJECTED, VMMGR_EXIT_FAILURE);
+            exit(VMMGR_EXIT_FAILURE);
+        }
+    }
 
-    void (*shellcode_entry)(void) = (void (*)(void))region;
-    shellcode_entry();
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
 
-    munmap(region, VMMGR_PAGE_SIZE);
+    return result;
 }
 
-/* ---------------------------------------------------------------------------
- *  MAIN ENTRY POINT
- * ---------------------------------------------------------------------------
+/**
+ * Verdicts of recently seen payloads, server and batch mode only. The
+ * server opens it shared before forking, so every connection and runner
+ * sees the same entries; vmmgr_rules_version keys them to the detectors
+ * that produced them.
  */
+static struct isol8r_cache vmmgr_verdict_cache = ISOL8R_CACHE_INIT;
+static uint64_t vmmgr_rules_version;
 
-int main(int argc, char *argv[]) {
-    vmmgr_print_banner();
-    FILE *input = vmmgr_open_input_stream(argc, argv);
-    struct shellcode_buffer buffer = vmmgr_read_shellcode(input);
+/** Opens the verdict cache for the serving modes; shared when children will use it. */
+static void vmmgr_cache_open(bool shared) {
+    const size_t key_max = vmmgr_limits.max_payload < VMMGR_CACHE_KEY_MAX ? vmmgr_limits.max_payload : VMMGR_CACHE_KEY_MAX;
+    isol8r_cache_from_env(&vmmgr_verdict_cache, "tiny_vmmgr", key_max, shared);
+}
 
-    if (buffer.length == 0) {
-        fprintf(stderr, "[tiny_vmmgr] Empty payload provided. Even no-ops deserve a byte.\n");
-        free(buffer.data);
-        return VMMGR_EXIT_FAILURE;
+static const char *vmmgr_detector_label(uint32_t detector) {
+    return vmmgr_detectors[detector].label;
+}
+
+/**
+ * Makes the vmmgr scope of `vmmgr_rules` the detector set, or the built-in
+ * table when the scope is empty, and rebuilds the scan patterns to match.
+ */
+static void vmmgr_use_detectors(void) {
+    const struct isol8r_rule_set *set = &vmmgr_rules.scopes[ISOL8R_RULES_VMMGR];
+
+    vmmgr_detectors = set->count > 0 ? set->rules : isol8r_builtin_vmmgr_rules;
+    vmmgr_detector_count = set->count > 0 ? set->count : VMMGR_ARRAY_LEN(isol8r_builtin_vmmgr_rules);
+    for (size_t i = 0; i < vmmgr_detector_count; ++i) {
+        vmmgr_scan_patterns[i].bytes = vmmgr_detectors[i].bytes;
+        vmmgr_scan_patterns[i].length = vmmgr_detectors[i].length;
+        /* The vectorised scan compares bytes exactly; say so rather than miss quietly. */
+        if (vmmgr_detectors[i].flags & ISOL8R_MATCH_NOCASE) {
+            fprintf(stderr, "[tiny_vmmgr] Rule '%s' asks for case-insensitive matching; matching it exactly.\n",
+                    vmmgr_detectors[i].label);
+        }
     }
+    isol8r_stats_labels((uint32_t)vmmgr_detector_count, vmmgr_detector_label);
 
-    if (!vmmgr_inspect_shellcode(&buffer)) {
-        return VMMGR_EXIT_FAILURE;
+    vmmgr_rules_version = isol8r_cache_hash(&vmmgr_detector_count, sizeof(vmmgr_detector_count), 0);
+    for (size_t i = 0; i < vmmgr_detector_count; ++i) {
+        vmmgr_rules_version = isol8r_cache_hash(vmmgr_scan_patterns[i].bytes, vmmgr_scan_patterns[i].length,
+                                                vmmgr_rules_version);
+    }
+}
+
+/**
+ * Loads the rules file at startup, or again after SIGHUP. A file that fails
+ * to load leaves the detectors as they were, built-in ones at startup.
+ *
+ * @param reload False at startup, true when replacing rules already in force.
+ */
+static void vmmgr_load_rules(bool reload) {
+    const int rc = reload ? isol8r_rules_reload(&vmmgr_rules, "tiny_vmmgr")
+                          : isol8r_rules_from_env(&vmmgr_rules, "tiny_vmmgr");
+    vmmgr_use_detectors();
+    if (reload) {
+        fprintf(stderr, "[tiny_vmmgr] Rules %s: %zu detectors in force%s.\n",
+                rc < 0 ? "reload failed" : "reloaded",
+                vmmgr_detector_count,
+                vmmgr_detectors == isol8r_builtin_vmmgr_rules ? " (built-in)" : "");
     }
+}
 
-    vmmgr_execute_shellcode(&buffer);
-    return VMMGR_EXIT_SUCCESS;
+static void vmmgr_request_reload(int signo) {
+    VMMGR_UNUSED(signo);
+    vmmgr_reload_requested = 1;
+}
+
+/** Caller-facing message for a detector, with a generic one for bare rules. */
+static const char *vmmgr_detector_message(uint32_t detector) {
+    const char *message = detector < vmmgr_detector_count ? vmmgr_detectors[detector].message : NULL;
+    return message && *message ? message : VMMGR_DEFAULT_RULE_MESSAGE;
+}
+
+/**
+ * Inspects a payload in one pass: every detector that fires and whether a
+ * NUL is present. Nothing else needs to walk the payload before it is
+ * copied out for execution; the bait log encodes its own preview, and
+ * only when a detector fired.
+ *
+ * @param buffer  Shellcode buffer.
+ * @param verdict Receives the findings.
+ */
+static void vmmgr_inspect(const struct shellcode_buffer *buffer, struct vmmgr_verdict *verdict) {
+    int contains_nulls = 0;
+
+    memset(verdict, 0, sizeof(*verdict));
+    verdict->detector = VMMGR_NO_DETECTOR;
+    if (!buffer || !buffer->data || buffer->length == 0) {
+        return;
+    }
+
+    /* A repeat submission, byte for byte under the same detectors, is not scanned again. */
+    struct isol8r_cache_verdict cached;
+    if (isol8r_cache_lookup(&vmmgr_verdict_cache, vmmgr_rules_version, buffer->data, buffer->length, &cached)) {
+        isol8r_stats_add(ISOL8R_STATS_CACHE_HITS, 1);
+        verdict->matches = cached.mask;
+        contains_nulls = cached.detail != 0;
+    } else {
+        verdict->matches = isol8r_scan_multi(buffer->data, buffer->length, vmmgr_scan_patterns, vmmgr_detector_count, &contains_nulls);
+        cached.mask = verdict->matches;
+        cached.detail = contains_nulls != 0;
+        isol8r_cache_store(&vmmgr_verdict_cache, vmmgr_rules_version, buffer->data, buffer->length, &cached);
+    }
+    verdict->contains_nulls = contains_nulls != 0;
+    if (verdict->matches) {
+        verdict->detector = (uint32_t)__builtin_ctz(verdict->matches);
+    }
+}
+
+/**
+ * Appends a formatted entry to the bait log, tagging the security team and
+ * leaving breadcrumbs for post-incident forensics. The message names the
+ * detector acted on, any others that also fired, and the timestamp in UTC.
+ *
+ * When the event ring is enabled the raw leading bytes go there as well,
+ * and the text lines are skipped if the ring is configured as exclusive.
+ *
+ * The hex dump covers vmmgr_log_options.preview_bytes leading bytes and
+ * ends in " ..." when it stops short; with base64 enabled a third line
+ * carries the whole payload. Under the server's log flusher, detections by
+ * the same detector within ISOL8R_LOG_COALESCE_MS are written once and then
+ * only counted, so a client retrying one payload cannot flood the log.
+ *
+ * @param verdict Findings from vmmgr_inspect(); at least one detector fired.
+ * @param buffer  The offending payload.
+ */
+static void vmmgr_log_bait_event(const struct vmmgr_verdict *verdict, const struct shellcode_buffer *buffer) {
+    size_t payload_length = buffer && buffer->data ? buffer->length : 0u;
+
+    if (isol8r_ring_enabled(&vmmgr_event_ring)) {
+        isol8r_ring_append(&vmmgr_event_ring,
+                           ISOL8R_RING_SOURCE_VMMGR,
+                           "bait",
+                           verdict->detector,
+                           buffer ? buffer->data : NULL,
+                           payload_length,
+                           payload_length,
+                           ISOL8R_RING_BINARY);
+        if (vmmgr_event_ring.exclusive) {
+            return;
+        }
+    }
+
+    char timestamp[ISOL8R_TIMESTAMP_MAX];
+    isol8r_log_timestamp(timestamp, vmmgr_bait_log.millis);
+
+    /* ", also 'execve', 'flag'" for every detector past the first. */
+    char also[128];
+    size_t also_len = 0;
+    also[0] = '\0';
+    for (uint32_t rest = verdict->matches & (verdict->matches - 1u); rest; rest &= rest - 1u) {
+        int written = snprintf(also + also_len,
+                               sizeof(also) - also_len,
+                               "%s'%s'",
+                               also_len == 0 ? ", also " : ", ",
+                               vmmgr_detectors[__builtin_ctz(rest)].label);
+        if (written < 0 || (size_t)written >= sizeof(also) - also_len) {
+            break;
+        }
+        also_len += (size_t)written;
+    }
+
+    const bool known = verdict->detector < vmmgr_detector_count;
+    const char *pattern = known ? vmmgr_detectors[verdict->detector].label : "unknown";
+    const char *severity = known ? isol8r_severity_name(vmmgr_detectors[verdict->detector].severity) : "unknown";
+
+    char head[512];
+    int head_len = snprintf(head,
+                            sizeof(head),
+                            "[BAIT] [VMMGR] Pattern '%s' (severity=%s) detected in payload (length=%zu%s) at %s\n"
+                            "[BAIT] [VMMGR] Payload hex dump: ",
+                            pattern,
+                            severity,
+                            payload_length,
+                            also,
+                            timestamp);
+    if (head_len < 0) {
+        return;
+    }
+    if ((size_t)head_len >= sizeof(head)) {
+        head_len = (int)sizeof(head) - 1;
+    }
+
+    size_t preview_len = payload_length < vmmgr_log_options.preview_bytes ? payload_length : vmmgr_log_options.preview_bytes;
+    bool attach = vmmgr_log_options.base64 && payload_length > 0;
+    const size_t stamp_len = strlen(timestamp);
+    const size_t line_end = sizeof(" at ") - 1 + stamp_len + 1;
+    size_t size = (size_t)head_len + ISOL8R_HEX_LEN(preview_len, 1) + sizeof(" ...") + line_end;
+    if (attach) {
+        size += sizeof(VMMGR_BASE64_PREFIX) - 1 + ISOL8R_BASE64_LEN(payload_length) + line_end;
+    }
+
+    /* Everything is encoded in place into one record, heap-backed only for big dumps. */
+    char stack_record[ISOL8R_LOG_RECORD_MAX];
+    char *record = size <= sizeof(stack_record) ? stack_record : malloc(size);
+    if (!record) {
+        record = stack_record;
+        preview_len = preview_len < VMMGR_PREVIEW_BYTES ? preview_len : VMMGR_PREVIEW_BYTES;
+        attach = false;
+    }
+
+    char *cursor = record;
+    memcpy(cursor, head, (size_t)head_len);
+    cursor += head_len;
+    if (payload_length == 0) {
+        memcpy(cursor, "(empty)", 7);
+        cursor += 7;
+    } else {
+        cursor += isol8r_hex_encode(cursor, buffer->data, preview_len, ' ');
+        if (payload_length > preview_len) {
+            const char *more = preview_len > 0 ? " ..." : "...";
+            memcpy(cursor, more, strlen(more));
+            cursor += strlen(more);
+        }
+    }
+    memcpy(cursor, " at ", 4);
+    memcpy(cursor + 4, timestamp, stamp_len);
+    cursor += 4 + stamp_len;
+    *cursor++ = '\n';
+
+    if (attach) {
+        memcpy(cursor, VMMGR_BASE64_PREFIX, sizeof(VMMGR_BASE64_PREFIX) - 1);
+        cursor += sizeof(VMMGR_BASE64_PREFIX) - 1;
+        cursor += isol8r_base64_encode(cursor, buffer->data, payload_length);
+        memcpy(cursor, " at ", 4);
+        memcpy(cursor + 4, timestamp, stamp_len);
+        cursor += 4 + stamp_len;
+        *cursor++ = '\n';
+    }
+
+    /* All lines go out in one append so concurrent runs cannot split them. */
+    struct iovec iov = { .iov_base = record, .iov_len = (size_t)(cursor - record) };
+    const struct isol8r_log_key key = {
+        .source = "tiny_vmmgr",
+        .tag = "bait",
+        .pattern = known ? verdict->detector : ISOL8R_LOG_NO_PATTERN,
+        .label = known ? pattern : NULL,
+        .client = NULL,
+    };
+    if (isol8r_log_event(&vmmgr_bait_log, &key, &iov, 1) != 0) {
+        fprintf(stderr, "[tiny_vmmgr] Warning: unable to write bait log at '%s': %s\n", VMMGR_BAIT_LOG_PATH, strerror(errno));
+    }
+    if (record != stack_record) {
+        free(record);
+    }
+}
+
+/**
+ * Handles bait detection events: logs the attempt, prints a sarcastic quip,
+ * and terminates the program.
+ *
+ * @param verdict Findings from vmmgr_inspect().
+ * @param buffer  The offending payload.
+ */
+static void vmmgr_handle_bait_detection(const struct vmmgr_verdict *verdict, struct shellcode_buffer *buffer) {
+    isol8r_stage_mark(ISOL8R_STAGE_INSPECT);
+    vmmgr_log_bait_event(verdict, buffer);
+    isol8r_stage_mark(ISOL8R_STAGE_LOG);
+    fprintf(stderr, "%s\n", vmmgr_detector_message(verdict->detector));
+
+    vmmgr_release_buffer(buffer);
+    vmmgr_telemetry_emit(VMMGR_RESULT_REJECTED, VMMGR_EXIT_FAILURE);
+    exit(VMMGR_EXIT_FAILURE);
+}
+
+/**
+ * Inspects the shellcode for banned patterns. Returns true if the payload is
+ * deemed safe, false otherwise. The function handles logging when necessary.
+ *
+ * @param buffer  Shellcode buffer.
+ * @param verdict Receives the findings, reused when executing.
+ * @return True if no banned patterns were found.
+ */
+static bool vmmgr_inspect_shellcode(struct shellcode_buffer *buffer, struct vmmgr_verdict *verdict) {
+    if (!buffer || !buffer->data) {
+        return false;
+    }
+
+    uint64_t mark = vmmgr_monotonic_ns();
+    vmmgr_inspect(buffer, verdict);
+    vmmgr_telemetry.inspect_ns = vmmgr_lap_ns(&mark);
+    vmmgr_telemetry.detector = verdict->detector;
+    vmmgr_telemetry.matches = verdict->matches;
+    if (verdict->detector != VMMGR_NO_DETECTOR) {
+        vmmgr_handle_bait_detection(verdict, buffer);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Emits a gentle warning if the payload contains null bytes. These often foil
+ * string-based loaders, and the harness prefers to alert the operator rather
+ * than enforce a restriction.
+ *
+ * @param contains_nulls Whether the original payload included a null byte.
+ */
+static void vmmgr_warn_about_nulls(bool contains_nulls) {
+    if (contains_nulls) {
+        fprintf(stderr, "[tiny_vmmgr] Caution: payload contains null bytes. Hope your loader likes NULs.\n");
+    }
+}
+
+/** Observed payload child: jump straight to the already executable payload. */
+static void vmmgr_child_jump(void *ctx) {
+    struct shellcode_buffer *buffer = ctx;
+
+    /* The record and the stats page are the parent's to write; keep the payload off them. */
+    if (vmmgr_telemetry_fd >= 0) {
+        close(vmmgr_telemetry_fd);
+    }
+    isol8r_stats_detach();
+    isol8r_cache_close(&vmmgr_verdict_cache);
+    void (*shellcode_entry)(void) = (void (*)(void))buffer->data;
+    shellcode_entry();
+    _exit(VMMGR_EXIT_SUCCESS);
+}
+
+/**
+ * Runs an executable payload in a supervised child so its fate can be
+ * reported and its budget enforced from outside: the parent relays the
+ * child's output as it arrives, counting it against the output budget,
+ * kills the child if it overruns its wall-clock budget, and reaps it with
+ * wait4() for the status and resource usage. It then writes the telemetry
+ * record and leaves the way the child did, so callers see the same exit
+ * status or signal as an unobserved run. Does not return.
+ *
+ * @param buffer Executable shellcode buffer.
+ */
+static void vmmgr_run_observed(struct shellcode_buffer *buffer) {
+    uint64_t mark = vmmgr_monotonic_ns();
+    struct vmmgr_capture out = { NULL, 0, STDOUT_FILENO };
+    struct vmmgr_capture err = { NULL, 0, STDERR_FILENO };
+    uint32_t kind = VMMGR_RESULT_EXITED;
+    uint32_t code = VMMGR_EXIT_FAILURE;
+
+    if (vmmgr_fork_capture(vmmgr_child_jump, buffer, NULL, 0, &out, &err, &kind, &code, &vmmgr_telemetry.child) != 0) {
+        perror("[tiny_vmmgr] fork");
+        vmmgr_telemetry_emit(VMMGR_RESULT_EXITED, VMMGR_EXIT_FAILURE);
+        exit(VMMGR_EXIT_FAILURE);
+    }
+    vmmgr_telemetry.execute_ns = vmmgr_lap_ns(&mark);
+    vmmgr_release_buffer(buffer);
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+    vmmgr_telemetry_emit(kind, code);
+
+    if (kind == VMMGR_RESULT_SIGNALED) {
+        signal((int)code, SIG_DFL);
+        raise((int)code);
+        _exit(128 + (int)code);
+    }
+    exit((int)code);
+}
+
+/**
+ * Executes the validated shellcode by flipping the mapping it was read and
+ * inspected in to RWX and performing a function pointer jump. A file mapping
+ * on a noexec mount refuses PROT_EXEC; only then is the payload copied into
+ * an anonymous page first. With telemetry or an output budget the jump
+ * happens in an observed child instead; otherwise the time budget is armed
+ * in this process.
+ *
+ * @param buffer  Shellcode buffer; its mapping is consumed.
+ * @param verdict Findings from the inspection pass.
+ */
+static void vmmgr_execute_shellcode(struct shellcode_buffer *buffer, const struct vmmgr_verdict *verdict) {
+    if (!buffer || !buffer->data || buffer->length == 0) {
+        fprintf(stderr, "[tiny_vmmgr] No shellcode to execute. Perhaps try writing some first.\n");
+        exit(VMMGR_EXIT_FAILURE);
+    }
+
+    uint64_t mark = vmmgr_monotonic_ns();
+    int rc = mprotect(buffer->data, buffer->map_length, PROT_READ | PROT_WRITE | PROT_EXEC);
+    if (rc != 0 && buffer->file_backed) {
+        const size_t length = buffer->length;
+        uint8_t *region = vmmgr_map_region();
+        memcpy(region, buffer->data, length);
+        vmmgr_release_buffer(buffer);
+        buffer->data = region;
+        buffer->length = length;
+        buffer->map_length = vmmgr_limits.map_length;
+        buffer->file_backed = false;
+        rc = mprotect(buffer->data, buffer->map_length, PROT_READ | PROT_WRITE | PROT_EXEC);
+    }
+    if (rc != 0) {
+        perror("[tiny_vmmgr] mprotect");
+        vmmgr_release_buffer(buffer);
+        vmmgr_telemetry_emit(VMMGR_RESULT_EXITED, VMMGR_EXIT_FAILURE);
+        exit(VMMGR_EXIT_FAILURE);
+    }
+    vmmgr_telemetry.mprotect_ns = vmmgr_lap_ns(&mark);
+
+    vmmgr_warn_about_nulls(verdict->contains_nulls);
+
+    /* A budget ends the process with _exit(); nothing buffered may be lost. */
+    fflush(NULL);
+    if (!vmmgr_supervised) {
+        if (vmmgr_telemetry_fd >= 0 || vmmgr_budget.output_max > 0) {
+            vmmgr_run_observed(buffer);
+        }
+        if (isol8r_budget_arm(&vmmgr_budget, 1) != 0) {
+            perror("[tiny_vmmgr] Warning: payload budget not fully armed");
+        }
+        /* Nobody sees how an unobserved run ends; count what is known up front. */
+        vmmgr_telemetry_closed = true;
+        vmmgr_stats_record(&vmmgr_telemetry);
+    }
+    isol8r_stats_detach();
+
+    void (*shellcode_entry)(void) = (void (*)(void))buffer->data;
+    shellcode_entry();
+
+    vmmgr_release_buffer(buffer);
+}
+
+/* ---------------------------------------------------------------------------
+ *  FORK SERVER
+ * ---------------------------------------------------------------------------
+ *
+ *  Wire format on the unix socket, one exchange per payload, repeatable on
+ *  the same connection. Requests may be pipelined: a client can send any
+ *  number before reading, and replies come back in the order the requests
+ *  were sent however the payloads are scheduled:
+ *
+ *    request: u32 length (big-endian) | payload bytes
+ *    reply:   u32 length (big-endian) | u32 kind | u32 code
+ *             | u32 detector | u32 matches
+ *             | u32 stdout_len | u32 stderr_len | stdout | stderr
+ *             | u32 telemetry_len | telemetry
+ *
+ *  kind is VMMGR_RESULT_*; code is the exit status, or the signal number
+ *  for VMMGR_RESULT_SIGNALED. A payload that exhausts its budget reports
+ *  the matching ISOL8R_BUDGET_EXIT_* status, with VMMGR_RESULT_TIMEOUT for
+ *  the wall clock. detector, matches and telemetry are as in
+ *  batch mode below: each connection handler inspects payloads itself and
+ *  only forks for the ones that pass. The parent only ever accepts connections and
+ *  forks, so its pristine state is what every handler starts from.
+ */
+
+/**
+ * Fills a buffer from a descriptor.
+ *
+ * @return 1 when the buffer is full, 0 on EOF before the first byte, -1 on
+ *         error or EOF midway.
+ */
+static int vmmgr_read_full(int fd, void *buffer, size_t len) {
+    uint8_t *cursor = buffer;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t got = read(fd, cursor + done, len - done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            return done == 0 ? 0 : -1;
+        }
+        done += (size_t)got;
+    }
+    return 1;
+}
+
+static int vmmgr_write_full(int fd, const void *buffer, size_t len) {
+    const uint8_t *cursor = buffer;
+    while (len > 0) {
+        ssize_t put = write(fd, cursor, len);
+        if (put < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        cursor += put;
+        len -= (size_t)put;
+    }
+    return 0;
+}
+
+static uint32_t vmmgr_get_be32(const uint8_t *in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | (uint32_t)in[3];
+}
+
+static void vmmgr_put_be32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+static uint64_t vmmgr_monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000u + (uint64_t)now.tv_nsec / 1000000u;
+}
+
+/** Appends to a capture, or passes the bytes through to its sink; beyond VMMGR_CAPTURE_MAX they are dropped. */
+static void vmmgr_capture_put(struct vmmgr_capture *capture, const void *bytes, size_t len) {
+    if (!capture->data) {
+        vmmgr_write_full(capture->sink, bytes, len);
+        capture->length += len;
+        return;
+    }
+    size_t room = VMMGR_CAPTURE_MAX - capture->length;
+    size_t keep = len < room ? len : room;
+    memcpy(capture->data + capture->length, bytes, keep);
+    capture->length += keep;
+}
+
+/**
+ * Tells whether a child was ended by the RLIMIT_CPU backstop rather than its
+ * own budget timer, i.e. the payload had disarmed or blocked the timer.
+ */
+static bool vmmgr_cpu_backstop_hit(int status, const struct rusage *spent) {
+    if (!WIFSIGNALED(status) || vmmgr_budget.cpu_ms == 0) {
+        return false;
+    }
+    const uint64_t spent_ms = (vmmgr_timeval_us(spent->ru_utime) + vmmgr_timeval_us(spent->ru_stime)) / 1000u;
+    return WTERMSIG(status) == SIGXCPU || (WTERMSIG(status) == SIGKILL && spent_ms >= vmmgr_budget.cpu_ms);
+}
+
+/**
+ * Runs `child_main` in a fresh child whose stdin, stdout and stderr are
+ * pipes, then collects its output and how it ended. The child runs under
+ * the CPU budget and dies with this process; it is killed if it outlives
+ * the wall-clock budget or writes more than the output budget allows, and
+ * a note saying which is appended to `err`.
+ *
+ * @param child_main What the child runs.
+ * @param ctx        Passed to child_main.
+ * @param input      Bytes fed to the child's stdin (at most a pipe buffer).
+ * @param input_len  Number of input bytes.
+ * @param out        Captured stdout.
+ * @param err        Captured stderr.
+ * @param kind       Receives a VMMGR_RESULT_* value.
+ * @param code       Receives the exit status or signal number; an exhausted
+ *                   budget reports its ISOL8R_BUDGET_EXIT_* status (with
+ *                   VMMGR_RESULT_TIMEOUT for the wall clock).
+ * @param usage      Receives the child's resource usage; may be NULL.
+ * @return 0 on success, -1 if the child could not be started.
+ */
+static int vmmgr_fork_capture(vmmgr_child_main child_main,
+                              void *ctx,
+                              const uint8_t *input,
+                              size_t input_len,
+                              struct vmmgr_capture *out,
+                              struct vmmgr_capture *err,
+                              uint32_t *kind,
+                              uint32_t *code,
+                              struct rusage *usage) {
+    int in_pipe[2];
+    int out_pipe[2];
+    int err_pipe[2];
+
+    if (pipe(in_pipe) != 0) {
+        return -1;
+    }
+    if (pipe(out_pipe) != 0) {
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return -1;
+    }
+    if (pipe(err_pipe) != 0) {
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return -1;
+    }
+
+    fflush(NULL);
+    const pid_t parent = getpid();
+    pid_t child = fork();
+    if (child < 0) {
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return -1;
+    }
+
+    if (child == 0) {
+        dup2(in_pipe[0], STDIN_FILENO);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        signal(SIGPIPE, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != parent) {
+            _exit(VMMGR_EXIT_FAILURE);
+        }
+        vmmgr_supervised = true;
+        isol8r_budget_arm(&vmmgr_budget, 0);
+        isol8r_stage_restart();
+        child_main(ctx);
+        exit(VMMGR_EXIT_SUCCESS);
+    }
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+
+    /* The input never exceeds a pipe buffer, so this cannot deadlock. */
+    vmmgr_write_full(in_pipe[1], input, input_len);
+    close(in_pipe[1]);
+
+    struct pollfd fds[2] = {
+        { .fd = out_pipe[0], .events = POLLIN },
+        { .fd = err_pipe[0], .events = POLLIN },
+    };
+    struct vmmgr_capture *captures[2] = { out, err };
+    const uint64_t deadline = vmmgr_monotonic_ms() + vmmgr_budget.wall_ms;
+    uint64_t written = 0;
+    bool timed_out = false;
+    bool over_output = false;
+    int open_fds = 2;
+
+    while (open_fds > 0 && !over_output) {
+        int wait_ms = -1;
+        if (vmmgr_budget.wall_ms > 0) {
+            uint64_t now = vmmgr_monotonic_ms();
+            if (now >= deadline) {
+                timed_out = true;
+                break;
+            }
+            wait_ms = (int)(deadline - now);
+        }
+        int ready = poll(fds, 2, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            timed_out = true;
+            break;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            uint8_t chunk[4096];
+            ssize_t got = read(fds[i].fd, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                --open_fds;
+                continue;
+            }
+            size_t keep = (size_t)got;
+            if (vmmgr_budget.output_max > 0 && written + keep > vmmgr_budget.output_max) {
+                keep = (size_t)(vmmgr_budget.output_max - written);
+                over_output = true;
+            }
+            written += keep;
+            vmmgr_capture_put(captures[i], chunk, keep);
+            if (over_output) {
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (fds[i].fd >= 0) {
+            close(fds[i].fd);
+        }
+    }
+    if (timed_out || over_output) {
+        kill(child, SIGKILL);
+    }
+
+    int status = 0;
+    struct rusage child_usage;
+    while (wait4(child, &status, 0, usage ? usage : &child_usage) < 0) {
+        if (errno != EINTR) {
+            status = 0;
+            break;
+        }
+    }
+
+    char note[96];
+    note[0] = '\0';
+    if (timed_out) {
+        *kind = VMMGR_RESULT_TIMEOUT;
+        *code = ISOL8R_BUDGET_EXIT_WALL;
+        snprintf(note, sizeof(note), "[tiny_vmmgr] Wall-clock budget of %u ms exhausted.\n", (unsigned)vmmgr_budget.wall_ms);
+    } else if (over_output) {
+        *kind = VMMGR_RESULT_EXITED;
+        *code = ISOL8R_BUDGET_EXIT_OUTPUT;
+        snprintf(note, sizeof(note), "\n[tiny_vmmgr] Output budget of %llu bytes exhausted.\n",
+                 (unsigned long long)vmmgr_budget.output_max);
+    } else if (vmmgr_cpu_backstop_hit(status, usage ? usage : &child_usage)) {
+        *kind = VMMGR_RESULT_EXITED;
+        *code = ISOL8R_BUDGET_EXIT_CPU;
+        snprintf(note, sizeof(note), "[tiny_vmmgr] CPU budget of %u ms exhausted.\n", (unsigned)vmmgr_budget.cpu_ms);
+    } else if (WIFSIGNALED(status)) {
+        *kind = VMMGR_RESULT_SIGNALED;
+        *code = (uint32_t)WTERMSIG(status);
+    } else {
+        *kind = VMMGR_RESULT_EXITED;
+        *code = (uint32_t)WEXITSTATUS(status);
+    }
+    if (note[0] != '\0') {
+        vmmgr_capture_put(err, note, strlen(note));
+    }
+    return 0;
+}
+
+/*
+ * Parallel execution. A connection's requests are pipelined: its handler
+ * keeps reading frames while earlier ones run, starts up to client_cap of
+ * them at once and writes the replies strictly in request order. Payloads
+ * are read straight into regions from the handler's pool, twice client_cap
+ * of them, and reading stalls while none is free. Each request runs in a
+ * runner process forked from the handler, which goes through
+ * vmmgr_process_one() on its inherited view of the region exactly as a
+ * sequential handler would, writing the result frame down a pipe.
+ *
+ * Runners first take a lease from a table shared by the whole server,
+ * which caps payloads in flight across every connection at global_cap. A
+ * lease is a slot holding the runner's pid, so one that dies holding it is
+ * swept once the table is full. Under the "spread" affinity policy lease i
+ * also picks the CPU the runner and its payload are pinned to, so
+ * concurrent payloads land on distinct cores:
+ *
+ *   ISOL8R_VMMGR_CPUS=LIST          CPUs to use, e.g. "0-3,6" (default: all allowed)
+ *   ISOL8R_VMMGR_AFFINITY=POLICY    spread (pin per lease, default), set, none
+ *   ISOL8R_VMMGR_PARALLEL=N         payloads in flight server-wide (default: CPU count)
+ *   ISOL8R_VMMGR_CLIENT_PARALLEL=N  payloads in flight per connection (default: half of that)
+ */
+
+enum vmmgr_affinity {
+    VMMGR_AFFINITY_SPREAD,  /**< Pin each runner to one CPU, picked by its lease. */
+    VMMGR_AFFINITY_SET,     /**< Confine runners to the CPU set; the scheduler places them. */
+    VMMGR_AFFINITY_NONE,    /**< Leave affinity alone. */
+};
+
+/** Server-wide lease table, shared with every handler and runner. */
+struct vmmgr_leases {
+    _Atomic uint32_t wake;                  /**< Futex word; bumped on every release. */
+    _Atomic pid_t owner[VMMGR_PARALLEL_MAX]; /**< Runner holding lease i, 0 when free. */
+};
+
+static struct vmmgr_parallel {
+    cpu_set_t cpus;
+    int cpu_list[CPU_SETSIZE];
+    unsigned cpu_count;
+    enum vmmgr_affinity affinity;
+    unsigned global_cap;
+    unsigned client_cap;
+    struct vmmgr_leases *leases;
+} vmmgr_parallel;
+
+/** A connection's request, from the moment its header arrives until its reply is queued. */
+struct vmmgr_slot {
+    uint8_t *payload;       /**< Pooled region the payload is read into; NULL when oversized. */
+    size_t length;          /**< Length as sent. */
+    size_t received;        /**< Payload bytes read so far. */
+    struct vmmgr_telemetry telemetry;
+    pid_t runner;           /**< 0 until started. */
+    int result_fd;          /**< Read end of the runner's result pipe, -1 when closed. */
+    uint8_t *result;        /**< Result frame as it arrives. */
+    size_t result_len;
+    size_t result_cap;
+    bool done;              /**< result holds the complete reply. */
+};
+
+/** Result pipe of the runner this process is, so the payload child can drop it. */
+static int vmmgr_runner_fd = -1;
+
+static unsigned vmmgr_env_count(const char *name, unsigned fallback, unsigned limit) {
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        return fallback;
+    }
+    char *end = NULL;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (!end || *end != '\0' || parsed < 1 || parsed > limit) {
+        fprintf(stderr, "[tiny_vmmgr] Ignoring %s=%s (want 1..%u).\n", name, value, limit);
+        return fallback;
+    }
+    return (unsigned)parsed;
+}
+
+/** Parses "0-3,6" into a set; returns false on any malformed piece. */
+static bool vmmgr_parse_cpus(const char *text, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *cursor = text;
+    while (*cursor) {
+        char *end = NULL;
+        unsigned long first = strtoul(cursor, &end, 10);
+        if (end == cursor) {
+            return false;
+        }
+        unsigned long last = first;
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtoul(cursor, &end, 10);
+            if (end == cursor) {
+                return false;
+            }
+        }
+        if (first > last || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (unsigned long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET((int)cpu, set);
+        }
+        if (*end == ',') {
+            ++end;
+        } else if (*end != '\0') {
+            return false;
+        }
+        cursor = end;
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+/**
+ * Reads the parallelism knobs and maps the lease table. Called by the
+ * listening process before it forks any handler.
+ */
+static void vmmgr_load_parallel(void) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    vmmgr_parallel.cpus = allowed;
+    const char *cpus = getenv("ISOL8R_VMMGR_CPUS");
+    if (cpus && *cpus) {
+        cpu_set_t wanted;
+        cpu_set_t usable;
+        if (!vmmgr_parse_cpus(cpus, &wanted)) {
+            fprintf(stderr, "[tiny_vmmgr] Ignoring ISOL8R_VMMGR_CPUS=%s (want a list like 0-3,6).\n", cpus);
+        } else {
+            CPU_AND(&usable, &wanted, &allowed);
+            if (CPU_COUNT(&usable) == 0) {
+                fprintf(stderr, "[tiny_vmmgr] Ignoring ISOL8R_VMMGR_CPUS=%s: none of those CPUs are available.\n", cpus);
+            } else {
+                vmmgr_parallel.cpus = usable;
+            }
+        }
+    }
+
+    vmmgr_parallel.cpu_count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &vmmgr_parallel.cpus)) {
+            vmmgr_parallel.cpu_list[vmmgr_parallel.cpu_count++] = cpu;
+        }
+    }
+
+    vmmgr_parallel.affinity = VMMGR_AFFINITY_SPREAD;
+    const char *policy = getenv("ISOL8R_VMMGR_AFFINITY");
+    if (policy && strcmp(policy, "set") == 0) {
+        vmmgr_parallel.affinity = VMMGR_AFFINITY_SET;
+    } else if (policy && strcmp(policy, "none") == 0) {
+        vmmgr_parallel.affinity = VMMGR_AFFINITY_NONE;
+    } else if (policy && *policy && strcmp(policy, "spread") != 0) {
+        fprintf(stderr, "[tiny_vmmgr] Ignoring ISOL8R_VMMGR_AFFINITY=%s (want spread, set or none).\n", policy);
+    }
+
+    const unsigned cores = vmmgr_parallel.cpu_count < VMMGR_PARALLEL_MAX ? vmmgr_parallel.cpu_count : VMMGR_PARALLEL_MAX;
+    vmmgr_parallel.global_cap = vmmgr_env_count("ISOL8R_VMMGR_PARALLEL", cores, VMMGR_PARALLEL_MAX);
+    const unsigned share = (vmmgr_parallel.global_cap + 1u) / 2u;
+    vmmgr_parallel.client_cap = vmmgr_env_count("ISOL8R_VMMGR_CLIENT_PARALLEL", share, VMMGR_CLIENT_QUEUE);
+    if (vmmgr_parallel.client_cap > vmmgr_parallel.global_cap) {
+        vmmgr_parallel.client_cap = vmmgr_parallel.global_cap;
+    }
+
+    struct vmmgr_leases *leases = mmap(NULL, sizeof(*leases), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    vmmgr_parallel.leases = leases == MAP_FAILED ? NULL : leases;
+    if (!vmmgr_parallel.leases) {
+        perror("[tiny_vmmgr] lease table");
+    }
+
+    static const char *const policy_names[] = { "spread", "set", "none" };
+    fprintf(stderr,
+            "[tiny_vmmgr] Up to %u payloads at once (%u per connection) on %u CPUs, affinity %s.\n",
+            vmmgr_parallel.global_cap,
+            vmmgr_parallel.client_cap,
+            vmmgr_parallel.cpu_count,
+            policy_names[vmmgr_parallel.affinity]);
+}
+
+/**
+ * Whether pid is a live runner of this server: it must exist, be ours to
+ * signal and share the server's session, so a stale or foreign pid in the
+ * table (pid 1 answers kill() with EPERM) does not hold a lease forever.
+ */
+static bool vmmgr_lease_owner_alive(pid_t pid) {
+    if (kill(pid, 0) != 0) {
+        return false;
+    }
+    const pid_t session = getsid(pid);
+    return session >= 0 && session == getsid(0);
+}
+
+/**
+ * Takes a free lease, waiting for one if the server is at its cap; -1 if
+ * there is no table, VMMGR_LEASE_BUSY if none came free within
+ * VMMGR_LEASE_WAIT_MS. Payload budgets bound how long a lease is held, so
+ * a wait that long means overload, and the cap still has to hold.
+ */
+static int vmmgr_lease_acquire(void) {
+    struct vmmgr_leases *leases = vmmgr_parallel.leases;
+    if (!leases) {
+        return -1;
+    }
+    const pid_t self = getpid();
+    const uint64_t deadline_ns = vmmgr_monotonic_ns() + (uint64_t)VMMGR_LEASE_WAIT_MS * 1000000u;
+    for (;;) {
+        const uint32_t seen = atomic_load(&leases->wake);
+        for (unsigned i = 0; i < vmmgr_parallel.global_cap; ++i) {
+            pid_t expected = 0;
+            if (atomic_compare_exchange_strong(&leases->owner[i], &expected, self)) {
+                return (int)i;
+            }
+        }
+
+        /* Full: free the leases of runners that died holding them. */
+        bool swept = false;
+        for (unsigned i = 0; i < vmmgr_parallel.global_cap; ++i) {
+            pid_t owner = atomic_load(&leases->owner[i]);
+            if (owner > 0 && !vmmgr_lease_owner_alive(owner)) {
+                swept |= atomic_compare_exchange_strong(&leases->owner[i], &owner, 0);
+            }
+        }
+        if (!swept) {
+            if (vmmgr_monotonic_ns() >= deadline_ns) {
+                return VMMGR_LEASE_BUSY;
+            }
+            struct timespec timeout = { 0, VMMGR_LEASE_POLL_MS * 1000000L };
+            syscall(SYS_futex, (uint32_t *)&leases->wake, FUTEX_WAIT, seen, &timeout, NULL, 0);
+        }
+    }
+}
+
+static void vmmgr_lease_release(int lease) {
+    struct vmmgr_leases *leases = vmmgr_parallel.leases;
+    if (!leases || lease < 0) {
+        return;
+    }
+    atomic_store(&leases->owner[lease], 0);
+    atomic_fetch_add(&leases->wake, 1u);
+    syscall(SYS_futex, (uint32_t *)&leases->wake, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/** Applies the affinity policy to the calling runner; its payload child inherits it. */
+static void vmmgr_apply_affinity(int lease) {
+    if (vmmgr_parallel.affinity == VMMGR_AFFINITY_NONE || vmmgr_parallel.cpu_count == 0) {
+        return;
+    }
+    cpu_set_t set = vmmgr_parallel.cpus;
+    if (vmmgr_parallel.affinity == VMMGR_AFFINITY_SPREAD) {
+        const unsigned pick = lease >= 0 ? (unsigned)lease : (unsigned)getpid();
+        CPU_ZERO(&set);
+        CPU_SET(vmmgr_parallel.cpu_list[pick % vmmgr_parallel.cpu_count], &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+static void vmmgr_slot_fail(struct vmmgr_slot *slot, const char *message);
+
+/**
+ * Runs one request inside a runner process and writes its result frame to
+ * fd. Never returns.
+ */
+static void vmmgr_runner_main(struct vmmgr_slot *slot, int fd) {
+    static uint8_t out_buffer[VMMGR_CAPTURE_MAX];
+    static uint8_t err_buffer[VMMGR_CAPTURE_MAX];
+
+    const int lease = vmmgr_lease_acquire();
+    if (lease == VMMGR_LEASE_BUSY) {
+        vmmgr_slot_fail(slot, "[tiny_vmmgr] Server busy: no runner slot came free in time.\n");
+        const int status = slot->result_len ? vmmgr_write_full(fd, slot->result, slot->result_len) : -1;
+        _exit(status == 0 ? VMMGR_EXIT_SUCCESS : VMMGR_EXIT_FAILURE);
+    }
+    vmmgr_apply_affinity(lease);
+    vmmgr_runner_fd = fd;
+
+    /*
+     * Usage so far belongs to the handler, and time spent queued for a lease
+     * is not the payload's: the record counts from here, plus the read.
+     */
+    getrusage(RUSAGE_SELF, &slot->telemetry.self_start);
+    slot->telemetry.started_ns = vmmgr_monotonic_ns() - slot->telemetry.read_ns;
+    struct vmmgr_capture out = { out_buffer, 0, -1 };
+    struct vmmgr_capture err = { err_buffer, 0, -1 };
+    struct vmmgr_verdict verdict;
+    vmmgr_process_one(slot->payload, slot->length, &out, &err, &verdict, &slot->telemetry);
+    const int status = vmmgr_write_result(fd, &out, &err, &verdict, &slot->telemetry, false, 0);
+    vmmgr_lease_release(lease);
+    _exit(status == 0 ? VMMGR_EXIT_SUCCESS : VMMGR_EXIT_FAILURE);
+}
+
+static int vmmgr_slot_append(struct vmmgr_slot *slot, const uint8_t *data, size_t len) {
+    if (slot->result_len + len > slot->result_cap) {
+        size_t capacity = slot->result_cap ? slot->result_cap : 4096u;
+        while (capacity < slot->result_len + len) {
+            capacity *= 2u;
+        }
+        uint8_t *grown = realloc(slot->result, capacity);
+        if (!grown) {
+            return -1;
+        }
+        slot->result = grown;
+        slot->result_cap = capacity;
+    }
+    memcpy(slot->result + slot->result_len, data, len);
+    slot->result_len += len;
+    return 0;
+}
+
+/**
+ * Replaces a request's reply with a failure frame, for runners that could
+ * not be forked or died before answering. The frame is far smaller than a
+ * pipe buffer, so it is written and read back in place.
+ */
+static void vmmgr_slot_fail(struct vmmgr_slot *slot, const char *message) {
+    isol8r_stats_add(ISOL8R_STATS_ERRORS, 1);
+    uint8_t out_buffer[sizeof(VMMGR_BANNER_TEXT)];
+    uint8_t err_buffer[128];
+    struct vmmgr_capture out = { out_buffer, 0, -1 };
+    struct vmmgr_capture err = { err_buffer, 0, -1 };
+    struct vmmgr_verdict verdict;
+    int pipe_fds[2];
+
+    vmmgr_inspect(NULL, &verdict);
+    vmmgr_capture_put(&out, VMMGR_BANNER_TEXT, strlen(VMMGR_BANNER_TEXT));
+    vmmgr_capture_put(&err, message, strlen(message));
+    slot->telemetry.kind = VMMGR_RESULT_EXITED;
+    slot->telemetry.code = VMMGR_EXIT_FAILURE;
+    slot->telemetry.bytes = slot->length;
+    slot->result_len = 0;
+    slot->done = true;
+
+    if (pipe(pipe_fds) != 0) {
+        return;
+    }
+    if (vmmgr_write_result(pipe_fds[1], &out, &err, &verdict, &slot->telemetry, false, 0) == 0) {
+        close(pipe_fds[1]);
+        uint8_t chunk[1024];
+        ssize_t got;
+        while ((got = read(pipe_fds[0], chunk, sizeof(chunk))) > 0 && vmmgr_slot_append(slot, chunk, (size_t)got) == 0) {
+        }
+    } else {
+        close(pipe_fds[1]);
+    }
+    close(pipe_fds[0]);
+}
+
+static void vmmgr_slot_release(struct vmmgr_region_pool *pool, struct vmmgr_slot *slot) {
+    if (slot->result_fd >= 0) {
+        close(slot->result_fd);
+    }
+    if (slot->runner > 0) {
+        kill(slot->runner, SIGKILL);
+        while (waitpid(slot->runner, NULL, 0) < 0 && errno == EINTR) {
+        }
+    }
+    if (slot->payload) {
+        vmmgr_pool_give(pool, slot->payload, slot->received);
+    }
+    free(slot->result);
+    memset(slot, 0, sizeof(*slot));
+    slot->result_fd = -1;
+}
+
+/** Per-connection state of the pipelined handler. */
+struct vmmgr_conn {
+    int client;
+    struct vmmgr_region_pool pool;
+    struct vmmgr_slot slots[VMMGR_CLIENT_QUEUE];
+    unsigned head;          /**< Oldest request, the next to be answered. */
+    unsigned count;         /**< Requests queued, reading included. */
+    unsigned started;       /**< Requests handed to a runner, counted from head. */
+    unsigned running;       /**< Runners still writing their result. */
+    uint8_t header[4];
+    size_t header_len;      /**< Header bytes of the next request read so far; a full one waits for a region. */
+    bool reading;           /**< The newest slot is still receiving its payload. */
+    uint64_t skip;          /**< Bytes of an oversized payload still to discard. */
+    bool eof;
+    uint8_t in[65536];      /**< Bytes read but not yet taken by vmmgr_conn_feed(). */
+    size_t in_start;
+    size_t in_end;
+    uint8_t *out;           /**< Replies waiting for the socket to take them. */
+    size_t out_len;
+    size_t out_cap;
+    size_t out_sent;
+};
+
+static struct vmmgr_slot *vmmgr_conn_slot(struct vmmgr_conn *conn, unsigned index) {
+    return &conn->slots[(conn->head + index) % VMMGR_CLIENT_QUEUE];
+}
+
+static void vmmgr_conn_start(struct vmmgr_conn *conn, struct vmmgr_slot *slot) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        vmmgr_slot_fail(slot, "[tiny_vmmgr] Could not start a payload runner.\n");
+        return;
+    }
+
+    fflush(NULL);
+    const pid_t handler = getpid();
+    const pid_t runner = fork();
+    if (runner == 0) {
+        close(pipe_fds[0]);
+        close(conn->client);
+        for (unsigned i = 0; i < conn->count; ++i) {
+            const struct vmmgr_slot *other = vmmgr_conn_slot(conn, i);
+            if (other != slot && other->result_fd >= 0) {
+                close(other->result_fd);
+            }
+        }
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != handler) {
+            _exit(VMMGR_EXIT_FAILURE);
+        }
+        vmmgr_runner_main(slot, pipe_fds[1]);
+    }
+    close(pipe_fds[1]);
+    if (runner < 0) {
+        close(pipe_fds[0]);
+        vmmgr_slot_fail(slot, "[tiny_vmmgr] Could not start a payload runner.\n");
+        return;
+    }
+    slot->runner = runner;
+    slot->result_fd = pipe_fds[0];
+    ++conn->running;
+}
+
+/** Reads a runner's result; on EOF reaps it and marks the slot answered. */
+static void vmmgr_conn_collect(struct vmmgr_conn *conn, struct vmmgr_slot *slot) {
+    uint8_t chunk[16384];
+    ssize_t got = read(slot->result_fd, chunk, sizeof(chunk));
+    if (got < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return;
+    }
+    if (got > 0 && vmmgr_slot_append(slot, chunk, (size_t)got) == 0) {
+        return;
+    }
+
+    close(slot->result_fd);
+    slot->result_fd = -1;
+    int status = 0;
+    while (waitpid(slot->runner, &status, 0) < 0 && errno == EINTR) {
+    }
+    slot->runner = 0;
+    --conn->running;
+
+    /* A complete frame is its own length prefix plus that many bytes. */
+    const bool whole = slot->result_len >= 4 && vmmgr_get_be32(slot->result) == slot->result_len - 4;
+    if (!whole || !WIFEXITED(status) || WEXITSTATUS(status) != VMMGR_EXIT_SUCCESS) {
+        vmmgr_slot_fail(slot, "[tiny_vmmgr] The payload runner died before answering.\n");
+    }
+    slot->done = true;
+}
+
+/** Opens a slot for the complete header; false while the queue is full or no region is free. */
+static bool vmmgr_conn_open(struct vmmgr_conn *conn) {
+    const uint32_t length = vmmgr_get_be32(conn->header);
+    /* Same limit as vmmgr_read_shellcode(); oversized payloads are drained unread. */
+    const bool oversized = length >= vmmgr_limits.max_payload;
+    uint8_t *region = NULL;
+    if (conn->count == VMMGR_CLIENT_QUEUE || (!oversized && !(region = vmmgr_pool_take(&conn->pool)))) {
+        return false;
+    }
+
+    struct vmmgr_slot *slot = vmmgr_conn_slot(conn, conn->count++);
+    memset(slot, 0, sizeof(*slot));
+    slot->result_fd = -1;
+    slot->payload = region;
+    slot->length = length;
+    vmmgr_telemetry_begin(&slot->telemetry);
+    conn->header_len = 0;
+    if (oversized) {
+        conn->skip = length;
+    } else {
+        conn->reading = length > 0;
+    }
+    return true;
+}
+
+/**
+ * Consumes buffered request bytes: headers open slots, bodies fill them,
+ * oversized ones are skipped. Stops early once the queue is full or every
+ * pooled region is taken.
+ */
+static void vmmgr_conn_feed(struct vmmgr_conn *conn) {
+    const uint8_t *data = conn->in + conn->in_start;
+    size_t len = conn->in_end - conn->in_start;
+    for (;;) {
+        if (conn->skip > 0 && len > 0) {
+            const size_t step = len < conn->skip ? len : (size_t)conn->skip;
+            conn->skip -= step;
+            data += step;
+            len -= step;
+            continue;
+        }
+        if (conn->reading && len > 0) {
+            struct vmmgr_slot *slot = vmmgr_conn_slot(conn, conn->count - 1u);
+            const size_t step = len < slot->length - slot->received ? len : slot->length - slot->received;
+            memcpy(slot->payload + slot->received, data, step);
+            slot->received += step;
+            data += step;
+            len -= step;
+            if (slot->received == slot->length) {
+                slot->telemetry.read_ns = vmmgr_monotonic_ns() - slot->telemetry.started_ns;
+                conn->reading = false;
+            }
+            continue;
+        }
+        if (conn->skip > 0 || conn->reading) {
+            break;
+        }
+        if (conn->header_len == sizeof(conn->header)) {
+            if (!vmmgr_conn_open(conn)) {
+                break;
+            }
+            continue;
+        }
+        if (len == 0) {
+            break;
+        }
+        const size_t step = len < sizeof(conn->header) - conn->header_len ? len : sizeof(conn->header) - conn->header_len;
+        memcpy(conn->header + conn->header_len, data, step);
+        conn->header_len += step;
+        data += step;
+        len -= step;
+    }
+    conn->in_start = conn->in_end - len;
+    if (conn->in_start == conn->in_end) {
+        conn->in_start = conn->in_end = 0;
+    }
+}
+
+/** Whether the peer has left VMMGR_CONN_OUT_HIGH bytes of replies unread. */
+static bool vmmgr_conn_backlogged(const struct vmmgr_conn *conn) {
+    return conn->out_len - conn->out_sent >= VMMGR_CONN_OUT_HIGH;
+}
+
+/**
+ * Moves finished replies, oldest first, into the output buffer until it
+ * reaches the high-water mark; returns how many, or -1.
+ */
+static int vmmgr_conn_flush_done(struct vmmgr_conn *conn) {
+    int flushed = 0;
+    while (conn->count > 0 && conn->started > 0 && vmmgr_conn_slot(conn, 0)->done && !vmmgr_conn_backlogged(conn)) {
+        struct vmmgr_slot *slot = vmmgr_conn_slot(conn, 0);
+        if (conn->out_len + slot->result_len > conn->out_cap) {
+            size_t capacity = conn->out_cap ? conn->out_cap : 65536u;
+            while (capacity < conn->out_len + slot->result_len) {
+                capacity *= 2u;
+            }
+            uint8_t *grown = realloc(conn->out, capacity);
+            if (!grown) {
+                return -1;
+            }
+            conn->out = grown;
+            conn->out_cap = capacity;
+        }
+        memcpy(conn->out + conn->out_len, slot->result, slot->result_len);
+        conn->out_len += slot->result_len;
+        vmmgr_slot_release(&conn->pool, slot);
+        conn->head = (conn->head + 1u) % VMMGR_CLIENT_QUEUE;
+        --conn->count;
+        --conn->started;
+        ++flushed;
+    }
+    return flushed;
+}
+
+/**
+ * Serves pipelined framed payloads on one connection until the peer hangs
+ * up and every reply is out. Runs in its own process so a slow client
+ * never holds up the accept loop.
+ *
+ * @param client Connected socket.
+ */
+static void vmmgr_serve_connection(int client) {
+    static struct vmmgr_conn conn;
+
+    memset(&conn, 0, sizeof(conn));
+    conn.client = client;
+    conn.pool.limit = 2u * vmmgr_parallel.client_cap < VMMGR_CLIENT_QUEUE ? 2u * vmmgr_parallel.client_cap : VMMGR_CLIENT_QUEUE;
+    for (unsigned i = 0; i < VMMGR_CLIENT_QUEUE; ++i) {
+        conn.slots[i].result_fd = -1;
+    }
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+
+    for (;;) {
+        /*
+         * Flushed replies free regions, which may unblock a stalled header.
+         * While the peer leaves too much unread, nothing new is taken in,
+         * started or queued, so a client that only writes gets back-pressure.
+         */
+        int flushed = 0;
+        while (!vmmgr_conn_backlogged(&conn)) {
+            vmmgr_conn_feed(&conn);
+
+            /* Start runners in request order; a slot still receiving its payload has to wait. */
+            while (conn.started < conn.count && conn.running < vmmgr_parallel.client_cap) {
+                struct vmmgr_slot *slot = vmmgr_conn_slot(&conn, conn.started);
+                if (conn.reading && conn.started == conn.count - 1u) {
+                    break;
+                }
+                if (!slot->done) {
+                    vmmgr_conn_start(&conn, slot);
+                }
+                ++conn.started;
+            }
+            flushed = vmmgr_conn_flush_done(&conn);
+            if (flushed <= 0) {
+                break;
+            }
+        }
+        if (flushed < 0) {
+            break;
+        }
+        if (conn.eof && conn.count == 0 && conn.out_sent == conn.out_len) {
+            break;
+        }
+
+        struct pollfd fds[1 + VMMGR_CLIENT_QUEUE];
+        struct vmmgr_slot *owners[1 + VMMGR_CLIENT_QUEUE];
+        nfds_t nfds = 1;
+        /* Input waits until vmmgr_conn_feed() has taken the last read. */
+        fds[0].events = (short)((!conn.eof && conn.in_end == 0 ? POLLIN : 0) |
+                                (conn.out_sent < conn.out_len ? POLLOUT : 0));
+        fds[0].fd = fds[0].events ? client : -1;
+        fds[0].revents = 0;
+        for (unsigned i = 0; i < conn.started; ++i) {
+            struct vmmgr_slot *slot = vmmgr_conn_slot(&conn, i);
+            if (slot->result_fd >= 0) {
+                fds[nfds].fd = slot->result_fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                owners[nfds++] = slot;
+            }
+        }
+        if (fds[0].events == 0 && nfds == 1) {
+            /* Nothing can make progress any more. */
+            break;
+        }
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (nfds_t i = 1; i < nfds; ++i) {
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                vmmgr_conn_collect(&conn, owners[i]);
+            }
+        }
+        if (fds[0].revents & POLLOUT) {
+            ssize_t sent = write(client, conn.out + conn.out_sent, conn.out_len - conn.out_sent);
+            if (sent < 0 && errno != EINTR && errno != EAGAIN) {
+                break;
+            }
+            if (sent > 0) {
+                /* Keep the unsent tail at the front so the buffer never outgrows the mark. */
+                conn.out_sent += (size_t)sent;
+                memmove(conn.out, conn.out + conn.out_sent, conn.out_len - conn.out_sent);
+                conn.out_len -= conn.out_sent;
+                conn.out_sent = 0;
+            }
+        }
+        if ((fds[0].events & POLLIN) && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t got = read(client, conn.in, sizeof(conn.in));
+            if (got > 0) {
+                conn.in_end = (size_t)got;
+            } else if (got == 0 || (errno != EINTR && errno != EAGAIN)) {
+                conn.eof = true;
+                /* A request cut off midway never gets a reply. */
+                if (conn.reading) {
+                    vmmgr_slot_release(&conn.pool, vmmgr_conn_slot(&conn, conn.count - 1u));
+                    --conn.count;
+                    conn.reading = false;
+                }
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < conn.count; ++i) {
+        vmmgr_slot_release(&conn.pool, vmmgr_conn_slot(&conn, i));
+    }
+    free(conn.out);
+}
+
+/** Prints the bait log flusher counters, if one runs. */
+static void vmmgr_report_log_queue(void) {
+    struct isol8r_log_stats stats;
+    if (isol8r_log_queue_stats(&vmmgr_bait_log, &stats) == 0) {
+        fprintf(stderr,
+                "[tiny_vmmgr] Log queue: %llu written, %llu dropped, %llu oversized, %llu coalesced, %llu fsyncs (%u slots).\n",
+                (unsigned long long)stats.written,
+                (unsigned long long)stats.dropped,
+                (unsigned long long)stats.direct,
+                (unsigned long long)stats.coalesced,
+                (unsigned long long)stats.fsyncs,
+                stats.capacity);
+    }
+}
+
+/**
+ * Listens on a unix socket and forks a handler per connection. Never
+ * returns; setup failures terminate the process.
+ *
+ * @param socket_path Filesystem path for the listening socket.
+ */
+static void vmmgr_serve(const char *socket_path) {
+    struct sockaddr_un addr;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[tiny_vmmgr] Socket path too long: %s\n", socket_path);
+        exit(VMMGR_EXIT_FAILURE);
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        perror("[tiny_vmmgr] socket");
+        exit(VMMGR_EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path) + 1);
+
+    unlink(socket_path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        perror("[tiny_vmmgr] bind");
+        exit(VMMGR_EXIT_FAILURE);
+    }
+
+    /* Connection handlers are fire-and-forget; let the kernel reap them. */
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* No SA_RESTART: SIGHUP has to break accept() so the reload is not left waiting. */
+    struct sigaction hup;
+    memset(&hup, 0, sizeof(hup));
+    hup.sa_handler = vmmgr_request_reload;
+    sigemptyset(&hup.sa_mask);
+    sigaction(SIGHUP, &hup, NULL);
+
+    /* Before any fork, so every handler and runner shares one lease table. */
+    vmmgr_load_parallel();
+    vmmgr_cache_open(true);
+
+    /* Started before any fork, so every handler pushes onto the same queue. */
+    if (isol8r_log_start_flusher(&vmmgr_bait_log, "tiny_vmmgr") < 0) {
+        fprintf(stderr, "[tiny_vmmgr] Warning: log flusher unavailable, logging synchronously: %s\n", strerror(errno));
+    }
+    fprintf(stderr, "[tiny_vmmgr] Fork server listening on %s\n", socket_path);
+
+    for (;;) {
+        if (vmmgr_reload_requested) {
+            vmmgr_reload_requested = 0;
+            /* The same signal tells us the bait log was rotated from outside. */
+            if (isol8r_log_reopen(&vmmgr_bait_log) != 0) {
+                fprintf(stderr, "[tiny_vmmgr] Warning: cannot reopen '%s': %s\n", vmmgr_bait_log.path, strerror(errno));
+            }
+            vmmgr_load_rules(true);
+            vmmgr_report_log_queue();
+        }
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("[tiny_vmmgr] accept");
+            exit(VMMGR_EXIT_FAILURE);
+        }
+
+        fflush(NULL);
+        pid_t handler = fork();
+        if (handler == 0) {
+            close(listener);
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGHUP, SIG_DFL);
+            vmmgr_serve_connection(client);
+            _exit(VMMGR_EXIT_SUCCESS);
+        }
+        if (handler < 0) {
+            perror("[tiny_vmmgr] fork");
+        }
+        close(client);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ *  BATCH MODE
+ * ---------------------------------------------------------------------------
+ *
+ *  tiny_vmmgr --batch takes every payload a snippet queued in one launch.
+ *  All integers are big-endian:
+ *
+ *    stdin:  u32 count | count x (u32 length | payload bytes)
+ *    stdout: u32 count | count x (u32 length | u32 kind | u32 code
+ *            | u32 detector | u32 matches | u32 duration_us
+ *            | u32 stdout_len | u32 stderr_len | stdout | stderr
+ *            | u32 telemetry_len | telemetry)
+ *
+ *  Payloads are inspected in this process; each accepted one executes in
+ *  its own forked child. Payloads that never ran (detector hit, empty or
+ *  oversized) come back as VMMGR_RESULT_REJECTED with code 1 and the same
+ *  output a one-shot run would have produced. detector is the index of the
+ *  detector acted on, or VMMGR_NO_DETECTOR; matches has bit i set for
+ *  every detector i that fired. telemetry is the same one-line JSON record
+ *  a one-shot run writes to ISOL8R_VMMGR_TELEMETRY_FD; mprotect happens in
+ *  the payload child here, so mprotect_ns is null and counted in execute_ns.
+ */
+
+/** A payload that passed inspection, handed to the child that runs it. */
+struct vmmgr_job {
+    struct shellcode_buffer buffer;
+    struct vmmgr_verdict verdict;
+};
+
+/** Payload child: execute an already inspected payload. */
+static void vmmgr_child_execute(void *ctx) {
+    struct vmmgr_job *job = ctx;
+    /* The payload must not reach the server's shared log queue or stats page, nor forge its runner's reply. */
+    isol8r_log_stop_flusher(&vmmgr_bait_log);
+    isol8r_stats_detach();
+    isol8r_cache_close(&vmmgr_verdict_cache);
+    if (vmmgr_runner_fd >= 0) {
+        close(vmmgr_runner_fd);
+        vmmgr_runner_fd = -1;
+    }
+    /* Nor the lease table: a forged owner pid would starve every later runner. */
+    if (vmmgr_parallel.leases) {
+        munmap(vmmgr_parallel.leases, sizeof(*vmmgr_parallel.leases));
+        vmmgr_parallel.leases = NULL;
+    }
+    vmmgr_print_banner();
+    vmmgr_execute_shellcode(&job->buffer, &job->verdict);
+    exit(VMMGR_EXIT_SUCCESS);
+}
+
+static void vmmgr_capture_append(struct vmmgr_capture *capture, const char *text) {
+    vmmgr_capture_put(capture, text, strlen(text));
+}
+
+static uint64_t vmmgr_monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+}
+
+/**
+ * Writes one result frame, shared by batch entries and server replies.
+ *
+ * @param fd          Destination descriptor.
+ * @param out         Captured stdout.
+ * @param err         Captured stderr.
+ * @param verdict     Inspection findings.
+ * @param telemetry   Closed record for the payload; appended after stderr.
+ * @param with_timing Include the batch-only duration_us field.
+ * @param elapsed_us  Value for duration_us.
+ * @return 0 on success, -1 on a write error.
+ */
+static int vmmgr_write_result(int fd,
+                              const struct vmmgr_capture *out,
+                              const struct vmmgr_capture *err,
+                              const struct vmmgr_verdict *verdict,
+                              const struct vmmgr_telemetry *telemetry,
+                              bool with_timing,
+                              uint64_t elapsed_us) {
+    char record[VMMGR_TELEMETRY_MAX];
+    const size_t record_len = vmmgr_telemetry_format(telemetry, record, sizeof(record));
+
+    uint8_t reply[40];
+    size_t used = 4;
+    vmmgr_put_be32(reply + used, telemetry->kind);
+    vmmgr_put_be32(reply + used + 4, telemetry->code);
+    vmmgr_put_be32(reply + used + 8, verdict->detector);
+    vmmgr_put_be32(reply + used + 12, verdict->matches);
+    used += 16;
+    if (with_timing) {
+        vmmgr_put_be32(reply + used, elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us);
+        used += 4;
+    }
+    vmmgr_put_be32(reply + used, (uint32_t)out->length);
+    vmmgr_put_be32(reply + used + 4, (uint32_t)err->length);
+    used += 8;
+
+    uint8_t trailer[4];
+    vmmgr_put_be32(trailer, (uint32_t)record_len);
+    vmmgr_put_be32(reply, (uint32_t)(used - 4 + out->length + err->length + sizeof(trailer) + record_len));
+    if (vmmgr_write_full(fd, reply, used) != 0 ||
+        vmmgr_write_full(fd, out->data, out->length) != 0 ||
+        vmmgr_write_full(fd, err->data, err->length) != 0 ||
+        vmmgr_write_full(fd, trailer, sizeof(trailer)) != 0 ||
+        vmmgr_write_full(fd, record, record_len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Inspects and runs one framed payload, for both batch entries and server
+ * requests. Inspection happens here, in place; only an accepted payload
+ * costs a fork, and the child runs its copy-on-write view of the same page.
+ *
+ * @param data    Payload at the start of a pooled region, which a child
+ *                executes in place; NULL if the payload was oversized.
+ * @param length  Payload length as sent.
+ * @param out       Captured stdout.
+ * @param err       Captured stderr.
+ * @param verdict   Receives the inspection findings (empty if never inspected).
+ * @param telemetry Record opened by the caller before reading the payload;
+ *                  receives the outcome (kind and code) and phase timings.
+ */
+static void vmmgr_process_one(uint8_t *data,
+                              size_t length,
+                              struct vmmgr_capture *out,
+                              struct vmmgr_capture *err,
+                              struct vmmgr_verdict *verdict,
+                              struct vmmgr_telemetry *telemetry) {
+    telemetry->bytes = length;
+    telemetry->mprotect_measured = false;
+    vmmgr_inspect(NULL, verdict);
+
+    if (!data) {
+        char message[96];
+        snprintf(message, sizeof(message), "[tiny_vmmgr] Payload exceeds %zu bytes. Please behave.\n", vmmgr_limits.max_payload);
+        vmmgr_capture_append(out, VMMGR_BANNER_TEXT);
+        vmmgr_capture_append(err, message);
+        telemetry->rejected = "payload too large";
+        vmmgr_stats_record(telemetry);
+        return;
+    }
+    if (length == 0) {
+        vmmgr_capture_append(out, VMMGR_BANNER_TEXT);
+        vmmgr_capture_append(err, "[tiny_vmmgr] Empty payload provided. Even no-ops deserve a byte.\n");
+        telemetry->rejected = "empty payload";
+        vmmgr_stats_record(telemetry);
+        return;
+    }
+
+    struct vmmgr_job job = {
+        .buffer = {
+            .data = data,
+            .length = length,
+            .map_length = vmmgr_limits.map_length,
+            .from_stdin = true,
+            .file_backed = false,
+        },
+    };
+
+    uint64_t mark = vmmgr_monotonic_ns();
+    vmmgr_inspect(&job.buffer, &job.verdict);
+    *verdict = job.verdict;
+    telemetry->inspect_ns = vmmgr_lap_ns(&mark);
+    telemetry->detector = verdict->detector;
+    telemetry->matches = verdict->matches;
+    isol8r_stage_mark(ISOL8R_STAGE_INSPECT);
+
+    if (verdict->detector != VMMGR_NO_DETECTOR) {
+        vmmgr_log_bait_event(verdict, &job.buffer);
+        isol8r_stage_mark(ISOL8R_STAGE_LOG);
+        vmmgr_capture_append(out, VMMGR_BANNER_TEXT);
+        vmmgr_capture_append(err, vmmgr_detector_message(verdict->detector));
+        vmmgr_capture_append(err, "\n");
+    } else {
+        if (vmmgr_fork_capture(vmmgr_child_execute,
+                               &job,
+                               NULL,
+                               0,
+                               out,
+                               err,
+                               &telemetry->kind,
+                               &telemetry->code,
+                               &telemetry->child) != 0) {
+            telemetry->kind = VMMGR_RESULT_EXITED;
+            telemetry->code = VMMGR_EXIT_FAILURE;
+            vmmgr_capture_append(err, "[tiny_vmmgr] Could not fork a payload child.\n");
+        }
+        telemetry->execute_ns = vmmgr_lap_ns(&mark);
+    }
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+    vmmgr_stats_record(telemetry);
+}
+
+/**
+ * Reads a batch from `in_fd` and writes one result frame per payload to
+ * `out_fd`.
+ *
+ * @return Process exit status: success once every result has been written.
+ */
+static int vmmgr_run_batch(int in_fd, int out_fd) {
+    vmmgr_cache_open(false);
+    struct vmmgr_region_pool pool = { .limit = 1 };
+    uint8_t *payload = vmmgr_pool_take(&pool);
+    static uint8_t out_buffer[VMMGR_CAPTURE_MAX];
+    static uint8_t err_buffer[VMMGR_CAPTURE_MAX];
+
+    signal(SIGPIPE, SIG_IGN);
+
+    uint8_t header[4];
+    if (vmmgr_read_full(in_fd, header, sizeof(header)) != 1) {
+        fprintf(stderr, "[tiny_vmmgr] Batch header missing. Count your payloads first.\n");
+        return VMMGR_EXIT_FAILURE;
+    }
+    const uint32_t count = vmmgr_get_be32(header);
+    if (count > VMMGR_BATCH_MAX) {
+        fprintf(stderr, "[tiny_vmmgr] Batch of %" PRIu32 " payloads exceeds %u. Pace yourself.\n", count, VMMGR_BATCH_MAX);
+        return VMMGR_EXIT_FAILURE;
+    }
+    if (vmmgr_write_full(out_fd, header, sizeof(header)) != 0) {
+        return VMMGR_EXIT_FAILURE;
+    }
+
+    for (uint32_t index = 0; index < count; ++index) {
+        struct vmmgr_telemetry telemetry;
+        vmmgr_telemetry_begin(&telemetry);
+        if (vmmgr_read_full(in_fd, header, sizeof(header)) != 1) {
+            fprintf(stderr, "[tiny_vmmgr] Batch truncated at payload %" PRIu32 ".\n", index);
+            return VMMGR_EXIT_FAILURE;
+        }
+        const uint32_t length = vmmgr_get_be32(header);
+
+        /* Same limit as vmmgr_read_shellcode(): a full buffer counts as too much. */
+        const bool oversized = length >= vmmgr_limits.max_payload;
+        size_t remaining = length;
+        if (!oversized && length > 0) {
+            if (vmmgr_read_full(in_fd, payload, length) != 1) {
+                fprintf(stderr, "[tiny_vmmgr] Batch truncated at payload %" PRIu32 ".\n", index);
+                return VMMGR_EXIT_FAILURE;
+            }
+            remaining = 0;
+        }
+        while (remaining > 0) {
+            uint8_t sink[4096];
+            size_t step = remaining < sizeof(sink) ? remaining : sizeof(sink);
+            if (vmmgr_read_full(in_fd, sink, step) != 1) {
+                fprintf(stderr, "[tiny_vmmgr] Batch truncated at payload %" PRIu32 ".\n", index);
+                return VMMGR_EXIT_FAILURE;
+            }
+            remaining -= step;
+        }
+        telemetry.read_ns = vmmgr_monotonic_ns() - telemetry.started_ns;
+        isol8r_stage_mark(ISOL8R_STAGE_READ);
+
+        struct vmmgr_capture out = { out_buffer, 0, -1 };
+        struct vmmgr_capture err = { err_buffer, 0, -1 };
+        struct vmmgr_verdict verdict;
+        const uint64_t started = vmmgr_monotonic_us();
+        vmmgr_process_one(oversized ? NULL : payload, length, &out, &err, &verdict, &telemetry);
+        const uint64_t elapsed = vmmgr_monotonic_us() - started;
+        vmmgr_pool_give(&pool, payload, oversized ? 0 : length);
+        payload = vmmgr_pool_take(&pool);
+
+        if (vmmgr_write_result(out_fd, &out, &err, &verdict, &telemetry, true, elapsed) != 0) {
+            return VMMGR_EXIT_FAILURE;
+        }
+    }
+    return VMMGR_EXIT_SUCCESS;
+}
+
+/**
+ * The one-shot pipeline: read, inspect, execute.
+ *
+ * @param fd Descriptor the shellcode is read from.
+ * @return Process exit status.
+ */
+static int vmmgr_run_payload(int fd) {
+    struct shellcode_buffer buffer = vmmgr_read_shellcode(fd);
+    vmmgr_telemetry.read_ns = vmmgr_monotonic_ns() - vmmgr_telemetry.started_ns - vmmgr_telemetry.map_ns;
+    vmmgr_telemetry.bytes = buffer.length;
+    isol8r_stage_mark(ISOL8R_STAGE_READ);
+
+    if (buffer.length == 0) {
+        fprintf(stderr, "[tiny_vmmgr] Empty payload provided. Even no-ops deserve a byte.\n");
+        vmmgr_release_buffer(&buffer);
+        vmmgr_telemetry.rejected = "empty payload";
+        vmmgr_telemetry_emit(VMMGR_RESULT_REJECTED, VMMGR_EXIT_FAILURE);
+        return VMMGR_EXIT_FAILURE;
+    }
+
+    struct vmmgr_verdict verdict;
+    if (!vmmgr_inspect_shellcode(&buffer, &verdict)) {
+        return VMMGR_EXIT_FAILURE;
+    }
+    isol8r_stage_mark(ISOL8R_STAGE_INSPECT);
+
+    vmmgr_execute_shellcode(&buffer, &verdict);
+    isol8r_stage_mark(ISOL8R_STAGE_EXECUTE);
+    return VMMGR_EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------
+ *  SCAN-ONLY REPLAY
+ * ---------------------------------------------------------------------------
+ *
+ *  tiny_vmmgr --scan-only CORPUS [BASELINE] feeds every payload in a corpus
+ *  to vmmgr_inspect() and nothing else: no region is mapped, nothing runs
+ *  and the bait log is left alone. isol8r_replay does the loading, timing
+ *  and baseline diff; payloads at or over the size limit are reported as
+ *  oversized, as the other modes would refuse them unread.
+ */
+
+static uint32_t vmmgr_replay_inspect(const uint8_t *data, size_t len, void *ctx) {
+    struct shellcode_buffer buffer = { .data = (uint8_t *)data, .length = len };
+    struct vmmgr_verdict verdict;
+    VMMGR_UNUSED(ctx);
+    vmmgr_inspect(&buffer, &verdict);
+    return verdict.matches;
+}
+
+static const char *vmmgr_replay_label(uint32_t detector, void *ctx) {
+    VMMGR_UNUSED(ctx);
+    return detector < vmmgr_detector_count ? vmmgr_detectors[detector].label : "unknown";
+}
+
+static int vmmgr_scan_only(const char *corpus, const char *baseline) {
+    const struct isol8r_replay replay = {
+        .program = "tiny_vmmgr",
+        .inspect = vmmgr_replay_inspect,
+        .label = vmmgr_replay_label,
+        .ctx = NULL,
+        .detector_count = (uint32_t)vmmgr_detector_count,
+        .max_payload = vmmgr_limits.max_payload,
+    };
+    return isol8r_replay_run(&replay, corpus, baseline);
+}
+
+/* ---------------------------------------------------------------------------
+ *  MAIN ENTRY POINT
+ * ---------------------------------------------------------------------------
+ */
+
+int main(int argc, char *argv[]) {
+    vmmgr_fast_start = vmmgr_env_flag("ISOL8R_FAST_START") &&
+                       (argc == 1 || (argc == 2 && strcmp(argv[1], VMMGR_BATCH_FLAG) != 0));
+
+    isol8r_stage_init("tiny_vmmgr");
+    if (!vmmgr_fast_start) {
+        isol8r_stats_init("tiny_vmmgr");
+    }
+    vmmgr_load_limits();
+    isol8r_budget_from_env(&vmmgr_budget, "ISOL8R_VMMGR", "tiny_vmmgr");
+    isol8r_rules_set_builtin(&isol8r_builtin_rules);
+    if (vmmgr_fast_start) {
+        vmmgr_use_detectors();
+    } else {
+        vmmgr_load_rules(false);
+    }
+    isol8r_log_from_env(&vmmgr_bait_log);
+    vmmgr_load_log_options();
+    if (isol8r_ring_from_env(&vmmgr_event_ring) != 0) {
+        fprintf(stderr, "[tiny_vmmgr] Warning: event ring unavailable: %s\n", strerror(errno));
+    }
+    if (argc == 3 && strcmp(argv[1], VMMGR_SERVER_FLAG) == 0) {
+        vmmgr_serve(argv[2]);
+    }
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], VMMGR_SCAN_ONLY_FLAG) == 0) {
+        return vmmgr_scan_only(argv[2], argc == 4 ? argv[3] : NULL);
+    }
+    if (argc == 2 && strcmp(argv[1], VMMGR_BATCH_FLAG) == 0) {
+        return vmmgr_run_batch(STDIN_FILENO, STDOUT_FILENO);
+    }
+
+    /* Always opened: the stats page counts one-shot runs with or without a telemetry fd. */
+    vmmgr_telemetry_begin(&vmmgr_telemetry);
+    vmmgr_telemetry_from_env();
+    if (!vmmgr_fast_start) {
+        vmmgr_print_banner();
+    }
+    return vmmgr_run_payload(vmmgr_open_input(argc, argv));
 }
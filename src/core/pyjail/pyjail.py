@@ -43,9 +43,12 @@ import contextlib
 import ctypes
 import dataclasses
 import io
+import json
 import logging
+import os
 import random
 import re
+import socket
 import subprocess
 import textwrap
 import threading
@@ -53,6 +56,11 @@ import time
 from pathlib import Path
 from typing import Dict, Iterable, List, Optional, Tuple, Type
 
+try:
+    from src.utils import isol8r_scan
+except ImportError:  # imported outside the app package; substring checks only
+    isol8r_scan = None  # type: ignore[assignment]
+
 _FAKE_FLAG_NAME_PATTERN = re.compile(r"fake[-_]?flag[-_]?(\d+)\.txt$", re.IGNORECASE)
 
 
@@ -107,6 +115,69 @@ def _pyjail_dir(*_args, **_kwargs) -> List[str]:
     return ["escape", "evade", "legacy_hook (removed or changed, probably)"]  # One of these maps to vm_escape()
 
 
+# ==============================================================================
+# Detector Rules
+# ==============================================================================
+
+# A bare word, or a "quoted" string (optionally i"..."), as in isol8r_rules.h.
+_RULE_TOKEN = re.compile(r'i?"(?:[^"\\]|\\.)*"|[^\s"]\S*')
+_RULE_ESCAPES = {"\\": "\\", '"': '"', "n": "\n", "r": "\r", "t": "\t", "0": "\0"}
+
+
+def _unescape_rule_text(text: str) -> str:
+    def replace(match: "re.Match[str]") -> str:
+        escape = match.group(1)
+        if escape.startswith("x"):
+            return chr(int(escape[1:], 16))
+        if escape not in _RULE_ESCAPES:
+            raise ValueError(f"unknown escape \\{escape}")
+        return _RULE_ESCAPES[escape]
+
+    return re.sub(r"\\(x[0-9a-fA-F]{2}|.)", replace, text)
+
+
+def _parse_rule_text(token: str) -> str:
+    """Label or message token: quoted strings are unescaped, bare words kept."""
+    if token.startswith('"'):
+        return _unescape_rule_text(token[1:-1])
+    return token
+
+
+def load_pyjail_rules(path: Path) -> List[Tuple[str, str]]:
+    """
+    Read the ``pyjail`` rules of a detector rules file, the same file the C
+    binaries compile, as ``(keyword, message)`` pairs in file order. Other
+    scopes are only checked for shape. Raises ``ValueError`` naming the line
+    on malformed input and ``OSError`` if the file cannot be read.
+    """
+    rules: List[Tuple[str, str]] = []
+    with open(path, encoding="utf-8") as handle:
+        for line_no, line in enumerate(handle, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            tokens = _RULE_TOKEN.findall(line)
+            if _RULE_TOKEN.sub("", line).strip():
+                raise ValueError(f"{path}:{line_no}: malformed line")
+            if len(tokens) < 3 or len(tokens) > 5:
+                raise ValueError(f"{path}:{line_no}: want <scope> <severity> <pattern> [<label> [<message>]]")
+            scope, severity, pattern = tokens[:3]
+            if scope not in ("echo", "vmmgr", "pyjail"):
+                raise ValueError(f"{path}:{line_no}: unknown scope {scope!r}")
+            if severity not in ("low", "medium", "high"):
+                raise ValueError(f"{path}:{line_no}: unknown severity {severity!r}")
+            if scope != "pyjail":
+                continue
+            if pattern.startswith(('"', 'i"')):
+                keyword = _unescape_rule_text(pattern[pattern.index('"') + 1:-1])
+            else:
+                raise ValueError(f"{path}:{line_no}: pyjail patterns must be quoted text")
+            message = _parse_rule_text(tokens[4]) if len(tokens) == 5 else ""
+            if keyword:
+                rules.append((keyword, message))
+    return rules
+
+
 # ==============================================================================
 # Timeout Guard
 # ==============================================================================
@@ -258,7 +329,24 @@ class PythonJail:
 
     DEFAULT_TIMEOUT: float = 2.5
     VM_PAYLOAD_LIMIT: int = 4096
+    # Backstop only: tiny_vmmgr ends payloads itself once they exhaust its
+    # CPU or wall-clock budget (ISOL8R_VMMGR_CPU_MS / ISOL8R_VMMGR_WALL_MS).
+    VM_PAYLOAD_TIMEOUT: float = 3.0
+    # Set by the entrypoint when ``tiny_vmmgr --server`` is up; forking a warm
+    # parent beats exec'ing a fresh binary for every vm_escape payload.
+    VMMGR_SOCKET_ENV: str = "ISOL8R_VMMGR_SOCKET"
+    # tiny_vmmgr's runtime payload limit; honoured here too so larger staged
+    # payloads are not refused before the binary ever sees them.
+    VMMGR_MAX_SIZE_ENV: str = "ISOL8R_VMMGR_MAX_SIZE"
+    # Descriptor a one-shot tiny_vmmgr writes its JSON telemetry record to.
+    VMMGR_TELEMETRY_FD_ENV: str = "ISOL8R_VMMGR_TELEMETRY_FD"
+    # Shared detector rules file; its pyjail scope replaces the list below.
+    # "none" keeps the built-in list. Reread whenever the file changes,
+    # looking at most once per RULES_RECHECK_SECONDS.
+    RULES_ENV: str = "ISOL8R_RULES"
+    RULES_RECHECK_SECONDS: float = 1.0
     # Pretend we patched this list after a deeply scientific incident review.
+    # Also the fallback when the rules file is missing or malformed.
     DEFAULT_BANNED_KEYWORDS: Tuple[str, ...] = (
         "import",
         "from",
@@ -370,8 +458,13 @@ class PythonJail:
         self._logger = logging.getLogger("isol8r.pyjail")
         self._log_error_reported = False
         self._fake_flag_error_reported = False
-        provided_keywords = tuple(banned_keywords) if banned_keywords else ()
-        self.banned_keywords = tuple(sorted(set(self.DEFAULT_BANNED_KEYWORDS + provided_keywords)))
+        self._provided_keywords = tuple(banned_keywords) if banned_keywords else ()
+        self._rules_stamp: Optional[Tuple[int, int, int]] = None
+        self._rules_checked_at = float("-inf")
+        self.rule_messages: Dict[str, str] = {}
+        self._keyword_screen: Tuple[Tuple[str, ...], object] = ((), None)
+        self._set_banned_keywords(self.DEFAULT_BANNED_KEYWORDS)
+        self._refresh_rules()
         self._ensure_paths()
 
     # ------------------------------------------------------------------ setup --
@@ -485,13 +578,71 @@ class PythonJail:
 
     # --------------------------------------------------------------- analysis --
 
+    def _rules_path(self) -> Optional[Path]:
+        configured = os.environ.get(self.RULES_ENV, "").strip()
+        if configured == "none":
+            return None
+        return Path(configured) if configured else self.project_root / "config" / "isol8r_rules.conf"
+
+    def _refresh_rules(self) -> None:
+        """
+        Pick up the rules file's pyjail keywords if it changed since the last
+        look. A missing file restores the built-in list, a malformed one is
+        reported and the keywords in force are kept.
+        """
+        now = time.monotonic()
+        if now - self._rules_checked_at < self.RULES_RECHECK_SECONDS:
+            return
+        self._rules_checked_at = now
+        path = self._rules_path()
+        try:
+            info = path.stat() if path else None
+        except OSError:
+            info = None
+        stamp = (info.st_size, info.st_mtime_ns, info.st_ino) if info else None
+        if stamp == self._rules_stamp:
+            return
+        self._rules_stamp = stamp
+
+        rules: List[Tuple[str, str]] = []
+        if path and info:
+            try:
+                rules = load_pyjail_rules(path)
+            except (OSError, ValueError) as exc:
+                self._logger.warning("Keeping current banned keywords; rules not loaded: %s", exc)
+                return
+        self._set_banned_keywords(tuple(keyword for keyword, _ in rules) or self.DEFAULT_BANNED_KEYWORDS)
+        self.rule_messages = {keyword: message for keyword, message in rules if message}
+
+    def _set_banned_keywords(self, keywords: Tuple[str, ...]) -> None:
+        """
+        Install a keyword list and compile it for libisol8r_scan, the matcher
+        the C binaries use, when the library is built. Matching lowercased
+        keywords against lowercased code keeps the verdicts identical to the
+        substring fallback.
+        """
+        banned = tuple(sorted(set(keywords + self._provided_keywords)))
+        screen = None
+        if isol8r_scan is not None and isol8r_scan.available() and banned:
+            try:
+                screen = isol8r_scan.KeywordScreen([keyword.lower() for keyword in banned])
+            except ValueError as exc:
+                self._logger.warning("Keyword screen unavailable, using substring checks: %s", exc)
+        # One assignment, so a concurrent check never pairs a screen with another list.
+        self._keyword_screen = (banned, screen)
+        self.banned_keywords = banned
+
     def check_banned_keywords(self, code: str) -> Tuple[str, ...]:
         """
         Inspect the provided code for banned keywords. The check is intentionally
         low-tech (basic substring matching) to lure creative bypass attempts.
         Returns a tuple of keywords that were observed.
         """
+        self._refresh_rules()
         normalized = code.lower()
+        banned, screen = self._keyword_screen
+        if screen is not None:
+            return tuple(banned[index] for index in screen.hit_indices(normalized))
         matches: List[str] = []
         for keyword in self.banned_keywords:
             if keyword.lower() in normalized:
@@ -596,10 +747,30 @@ class PythonJail:
 
         if not data:
             raise ValueError("vm_escape payload must not be empty (hint: ever tried fuzzing directories?)")
-        if len(data) > self.VM_PAYLOAD_LIMIT:
-            raise ValueError(f"vm_escape payload exceeds {self.VM_PAYLOAD_LIMIT} bytes")
+        limit = self._vm_payload_limit()
+        if len(data) > limit:
+            raise ValueError(f"vm_escape payload exceeds {limit} bytes")
         return data
 
+    def _vm_payload_limit(self) -> int:
+        """
+        Largest payload tiny_vmmgr will accept. ``ISOL8R_VMMGR_MAX_SIZE``
+        (bytes, optional k/m suffix) says payloads must be *smaller* than the
+        value, exactly as the binary parses it; anything unparsable leaves
+        the default in place, as the binary does.
+        """
+        raw = os.environ.get(self.VMMGR_MAX_SIZE_ENV, "").strip()
+        if not raw:
+            return self.VM_PAYLOAD_LIMIT
+        scale = {"k": 1024, "m": 1024 * 1024}.get(raw[-1].lower(), 1)
+        digits = raw[:-1] if scale != 1 else raw
+        if not digits.isdigit():
+            return self.VM_PAYLOAD_LIMIT
+        value = int(digits) * scale
+        if not 2 <= value <= 64 * 1024 * 1024:
+            return self.VM_PAYLOAD_LIMIT
+        return value - 1
+
     def _compile_snippet(self, code: str):
         """
         Compile the snippet to bytecode. We use :func:`compile` with the `exec`
@@ -611,8 +782,9 @@ class PythonJail:
     def _launch_vm_payloads(self, payloads: List[bytes]) -> List[Dict[str, object]]:
         """
         Execute queued payloads through the tiny VM harness and capture results.
-        Each payload is written to tiny_vmmgr via stdin with a strict timeout
-        to prevent runaway shellcode from stalling the web tier.
+        Each payload is written to tiny_vmmgr via stdin. The binary enforces
+        its own CPU, wall-clock and output budgets, so runaway shellcode comes
+        back within milliseconds; the timeout here only guards the binary.
         """
         results: List[Dict[str, object]] = []
         if not payloads:
@@ -634,20 +806,53 @@ class PythonJail:
                 )
             return results
 
-        for payload in payloads:
-            start = time.monotonic()
+        server_socket = os.environ.get(self.VMMGR_SOCKET_ENV) or None
+        if server_socket is None and len(payloads) > 1:
+            batch_results = self._run_vm_batch(binary_path, payloads)
+            if batch_results is not None:
+                return batch_results
+
+        if server_socket is not None:
+            conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            conn.settimeout(self.VM_PAYLOAD_TIMEOUT)
             try:
-                proc = subprocess.Popen(
-                    [str(binary_path)],
-                    stdin=subprocess.PIPE,
-                    stdout=subprocess.PIPE,
-                    stderr=subprocess.PIPE,
-                    cwd=str(self.project_root),
+                conn.connect(server_socket)
+            except OSError as exc:
+                conn.close()
+                self.log_attempt(
+                    "WARN", f"tiny_vmmgr server at {server_socket} unavailable ({exc}); spawning instead"
                 )
-                stdout_bytes, stderr_bytes = proc.communicate(payload, timeout=6.0)
+            else:
+                # Past this point the server may already have run a payload;
+                # spawning it again would run and log it twice.
+                with conn:
+                    self._run_vm_payloads_via_server(conn, payloads, results)
+                return results
+
+        for payload in payloads[len(results):]:
+            start = time.monotonic()
+            telemetry: Optional[Dict[str, object]] = None
+            telemetry_read, telemetry_write = os.pipe()
+            try:
+                try:
+                    proc = subprocess.Popen(
+                        [str(binary_path)],
+                        stdin=subprocess.PIPE,
+                        stdout=subprocess.PIPE,
+                        stderr=subprocess.PIPE,
+                        cwd=str(self.project_root),
+                        pass_fds=(telemetry_write,),
+                        env={**os.environ, self.VMMGR_TELEMETRY_FD_ENV: str(telemetry_write)},
+                    )
+                finally:
+                    os.close(telemetry_write)
+                stdout_bytes, stderr_bytes = proc.communicate(payload, timeout=self.VM_PAYLOAD_TIMEOUT)
                 returncode = proc.returncode
+                telemetry = self._parse_telemetry(self._drain_fd(telemetry_read))
                 duration = time.monotonic() - start
                 error_message = None if returncode == 0 else f"tiny_vmmgr exited with code {returncode}"
+                if telemetry is not None:
+                    duration, error_message = self._telemetry_outcome(telemetry, duration, error_message)
                 log_level = "INFO" if error_message is None else "WARN"
                 self.log_attempt(log_level, f"tiny_vmmgr run rc={returncode} bytes={len(payload)} duration={duration:.3f}s")
             except subprocess.TimeoutExpired:
@@ -671,21 +876,282 @@ class PythonJail:
                 returncode = None
                 error_message = f"tiny_vmmgr execution failed: {exc}"
                 self.log_attempt("WARN", error_message)
+            finally:
+                os.close(telemetry_read)
 
             stdout_text = stdout_bytes.decode("utf-8", "replace")
             stderr_text = stderr_bytes.decode("utf-8", "replace")
 
+            result: Dict[str, object] = {
+                "stdout": stdout_text,
+                "stderr": stderr_text,
+                "returncode": returncode,
+                "duration": duration,
+                "error": error_message,
+            }
+            if telemetry is not None:
+                result["telemetry"] = telemetry
+            results.append(result)
+
+        return results
+
+    def _run_vm_batch(self, binary_path: Path, payloads: List[bytes]) -> Optional[List[Dict[str, object]]]:
+        """
+        Run every queued payload through a single ``tiny_vmmgr --batch``
+        launch: one process inspects them all and forks a child per accepted
+        payload. Returns ``None`` only if the process could not be started, in
+        which case the caller runs the payloads one at a time instead; once
+        the payloads have been handed over, any result the batch did not
+        deliver comes back as an error entry rather than being run again.
+        """
+        frame = bytearray(len(payloads).to_bytes(4, "big"))
+        for payload in payloads:
+            frame += len(payload).to_bytes(4, "big") + payload
+
+        start = time.monotonic()
+        try:
+            proc = subprocess.Popen(
+                [str(binary_path), "--batch"],
+                stdin=subprocess.PIPE,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.PIPE,
+                cwd=str(self.project_root),
+            )
+        except OSError as exc:
+            self.log_attempt("WARN", f"tiny_vmmgr batch failed to start: {exc}")
+            return None
+
+        failure: Optional[str] = None
+        try:
+            stdout_bytes, stderr_bytes = proc.communicate(
+                bytes(frame), timeout=self.VM_PAYLOAD_TIMEOUT * len(payloads)
+            )
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            stdout_bytes, stderr_bytes = proc.communicate()
+            failure = "tiny_vmmgr batch timed out before this payload finished."
+        except OSError as exc:
+            proc.kill()
+            proc.wait()
+            stdout_bytes, stderr_bytes = b"", b""
+            failure = f"tiny_vmmgr batch failed: {exc}"
+        if failure is None and proc.returncode != 0:
+            detail = stderr_bytes.decode("utf-8", "replace").strip() or f"exit code {proc.returncode}"
+            failure = f"tiny_vmmgr batch failed: {detail}"
+
+        def field(offset: int) -> int:
+            return int.from_bytes(stdout_bytes[offset:offset + 4], "big")
+
+        results: List[Dict[str, object]] = []
+        offset = 4
+        count = field(0) if len(stdout_bytes) >= 4 else 0
+        for payload in payloads[:count]:
+            length = field(offset)
+            body = offset + 4
+            if length < 28 or body + length > len(stdout_bytes):
+                break
+            kind, code, detector, matches, duration_us, out_len, err_len = (field(body + i) for i in range(0, 28, 4))
+            out_start = body + 28
+            stdout_text = stdout_bytes[out_start:out_start + out_len].decode("utf-8", "replace")
+            stderr_text = stdout_bytes[out_start + out_len:out_start + out_len + err_len].decode("utf-8", "replace")
+            telemetry = self._frame_telemetry(stdout_bytes[out_start + out_len + err_len:body + length])
+            offset = body + length
+            duration = duration_us / 1_000_000
+
+            if kind == 2:
+                returncode: Optional[int] = code or -9
+                error_message: Optional[str] = "tiny_vmmgr timed out while executing payload."
+                if telemetry is not None:
+                    duration, error_message = self._telemetry_outcome(telemetry, duration, error_message)
+                self.log_attempt("WARN", f"tiny_vmmgr timeout after {duration:.3f}s bytes={len(payload)}")
+            else:
+                returncode = -code if kind == 1 else code
+                error_message = None if returncode == 0 else f"tiny_vmmgr exited with code {returncode}"
+                if telemetry is not None:
+                    duration, error_message = self._telemetry_outcome(telemetry, duration, error_message)
+                log_level = "INFO" if error_message is None else "WARN"
+                self.log_attempt(log_level, f"tiny_vmmgr run rc={returncode} bytes={len(payload)} duration={duration:.3f}s")
+
+            result: Dict[str, object] = {
+                "stdout": stdout_text,
+                "stderr": stderr_text,
+                "returncode": returncode,
+                "duration": duration,
+                "error": error_message,
+                **self._detector_fields(detector, matches),
+            }
+            if telemetry is not None:
+                result["telemetry"] = telemetry
+            results.append(result)
+
+        elapsed = time.monotonic() - start
+        if len(results) < len(payloads):
+            # The payloads were handed over and may have run; never run them twice.
+            message = failure or "tiny_vmmgr batch reply was truncated."
+            self.log_attempt(
+                "WARN", f"tiny_vmmgr batch returned {len(results)} of {len(payloads)} results: {message}"
+            )
+            while len(results) < len(payloads):
+                results.append(
+                    {
+                        "stdout": "",
+                        "stderr": stderr_bytes.decode("utf-8", "replace"),
+                        "returncode": proc.returncode,
+                        "duration": elapsed,
+                        "error": message,
+                    }
+                )
+            return results
+        self.log_attempt("INFO", f"tiny_vmmgr batch of {len(payloads)} completed in {elapsed:.3f}s")
+        return results
+
+    def _run_vm_payloads_via_server(
+        self, conn: socket.socket, payloads: List[bytes], results: List[Dict[str, object]]
+    ) -> None:
+        """
+        Hand payloads to the ``tiny_vmmgr --server`` fork server over the
+        connected socket ``conn`` and translate its replies into the same
+        shape the spawning path produces. Every payload is sent up front, so
+        the server runs them in parallel; replies arrive in submission order
+        and are appended to ``results`` as they do. Any payload in flight may
+        already have run, so if the exchange fails part way (a timeout or a
+        dropped connection, while sending or receiving) every reply still
+        missing is filled in as an error; the caller must not run it again.
+        """
+        start = time.monotonic()
+        try:
+            conn.sendall(b"".join(len(payload).to_bytes(4, "big") + payload for payload in payloads))
+            for payload in payloads:
+                length = int.from_bytes(self._recv_exact(conn, 4), "big")
+                body = self._recv_exact(conn, length)
+                results.append(self._server_result(body, payload, time.monotonic() - start))
+                start = time.monotonic()
+        except socket.timeout:
+            duration = time.monotonic() - start
+            message = "tiny_vmmgr timed out while executing payload."
+            self.log_attempt(
+                "WARN", f"tiny_vmmgr timeout after {duration:.3f}s bytes={len(payloads[len(results)])}"
+            )
+            stderr = ""
+        except OSError as exc:
+            duration = time.monotonic() - start
+            message = f"tiny_vmmgr server connection failed: {exc}"
+            self.log_attempt("WARN", message)
+            stderr = message
+        else:
+            return
+        # Later replies would queue up behind the missing one; fail them all.
+        while len(results) < len(payloads):
             results.append(
                 {
-                    "stdout": stdout_text,
-                    "stderr": stderr_text,
-                    "returncode": returncode,
+                    "stdout": "",
+                    "stderr": stderr,
+                    "returncode": None,
                     "duration": duration,
-                    "error": error_message,
+                    "error": message,
                 }
             )
 
-        return results
+    def _server_result(self, body: bytes, payload: bytes, duration: float) -> Dict[str, object]:
+        """Translate one server reply frame (length prefix stripped)."""
+        kind, code, detector, matches, out_len, err_len = (int.from_bytes(body[i:i + 4], "big") for i in range(0, 24, 4))
+        stdout_bytes = body[24:24 + out_len]
+        stderr_bytes = body[24 + out_len:24 + out_len + err_len]
+        telemetry = self._frame_telemetry(body[24 + out_len + err_len:])
+
+        if kind == 2:
+            returncode: Optional[int] = code or -9
+            error_message: Optional[str] = "tiny_vmmgr timed out while executing payload."
+            if telemetry is not None:
+                duration, error_message = self._telemetry_outcome(telemetry, duration, error_message)
+            self.log_attempt("WARN", f"tiny_vmmgr timeout after {duration:.3f}s bytes={len(payload)}")
+        else:
+            returncode = -code if kind == 1 else code
+            error_message = None if returncode == 0 else f"tiny_vmmgr exited with code {returncode}"
+            if telemetry is not None:
+                duration, error_message = self._telemetry_outcome(telemetry, duration, error_message)
+            log_level = "INFO" if error_message is None else "WARN"
+            self.log_attempt(log_level, f"tiny_vmmgr run rc={returncode} bytes={len(payload)} duration={duration:.3f}s")
+
+        result: Dict[str, object] = {
+            "stdout": stdout_bytes.decode("utf-8", "replace"),
+            "stderr": stderr_bytes.decode("utf-8", "replace"),
+            "returncode": returncode,
+            "duration": duration,
+            "error": error_message,
+            **self._detector_fields(detector, matches),
+        }
+        if telemetry is not None:
+            result["telemetry"] = telemetry
+        return result
+
+    @staticmethod
+    def _detector_fields(detector: int, matches: int) -> Dict[str, object]:
+        """
+        Decode the detector fields of a batch or server result frame: the
+        detector acted on (``None`` if nothing fired) and every one that fired.
+        """
+        return {
+            "detector": None if detector == 0xFFFFFFFF else detector,
+            "matches": [bit for bit in range(32) if matches >> bit & 1],
+        }
+
+    @staticmethod
+    def _parse_telemetry(raw: bytes) -> Optional[Dict[str, object]]:
+        """
+        Decode a tiny_vmmgr telemetry record (one JSON object); ``None`` if
+        the binary wrote nothing usable.
+        """
+        try:
+            record = json.loads(raw.decode("utf-8"))
+        except ValueError:
+            return None
+        return record if isinstance(record, dict) else None
+
+    @classmethod
+    def _frame_telemetry(cls, trailer: bytes) -> Optional[Dict[str, object]]:
+        """Decode the optional ``u32 length | record`` tail of a result frame."""
+        if len(trailer) < 4:
+            return None
+        length = int.from_bytes(trailer[:4], "big")
+        return cls._parse_telemetry(trailer[4:4 + length])
+
+    @staticmethod
+    def _telemetry_outcome(
+        telemetry: Dict[str, object], duration: float, error_message: Optional[str]
+    ) -> Tuple[float, Optional[str]]:
+        """
+        Prefer the binary's own account of a run: its wall time and error
+        string, falling back to what the caller measured.
+        """
+        wall_ns = telemetry.get("wall_ns")
+        if isinstance(wall_ns, int):
+            duration = wall_ns / 1_000_000_000
+        if "error" in telemetry:
+            error = telemetry["error"]
+            error_message = error if isinstance(error, str) else None
+        return duration, error_message
+
+    @staticmethod
+    def _drain_fd(fd: int) -> bytes:
+        chunks: List[bytes] = []
+        while True:
+            chunk = os.read(fd, 4096)
+            if not chunk:
+                return b"".join(chunks)
+            chunks.append(chunk)
+
+    @staticmethod
+    def _recv_exact(conn: socket.socket, count: int) -> bytes:
+        chunks: List[bytes] = []
+        remaining = count
+        while remaining:
+            chunk = conn.recv(remaining)
+            if not chunk:
+                raise ConnectionResetError("tiny_vmmgr server closed the connection")
+            chunks.append(chunk)
+            remaining -= len(chunk)
+        return b"".join(chunks)
 
     def execute_code(self, code: str) -> ExecutionResult:
         """
@@ -710,7 +1176,9 @@ class PythonJail:
             else:
                 log_payload = sanitized_code[:157] + "..."
             self.log_attempt("BAIT", f"User attempted {log_payload!r}")
-            honeypot_comment = self.KEYWORD_HONEYPOTS.get(keyword_hits[0], "Keyword violation detected.")
+            honeypot_comment = self.rule_messages.get(keyword_hits[0]) or self.KEYWORD_HONEYPOTS.get(
+                keyword_hits[0], "Keyword violation detected."
+            )
             honeypot_banner = f"{honeypot_comment} Fake flag dispensed for archival joy."
             self.drop_fake_flag()
             violation = JailViolation(
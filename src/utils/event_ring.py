@@ -0,0 +1,217 @@
+"""
+Reader for the optional mmap bait event ring (``ISOL8R_EVENT_RING``).
+
+The C writers in ``src/core/libisol8r/isol8r_ring.c`` drop fixed 128-byte
+records into a file-backed ring instead of formatting text, so this module
+never has to parse anything: it maps the file read-only, walks the last
+``capacity`` sequence numbers and keeps the slots whose sequence still
+matches. Records that were overwritten or are mid-write are skipped, not
+guessed at.
+
+Usage::
+
+    python -m src.utils.event_ring [PATH] [--json] [--follow] [--limit N]
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import mmap
+import os
+import struct
+import sys
+import time
+from dataclasses import asdict, dataclass
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Iterator, List, Optional, Tuple
+
+BASE_DIR = Path(__file__).resolve().parent.parent
+DEFAULT_RING_PATH = BASE_DIR.parent / "logs" / "bait.ring"
+
+RING_MAGIC = b"I8RRING1"
+RING_VERSION = 1
+
+# Native byte order, no padding: mirrors struct isol8r_ring_header/record.
+_HEADER = struct.Struct("=8sIIIIQ32x")
+_RECORD = struct.Struct("=QQQIHHHH12s80s")
+_HEAD_OFFSET = 24
+
+NO_PATTERN = 0xFFFFFFFF
+FLAG_TRUNCATED = 0x1
+FLAG_BINARY = 0x2
+
+SOURCES = {0: "unknown", 1: "echo", 2: "vmmgr", 3: "pyjail", 4: "app"}
+
+
+class RingFormatError(Exception):
+    """Raised when the file is not a ring this reader understands."""
+
+
+@dataclass
+class RingEvent:
+    seq: int
+    timestamp: str
+    source: str
+    tag: str
+    pattern_id: Optional[int]
+    payload_length: int
+    truncated: bool
+    preview: str
+
+    def as_text(self) -> str:
+        pattern = "-" if self.pattern_id is None else str(self.pattern_id)
+        more = "..." if self.truncated else ""
+        return (
+            f"{self.timestamp} #{self.seq} {self.source}/{self.tag} "
+            f"pattern={pattern} length={self.payload_length} | {self.preview}{more}"
+        )
+
+
+def _format_timestamp(timestamp_ns: int) -> str:
+    seconds, nanos = divmod(timestamp_ns, 1_000_000_000)
+    stamp = datetime.fromtimestamp(seconds, tz=timezone.utc)
+    return stamp.strftime("%Y-%m-%dT%H:%M:%S") + f".{nanos // 1_000_000:03d}Z"
+
+
+def _decode_preview(raw: bytes, flags: int) -> str:
+    if flags & FLAG_BINARY:
+        return raw.hex(" ")
+    return raw.decode("utf-8", errors="backslashreplace")
+
+
+class EventRing:
+    """A read-only view of a ring file."""
+
+    def __init__(self, path: Path) -> None:
+        self.path = Path(path)
+        with self.path.open("rb") as handle:
+            self._map = mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ)
+        if len(self._map) < _HEADER.size:
+            self._map.close()
+            raise RingFormatError(f"{self.path} is too small to be an event ring")
+
+        magic, version, record_size, capacity, _reserved, _head = _HEADER.unpack_from(self._map, 0)
+        if magic != RING_MAGIC or version != RING_VERSION or record_size != _RECORD.size:
+            self._map.close()
+            raise RingFormatError(f"{self.path} is not a version {RING_VERSION} event ring")
+        if capacity == 0 or len(self._map) < _HEADER.size + capacity * _RECORD.size:
+            self._map.close()
+            raise RingFormatError(f"{self.path} is truncated")
+        self.capacity = capacity
+
+    def close(self) -> None:
+        self._map.close()
+
+    def __enter__(self) -> "EventRing":
+        return self
+
+    def __exit__(self, *_exc: object) -> None:
+        self.close()
+
+    def head(self) -> int:
+        """Next sequence number the writers will hand out."""
+        return struct.unpack_from("=Q", self._map, _HEAD_OFFSET)[0]
+
+    def _read_slot(self, seq: int) -> Optional[RingEvent]:
+        offset = _HEADER.size + (seq % self.capacity) * _RECORD.size
+        raw = self._map[offset:offset + _RECORD.size]
+        again = struct.unpack_from("=Q", self._map, offset)[0]
+        fields = _RECORD.unpack(raw)
+        stored_seq = fields[0]
+        if stored_seq != seq + 1 or again != stored_seq:
+            return None
+
+        (_, timestamp_ns, payload_length, pattern_id, source, flags,
+         preview_length, _reserved, tag, preview) = fields
+        return RingEvent(
+            seq=seq,
+            timestamp=_format_timestamp(timestamp_ns),
+            source=SOURCES.get(source, str(source)),
+            tag=tag.rstrip(b"\0").decode("ascii", errors="replace"),
+            pattern_id=None if pattern_id == NO_PATTERN else pattern_id,
+            payload_length=payload_length,
+            truncated=bool(flags & FLAG_TRUNCATED),
+            preview=_decode_preview(preview[:preview_length], flags),
+        )
+
+    def read(self, start: Optional[int] = None) -> Tuple[List[RingEvent], int, int]:
+        """
+        Returns ``(events, next_seq, dropped)``: every intact record from
+        ``start`` (default: the oldest still in the ring) up to the head,
+        where to resume, and how many records were lost to wrap-around.
+        """
+        head = self.head()
+        oldest = max(0, head - self.capacity)
+        if start is None or start < oldest:
+            dropped = 0 if start is None else oldest - start
+            start = oldest
+        else:
+            dropped = 0
+
+        events = []
+        for seq in range(start, head):
+            event = self._read_slot(seq)
+            if event is not None:
+                events.append(event)
+        return events, head, dropped
+
+
+def default_ring_path() -> Path:
+    return Path(os.environ.get("ISOL8R_EVENT_RING") or DEFAULT_RING_PATH)
+
+
+def iter_events(path: Optional[Path] = None) -> Iterator[RingEvent]:
+    """Convenience generator over the current contents of a ring."""
+    with EventRing(path or default_ring_path()) as ring:
+        events, _, _ = ring.read()
+    yield from events
+
+
+def _emit(event: RingEvent, as_json: bool) -> None:
+    if as_json:
+        print(json.dumps(asdict(event), ensure_ascii=False))
+    else:
+        print(event.as_text())
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    parser = argparse.ArgumentParser(description="Dump the isol8r bait event ring.")
+    parser.add_argument("path", nargs="?", type=Path, default=None, help="ring file (default: $ISOL8R_EVENT_RING)")
+    parser.add_argument("--json", action="store_true", help="one JSON object per line")
+    parser.add_argument("--follow", "-f", action="store_true", help="keep printing new events")
+    parser.add_argument("--limit", "-n", type=int, default=0, help="only the last N events")
+    parser.add_argument("--interval", type=float, default=0.5, help="poll interval for --follow, seconds")
+    args = parser.parse_args(argv)
+
+    path = args.path or default_ring_path()
+    try:
+        ring = EventRing(path)
+    except (OSError, RingFormatError) as exc:
+        print(f"event_ring: {exc}", file=sys.stderr)
+        return 1
+
+    with ring:
+        events, next_seq, _ = ring.read()
+        if args.limit > 0:
+            events = events[-args.limit:]
+        for event in events:
+            _emit(event, args.json)
+        sys.stdout.flush()
+
+        while args.follow:
+            time.sleep(args.interval)
+            events, next_seq, dropped = ring.read(next_seq)
+            if dropped:
+                print(f"event_ring: {dropped} events overwritten before they were read", file=sys.stderr)
+            for event in events:
+                _emit(event, args.json)
+            sys.stdout.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(130)
@@ -0,0 +1,154 @@
+"""
+ctypes binding for ``libisol8r_scan.so``, the matcher the C binaries link.
+
+The Dockerfile builds the library from ``src/core/libisol8r`` next to the
+static archive both binaries use, so Python screens text with the same
+Aho-Corasick automaton: every keyword in one pass over the input instead
+of one substring search per keyword. ``ISOL8R_SCAN_LIB`` points at a
+different build. When no library loads, :func:`available` is false and
+callers keep their pure-Python path; nothing here raises on import.
+
+Usage::
+
+    screen = KeywordScreen(["import", "os"])
+    screen.scan("import os")   # -> ("import", "os")
+"""
+from __future__ import annotations
+
+import ctypes
+import os
+import threading
+from pathlib import Path
+from typing import Optional, Sequence, Tuple
+
+BASE_DIR = Path(__file__).resolve().parent.parent
+DEFAULT_LIBRARY_PATH = BASE_DIR / "core" / "libisol8r" / "libisol8r_scan.so"
+LIBRARY_ENV = "ISOL8R_SCAN_LIB"
+
+# Mirrors isol8r_screen.h / isol8r_match.h.
+SCREEN_ABI = 1
+MATCH_NOCASE = 0x1
+MAX_KEYWORD = 256
+
+_library: Optional[ctypes.CDLL] = None
+_library_error: Optional[str] = None
+_library_lock = threading.Lock()
+_library_loaded = False
+
+
+def _bind(library: ctypes.CDLL) -> ctypes.CDLL:
+    library.isol8r_screen_abi.argtypes = []
+    library.isol8r_screen_abi.restype = ctypes.c_int
+    library.isol8r_screen_new.argtypes = [
+        ctypes.POINTER(ctypes.c_char_p),
+        ctypes.POINTER(ctypes.c_size_t),
+        ctypes.c_size_t,
+        ctypes.c_uint,
+    ]
+    library.isol8r_screen_new.restype = ctypes.c_void_p
+    library.isol8r_screen_run.argtypes = [
+        ctypes.c_void_p,
+        ctypes.c_char_p,
+        ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_uint8),
+    ]
+    library.isol8r_screen_run.restype = ctypes.c_size_t
+    library.isol8r_screen_free.argtypes = [ctypes.c_void_p]
+    library.isol8r_screen_free.restype = None
+    library.isol8r_scan_active.argtypes = []
+    library.isol8r_scan_active.restype = ctypes.c_int
+    library.isol8r_scan_isa_name.argtypes = [ctypes.c_int]
+    library.isol8r_scan_isa_name.restype = ctypes.c_char_p
+    return library
+
+
+def load_library() -> Optional[ctypes.CDLL]:
+    """Load and bind the library once; ``None`` if it is missing or mismatched."""
+    global _library, _library_error, _library_loaded
+    with _library_lock:
+        if _library_loaded:
+            return _library
+        _library_loaded = True
+        path = os.environ.get(LIBRARY_ENV) or str(DEFAULT_LIBRARY_PATH)
+        try:
+            library = _bind(ctypes.CDLL(path))
+        except (OSError, AttributeError) as exc:
+            _library_error = f"{path}: {exc}"
+            return None
+        abi = library.isol8r_screen_abi()
+        if abi != SCREEN_ABI:
+            _library_error = f"{path}: ABI {abi}, expected {SCREEN_ABI}"
+            return None
+        _library = library
+        return library
+
+
+def available() -> bool:
+    return load_library() is not None
+
+
+def load_error() -> Optional[str]:
+    """Why the library did not load, if it did not."""
+    load_library()
+    return _library_error
+
+
+def active_kernel() -> Optional[str]:
+    """The byte-scan kernel the library picked (``scalar``, ``sse2``, ``avx2``)."""
+    library = load_library()
+    if library is None:
+        return None
+    return library.isol8r_scan_isa_name(library.isol8r_scan_active()).decode()
+
+
+def _encode(text: str) -> bytes:
+    # UTF-8 keeps substring relations intact: ASCII bytes never occur inside
+    # a multi-byte sequence, so byte hits are exactly str hits.
+    return text.encode("utf-8", "surrogatepass")
+
+
+class KeywordScreen:
+    """
+    One compiled keyword set. Scanning only reads the automaton, so a
+    screen is safe to share between threads; ctypes drops the GIL for the
+    duration of each call.
+    """
+
+    def __init__(self, keywords: Sequence[str], *, nocase: bool = False) -> None:
+        library = load_library()
+        if library is None:
+            raise RuntimeError(f"libisol8r_scan unavailable: {_library_error}")
+        encoded = [_encode(keyword) for keyword in keywords]
+        if not encoded or any(not 0 < len(item) <= MAX_KEYWORD for item in encoded):
+            raise ValueError(f"keywords must be 1..{MAX_KEYWORD} bytes each, and at least one is needed")
+
+        self.keywords: Tuple[str, ...] = tuple(keywords)
+        self._library = library
+        count = len(encoded)
+        pointers = (ctypes.c_char_p * count)(*encoded)
+        lengths = (ctypes.c_size_t * count)(*(len(item) for item in encoded))
+        handle = library.isol8r_screen_new(pointers, lengths, count, MATCH_NOCASE if nocase else 0)
+        if not handle:
+            raise ValueError("libisol8r_scan refused the keyword set")
+        self._handle = handle
+
+    def hit_indices(self, text: str) -> Tuple[int, ...]:
+        """Indices of the keywords occurring anywhere in ``text``, ascending."""
+        data = _encode(text)
+        hits = (ctypes.c_uint8 * len(self.keywords))()
+        if not self._library.isol8r_screen_run(self._handle, data, len(data), hits):
+            return ()
+        # Walking a ctypes array element by element is slow; a bytes copy is not.
+        return tuple(index for index, hit in enumerate(bytes(hits)) if hit)
+
+    def scan(self, text: str) -> Tuple[str, ...]:
+        """Keywords occurring anywhere in ``text``, in keyword order."""
+        return tuple(self.keywords[index] for index in self.hit_indices(text))
+
+    def close(self) -> None:
+        handle, self._handle = getattr(self, "_handle", None), None
+        if handle:
+            self._library.isol8r_screen_free(handle)
+
+    def __del__(self) -> None:
+        self.close()
@@ -0,0 +1,169 @@
+"""
+Reader for the shared stats pages the sandbox binaries keep (``ISOL8R_STATS_DIR``).
+
+``src/core/libisol8r/isol8r_stats.c`` gives each binary one small file,
+``<dir>/<program>.stats``, that every process running it maps and bumps
+with atomic increments: request and byte counts, hits per keyword or
+detector, budget and error counts, and a log2 latency histogram per stage.
+Counters only grow and the page is independent of ``bait.log``, so the
+numbers survive log rotation and cleanup. Reading is a plain copy of the
+page; a counter may be a few increments ahead of its neighbours, never torn.
+
+Usage::
+
+    python -m src.utils.isol8r_stats [DIR] [--program NAME] [--buckets]
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import struct
+import sys
+from pathlib import Path
+from typing import Dict, List, Optional
+
+STATS_MAGIC = b"I8RSTAT1"
+STATS_VERSION = 1
+DEFAULT_STATS_DIR = Path("/var/run/isol8r")
+
+# Mirrors isol8r_stats.h: native byte order, no padding.
+BUCKETS = 40
+PATTERNS = 32
+LABEL_MAX = 32
+COUNTER_SLOTS = 16
+COUNTERS = (
+    "requests", "bytes", "flagged", "rejected", "timeouts", "output_capped", "signaled", "errors", "cache_hits",
+)
+STAGES = ("read", "inspect", "log", "execute")
+
+_HEADER = struct.Struct("=8sIIQII24sQ")
+_COUNTERS = struct.Struct(f"={COUNTER_SLOTS}Q")
+_HITS = struct.Struct(f"={PATTERNS}Q")
+_LATENCY = struct.Struct(f"=QQ{BUCKETS}Q")
+_LABELS = struct.Struct(f"={PATTERNS * LABEL_MAX}s")
+PAGE_SIZE = _HEADER.size + _COUNTERS.size + _HITS.size + len(STAGES) * _LATENCY.size + _LABELS.size
+
+
+class StatsFormatError(Exception):
+    """Raised when a file is not a stats page this reader understands."""
+
+
+def bucket_upper_ns(bucket: int) -> int:
+    """Exclusive upper bound of a histogram bucket; the last one is open-ended."""
+    return 1 if bucket == 0 else 1 << bucket
+
+
+def _percentile(buckets: List[int], count: int, fraction: float) -> Optional[int]:
+    # Reported as the upper bound of the bucket the sample falls in, so
+    # every figure is an over-estimate by at most a factor of two.
+    if count == 0:
+        return None
+    rank = max(1, int(count * fraction + 0.999999))
+    seen = 0
+    for index, samples in enumerate(buckets):
+        seen += samples
+        if seen >= rank:
+            return bucket_upper_ns(index)
+    return bucket_upper_ns(len(buckets) - 1)
+
+
+def parse_page(raw: bytes, *, with_buckets: bool = False) -> Dict[str, object]:
+    """Decodes one page into plain, JSON-ready values."""
+    if len(raw) < PAGE_SIZE:
+        raise StatsFormatError(f"page is {len(raw)} bytes, expected {PAGE_SIZE}")
+    magic, version, size, created_ns, pattern_count, _reserved, program, _pad = _HEADER.unpack_from(raw, 0)
+    if magic != STATS_MAGIC or version != STATS_VERSION or size != PAGE_SIZE:
+        raise StatsFormatError(f"not a version {STATS_VERSION} stats page")
+
+    offset = _HEADER.size
+    counters = _COUNTERS.unpack_from(raw, offset)
+    offset += _COUNTERS.size
+    hits = _HITS.unpack_from(raw, offset)
+    offset += _HITS.size
+    latencies = []
+    for _stage in STAGES:
+        latencies.append(_LATENCY.unpack_from(raw, offset))
+        offset += _LATENCY.size
+    (labels_raw,) = _LABELS.unpack_from(raw, offset)
+
+    labels = []
+    for index in range(min(pattern_count, PATTERNS)):
+        label = labels_raw[index * LABEL_MAX:(index + 1) * LABEL_MAX].rstrip(b"\0")
+        labels.append(label.decode("utf-8", errors="replace") or f"#{index}")
+
+    stages: Dict[str, Dict[str, object]] = {}
+    for name, (count, total_ns, *buckets) in zip(STAGES, latencies):
+        if count == 0:
+            continue
+        entry: Dict[str, object] = {
+            "count": count,
+            "mean_ns": total_ns // count,
+            "p50_ns": _percentile(buckets, count, 0.50),
+            "p90_ns": _percentile(buckets, count, 0.90),
+            "p99_ns": _percentile(buckets, count, 0.99),
+        }
+        if with_buckets:
+            entry["buckets"] = {str(bucket_upper_ns(i)): n for i, n in enumerate(buckets) if n}
+        stages[name] = entry
+
+    return {
+        "program": program.rstrip(b"\0").decode("ascii", errors="replace"),
+        "created_ns": created_ns,
+        "counters": dict(zip(COUNTERS, counters)),
+        "hits": {label: hits[index] for index, label in enumerate(labels)},
+        "latency": stages,
+    }
+
+
+def default_stats_dir() -> Path:
+    configured = os.environ.get("ISOL8R_STATS_DIR")
+    return Path(configured) if configured else DEFAULT_STATS_DIR
+
+
+def read_page(path: Path, *, with_buckets: bool = False) -> Dict[str, object]:
+    with Path(path).open("rb") as handle:
+        raw = handle.read(PAGE_SIZE)
+    try:
+        return parse_page(raw, with_buckets=with_buckets)
+    except StatsFormatError as exc:
+        raise StatsFormatError(f"{path}: {exc}") from None
+
+
+def read_all(directory: Optional[Path] = None, *, with_buckets: bool = False) -> Dict[str, Dict[str, object]]:
+    """Every readable page in ``directory``, keyed by program; unreadable ones are skipped."""
+    pages: Dict[str, Dict[str, object]] = {}
+    try:
+        candidates = sorted(Path(directory or default_stats_dir()).glob("*.stats"))
+    except OSError:
+        return pages
+    for path in candidates:
+        try:
+            pages[path.stem] = read_page(path, with_buckets=with_buckets)
+        except (OSError, StatsFormatError):
+            continue
+    return pages
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    parser = argparse.ArgumentParser(description="Print the isol8r sandbox stats pages as JSON.")
+    parser.add_argument("directory", nargs="?", type=Path, default=None, help="stats directory (default: $ISOL8R_STATS_DIR)")
+    parser.add_argument("--program", help="only this binary's page, e.g. tiny_vmmgr")
+    parser.add_argument("--buckets", action="store_true", help="include the raw latency histograms")
+    args = parser.parse_args(argv)
+
+    directory = args.directory or default_stats_dir()
+    if args.program:
+        try:
+            pages: object = read_page(directory / f"{args.program}.stats", with_buckets=args.buckets)
+        except (OSError, StatsFormatError) as exc:
+            print(f"isol8r_stats: {exc}", file=sys.stderr)
+            return 1
+    else:
+        pages = read_all(directory, with_buckets=args.buckets)
+    print(json.dumps(pages, indent=2, sort_keys=True))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -6,14 +6,19 @@ the protective gear in one place.
 """
 from __future__ import annotations
 
+import contextlib
+import fcntl
 import logging
 import os
+import select
 import shlex
+import struct
 import subprocess
 import textwrap
+import threading
 import time
 from pathlib import Path
-from typing import Dict, Optional
+from typing import Dict, List, NamedTuple, Optional, Tuple
 
 from src.core.pyjail.pyjail import JailViolation, PythonJail
 
@@ -22,17 +27,273 @@ LOG_PATH = BASE_DIR.parent / "logs" / "bait.log"
 SANDBOX_BINARY = BASE_DIR / "core" / "jail_binaries" / "sandboxed_echo"
 _PYJAIL = PythonJail()
 
+#: Number of resident ``sandboxed_echo --serve`` workers; 0 spawns per request.
+ECHO_POOL_SIZE = int(os.environ.get("ISOL8R_ECHO_POOL_SIZE", "2"))
+
+# Verdict bytes carried in sandboxed_echo's framed replies.
+_VERDICT_BORING = 0
+_VERDICT_SUSPICIOUS = 1
+_VERDICT_EMPTY = 2
+_VERDICT_REJECTED = 3
+_VERDICT_NAMES = {
+    _VERDICT_BORING: "boring",
+    _VERDICT_SUSPICIOUS: "suspicious",
+    _VERDICT_EMPTY: "empty",
+    _VERDICT_REJECTED: "rejected",
+}
+
+# ``--record`` frame body after the length prefix; mirrors ECHO_RECORD_VERSION in sandboxed_echo.c.
+_RECORD_VERSION = 1
+_RECORD_HEADER = struct.Struct(">BBHIIQQQQ")
+
+#: Longest line the one-shot and framed modes look at; mirrors ECHO_LINE_MAX - 1.
+_ECHO_LINE_LIMIT = 511
+
+# Exit statuses of a spawned sandboxed_echo that ran out of budget (isol8r_budget.h).
+_BUDGET_EXITS = {121: "cpu", 122: "wall", 123: "output"}
+
+
+def _env_log_size(name: str, default: int) -> int:
+    value = os.environ.get(name, "")
+    scale = {"k": 1 << 10, "m": 1 << 20}.get(value[-1:].lower(), 1)
+    digits = value[:-1] if scale > 1 else value
+    return int(digits) * scale if digits.isdigit() else default
+
+
+def _env_log_keep(name: str, default: int) -> int:
+    value = os.environ.get(name, "")
+    return int(value) if value.isdigit() and 1 <= int(value) <= 99 else default
+
+
+#: bait.log rotation, shared with the C writers (isol8r_log.h): rotate at this
+#: many bytes (0 = never) and keep this many segments, bait.log.1 newest.
+LOG_ROTATE_BYTES = _env_log_size("ISOL8R_LOG_ROTATE_BYTES", 8 << 20)
+LOG_ROTATE_KEEP = _env_log_keep("ISOL8R_LOG_ROTATE_KEEP", 5)
+
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger("isol8r.sandbox")
 
 
 def _write_log(entry: str) -> None:
     LOG_PATH.parent.mkdir(parents=True, exist_ok=True)
-    with LOG_PATH.open("a", encoding="utf-8") as log_file:
-        log_file.write(entry + "\n")
+    with LOG_PATH.open("ab") as log_file:
+        log_file.write(entry.encode("utf-8") + b"\n")
+        size = log_file.tell()
+    if LOG_ROTATE_BYTES and size >= LOG_ROTATE_BYTES:
+        _rotate_log(LOG_PATH)
 
 
-def run_echo(payload: str, client_ip: str, timeout: float = 4.0) -> Dict[str, Optional[str]]:
+def _rotate_log(path: Path) -> None:
+    """
+    Same protocol as isol8r_log_rotate_fd(): lock the full file without
+    waiting, make sure it is still the one at ``path``, shift the segments
+    (a ``.gz`` left by the cron job moves along) and rename it to ``.1``.
+    Whoever loses the race simply finds a fresh file on its next write.
+    """
+    try:
+        handle = path.open("ab")
+    except OSError:
+        return
+    with handle:
+        try:
+            fcntl.flock(handle, fcntl.LOCK_EX | fcntl.LOCK_NB)
+        except OSError:
+            return
+        try:
+            held = os.fstat(handle.fileno())
+            current = os.stat(path)
+            if (held.st_dev, held.st_ino) != (current.st_dev, current.st_ino) or held.st_size < LOG_ROTATE_BYTES:
+                return
+            for suffix in ("", ".gz"):
+                with contextlib.suppress(OSError):
+                    os.unlink(f"{path}.{LOG_ROTATE_KEEP}{suffix}")
+            for index in range(LOG_ROTATE_KEEP - 1, 0, -1):
+                for suffix in ("", ".gz"):
+                    with contextlib.suppress(OSError):
+                        os.rename(f"{path}.{index}{suffix}", f"{path}.{index + 1}{suffix}")
+            os.rename(path, f"{path}.1")
+        except OSError as exc:
+            logger.warning("bait log rotation failed: %s", exc)
+        finally:
+            fcntl.flock(handle, fcntl.LOCK_UN)
+
+
+def _sandbox_env() -> Dict[str, str]:
+    env = os.environ.copy()
+    env["PATH"] = "/usr/bin:/bin"
+    env["ISOL8R_RUNTIME"] = "project-sandtrap"
+    return env
+
+
+class EchoRecord(NamedTuple):
+    """One decoded ``sandboxed_echo --record`` answer."""
+
+    verdict: int
+    keyword_ids: Tuple[int, ...]
+    keywords: Tuple[str, ...]
+    echoed: str
+    input_bytes: int
+    read_ns: int
+    inspect_ns: int
+    log_ns: int
+
+    @property
+    def verdict_name(self) -> str:
+        return _VERDICT_NAMES.get(self.verdict, f"unknown({self.verdict})")
+
+
+def _decode_record(body: bytes) -> EchoRecord:
+    """Decode a record body (length prefix stripped); ``ValueError`` if it is not one."""
+    if len(body) < _RECORD_HEADER.size:
+        raise ValueError("sandboxed_echo record truncated")
+    version, verdict, labels_len, hits, echo_len, input_len, read_ns, inspect_ns, log_ns = _RECORD_HEADER.unpack_from(body)
+    if version != _RECORD_VERSION:
+        raise ValueError(f"sandboxed_echo record version {version}, expected {_RECORD_VERSION}")
+    echo_end = _RECORD_HEADER.size + echo_len
+    if echo_end + labels_len != len(body):
+        raise ValueError("sandboxed_echo record length mismatch")
+    labels = body[echo_end:].decode("utf-8", "replace")
+    return EchoRecord(
+        verdict=verdict,
+        keyword_ids=tuple(bit for bit in range(32) if hits >> bit & 1),
+        keywords=tuple(labels.split(",")) if labels else (),
+        echoed=body[_RECORD_HEADER.size:echo_end].decode("utf-8", "replace"),
+        input_bytes=input_len,
+        read_ns=read_ns,
+        inspect_ns=inspect_ns,
+        log_ns=log_ns,
+    )
+
+
+def _record_streams(record: EchoRecord) -> Tuple[str, str, int]:
+    """The stdout, stderr and exit status the plain one-shot binary gives for the same input."""
+    if record.verdict == _VERDICT_EMPTY:
+        return "[sandboxed] no input received\n", "", 0
+    if record.verdict == _VERDICT_REJECTED:
+        return "", "[sandboxed_echo] request rejected as oversized\n", 1
+    if record.verdict == _VERDICT_SUSPICIOUS:
+        stderr = (
+            f"[TRAP] User tried command: {record.echoed}\n"
+            "[sandboxed_echo] suspicious content detected; event logged\n"
+        )
+        return f"{record.echoed}\n", stderr, 0
+    return f"{record.echoed}\n", "[sandboxed_echo] input classified as boring\n", 0
+
+
+class EchoWorkerTimeout(Exception):
+    """Raised when a resident echo worker sits on a request for too long."""
+
+
+class _EchoWorker:
+    """
+    One long-lived ``sandboxed_echo --serve --record`` process. Requests and
+    replies are length-prefixed frames, so the worker can be reused until it
+    dies of natural causes (or we put it down for dawdling).
+    """
+
+    def __init__(self) -> None:
+        self.proc = subprocess.Popen(
+            [str(SANDBOX_BINARY), "--serve", "--record"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            env=_sandbox_env(),
+            cwd=str(SANDBOX_BINARY.parent),
+            bufsize=0,
+        )
+
+    def alive(self) -> bool:
+        return self.proc.poll() is None
+
+    def kill(self) -> None:
+        try:
+            self.proc.kill()
+        except OSError:
+            pass
+        try:
+            self.proc.wait(timeout=1.0)
+        except subprocess.TimeoutExpired:
+            pass
+
+    def _read_exact(self, count: int, deadline: float) -> bytes:
+        fd = self.proc.stdout.fileno()
+        chunks: List[bytes] = []
+        remaining = count
+        while remaining:
+            wait = deadline - time.monotonic()
+            if wait <= 0 or not select.select([fd], [], [], wait)[0]:
+                raise EchoWorkerTimeout()
+            chunk = os.read(fd, remaining)
+            if not chunk:
+                raise EOFError("sandboxed_echo worker closed its pipe")
+            chunks.append(chunk)
+            remaining -= len(chunk)
+        return b"".join(chunks)
+
+    def request(self, payload: bytes, timeout: float) -> EchoRecord:
+        deadline = time.monotonic() + timeout
+        self.proc.stdin.write(len(payload).to_bytes(4, "big") + payload)
+        length = int.from_bytes(self._read_exact(4, deadline), "big")
+        return _decode_record(self._read_exact(length, deadline))
+
+
+class EchoWorkerPool:
+    """
+    A small stable of warm echo workers. Threads borrow a worker, use it for
+    a single request, and hand it back; broken or slow workers are culled and
+    quietly replaced on the next checkout.
+    """
+
+    def __init__(self, size: int) -> None:
+        self.size = size
+        self._idle: List[_EchoWorker] = []
+        self._lock = threading.Lock()
+        self._slots = threading.BoundedSemaphore(size)
+
+    def request(self, payload: bytes, timeout: float) -> EchoRecord:
+        if not self._slots.acquire(timeout=timeout):
+            raise EchoWorkerTimeout()
+        try:
+            with self._lock:
+                worker = self._idle.pop() if self._idle else None
+            if worker is None or not worker.alive():
+                worker = _EchoWorker()
+            try:
+                result = worker.request(payload, timeout)
+            except BaseException:
+                worker.kill()
+                raise
+            with self._lock:
+                self._idle.append(worker)
+            return result
+        finally:
+            self._slots.release()
+
+
+_ECHO_POOL: Optional[EchoWorkerPool] = EchoWorkerPool(ECHO_POOL_SIZE) if ECHO_POOL_SIZE > 0 else None
+
+
+#: What a run produced: stdout, stderr, exit status and, in record mode, the decoded record.
+_EchoOutcome = Tuple[str, str, Optional[int], Optional[EchoRecord]]
+
+
+def _run_echo_pooled(payload: str, timeout: float) -> _EchoOutcome:
+    """Push one request through the worker pool."""
+    try:
+        record = _ECHO_POOL.request(payload.encode("utf-8"), timeout)
+    except EchoWorkerTimeout:
+        _write_log("status=timeout")
+        return "", "\n[isol8r] execution timed out", -9, None
+    except Exception as exc:
+        _write_log(f"status=exception type={type(exc).__name__} detail={exc}")
+        return "", f"[isol8r] sandbox failure: {exc!r}", None, None
+
+    stdout, stderr, returncode = _record_streams(record)
+    _write_log(f"status=completed returncode={returncode}")
+    return stdout, stderr, returncode, record
+
+
+def run_echo(payload: str, client_ip: str, timeout: float = 4.0) -> Dict[str, object]:
     """
     Execute the sandboxed echo binary and return a structured response. The
     binary is intentionally boring, because bored binaries tend to be secure.
@@ -44,7 +305,8 @@ def run_echo(payload: str, client_ip: str, timeout: float = 4.0) -> Dict[str, Op
     client_ip: str
         IP address recorded for finger-pointing ceremonies.
     timeout: float
-        Seconds before we yank the ejection seat.
+        Seconds before we yank the ejection seat. A backstop: a spawned
+        binary gives up on its own once it exhausts its ISOL8R_ECHO_* budget.
     """
     start_time = time.monotonic()
     metadata_header = f"[{time.strftime('%Y-%m-%d %H:%M:%S')}] sandbox exec from={client_ip}"
@@ -64,11 +326,61 @@ def run_echo(payload: str, client_ip: str, timeout: float = 4.0) -> Dict[str, Op
             "duration": 0.0,
         }
 
-    env = os.environ.copy()
-    env["PATH"] = "/usr/bin:/bin"
-    env["ISOL8R_RUNTIME"] = "project-sandtrap"
+    if _needs_streaming(payload):
+        stdout, stderr, returncode, record = _run_echo_spawned(payload, timeout, stream=True)
+    elif _ECHO_POOL is not None:
+        stdout, stderr, returncode, record = _run_echo_pooled(payload, timeout)
+    else:
+        stdout, stderr, returncode, record = _run_echo_spawned(payload, timeout)
+
+    duration = time.monotonic() - start_time
+    _write_log(f"duration={duration:.3f}s")
+
+    result: Dict[str, object] = {
+        "stdout": stdout,
+        "stderr": stderr,
+        "returncode": returncode,
+        "duration": duration,
+    }
+    if record is not None:
+        # Structured fields straight from the binary; nothing to scrape.
+        _write_log(
+            f"verdict={record.verdict_name} keywords={','.join(record.keywords) or '-'} "
+            f"echo={record.echoed or '<empty>'}"
+        )
+        result.update(
+            verdict=record.verdict_name,
+            keywords=list(record.keywords),
+            keyword_ids=list(record.keyword_ids),
+            input_bytes=record.input_bytes,
+            timings_ns={"read": record.read_ns, "inspect": record.inspect_ns, "log": record.log_ns},
+        )
+        return result
+
+    if stdout:
+        normalized = textwrap.dedent(stdout.rstrip("\n"))
+        _write_log(f"stdout={normalized}")
+    if stderr:
+        normalized_err = textwrap.dedent(stderr.rstrip("\n"))
+        _write_log(f"stderr={normalized_err}")
+    return result
+
+
+def _needs_streaming(payload: str) -> bool:
+    """Payloads the line-based modes would truncate go through ``--stream``."""
+    if len(payload.encode("utf-8")) > _ECHO_LINE_LIMIT:
+        return True
+    return "\n" in payload.rstrip("\r\n")
 
-    cmd = [str(SANDBOX_BINARY)]
+
+def _run_echo_spawned(payload: str, timeout: float, stream: bool = False) -> _EchoOutcome:
+    """
+    The original fork/exec-per-request path, kept for pool-less deployments.
+    A line-sized payload runs with ``--record`` and comes back as one record;
+    with ``stream`` the binary scans and echoes the whole payload instead of
+    its first line, as plain text.
+    """
+    cmd = [str(SANDBOX_BINARY), "--stream" if stream else "--record"]
     logger.debug("Executing sandbox command: %s", " ".join(shlex.quote(x) for x in cmd))
 
     proc = subprocess.Popen(
@@ -76,44 +388,42 @@ def run_echo(payload: str, client_ip: str, timeout: float = 4.0) -> Dict[str, Op
         stdin=subprocess.PIPE,
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE,
-        env=env,
+        env=_sandbox_env(),
         cwd=str(SANDBOX_BINARY.parent),
-        text=True,
     )
 
+    record: Optional[EchoRecord] = None
     try:
-        stdout, stderr = proc.communicate(payload, timeout=timeout)
+        raw_stdout, raw_stderr = proc.communicate(payload.encode("utf-8"), timeout=timeout)
     except subprocess.TimeoutExpired:
         proc.kill()
-        stdout, stderr = proc.communicate()
-        stderr = (stderr or "") + "\n[isol8r] execution timed out"
+        raw_stdout, raw_stderr = proc.communicate()
+        raw_stderr = (raw_stderr or b"") + b"\n[isol8r] execution timed out"
         _write_log("status=timeout")
     except Exception as exc:
         proc.kill()
-        stdout, stderr = "", f"[isol8r] sandbox failure: {exc!r}"
+        raw_stdout, raw_stderr = b"", f"[isol8r] sandbox failure: {exc!r}".encode()
         _write_log(f"status=exception type={type(exc).__name__} detail={exc}")
     else:
-        _write_log(f"status=completed returncode={proc.returncode}")
-
-    duration = time.monotonic() - start_time
-    _write_log(f"duration={duration:.3f}s")
+        if proc.returncode in _BUDGET_EXITS:
+            _write_log(f"status=budget_exhausted budget={_BUDGET_EXITS[proc.returncode]}")
+        else:
+            _write_log(f"status=completed returncode={proc.returncode}")
+        if not stream and proc.returncode == 0:
+            try:
+                record = _decode_record(raw_stdout[4:])
+            except ValueError as exc:
+                _write_log(f"status=bad_record detail={exc}")
 
-    if stdout:
-        normalized = textwrap.dedent(stdout.rstrip("\n"))
-        _write_log(f"stdout={normalized}")
-    if stderr:
-        normalized_err = textwrap.dedent(stderr.rstrip("\n"))
-        _write_log(f"stderr={normalized_err}")
-
-    return {
-        "stdout": stdout,
-        "stderr": stderr,
-        "returncode": proc.returncode,
-        "duration": duration,
-    }
+    if record is not None:
+        stdout, stderr, _ = _record_streams(record)
+        return stdout, stderr, proc.returncode, record
+    stdout = raw_stdout.decode("utf-8", "replace") if raw_stdout and stream else ""
+    stderr = (raw_stderr or b"").decode("utf-8", "replace")
+    return stdout, stderr, proc.returncode, None
 
 
-def format_result(result: Dict[str, Optional[str]]) -> str:
+def format_result(result: Dict[str, object]) -> str:
     """
     Produce a friendly block of text summarising the sandbox run. The front-end
     expects something human-readable, seeing as the humans keep reading it.
@@ -124,6 +434,10 @@ def format_result(result: Dict[str, Optional[str]]) -> str:
         f"Return code : {result.get('returncode')}",
         f"Duration    : {result.get('duration', 0.0):.3f} seconds",
     ]
+    verdict = result.get("verdict")
+    if verdict is not None:
+        keywords = result.get("keywords") or []
+        lines.append(f"Verdict     : {verdict}" + (f" ({', '.join(keywords)})" if keywords else ""))
     stdout = result.get("stdout")
     stderr = result.get("stderr")
     if stdout: